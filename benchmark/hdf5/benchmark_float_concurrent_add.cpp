@@ -0,0 +1,176 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "benchmark_knowhere.h"
+#include "knowhere/comp/index_param.h"
+#include "knowhere/comp/knowhere_config.h"
+#include "knowhere/dataset.h"
+#include "knowhere/index/index_factory.h"
+
+// Measures the single query search latency of the growing (CC) IVF indexes while a writer keeps adding rows,
+// against the latency of the same index when no writer is running.
+class Benchmark_float_concurrent_add : public Benchmark_knowhere, public ::testing::Test {
+ public:
+    void
+    test_concurrent_add(const knowhere::Json& cfg) {
+        auto conf = cfg;
+        auto nlist = conf[knowhere::indexparam::NLIST].get<int32_t>();
+        auto nprobe = conf[knowhere::indexparam::NPROBE].get<int32_t>();
+        conf[knowhere::meta::TOPK] = topk_;
+
+        const int32_t nb_build = nb_ / 2;
+        auto version = knowhere::Version::GetCurrentVersion().VersionNumber();
+
+        for (auto thread_num : THREAD_NUMs_) {
+            auto index = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(index_type_, version).value();
+            printf("\n[%0.3f s] %s | %s | nlist=%d, nprobe=%d, k=%d, building on %d vectors\n", get_time_diff(),
+                   ann_test_name_.c_str(), index_type_.c_str(), nlist, nprobe, topk_, nb_build);
+            ASSERT_EQ(index.Build(knowhere::GenDataSet(nb_build, dim_, xb_), conf), knowhere::Status::success);
+            printf("================================================================================\n");
+
+            auto idle = search_latency(index, conf, thread_num, nullptr);
+            printf("  thread_num = %2d, idle:       p50 = %8.3fms, p99 = %8.3fms, VPS = %.3f\n", thread_num,
+                   idle.p50, idle.p99, idle.vps);
+
+            // the writer appends the rest of the base vectors in batches until the searchers are done
+            std::atomic<bool> stop{false};
+            std::atomic<int64_t> added{0};
+            std::thread writer([&]() {
+                int32_t offset = nb_build;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    if (offset >= nb_) {
+                        offset = nb_build;
+                    }
+                    auto rows = std::min(ADD_BATCH_SIZE_, nb_ - offset);
+                    auto ds = knowhere::GenDataSet(rows, dim_, (const float*)xb_ + (int64_t)offset * dim_);
+                    index.Add(ds, conf, false);
+                    offset += rows;
+                    added.fetch_add(rows, std::memory_order_relaxed);
+                }
+            });
+            auto busy = search_latency(index, conf, thread_num, &stop);
+            writer.join();
+            printf("  thread_num = %2d, under add:  p50 = %8.3fms, p99 = %8.3fms, VPS = %.3f, add VPS = %.3f\n",
+                   thread_num, busy.p50, busy.p99, busy.vps, added.load() / busy.elapse);
+            printf("================================================================================\n");
+            std::fflush(stdout);
+        }
+        printf("[%.3f s] Test '%s/%s' done\n\n", get_time_diff(), ann_test_name_.c_str(), index_type_.c_str());
+    }
+
+ private:
+    struct LatencyStat {
+        double p50;
+        double p99;
+        double vps;
+        double elapse;
+    };
+
+    // issues nq_ single query searches from worker_num threads, sets stop once all of them are done
+    LatencyStat
+    search_latency(knowhere::Index<knowhere::IndexNode>& index, const knowhere::Json& conf, int32_t worker_num,
+                   std::atomic<bool>* stop) {
+        std::vector<double> latencies(nq_);
+        auto worker = [&](int32_t idx_start, int32_t num) {
+            num = std::min(num, nq_ - idx_start);
+            for (int32_t i = 0; i < num; i++) {
+                auto ds_ptr = knowhere::GenDataSet(1, dim_, (const float*)xq_ + (idx_start + i) * dim_);
+                auto start = std::chrono::steady_clock::now();
+                index.Search(ds_ptr, conf, nullptr);
+                std::chrono::duration<double, std::milli> span = std::chrono::steady_clock::now() - start;
+                latencies[idx_start + i] = span.count();
+            }
+        };
+
+        double t_start = elapsed();
+        std::vector<std::thread> thread_vector(worker_num);
+        int32_t req_num = (nq_ + worker_num - 1) / worker_num;
+        for (int32_t i = 0; i < worker_num; i++) {
+            thread_vector[i] = std::thread(worker, std::min(req_num * i, nq_), req_num);
+        }
+        for (int32_t i = 0; i < worker_num; i++) {
+            thread_vector[i].join();
+        }
+        double t_span = elapsed() - t_start;
+        if (stop != nullptr) {
+            stop->store(true);
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        return {latencies[nq_ / 2], latencies[std::min<int32_t>(nq_ - 1, nq_ * 99 / 100)], nq_ / t_span, t_span};
+    }
+
+ protected:
+    void
+    SetUp() override {
+        T0_ = elapsed();
+        set_ann_test_name("sift-128-euclidean");
+        parse_ann_test_name();
+        load_hdf5_data<knowhere::fp32>();
+
+        cfg_[knowhere::meta::METRIC_TYPE] = metric_type_;
+        cfg_[knowhere::meta::NUM_BUILD_THREAD] = 1;
+        knowhere::KnowhereConfig::SetBuildThreadPoolSize(default_build_thread_num);
+        knowhere::KnowhereConfig::SetSearchThreadPoolSize(default_search_thread_num);
+    }
+
+    void
+    TearDown() override {
+        free_all();
+    }
+
+ protected:
+    const int32_t topk_ = 100;
+    const int32_t ADD_BATCH_SIZE_ = 1000;
+    const std::vector<int32_t> THREAD_NUMs_ = {1, 4, 8};
+
+    // IVF index params
+    const std::vector<int32_t> NLISTs_ = {1024};
+    const std::vector<int32_t> NPROBEs_ = {16, 64};
+    const int32_t SSIZE_ = 48;
+};
+
+TEST_F(Benchmark_float_concurrent_add, TEST_IVF_FLAT_CC) {
+    index_type_ = knowhere::IndexEnum::INDEX_FAISS_IVFFLAT_CC;
+
+    knowhere::Json conf = cfg_;
+    conf[knowhere::indexparam::SSIZE] = SSIZE_;
+    for (auto nlist : NLISTs_) {
+        conf[knowhere::indexparam::NLIST] = nlist;
+        for (auto nprobe : NPROBEs_) {
+            conf[knowhere::indexparam::NPROBE] = nprobe;
+            test_concurrent_add(conf);
+        }
+    }
+}
+
+TEST_F(Benchmark_float_concurrent_add, TEST_IVF_SQ_CC) {
+    index_type_ = knowhere::IndexEnum::INDEX_FAISS_IVFSQ_CC;
+
+    knowhere::Json conf = cfg_;
+    conf[knowhere::indexparam::SSIZE] = SSIZE_;
+    conf[knowhere::indexparam::CODE_SIZE] = 8;
+    for (auto nlist : NLISTs_) {
+        conf[knowhere::indexparam::NLIST] = nlist;
+        for (auto nprobe : NPROBEs_) {
+            conf[knowhere::indexparam::NPROBE] = nprobe;
+            test_concurrent_add(conf);
+        }
+    }
+}
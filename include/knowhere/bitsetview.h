@@ -93,6 +93,11 @@ class BitsetView {
         id_offset_ = id_offset;
     }
 
+    size_t
+    id_offset() const {
+        return id_offset_;
+    }
+
     // if the test succeeds, then the index should be skipped during search; otherwise, it should be included.
     bool
     test(int64_t index) const {
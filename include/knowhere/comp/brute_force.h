@@ -23,6 +23,8 @@
 
 namespace knowhere {
 
+class SearchCanceller;
+
 class BruteForce {
  public:
     template <typename DataType>
@@ -54,6 +56,13 @@ class BruteForce {
     AnnIterator(const DataSetPtr base_dataset, const DataSetPtr query_dataset, const Json& config,
                 const BitsetView& bitset, bool use_knowhere_search_pool = true,
                 milvus::OpContext* op_context = nullptr);
+
+ private:
+    // the search loops stop early once the canceller says so, and leave the unfinished queries empty
+    template <typename DataType>
+    static Status
+    SearchWithBufImpl(const DataSetPtr base_dataset, const DataSetPtr query_dataset, int64_t* ids, float* dis,
+                      const Json& config, const BitsetView& bitset, SearchCanceller& canceller);
 };
 
 }  // namespace knowhere
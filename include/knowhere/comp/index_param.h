@@ -112,6 +112,10 @@ constexpr const char* BM25_B = "bm25_b";
 // average document length
 constexpr const char* BM25_AVGDL = "bm25_avgdl";
 constexpr const char* DIM_MAX_SCORE_RATIO = "dim_max_score_ratio";
+constexpr const char* SEARCH_TIMEOUT_MS = "search_timeout_ms";
+constexpr const char* ALLOW_PARTIAL_RESULT = "allow_partial_result";
+// set on a result dataset when the search was stopped before completion
+constexpr const char* PARTIAL_RESULT = "partial_result";
 
 // emb list meta
 constexpr const char* EMB_LIST_META = "EMB_LIST_META";
@@ -129,11 +133,16 @@ constexpr const char* SSIZE = "ssize";
 constexpr const char* REORDER_K = "reorder_k";
 constexpr const char* WITH_RAW_DATA = "with_raw_data";
 constexpr const char* ENSURE_TOPK_FULL = "ensure_topk_full";
+constexpr const char* ADAPTIVE_NPROBE = "adaptive_nprobe";
 constexpr const char* CODE_SIZE = "code_size";
 constexpr const char* RAW_DATA_STORE_PREFIX = "raw_data_store_prefix";
 constexpr const char* SUB_DIM = "sub_dim";
 constexpr const char* REFINE_TYPE = "refine_type";
 constexpr const char* REFINE_WITH_QUANT = "refine_with_quant";
+constexpr const char* COARSE_QUANTIZER = "coarse_quantizer";
+constexpr const char* COARSE_HNSW_M = "coarse_hnsw_m";
+constexpr const char* COARSE_HNSW_EF = "coarse_hnsw_ef";
+constexpr const char* COARSE_REFINE_K = "coarse_refine_k";
 
 // cuVS Params
 constexpr const char* REFINE_RATIO = "refine_ratio";
@@ -205,6 +214,7 @@ constexpr const char* DROP_RATIO_SEARCH = "drop_ratio_search";
 
 // RaBitQ Params
 constexpr const char* RABITQ_QUERY_BITS = "rbq_bits_query";
+constexpr const char* RABITQ_REFINE_BY_LOWER_BOUND = "rbq_refine_by_lower_bound";
 
 // minhash meta Params
 constexpr const char* MH_ELEMENT_BIT_WIDTH = "mh_element_bit_width";
@@ -220,6 +230,12 @@ constexpr const char* MH_LSH_BATCH_SEARCH = "mh_lsh_batch_search";
 
 // Emb List Index Params
 constexpr const char* RETRIEVAL_ANN_RATIO = "retrieval_ann_ratio";
+
+// KMEANS Cluster Params
+constexpr const char* NUM_CLUSTERS = "num_clusters";
+constexpr const char* KMEANS_INIT = "kmeans_init";
+constexpr const char* KMEANS_MODE = "kmeans_mode";
+constexpr const char* KMEANS_BATCH_SIZE = "kmeans_batch_size";
 }  // namespace indexparam
 
 using MetricType = std::string;
@@ -78,13 +78,25 @@ class KnowhereConfig {
      * set Clustering type
      */
     enum ClusteringType {
-        K_MEANS = 0,        // k-means (default)
-        K_MEANS_PLUS_PLUS,  // k-means++
+        K_MEANS = 0,           // k-means (default)
+        K_MEANS_PLUS_PLUS,     // k-means++
+        K_MEANS_HIERARCHICAL,  // two-level k-means, for 1024 centroids (nlist) or more
     };
 
     static void
     SetClusteringType(const ClusteringType clustering_type);
 
+    /**
+     * set the maximum cluster size of K_MEANS_HIERARCHICAL, as a multiple of the average cluster size
+     *   Clusters larger than that have their farthest points moved to the next nearest centroids during training,
+     *   which bounds the IVF list sizes and so the cost of a probe. 0 (default) disables balancing.
+     */
+    static void
+    SetClusteringSizeSpread(const double size_spread);
+
+    static double
+    GetClusteringSizeSpread();
+
     /**
      * The numebr of maximum parallel disk reads per thread.
      * On Linux, the default limit of `aio-max-nr` is 65536, so the product of `num_threads` and `max_events` (default
@@ -0,0 +1,118 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "common/OpContext.h"
+#include "knowhere/config.h"
+#include "knowhere/dataset.h"
+#include "knowhere/expected.h"
+
+namespace knowhere {
+
+// Cooperative cancellation of a search request.
+//
+// The search loops poll IsStopped() between queries, list scans, graph hops or beam rounds. It turns true once the
+// caller cancels the request through milvus::OpContext or the search_timeout_ms budget runs out, and stays true from
+// then on. The loops keep what they found so far, Finish() then decides whether that is returned or reported as an
+// error, depending on allow_partial_result.
+class SearchCanceller {
+    using steady_clock = std::chrono::steady_clock;
+
+ public:
+    SearchCanceller(const milvus::OpContext* op_context, const BaseConfig& cfg);
+
+    SearchCanceller(const SearchCanceller&) = delete;
+    SearchCanceller&
+    operator=(const SearchCanceller&) = delete;
+
+    // a canceller shared by the iterators of one request, Finish() is called once the last of them is released
+    static std::shared_ptr<SearchCanceller>
+    MakeShared(const milvus::OpContext* op_context, const BaseConfig& cfg);
+
+    bool
+    IsStopped() const {
+        if (stopped_.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        if (!token_.has_value() && !has_deadline_) {
+            return false;
+        }
+        return CheckNow();
+    }
+
+    // whether a stop has been seen by the search loops so far, without polling again
+    bool
+    WasStopped() const {
+        return stopped_.load(std::memory_order_relaxed);
+    }
+
+    // a check for the loops below the knowhere layer, it must not outlive this object
+    std::function<bool()>
+    StopCheck() const {
+        if (!token_.has_value() && !has_deadline_) {
+            return nullptr;
+        }
+        return [this]() { return IsStopped(); };
+    }
+
+    // same as above, also sets *stopped once the check returned true, so that a loop polling it can tell whether it
+    // was cut short. `stopped` must outlive the check as well.
+    std::function<bool()>
+    StopCheck(bool* stopped) const {
+        if (!token_.has_value() && !has_deadline_) {
+            return nullptr;
+        }
+        return [this, stopped]() { return *stopped = IsStopped(); };
+    }
+
+    // records queries that were skipped or cut short
+    void
+    AbortQueries(int64_t n = 1) const {
+        aborted_queries_.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // marks the result as partial if the search was stopped, or turns it into an error if partial results are not
+    // allowed. Must be called once all the search loops are done.
+    expected<DataSetPtr>
+    Finish(DataSetPtr result) const;
+
+    // same as above, for the search paths that write into caller-provided buffers
+    Status
+    Finish() const;
+
+    // the slots of a query that was not searched, laid out like an unfilled faiss result heap
+    static void
+    FillEmptyResult(int64_t* ids, float* distances, int64_t k, bool larger_is_closer);
+
+ private:
+    bool
+    CheckNow() const;
+
+    // a copy of the request's token, the iterators may outlive the OpContext
+    std::optional<decltype(milvus::OpContext::cancellation_token)> token_;
+    bool has_deadline_ = false;
+    steady_clock::time_point deadline_;
+    bool allow_partial_result_ = false;
+
+    mutable std::atomic<bool> stopped_{false};
+    mutable std::atomic<bool> cancelled_{false};
+    mutable std::atomic<int64_t> aborted_queries_{0};
+};
+
+}  // namespace knowhere
@@ -611,6 +611,15 @@ class BaseConfig : public Config {
     CFG_MATERIALIZED_VIEW_SEARCH_INFO_TYPE materialized_view_search_info;
     CFG_STRING opt_fields_path;
     CFG_FLOAT iterator_refine_ratio;
+    /**
+     * search_timeout_ms and allow_partial_result bound the time spent in a search request.
+     * - once the timeout expires or the request is cancelled through milvus::OpContext, the search loops stop at
+     *   their next check.
+     * - with allow_partial_result, the results found so far are returned and the result dataset is marked with
+     *   meta::PARTIAL_RESULT, otherwise the request fails with Status::timeout or Status::cancelled.
+     */
+    CFG_INT search_timeout_ms;
+    CFG_BOOL allow_partial_result;
     /**
      * k1, b, avgdl are used by BM25 metric only.
      * - k1, b, avgdl must be provided at load time.
@@ -655,7 +664,8 @@ class BaseConfig : public Config {
             .for_static()
             .for_iterator()
             .for_deserialize()
-            .for_deserialize_from_file();
+            .for_deserialize_from_file()
+            .for_cluster();
         KNOWHERE_CONFIG_DECLARE_FIELD(retrieve_friendly)
             .description("whether the index holds raw data for fast retrieval")
             .set_default(false)
@@ -683,7 +693,8 @@ class BaseConfig : public Config {
             .description("index thread limit for build.")
             .allow_empty_without_default()
             .set_range(1, std::thread::hardware_concurrency())
-            .for_train();
+            .for_train()
+            .for_cluster();
         KNOWHERE_CONFIG_DECLARE_FIELD(radius)
             .set_default(0.0)
             .description("radius for range search")
@@ -757,6 +768,17 @@ class BaseConfig : public Config {
             .description("whether the result of iterator monotonically ordered")
             .for_iterator()
             .for_range_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(search_timeout_ms)
+            .allow_empty_without_default()
+            .set_range(0, std::numeric_limits<CFG_INT::value_type>::max())
+            .description("time budget of a search request in milliseconds")
+            .for_search()
+            .for_range_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(allow_partial_result)
+            .set_default(false)
+            .description("whether a timed out or cancelled search returns the results found so far")
+            .for_search()
+            .for_range_search();
         KNOWHERE_CONFIG_DECLARE_FIELD(bm25_k1)
             .allow_empty_without_default()
             .set_range(0.0, 3.0)
@@ -52,6 +52,7 @@ enum class Status {
     brute_force_inner_error = 30,
     emb_list_inner_error = 31,
     aisaq_error = 32,
+    cancelled = 33,
 };
 
 inline std::string
@@ -97,6 +98,8 @@ Status2String(knowhere::Status status) {
             return "the current index is not supported on the current CPU model";
         case knowhere::Status::cardinal_inner_error:
             return "cardinal inner error";
+        case knowhere::Status::timeout:
+            return "timeout";
         case knowhere::Status::invalid_cluster_error:
             return "invalid cluster type";
         case knowhere::Status::cluster_inner_error:
@@ -113,6 +116,8 @@ Status2String(knowhere::Status status) {
             return "emb_list inner error";
         case knowhere::Status::aisaq_error:
             return "internal AiSAQ error";
+        case knowhere::Status::cancelled:
+            return "cancelled";
         default:
             return "unexpected status";
     }
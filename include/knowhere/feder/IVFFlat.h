@@ -13,6 +13,7 @@
 
 #include <memory>
 #include <nlohmann/json.hpp>
+#include <string>
 #include <tuple>
 #include <unordered_set>
 #include <utility>
@@ -45,7 +46,8 @@ class IVFFlatMeta {
  public:
     IVFFlatMeta() = default;
 
-    explicit IVFFlatMeta(int64_t nlist, int64_t dim, int64_t ntotal) : nlist_(nlist), dim_(dim), ntotal_(ntotal) {
+    explicit IVFFlatMeta(int64_t nlist, int64_t dim, int64_t ntotal, std::string quantizer_type = "flat")
+        : nlist_(nlist), dim_(dim), ntotal_(ntotal), quantizer_type_(std::move(quantizer_type)) {
     }
 
     int64_t
@@ -63,6 +65,11 @@ class IVFFlatMeta {
         return ntotal_;
     }
 
+    const std::string&
+    GetQuantizerType() const {
+        return quantizer_type_;
+    }
+
     const std::vector<ClusterInfo>&
     GetClusters() const {
         return clusters_;
@@ -75,12 +82,14 @@ class IVFFlatMeta {
         clusters_.emplace_back(ClusterInfo(id, node_id_addr, node_num, centroid_addr, dim));
     }
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(IVFFlatMeta, nlist_, dim_, ntotal_, clusters_);
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(IVFFlatMeta, nlist_, dim_, ntotal_, quantizer_type_, clusters_);
 
  private:
     int64_t nlist_;
     int64_t dim_;
     int64_t ntotal_;
+    // the coarse quantizer over the centroids, flat, hnsw or sq8
+    std::string quantizer_type_;
     std::vector<ClusterInfo> clusters_;
 };
 
@@ -157,10 +157,23 @@ class Index {
     Status
     Add(const DataSetPtr dataset, const Json& json, bool use_knowhere_build_pool = true);
 
+    Status
+    DeleteByIds(const DataSetPtr dataset);
+
+    Status
+    Consolidate(bool use_knowhere_build_pool = true);
+
+    Status
+    Merge(const Index<T1>& other, const Json& json, bool use_knowhere_build_pool = true);
+
     expected<DataSetPtr>
     Search(const DataSetPtr dataset, const Json& json, const BitsetView& bitset,
            milvus::OpContext* op_context = nullptr) const;
 
+    expected<std::vector<DataSetPtr>>
+    MultiSearch(const DataSetPtr dataset, const Json& json, const std::vector<int64_t>& ks,
+                const std::vector<BitsetView>& bitsets, milvus::OpContext* op_context = nullptr) const;
+
     expected<std::vector<IndexNode::IteratorPtr>>
     AnnIterator(const DataSetPtr dataset, const Json& json, const BitsetView& bitset,
                 bool use_knowhere_search_pool = true, milvus::OpContext* op_context = nullptr) const;
@@ -184,6 +197,9 @@ class Index {
     Status
     Serialize(BinarySet& binset) const;
 
+    Status
+    SerializeToFile(const std::string& filename) const;
+
     Status
     Deserialize(const BinarySet& binset, const Json& json = {});
 
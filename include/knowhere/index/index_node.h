@@ -12,6 +12,7 @@
 #ifndef INDEX_NODE_H
 #define INDEX_NODE_H
 
+#include <fstream>
 #include <functional>
 #include <queue>
 #include <unordered_set>
@@ -21,6 +22,7 @@
 #include "common/OpContext.h"
 #include "knowhere/binaryset.h"
 #include "knowhere/bitsetview.h"
+#include "knowhere/comp/search_canceller.h"
 #include "knowhere/config.h"
 #include "knowhere/dataset.h"
 #include "knowhere/emb_list_utils.h"
@@ -125,6 +127,59 @@ class IndexNode : public Object {
     virtual Status
     Add(const DataSetPtr dataset, std::shared_ptr<Config> cfg, bool use_knowhere_build_pool = true) = 0;
 
+    /**
+     * @brief Deletes vectors from the index by marking them as tombstones.
+     *
+     * @param dataset Dataset containing the IDs of the vectors to delete.
+     * @return Status indicating success or failure of the deletion.
+     *
+     * @note
+     * 1. The other vectors keep their IDs. The deleted ones are never returned by the searches, but the graph indexes
+     * still route through them until @see Consolidate, so the search quality does not drop right after a delete.
+     * 2. Deleting an ID twice is a no-op, an ID out of range fails the whole call before anything is deleted.
+     * 3. This method is not thread safe with the search methods.
+     */
+    virtual Status
+    DeleteByIds(const DataSetPtr dataset) {
+        return Status::not_implemented;
+    }
+
+    /**
+     * @brief Removes the vectors deleted by @see DeleteByIds from the index structure.
+     *
+     * @param use_knowhere_build_pool
+     * @return Status indicating success or failure of the consolidation.
+     *
+     * @note
+     * 1. The graph indexes reconnect the neighbors of the deleted vectors to each other and release the storage only
+     * the graph used, so that the search cost and recall stay flat as deletes accumulate. Meant to be run between
+     * batches of searches, once a fair share of the vectors is deleted.
+     * 2. This method is not thread safe with the search methods.
+     */
+    virtual Status
+    Consolidate(bool use_knowhere_build_pool = true) {
+        return Status::not_implemented;
+    }
+
+    /**
+     * @brief Merges another index of the same type into this one.
+     *
+     * @param other Index to merge, it is left untouched.
+     * @param cfg Build configuration of this index.
+     * @param use_knowhere_build_pool
+     * @return Status indicating success or failure of the merge.
+     *
+     * @note
+     * 1. The vectors of other get the IDs that follow the ones of this index, in their order in other.
+     * 2. The graph indexes keep the links of both graphs and only search for the links between them, which is much
+     * cheaper than adding the vectors of other one by one.
+     * 3. This method is not thread safe with the other methods of both indexes.
+     */
+    virtual Status
+    Merge(const IndexNode& other, std::shared_ptr<Config> cfg, bool use_knowhere_build_pool = true) {
+        return Status::not_implemented;
+    }
+
     /**
      * @brief Performs a search operation on the index.
      *
@@ -157,6 +212,25 @@ class IndexNode : public Object {
                                          "BruteForceByIDs not supported for current index type");
     };
 
+    /**
+     * @brief Performs several independent searches that share one scan over the index.
+     *
+     * Row i of the dataset is searched with top-k `ks[i]` and filter `bitsets[i]`, so callers that serve many
+     * tenants with different filters over the same index only pay for reading the index data once.
+     *
+     * @param dataset Query vectors, one row per search.
+     * @param cfg Search configuration; its `k` is ignored in favour of `ks`.
+     * @param ks Top-k of each query, `ks.size()` equals the number of rows.
+     * @param bitsets Filter of each query, `bitsets.size()` equals the number of rows.
+     * @return An expected<> object containing one single-query result dataset per row, or an error.
+     */
+    virtual expected<std::vector<DataSetPtr>>
+    MultiSearch(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const std::vector<int64_t>& ks,
+                const std::vector<BitsetView>& bitsets, milvus::OpContext* op_context = nullptr) const {
+        return expected<std::vector<DataSetPtr>>::Err(Status::not_implemented,
+                                                      "MultiSearch not supported for current index type");
+    }
+
     // not thread safe.
     class iterator {
      public:
@@ -396,6 +470,40 @@ class IndexNode : public Object {
     virtual Status
     Serialize(BinarySet& binset) const = 0;
 
+    /**
+     * @brief Serializes the index into a file, laid out the way DeserializeFromFile reads it.
+     *
+     * @param filename Path to the file to write, it is truncated if it exists.
+     * @return Status indicating success or failure of the serialization.
+     *
+     * @note
+     * 1. The default goes through Serialize() and writes the binary out. The nodes that can stream into the file
+     * override it, so that the index is never held in memory a second time.
+     * 2. The emb_list meta is not part of the file, DeserializeFromFile reads it from emb_list_meta_file_path.
+     */
+    virtual Status
+    SerializeToFile(const std::string& filename) const {
+        BinarySet binset;
+        RETURN_IF_ERROR(Serialize(binset));
+        auto binary = binset.GetByName(Type());
+        if (binary == nullptr) {
+            LOG_KNOWHERE_WARNING_ << Type() << " does not serialize into a single file";
+            return Status::not_implemented;
+        }
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            LOG_KNOWHERE_WARNING_ << "failed to open " << filename << " for writing";
+            return Status::disk_file_error;
+        }
+        out.write(reinterpret_cast<const char*>(binary->data.get()), binary->size);
+        out.close();
+        if (out.fail()) {
+            LOG_KNOWHERE_WARNING_ << "failed to write " << filename;
+            return Status::disk_file_error;
+        }
+        return Status::success;
+    }
+
     /**
      * @brief Deserializes the index from a binary set.
      *
@@ -1096,7 +1204,19 @@ class IndexIterator : public IndexNode::iterator {
         initialized_ = true;
     }
 
+    // ends the iteration once the request that created the iterator is cancelled or runs out of time
+    void
+    set_canceller(std::shared_ptr<SearchCanceller> canceller) {
+        canceller_ = std::move(canceller);
+    }
+
  protected:
+    // a stop check for the graph traversals of next_batch(), nullptr if the request cannot be stopped
+    std::function<bool()>
+    stop_check() {
+        return canceller_ != nullptr ? canceller_->StopCheck(&traversal_stopped_) : nullptr;
+    }
+
     inline size_t
     min_refine_size() const {
         // TODO: maybe make this configurable
@@ -1141,10 +1261,25 @@ class IndexIterator : public IndexNode::iterator {
                 }
             }
         };
+        // a stopped request ends the iteration, the query is counted as aborted once
+        if (canceller_ != nullptr && !aborted_ && canceller_->IsStopped()) {
+            aborted_ = true;
+            canceller_->AbortQueries();
+        }
+        if (aborted_) {
+            return;
+        }
         next_batch(batch_handler);
+        if (traversal_stopped_) {
+            aborted_ = true;
+            canceller_->AbortQueries();
+        }
     }
 
     bool use_knowhere_search_pool_ = true;
+    std::shared_ptr<SearchCanceller> canceller_ = nullptr;
+    bool traversal_stopped_ = false;
+    bool aborted_ = false;
 };
 
 // An iterator implementation that accepts a function to get distances and ids list and returns them in order.
@@ -35,6 +35,24 @@ class IndexNodeDataMockWrapper : public IndexNode {
     Status
     Add(const DataSetPtr dataset, std::shared_ptr<Config> cfg, bool use_knowhere_build_pool) override;
 
+    Status
+    DeleteByIds(const DataSetPtr dataset) override {
+        return index_node_->DeleteByIds(dataset);
+    }
+
+    Status
+    Consolidate(bool use_knowhere_build_pool) override {
+        return index_node_->Consolidate(use_knowhere_build_pool);
+    }
+
+    Status
+    Merge(const IndexNode& other, std::shared_ptr<Config> cfg, bool use_knowhere_build_pool) override {
+        // other is wrapped the same way when it comes from the same factory entry
+        auto other_wrapper = dynamic_cast<const IndexNodeDataMockWrapper*>(&other);
+        return index_node_->Merge(other_wrapper != nullptr ? *other_wrapper->index_node_ : other, std::move(cfg),
+                                 use_knowhere_build_pool);
+    }
+
     expected<DataSetPtr>
     Search(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const BitsetView& bitset,
            milvus::OpContext* op_context) const override;
@@ -43,6 +61,10 @@ class IndexNodeDataMockWrapper : public IndexNode {
     RangeSearch(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const BitsetView& bitset,
                 milvus::OpContext* op_context) const override;
 
+    expected<std::vector<DataSetPtr>>
+    MultiSearch(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const std::vector<int64_t>& ks,
+                const std::vector<BitsetView>& bitsets, milvus::OpContext* op_context) const override;
+
     expected<std::vector<IteratorPtr>>
     AnnIterator(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const BitsetView& bitset,
                 bool use_knowhere_search_pool, milvus::OpContext* op_context) const override;
@@ -65,6 +87,11 @@ class IndexNodeDataMockWrapper : public IndexNode {
         return index_node_->Serialize(binset);
     }
 
+    Status
+    SerializeToFile(const std::string& filename) const override {
+        return index_node_->SerializeToFile(filename);
+    }
+
     Status
     Deserialize(const BinarySet& binset, std::shared_ptr<Config> cfg) override {
         return index_node_->Deserialize(binset, std::move(cfg));
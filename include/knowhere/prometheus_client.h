@@ -141,11 +141,19 @@ DECLARE_PROMETHEUS_HISTOGRAM(filter_mv_supplement_ep_bool_cnt, PROMETHEUS_LABEL_
 
 DECLARE_PROMETHEUS_HISTOGRAM(hnsw_bitset_ratio, PROMETHEUS_LABEL_KNOWHERE);
 DECLARE_PROMETHEUS_HISTOGRAM(hnsw_search_hops, PROMETHEUS_LABEL_KNOWHERE);
+DECLARE_PROMETHEUS_HISTOGRAM(hnsw_search_ndis, PROMETHEUS_LABEL_KNOWHERE);
+DECLARE_PROMETHEUS_HISTOGRAM(hnsw_bf_graph_cost_ratio, PROMETHEUS_LABEL_KNOWHERE);
 
 DECLARE_PROMETHEUS_HISTOGRAM(diskann_bitset_ratio, PROMETHEUS_LABEL_KNOWHERE);
 DECLARE_PROMETHEUS_HISTOGRAM(diskann_search_hops, PROMETHEUS_LABEL_KNOWHERE);
 DECLARE_PROMETHEUS_HISTOGRAM(diskann_range_search_iters, PROMETHEUS_LABEL_KNOWHERE);
 
+DECLARE_PROMETHEUS_COUNTER(search_cancelled_requests, PROMETHEUS_LABEL_KNOWHERE);
+DECLARE_PROMETHEUS_COUNTER(search_aborted_queries, PROMETHEUS_LABEL_KNOWHERE);
+
+DECLARE_PROMETHEUS_COUNTER(ivf_batch_assign_queries, PROMETHEUS_LABEL_KNOWHERE);
+DECLARE_PROMETHEUS_COUNTER(ivf_batch_assign_fallbacks, PROMETHEUS_LABEL_KNOWHERE);
+
 DECLARE_PROMETHEUS_HISTOGRAM_FAMILY(sparse_dataset_nnz_len, PROMETHEUS_LABEL_KNOWHERE);
 DECLARE_PROMETHEUS_HISTOGRAM_FAMILY(sparse_inverted_index_posting_list_len, PROMETHEUS_LABEL_KNOWHERE);
 DECLARE_PROMETHEUS_GAUGE_FAMILY(sparse_inverted_index_size, PROMETHEUS_LABEL_KNOWHERE);
@@ -0,0 +1,670 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "cluster/kmeans/kmeans_config.h"
+#include "faiss/IndexFlatElkan.h"
+#include "faiss/utils/distances.h"
+#include "knowhere/cluster/cluster_factory.h"
+#include "knowhere/cluster/cluster_node.h"
+#include "knowhere/comp/index_param.h"
+#include "knowhere/dataset.h"
+#include "knowhere/expected.h"
+#include "knowhere/log.h"
+#include "knowhere/thread_pool.h"
+#include "knowhere/utils.h"
+
+namespace knowhere {
+
+namespace {
+
+// A pass over the data converts and processes this many rows at a time. Besides the per-row assignments (and the
+// bounds of the lloyd mode), nothing proportional to the number of rows is held, so the tensor may be a mmapped file
+// larger than RAM.
+constexpr int64_t kBlockRows = 65536;
+// kmeans++ picks the initial centroids among this many sampled rows per cluster
+constexpr int64_t kInitSamplesPerCluster = 16;
+// relative perturbation applied when an empty cluster takes over half of the largest one
+constexpr float kSplitEps = 1.0f / 1024.0f;
+constexpr uint64_t kSeed = 1234;
+
+// m distinct row ids out of [0, n), sorted, using Floyd's algorithm
+std::vector<int64_t>
+SampleRows(const int64_t n, const int64_t m, std::mt19937_64& rng) {
+    std::vector<int64_t> ids;
+    if (m >= n) {
+        ids.resize(n);
+        std::iota(ids.begin(), ids.end(), 0);
+        return ids;
+    }
+    std::unordered_set<int64_t> picked;
+    picked.reserve(m);
+    for (int64_t j = n - m; j < n; j++) {
+        const int64_t t = std::uniform_int_distribution<int64_t>(0, j)(rng);
+        picked.insert(picked.count(t) ? j : t);
+    }
+    ids.assign(picked.begin(), picked.end());
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+// Reads rows of the tensor as float, normalized for COSINE. The returned pointer is valid until the next call.
+template <typename DataType>
+class RowReader {
+ public:
+    RowReader(const DataSet& dataset, const bool normalize)
+        : data_(reinterpret_cast<const DataType*>(dataset.GetTensor())),
+          dim_(dataset.GetDim()),
+          normalize_(normalize) {
+    }
+
+    // rows [begin, begin + n)
+    const float*
+    Read(const int64_t begin, const int64_t n) {
+        if constexpr (std::is_same_v<DataType, fp32>) {
+            if (!normalize_) {
+                return data_ + begin * dim_;
+            }
+        }
+        buf_.resize(n * dim_);
+        const DataType* src = data_ + begin * dim_;
+#pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < n * dim_; i++) {
+            buf_[i] = static_cast<float>(src[i]);
+        }
+        return Finish(n);
+    }
+
+    // the n rows listed in ids
+    const float*
+    Gather(const int64_t* ids, const int64_t n) {
+        buf_.resize(n * dim_);
+#pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < n; i++) {
+            const DataType* src = data_ + ids[i] * dim_;
+            for (int64_t j = 0; j < dim_; j++) {
+                buf_[i * dim_ + j] = static_cast<float>(src[j]);
+            }
+        }
+        return Finish(n);
+    }
+
+ private:
+    const float*
+    Finish(const int64_t n) {
+        if (normalize_) {
+            faiss::fvec_renorm_L2(dim_, n, buf_.data());
+        }
+        return buf_.data();
+    }
+
+    const DataType* data_;
+    const int64_t dim_;
+    const bool normalize_;
+    std::vector<float> buf_;
+};
+
+// Nearest centroid (k == 1) assignment. use_elkan prunes centroid comparisons with the centroid-to-centroid
+// distances, the same kernel the IVF k-means uses.
+class CentroidAssigner {
+ public:
+    CentroidAssigner(const float* centroids, const int64_t k, const int64_t dim, const bool use_elkan)
+        : index_(dim, faiss::METRIC_L2, false, use_elkan) {
+        index_.add(k, centroids);
+    }
+
+    void
+    Assign(const float* x, const int64_t n, int64_t* labels) {
+        dis_.resize(n);
+        index_.search(n, x, 1, dis_.data(), labels);
+    }
+
+ private:
+    faiss::IndexFlatElkan index_;
+    std::vector<float> dis_;
+};
+
+template <typename DataType>
+class KmeansTrainer {
+ public:
+    KmeansTrainer(const DataSet& dataset, const KmeansConfig& cfg, const bool is_cosine)
+        : reader_(dataset, is_cosine),
+          n_(dataset.GetRows()),
+          dim_(dataset.GetDim()),
+          k_(cfg.num_clusters.value()),
+          n_iters_(cfg.kmeans_n_iters.value()),
+          batch_size_(cfg.kmeans_batch_size.value()),
+          is_cosine_(is_cosine),
+          use_elkan_(cfg.use_elkan.value()),
+          rng_(kSeed) {
+    }
+
+    void
+    Train(const std::string& init, const std::string& mode) {
+        assign_ = std::make_unique<uint32_t[]>(n_);
+        if (init == kmeans::INIT_RANDOM) {
+            InitRandom();
+        } else {
+            InitKmeansPlusPlus();
+        }
+
+        if (mode == kmeans::MODE_LLOYD) {
+            Lloyd();
+        } else {
+            MiniBatch(mode == kmeans::MODE_STREAMING);
+            AssignAll();
+        }
+    }
+
+    std::vector<float>&
+    Centroids() {
+        return centroids_;
+    }
+
+    std::unique_ptr<uint32_t[]>&
+    Assignments() {
+        return assign_;
+    }
+
+ private:
+    void
+    InitRandom() {
+        auto ids = SampleRows(n_, k_, rng_);
+        std::shuffle(ids.begin(), ids.end(), rng_);
+        const float* x = reader_.Gather(ids.data(), k_);
+        centroids_.assign(x, x + k_ * dim_);
+    }
+
+    // kmeans++ seeding over a sample of the rows
+    void
+    InitKmeansPlusPlus() {
+        const auto ids = SampleRows(n_, k_ * kInitSamplesPerCluster, rng_);
+        const int64_t ns = ids.size();
+        const float* x = reader_.Gather(ids.data(), ns);
+
+        centroids_.resize(k_ * dim_);
+        std::vector<float> min_dis(ns, std::numeric_limits<float>::max());
+        int64_t picked = std::uniform_int_distribution<int64_t>(0, ns - 1)(rng_);
+        for (int64_t c = 0; c < k_; c++) {
+            float* centroid = centroids_.data() + c * dim_;
+            std::memcpy(centroid, x + picked * dim_, dim_ * sizeof(float));
+            if (c + 1 == k_) {
+                break;
+            }
+
+            double total = 0;
+#pragma omp parallel for schedule(static) reduction(+ : total)
+            for (int64_t i = 0; i < ns; i++) {
+                min_dis[i] = std::min(min_dis[i], faiss::fvec_L2sqr(x + i * dim_, centroid, dim_));
+                total += min_dis[i];
+            }
+
+            // the next centroid is a row picked with a probability proportional to its squared distance to the
+            // closest centroid so far, or any row once all of them coincide with a centroid
+            if (total <= 0) {
+                picked = std::uniform_int_distribution<int64_t>(0, ns - 1)(rng_);
+                continue;
+            }
+            double r = std::uniform_real_distribution<double>(0, total)(rng_);
+            picked = ns - 1;
+            for (int64_t i = 0; i < ns; i++) {
+                r -= min_dis[i];
+                if (r < 0) {
+                    picked = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Full-batch iterations. With use_elkan, Hamerly's bounds skip the rows whose centroid cannot have changed: an
+    // upper bound on the distance to the assigned centroid and a lower bound on the distance to any other one, both
+    // moved by how far the centroids drift.
+    void
+    Lloyd() {
+        const bool use_bounds = use_elkan_ && k_ > 1;
+        if (use_bounds) {
+            upper_.resize(n_);
+            lower_.resize(n_);
+        }
+
+        if (use_bounds) {
+            for (int64_t begin = 0; begin < n_; begin += kBlockRows) {
+                const int64_t nb = std::min(kBlockRows, n_ - begin);
+                NearestTwo(reader_.Read(begin, nb), nb, nullptr, begin);
+            }
+        } else {
+            AssignAll();
+        }
+
+        std::vector<int64_t> labels(std::min(n_, kBlockRows));
+
+        for (int64_t iter = 0; iter < n_iters_; iter++) {
+            const auto drift = UpdateCentroids();
+            if (*std::max_element(drift.begin(), drift.end()) == 0) {
+                break;
+            }
+
+            int64_t changed = 0;
+            if (use_bounds) {
+                changed = ReassignWithBounds(drift);
+            } else {
+                CentroidAssigner assigner(centroids_.data(), k_, dim_, use_elkan_);
+                for (int64_t begin = 0; begin < n_; begin += kBlockRows) {
+                    const int64_t nb = std::min(kBlockRows, n_ - begin);
+                    assigner.Assign(reader_.Read(begin, nb), nb, labels.data());
+                    for (int64_t i = 0; i < nb; i++) {
+                        changed += (assign_[begin + i] != labels[i]);
+                        assign_[begin + i] = labels[i];
+                    }
+                }
+            }
+            LOG_KNOWHERE_DEBUG_ << "kmeans iteration " << iter << ", " << changed << " rows changed cluster";
+            if (changed == 0) {
+                break;
+            }
+        }
+    }
+
+    // assigns the rows of x (the rows listed in rows, or begin, begin + 1, ... without rows) to their nearest
+    // centroid and resets their bounds
+    void
+    NearestTwo(const float* x, const int64_t nx, const int64_t* rows, const int64_t begin) {
+        std::vector<float> dis(nx * 2);
+        std::vector<int64_t> ids(nx * 2);
+        faiss::knn_L2sqr(x, centroids_.data(), dim_, nx, k_, 2, dis.data(), ids.data());
+        for (int64_t i = 0; i < nx; i++) {
+            const int64_t row = (rows == nullptr) ? begin + i : rows[i];
+            assign_[row] = ids[i * 2];
+            upper_[row] = std::sqrt(std::max(dis[i * 2], 0.0f));
+            lower_[row] = std::sqrt(std::max(dis[i * 2 + 1], 0.0f));
+        }
+    }
+
+    int64_t
+    ReassignWithBounds(const std::vector<float>& drift) {
+        // the largest drifts, the lower bound of a row moves by the largest drift among the other centroids
+        int64_t max_c = 0;
+        for (int64_t c = 1; c < k_; c++) {
+            max_c = (drift[c] > drift[max_c]) ? c : max_c;
+        }
+        float second_max = 0;
+        for (int64_t c = 0; c < k_; c++) {
+            second_max = (c != max_c) ? std::max(second_max, drift[c]) : second_max;
+        }
+
+        // a row is closer to its centroid than to any other one if it is within half of the distance from that
+        // centroid to its closest other centroid
+        std::vector<float> half_gap(k_);
+        {
+            std::vector<float> dis(k_ * 2);
+            std::vector<int64_t> ids(k_ * 2);
+            faiss::knn_L2sqr(centroids_.data(), centroids_.data(), dim_, k_, k_, 2, dis.data(), ids.data());
+            for (int64_t c = 0; c < k_; c++) {
+                // the nearest one is usually the centroid itself, unless it has a duplicate
+                const float gap = (ids[c * 2] == c) ? dis[c * 2 + 1] : dis[c * 2];
+                half_gap[c] = 0.5f * std::sqrt(std::max(gap, 0.0f));
+            }
+        }
+
+        int64_t changed = 0;
+        std::vector<uint8_t> recompute(std::min(n_, kBlockRows));
+        std::vector<int64_t> rows;
+        std::vector<float> gathered;
+        for (int64_t begin = 0; begin < n_; begin += kBlockRows) {
+            const int64_t nb = std::min(kBlockRows, n_ - begin);
+            const float* x = reader_.Read(begin, nb);
+#pragma omp parallel for schedule(static)
+            for (int64_t i = 0; i < nb; i++) {
+                const int64_t row = begin + i;
+                const uint32_t a = assign_[row];
+                upper_[row] += drift[a];
+                lower_[row] -= (a == max_c) ? second_max : drift[max_c];
+                const float bound = std::max(half_gap[a], lower_[row]);
+                recompute[i] = 0;
+                if (upper_[row] <= bound) {
+                    continue;
+                }
+                // tighten the upper bound before looking at the other centroids
+                upper_[row] = std::sqrt(faiss::fvec_L2sqr(x + i * dim_, centroids_.data() + a * dim_, dim_));
+                recompute[i] = (upper_[row] > bound);
+            }
+
+            rows.clear();
+            for (int64_t i = 0; i < nb; i++) {
+                if (recompute[i]) {
+                    rows.push_back(begin + i);
+                }
+            }
+            if (rows.empty()) {
+                continue;
+            }
+            const int64_t nr = rows.size();
+            gathered.resize(nr * dim_);
+#pragma omp parallel for schedule(static)
+            for (int64_t j = 0; j < nr; j++) {
+                std::memcpy(gathered.data() + j * dim_, x + (rows[j] - begin) * dim_, dim_ * sizeof(float));
+            }
+            std::vector<uint32_t> before(nr);
+            for (int64_t j = 0; j < nr; j++) {
+                before[j] = assign_[rows[j]];
+            }
+            NearestTwo(gathered.data(), nr, rows.data(), 0);
+            for (int64_t j = 0; j < nr; j++) {
+                changed += (assign_[rows[j]] != before[j]);
+            }
+        }
+        return changed;
+    }
+
+    // recomputes the centroids as the means of their rows, returns how far each one moved
+    std::vector<float>
+    UpdateCentroids() {
+        std::vector<double> sums(k_ * dim_, 0);
+        std::vector<int64_t> counts(k_, 0);
+        for (int64_t begin = 0; begin < n_; begin += kBlockRows) {
+            const int64_t nb = std::min(kBlockRows, n_ - begin);
+            const float* x = reader_.Read(begin, nb);
+            // every thread owns a range of centroids, so the sums need neither locks nor per-thread copies
+#pragma omp parallel
+            {
+                const int64_t nt = omp_get_num_threads();
+                const int64_t rank = omp_get_thread_num();
+                const int64_t c0 = k_ * rank / nt;
+                const int64_t c1 = k_ * (rank + 1) / nt;
+                for (int64_t i = 0; i < nb; i++) {
+                    const int64_t a = assign_[begin + i];
+                    if (a < c0 || a >= c1) {
+                        continue;
+                    }
+                    counts[a]++;
+                    double* sum = sums.data() + a * dim_;
+                    const float* xi = x + i * dim_;
+                    for (int64_t j = 0; j < dim_; j++) {
+                        sum[j] += xi[j];
+                    }
+                }
+            }
+        }
+
+        std::vector<float> updated(centroids_);
+        for (int64_t c = 0; c < k_; c++) {
+            if (counts[c] == 0) {
+                continue;
+            }
+            for (int64_t j = 0; j < dim_; j++) {
+                updated[c * dim_ + j] = sums[c * dim_ + j] / counts[c];
+            }
+        }
+        SplitEmptyClusters(updated.data(), counts);
+        if (is_cosine_) {
+            faiss::fvec_renorm_L2(dim_, k_, updated.data());
+        }
+
+        std::vector<float> drift(k_);
+        for (int64_t c = 0; c < k_; c++) {
+            drift[c] = std::sqrt(faiss::fvec_L2sqr(updated.data() + c * dim_, centroids_.data() + c * dim_, dim_));
+        }
+        centroids_.swap(updated);
+        return drift;
+    }
+
+    // an empty cluster takes over half of the largest one, with both centroids pushed slightly apart
+    void
+    SplitEmptyClusters(float* centroids, std::vector<int64_t>& counts) {
+        int64_t n_split = 0;
+        for (int64_t ci = 0; ci < k_; ci++) {
+            if (counts[ci] != 0) {
+                continue;
+            }
+            const int64_t cj = std::max_element(counts.begin(), counts.end()) - counts.begin();
+            if (counts[cj] < 2) {
+                break;
+            }
+            float* src = centroids + cj * dim_;
+            float* dst = centroids + ci * dim_;
+            for (int64_t j = 0; j < dim_; j++) {
+                const float eps = (j % 2 == 0) ? kSplitEps : -kSplitEps;
+                dst[j] = src[j] * (1 + eps);
+                src[j] = src[j] * (1 - eps);
+            }
+            counts[ci] = counts[cj] / 2;
+            counts[cj] -= counts[ci];
+            n_split++;
+        }
+        if (n_split > 0) {
+            LOG_KNOWHERE_DEBUG_ << "kmeans split " << n_split << " clusters to fill empty ones";
+        }
+    }
+
+    // Sculley's mini-batch k-means: every row moves its nearest centroid towards itself with a learning rate of
+    // 1 / (number of rows seen by that centroid so far). Batches are random samples, or consecutive rows read
+    // sequentially when streaming.
+    void
+    MiniBatch(const bool streaming) {
+        std::vector<int64_t> seen(k_, 0);
+        std::vector<int64_t> labels;
+
+        auto update = [&](const float* x, const int64_t nx) {
+            labels.resize(nx);
+            CentroidAssigner(centroids_.data(), k_, dim_, use_elkan_).Assign(x, nx, labels.data());
+            // every thread owns a range of centroids, which keeps the per-centroid update order of a serial run
+#pragma omp parallel
+            {
+                const int64_t nt = omp_get_num_threads();
+                const int64_t rank = omp_get_thread_num();
+                const int64_t c0 = k_ * rank / nt;
+                const int64_t c1 = k_ * (rank + 1) / nt;
+                for (int64_t i = 0; i < nx; i++) {
+                    const int64_t a = labels[i];
+                    if (a < c0 || a >= c1) {
+                        continue;
+                    }
+                    const float eta = 1.0f / ++seen[a];
+                    float* centroid = centroids_.data() + a * dim_;
+                    const float* xi = x + i * dim_;
+                    for (int64_t j = 0; j < dim_; j++) {
+                        centroid[j] += eta * (xi[j] - centroid[j]);
+                    }
+                }
+            }
+            if (is_cosine_) {
+                faiss::fvec_renorm_L2(dim_, k_, centroids_.data());
+            }
+        };
+
+        for (int64_t iter = 0; iter < n_iters_; iter++) {
+            if (streaming) {
+                for (int64_t begin = 0; begin < n_; begin += batch_size_) {
+                    const int64_t nb = std::min(batch_size_, n_ - begin);
+                    update(reader_.Read(begin, nb), nb);
+                }
+            } else {
+                const auto ids = SampleRows(n_, batch_size_, rng_);
+                update(reader_.Gather(ids.data(), ids.size()), ids.size());
+            }
+        }
+
+        // centroids that never won a row restart from a random row
+        for (int64_t c = 0; c < k_; c++) {
+            if (seen[c] == 0) {
+                const int64_t row = std::uniform_int_distribution<int64_t>(0, n_ - 1)(rng_);
+                std::memcpy(centroids_.data() + c * dim_, reader_.Read(row, 1), dim_ * sizeof(float));
+            }
+        }
+    }
+
+    void
+    AssignAll() {
+        CentroidAssigner assigner(centroids_.data(), k_, dim_, use_elkan_);
+        std::vector<int64_t> labels(std::min(n_, kBlockRows));
+        for (int64_t begin = 0; begin < n_; begin += kBlockRows) {
+            const int64_t nb = std::min(kBlockRows, n_ - begin);
+            assigner.Assign(reader_.Read(begin, nb), nb, labels.data());
+            for (int64_t i = 0; i < nb; i++) {
+                assign_[begin + i] = labels[i];
+            }
+        }
+    }
+
+    RowReader<DataType> reader_;
+    const int64_t n_;
+    const int64_t dim_;
+    const int64_t k_;
+    const int64_t n_iters_;
+    const int64_t batch_size_;
+    const bool is_cosine_;
+    const bool use_elkan_;
+    std::mt19937_64 rng_;
+
+    std::vector<float> centroids_;
+    std::unique_ptr<uint32_t[]> assign_;
+    // Hamerly's bounds of the lloyd mode
+    std::vector<float> upper_;
+    std::vector<float> lower_;
+};
+
+}  // namespace
+
+// CPU k-means over fp32, fp16 or bf16 rows, with L2 or COSINE (spherical k-means over the normalized rows).
+// Centroids are kept in fp32.
+template <typename DataType>
+class KmeansClusterNode : public ClusterNode {
+ public:
+    KmeansClusterNode(const Object& object) {
+        build_pool_ = ThreadPool::GetGlobalBuildThreadPool();
+    }
+
+    expected<DataSetPtr>
+    Train(const DataSet& dataset, const Config& cfg) override {
+        const auto& kmeans_cfg = static_cast<const KmeansConfig&>(cfg);
+        const auto rows = dataset.GetRows();
+        if (rows < kmeans_cfg.num_clusters.value()) {
+            return expected<DataSetPtr>::Err(Status::invalid_args, "num_clusters is larger than the number of rows");
+        }
+
+        std::unique_ptr<uint32_t[]> assign;
+        auto status = RunOnBuildPool(kmeans_cfg.num_build_thread, [&] {
+            const bool is_cosine = IsMetricType(kmeans_cfg.metric_type.value(), metric::COSINE);
+            KmeansTrainer<DataType> trainer(dataset, kmeans_cfg, is_cosine);
+            trainer.Train(kmeans_cfg.kmeans_init.value(), kmeans_cfg.kmeans_mode.value());
+            centroids_.swap(trainer.Centroids());
+            assign = std::move(trainer.Assignments());
+            dim_ = dataset.GetDim();
+            is_cosine_ = is_cosine;
+            use_elkan_ = kmeans_cfg.use_elkan.value();
+        });
+        if (status != Status::success) {
+            return expected<DataSetPtr>::Err(status, "kmeans training failed");
+        }
+        return GenResultDataSet(rows, 1, std::move(assign));
+    }
+
+    expected<DataSetPtr>
+    Assign(const DataSet& dataset) override {
+        if (centroids_.empty()) {
+            return expected<DataSetPtr>::Err(Status::index_not_trained, "kmeans is not trained");
+        }
+        if (dataset.GetDim() != dim_) {
+            return expected<DataSetPtr>::Err(Status::invalid_args, "dimension mismatch with the centroids");
+        }
+
+        const auto rows = dataset.GetRows();
+        auto assign = std::make_unique<uint32_t[]>(rows);
+        auto status = RunOnBuildPool(std::nullopt, [&] {
+            RowReader<DataType> reader(dataset, is_cosine_);
+            CentroidAssigner assigner(centroids_.data(), centroids_.size() / dim_, dim_, use_elkan_);
+            std::vector<int64_t> labels(std::min(rows, kBlockRows));
+            for (int64_t begin = 0; begin < rows; begin += kBlockRows) {
+                const int64_t nb = std::min(kBlockRows, rows - begin);
+                assigner.Assign(reader.Read(begin, nb), nb, labels.data());
+                std::copy_n(labels.begin(), nb, assign.get() + begin);
+            }
+        });
+        if (status != Status::success) {
+            return expected<DataSetPtr>::Err(status, "kmeans assignment failed");
+        }
+        return GenResultDataSet(rows, 1, std::move(assign));
+    }
+
+    expected<DataSetPtr>
+    GetCentroids() const override {
+        if (centroids_.empty()) {
+            return expected<DataSetPtr>::Err(Status::index_not_trained, "kmeans is not trained");
+        }
+        auto centroids = std::make_unique<float[]>(centroids_.size());
+        std::copy(centroids_.begin(), centroids_.end(), centroids.get());
+        return GenResultDataSet(centroids_.size() / dim_, dim_, std::move(centroids));
+    }
+
+    std::unique_ptr<Config>
+    CreateConfig() const override {
+        return std::make_unique<KmeansConfig>();
+    }
+
+    std::string
+    Type() const override {
+        return ClusterEnum::CLUSTER_KMEANS;
+    }
+
+ private:
+    // use build_pool_ to make sure the OMP threads spawned by k-means inherit the low nice value of its threads
+    template <typename Func>
+    Status
+    RunOnBuildPool(const CFG_INT& num_build_thread, Func&& func) const {
+        auto tryObj = build_pool_
+                          ->push([&] {
+                              std::unique_ptr<ThreadPool::ScopedBuildOmpSetter> setter;
+                              if (num_build_thread.has_value()) {
+                                  setter = std::make_unique<ThreadPool::ScopedBuildOmpSetter>(num_build_thread.value());
+                              } else {
+                                  setter = std::make_unique<ThreadPool::ScopedBuildOmpSetter>();
+                              }
+                              func();
+                          })
+                          .getTry();
+        if (!tryObj.hasValue()) {
+            LOG_KNOWHERE_WARNING_ << "kmeans inner error: " << tryObj.exception().what();
+            return Status::cluster_inner_error;
+        }
+        return Status::success;
+    }
+
+    std::shared_ptr<ThreadPool> build_pool_;
+    std::vector<float> centroids_;
+    int64_t dim_ = 0;
+    bool is_cosine_ = false;
+    bool use_elkan_ = true;
+};
+
+// the cardinal build registers its own KMEANS
+#ifndef KNOWHERE_WITH_CARDINAL
+KNOWHERE_CLUSTER_SIMPLE_REGISTER_GLOBAL(KMEANS, KmeansClusterNode, fp32);
+KNOWHERE_CLUSTER_SIMPLE_REGISTER_GLOBAL(KMEANS, KmeansClusterNode, fp16);
+KNOWHERE_CLUSTER_SIMPLE_REGISTER_GLOBAL(KMEANS, KmeansClusterNode, bf16);
+#endif
+
+}  // namespace knowhere
@@ -0,0 +1,97 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#ifndef KMEANS_CONFIG_H
+#define KMEANS_CONFIG_H
+
+#include <limits>
+#include <string>
+
+#include "knowhere/comp/index_param.h"
+#include "knowhere/config.h"
+#include "knowhere/utils.h"
+
+namespace knowhere {
+
+namespace kmeans {
+constexpr const char* INIT_KMEANS_PLUS_PLUS = "kmeans++";
+constexpr const char* INIT_RANDOM = "random";
+
+// full-batch iterations over all the rows
+constexpr const char* MODE_LLOYD = "lloyd";
+// every iteration updates the centroids with a random sample of kmeans_batch_size rows
+constexpr const char* MODE_MINI_BATCH = "mini_batch";
+// every iteration is one sequential pass over the rows, kmeans_batch_size rows at a time
+constexpr const char* MODE_STREAMING = "streaming";
+}  // namespace kmeans
+
+class KmeansConfig : public BaseConfig {
+ public:
+    CFG_INT num_clusters;
+    CFG_INT kmeans_n_iters;
+    CFG_STRING kmeans_init;
+    CFG_STRING kmeans_mode;
+    CFG_INT kmeans_batch_size;
+    CFG_BOOL use_elkan;
+    KNOHWERE_DECLARE_CONFIG(KmeansConfig) {
+        KNOWHERE_CONFIG_DECLARE_FIELD(num_clusters)
+            .description("number of clusters.")
+            .set_default(8)
+            .for_cluster()
+            .set_range(1, std::numeric_limits<CFG_INT::value_type>::max());
+        KNOWHERE_CONFIG_DECLARE_FIELD(kmeans_n_iters)
+            .description("maximum number of iterations, passes over the data in the streaming mode.")
+            .set_default(20)
+            .for_cluster()
+            .set_range(1, 1024);
+        KNOWHERE_CONFIG_DECLARE_FIELD(kmeans_init)
+            .description("centroid initialization, kmeans++ or random.")
+            .set_default(kmeans::INIT_KMEANS_PLUS_PLUS)
+            .for_cluster();
+        KNOWHERE_CONFIG_DECLARE_FIELD(kmeans_mode)
+            .description("training mode, lloyd, mini_batch or streaming.")
+            .set_default(kmeans::MODE_LLOYD)
+            .for_cluster();
+        KNOWHERE_CONFIG_DECLARE_FIELD(kmeans_batch_size)
+            .description("number of rows per centroid update in the mini_batch and streaming modes.")
+            .set_default(65536)
+            .for_cluster()
+            .set_range(1, std::numeric_limits<CFG_INT::value_type>::max());
+        KNOWHERE_CONFIG_DECLARE_FIELD(use_elkan)
+            .description("whether to skip distance computations with triangle inequality bounds.")
+            .set_default(true)
+            .for_cluster();
+    }
+
+    Status
+    CheckAndAdjust(PARAM_TYPE param_type, std::string* err_msg) override {
+        if (param_type == PARAM_TYPE::CLUSTER) {
+            const auto& init = kmeans_init.value();
+            if (init != kmeans::INIT_KMEANS_PLUS_PLUS && init != kmeans::INIT_RANDOM) {
+                return HandleError(err_msg, "unknown kmeans_init " + init, Status::invalid_args);
+            }
+            const auto& mode = kmeans_mode.value();
+            if (mode != kmeans::MODE_LLOYD && mode != kmeans::MODE_MINI_BATCH && mode != kmeans::MODE_STREAMING) {
+                return HandleError(err_msg, "unknown kmeans_mode " + mode, Status::invalid_args);
+            }
+            const auto& metric = metric_type.value();
+            if (!IsMetricType(metric, metric::L2) && !IsMetricType(metric, metric::COSINE)) {
+                return HandleError(err_msg, "kmeans only supports L2 and COSINE, got " + metric,
+                                   Status::invalid_metric_type);
+            }
+        }
+        return Status::success;
+    }
+};
+
+}  // namespace knowhere
+
+#endif /* KMEANS_CONFIG_H */
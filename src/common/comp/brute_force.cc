@@ -15,11 +15,13 @@
 
 #include "common/metric.h"
 #include "faiss/MetricType.h"
+#include "faiss/utils/Heap.h"
 #include "faiss/utils/binary_distances.h"
 #include "faiss/utils/distances.h"
 #include "faiss/utils/distances_typed.h"
 #include "index/minhash/minhash_util.h"
 #include "knowhere/bitsetview_idselector.h"
+#include "knowhere/comp/search_canceller.h"
 #include "knowhere/comp/task.h"
 #include "knowhere/config.h"
 #include "knowhere/emb_list_utils.h"
@@ -66,23 +68,60 @@ GetDocValueComputer(const BruteForceConfig& cfg) {
     }
 }
 
+// Similarity between a sparse query and a sparse base row through the simd intersection kernels. For IP the
+// products are accumulated by the kernel. For BM25 the matched values are collected into `buf` first, so the row
+// sum and the doc value computer are only evaluated for rows that share a dimension with the query.
+float
+SparseRowDistance(const sparse::SparseRow<float>& query, const sparse::SparseRow<float>& row, const bool is_bm25,
+                  const sparse::DocValueComputer<float>& computer, std::vector<float>& buf) {
+    const auto* q_data = static_cast<const char*>(query.data());
+    const auto* r_data = static_cast<const char*>(row.data());
+    if (!is_bm25) {
+        return faiss::sparse_inner_product(q_data, query.size(), r_data, row.size());
+    }
+
+    const size_t max_matches = std::min(query.size(), row.size());
+    buf.resize(2 * max_matches);
+    float* q_vals = buf.data();
+    float* r_vals = buf.data() + max_matches;
+    const size_t n = faiss::sparse_intersect_values(q_data, query.size(), r_data, row.size(), q_vals, r_vals);
+    if (n == 0) {
+        return 0.0f;
+    }
+    float row_sum = 0;
+    for (size_t k = 0; k < row.size(); ++k) {
+        row_sum += row[k].val;
+    }
+    float dist = 0.0f;
+    for (size_t k = 0; k < n; ++k) {
+        dist += q_vals[k] * computer(r_vals[k], row_sum);
+    }
+    return dist;
+}
+
 template <typename DataType>
-std::unique_ptr<float[]>
-GetVecNorms(const DataSetPtr& base) {
-    using NormComputer = float (*)(const DataType*, size_t);
-    NormComputer norm_computer;
+using NormComputer = float (*)(const DataType*, size_t);
+
+template <typename DataType>
+NormComputer<DataType>
+GetNormComputer() {
     if constexpr (std::is_same_v<DataType, knowhere::fp32>) {
-        norm_computer = faiss::fvec_norm_L2sqr;
+        return faiss::fvec_norm_L2sqr;
     } else if constexpr (std::is_same_v<DataType, knowhere::fp16>) {
-        norm_computer = faiss::fp16_vec_norm_L2sqr;
+        return faiss::fp16_vec_norm_L2sqr;
     } else if constexpr (std::is_same_v<DataType, knowhere::bf16>) {
-        norm_computer = faiss::bf16_vec_norm_L2sqr;
+        return faiss::bf16_vec_norm_L2sqr;
+    } else if constexpr (std::is_same_v<DataType, knowhere::int8>) {
+        return faiss::int8_vec_norm_L2sqr;
     } else {
         return nullptr;
     }
-    auto xb = (DataType*)base->GetTensor();
-    auto nb = base->GetRows();
-    auto dim = base->GetDim();
+}
+
+template <typename DataType>
+std::unique_ptr<float[]>
+ComputeVecNorms(const DataType* xb, int64_t nb, int64_t dim, bool squared) {
+    auto norm_computer = GetNormComputer<DataType>();
     auto norms = std::make_unique<float[]>(nb);
 
     // use build thread pool to compute norms
@@ -95,13 +134,163 @@ GetVecNorms(const DataSetPtr& base) {
         auto last = std::min(i + chunk_size, nb);
         futs.emplace_back(pool->push([&, beg_id = i, end_id = last] {
             for (auto j = beg_id; j < end_id; j++) {
-                norms[j] = std::sqrt(norm_computer(xb + j * dim, dim));
+                auto norm = norm_computer(xb + j * dim, dim);
+                norms[j] = squared ? norm : std::sqrt(norm);
             }
         }));
     }
     WaitAllSuccess(futs);
     return norms;
 }
+
+template <typename DataType>
+std::unique_ptr<float[]>
+GetVecNorms(const DataSetPtr& base) {
+    if constexpr (std::is_same_v<DataType, knowhere::fp32> || std::is_same_v<DataType, knowhere::fp16> ||
+                  std::is_same_v<DataType, knowhere::bf16>) {
+        return ComputeVecNorms((const DataType*)base->GetTensor(), base->GetRows(), base->GetDim(), false);
+    } else {
+        return nullptr;
+    }
+}
+
+// Tiled brute force: a block of queries is matched against a block of base vectors with one call of the
+// batched inner product kernel, which runs on AMX tiles. It is only used when the kernel is backed by AMX,
+// otherwise the per-query faiss path is faster.
+constexpr int64_t kTileSearchMinQueries = 16;
+constexpr int64_t kTileSearchQueryBlock = 64;
+constexpr int64_t kTileSearchBaseBlock = 1024;
+
+template <typename DataType>
+bool
+WhetherPerformTileSearch(const std::string& metric_str, int64_t nq) {
+    if (!faiss::support_amx || nq < kTileSearchMinQueries) {
+        return false;
+    }
+    if (!IsMetricType(metric_str, metric::L2) && !IsMetricType(metric_str, metric::IP) &&
+        !IsMetricType(metric_str, metric::COSINE)) {
+        return false;
+    }
+    if constexpr (std::is_same_v<DataType, knowhere::bf16> || std::is_same_v<DataType, knowhere::int8>) {
+        return true;
+    } else if constexpr (std::is_same_v<DataType, knowhere::fp32>) {
+        // amx computes fp32 as bf16, which is only acceptable when the patch asks for it
+        return faiss::is_patch_for_fp32_bf16_enabled();
+    } else {
+        return false;
+    }
+}
+
+template <typename C, typename DataType>
+Status
+TileSearch(const DataType* xb, int64_t nb, const DataType* xq, int64_t nq, int64_t dim, int64_t topk,
+           const std::string& metric_str, const BitsetView& bitset, SearchCanceller& canceller, int64_t* ids,
+           float* dis) {
+    using BatchComputer = void (*)(float*, const DataType*, const DataType*, size_t, size_t, size_t);
+    BatchComputer batch_computer;
+    if constexpr (std::is_same_v<DataType, knowhere::fp32>) {
+        batch_computer = faiss::fvec_inner_products_batch;
+    } else if constexpr (std::is_same_v<DataType, knowhere::bf16>) {
+        batch_computer = faiss::bf16_vec_inner_products_batch;
+    } else {
+        batch_computer = faiss::int8_vec_inner_products_batch;
+    }
+    const bool is_l2 = IsMetricType(metric_str, metric::L2);
+    const bool is_cosine = IsMetricType(metric_str, metric::COSINE);
+    // L2 is expanded as |x|^2 + |y|^2 - 2 <x, y>, cosine divides by the (non-squared) norms
+    std::unique_ptr<float[]> xb_norms = (is_l2 || is_cosine) ? ComputeVecNorms(xb, nb, dim, is_l2) : nullptr;
+
+    auto pool = ThreadPool::GetGlobalSearchThreadPool();
+    std::vector<folly::Future<Status>> futs;
+    futs.reserve((nq + kTileSearchQueryBlock - 1) / kTileSearchQueryBlock);
+    for (int64_t q0 = 0; q0 < nq; q0 += kTileSearchQueryBlock) {
+        futs.emplace_back(pool->push([&, q_beg = q0, q_end = std::min(q0 + kTileSearchQueryBlock, nq)] {
+            ThreadPool::ScopedSearchOmpSetter setter(1);
+            const int64_t nqb = q_end - q_beg;
+            const DataType* cur_query = xq + q_beg * dim;
+            auto cur_ids = ids + q_beg * topk;
+            auto cur_dis = dis + q_beg * topk;
+
+            std::vector<float> xq_norms(nqb, 1.0f);
+            if (is_l2 || is_cosine) {
+                auto norm_computer = GetNormComputer<DataType>();
+                for (int64_t i = 0; i < nqb; i++) {
+                    auto norm = norm_computer(cur_query + i * dim, dim);
+                    xq_norms[i] = is_l2 ? norm : std::sqrt(norm);
+                }
+            }
+            for (int64_t i = 0; i < nqb; i++) {
+                faiss::heap_heapify<C>(topk, cur_dis + i * topk, cur_ids + i * topk);
+            }
+
+            std::vector<float> ip(nqb * kTileSearchBaseBlock);
+            std::vector<uint8_t> filtered(kTileSearchBaseBlock);
+            for (int64_t b0 = 0; b0 < nb; b0 += kTileSearchBaseBlock) {
+                // a stopped request keeps the best results among the base blocks scanned so far
+                if (canceller.IsStopped()) {
+                    canceller.AbortQueries(nqb);
+                    break;
+                }
+                const int64_t nbb = std::min(kTileSearchBaseBlock, nb - b0);
+                bool all_filtered = true;
+                for (int64_t j = 0; j < nbb; j++) {
+                    filtered[j] = !bitset.empty() && bitset.test(b0 + j);
+                    all_filtered &= (filtered[j] != 0);
+                }
+                if (all_filtered) {
+                    continue;
+                }
+                batch_computer(ip.data(), cur_query, xb + b0 * dim, dim, nqb, nbb);
+                for (int64_t i = 0; i < nqb; i++) {
+                    float* heap_dis = cur_dis + i * topk;
+                    int64_t* heap_ids = cur_ids + i * topk;
+                    const float* row = ip.data() + i * nbb;
+                    for (int64_t j = 0; j < nbb; j++) {
+                        if (filtered[j]) {
+                            continue;
+                        }
+                        float v = row[j];
+                        if (is_l2) {
+                            v = xq_norms[i] + xb_norms[b0 + j] - 2 * v;
+                        } else if (is_cosine) {
+                            auto x_norm = xq_norms[i] == 0.0f ? 1.0f : xq_norms[i];
+                            auto y_norm = xb_norms[b0 + j] == 0.0f ? 1.0f : xb_norms[b0 + j];
+                            v = v / (x_norm * y_norm);
+                        }
+                        if (C::cmp(heap_dis[0], v)) {
+                            faiss::heap_replace_top<C>(topk, heap_dis, heap_ids, v, b0 + j);
+                        }
+                    }
+                }
+            }
+            for (int64_t i = 0; i < nqb; i++) {
+                faiss::heap_reorder<C>(topk, cur_dis + i * topk, cur_ids + i * topk);
+            }
+            return Status::success;
+        }));
+    }
+    return WaitAllSuccess(futs);
+}
+
+template <typename DataType>
+Status
+TileSearchWithBuf(const DataType* xb, int64_t nb, const DataType* xq, int64_t nq, int64_t dim, int64_t topk,
+                  const std::string& metric_str, const BitsetView& bitset, SearchCanceller& canceller, int64_t* ids,
+                  float* dis) {
+    if constexpr (std::is_same_v<DataType, knowhere::fp32> || std::is_same_v<DataType, knowhere::bf16> ||
+                  std::is_same_v<DataType, knowhere::int8>) {
+        if (IsMetricType(metric_str, metric::L2)) {
+            return TileSearch<faiss::CMax<float, int64_t>>(xb, nb, xq, nq, dim, topk, metric_str, bitset, canceller,
+                                                           ids, dis);
+        } else {
+            return TileSearch<faiss::CMin<float, int64_t>>(xb, nb, xq, nq, dim, topk, metric_str, bitset, canceller,
+                                                           ids, dis);
+        }
+    } else {
+        LOG_KNOWHERE_ERROR_ << "tile search not supported for current vector type";
+        return Status::not_implemented;
+    }
+}
 }  // namespace
 
 template <typename DataType>
@@ -127,20 +316,32 @@ BruteForce::Search(const DataSetPtr base_dataset, const DataSetPtr query_dataset
     auto labels = std::make_unique<int64_t[]>(nq * topk);
     auto distances = std::make_unique<float[]>(nq * topk);
 
-    auto search_status = SearchWithBuf<DataType>(base_dataset, query_dataset, labels.get(), distances.get(), config,
-                                                 bitset_, op_context);
+    SearchCanceller canceller(op_context, cfg);
+    auto search_status = SearchWithBufImpl<DataType>(base_dataset, query_dataset, labels.get(), distances.get(),
+                                                     config, bitset_, canceller);
     if (search_status != Status::success) {
         return expected<DataSetPtr>::Err(search_status, "search with buf failed");
     }
     auto res = GenResultDataSet(nq, cfg.k.value(), std::move(labels), std::move(distances));
 
-    return res;
+    return canceller.Finish(res);
 }
 
 template <typename DataType>
 Status
 BruteForce::SearchWithBuf(const DataSetPtr base_dataset, const DataSetPtr query_dataset, int64_t* ids, float* dis,
-                          const Json& config, const BitsetView& bitset_, milvus::OpContext* op_context) {
+                          const Json& config, const BitsetView& bitset, milvus::OpContext* op_context) {
+    BruteForceConfig cfg;
+    RETURN_IF_ERROR(Config::Load(cfg, config, knowhere::SEARCH));
+    SearchCanceller canceller(op_context, cfg);
+    RETURN_IF_ERROR(SearchWithBufImpl<DataType>(base_dataset, query_dataset, ids, dis, config, bitset, canceller));
+    return canceller.Finish();
+}
+
+template <typename DataType>
+Status
+BruteForce::SearchWithBufImpl(const DataSetPtr base_dataset, const DataSetPtr query_dataset, int64_t* ids, float* dis,
+                              const Json& config, const BitsetView& bitset_, SearchCanceller& canceller) {
     auto xb = base_dataset->GetTensor();
     auto nb = base_dataset->GetRows();
     auto dim = base_dataset->GetDim();
@@ -218,6 +419,12 @@ BruteForce::SearchWithBuf(const DataSetPtr base_dataset, const DataSetPtr query_
 
         for (size_t query_el_i = 0; query_el_i < num_query_el; query_el_i++) {
             futs.emplace_back(pool->push([&, query_el_idx = query_el_i] {
+                if (canceller.IsStopped()) {
+                    SearchCanceller::FillEmptyResult(ids + query_el_idx * topk, dis + query_el_idx * topk, topk,
+                                                     larger_is_closer);
+                    canceller.AbortQueries();
+                    return Status::success;
+                }
                 ThreadPool::ScopedSearchOmpSetter setter(1);
                 std::priority_queue<DistId, std::vector<DistId>, std::greater<>> minheap;
                 std::priority_queue<DistId, std::vector<DistId>, std::less<>> maxheap;
@@ -384,6 +591,14 @@ BruteForce::SearchWithBuf(const DataSetPtr base_dataset, const DataSetPtr query_
                 labels[i] = labels[i] == -1 ? -1 : labels[i] + xb_id_offset;
             }
         }
+    } else if (WhetherPerformTileSearch<DataType>(metric_str, nq)) {
+        RETURN_IF_ERROR(TileSearchWithBuf<DataType>((const DataType*)xb, nb, (const DataType*)xq, nq, dim, topk,
+                                                    metric_str, bitset, canceller, ids, dis));
+        if (xb_id_offset != 0) {
+            for (auto i = 0; i < nq * topk; i++) {
+                ids[i] = ids[i] == -1 ? -1 : ids[i] + xb_id_offset;
+            }
+        }
     } else {
         auto result = Str2FaissMetricType(cfg.metric_type.value());
         if (result.error() != Status::success) {
@@ -404,6 +619,12 @@ BruteForce::SearchWithBuf(const DataSetPtr base_dataset, const DataSetPtr query_
                 ThreadPool::ScopedSearchOmpSetter setter(1);
                 auto cur_labels = labels + topk * index;
                 auto cur_distances = distances + topk * index;
+                if (canceller.IsStopped()) {
+                    SearchCanceller::FillEmptyResult(cur_labels, cur_distances, topk,
+                                                     faiss::is_similarity_metric(faiss_metric_type));
+                    canceller.AbortQueries();
+                    return Status::success;
+                }
 
                 BitsetViewIDSelector bw_idselector(bitset);
                 faiss::IDSelector* id_selector = (bitset.empty()) ? nullptr : &bw_idselector;
@@ -576,6 +797,7 @@ BruteForce::RangeSearch(const DataSetPtr base_dataset, const DataSetPtr query_da
                                        IsMetricType(metric_str, metric::BM25);
     auto radius = cfg.radius.value();
     float range_filter = cfg.range_filter.value();
+    SearchCanceller canceller(op_context, cfg);
 
     auto pool = ThreadPool::GetGlobalSearchThreadPool();
     // some check for minhash metric
@@ -591,24 +813,22 @@ BruteForce::RangeSearch(const DataSetPtr base_dataset, const DataSetPtr query_da
     futs.reserve(nq);
     for (int i = 0; i < nq; ++i) {
         futs.emplace_back(pool->push([&, index = i] {
+            if (canceller.IsStopped()) {
+                canceller.AbortQueries();
+                return Status::success;
+            }
             if constexpr (std::is_same_v<DataType, knowhere::sparse::SparseRow<float>>) {
                 auto cur_query = (const sparse::SparseRow<float>*)xq + index;
                 auto xb_sparse = (const sparse::SparseRow<float>*)xb;
                 std::set<std::pair<float, int64_t>, std::greater<>> result;
+                std::vector<float> buf;
                 for (int j = 0; j < nb; ++j) {
                     auto xid = xb_id_offset + j;
                     // bitset has already set the id_offset, so we need to use j instead of xid
                     if (!bitset.empty() && bitset.test(j)) {
                         continue;
                     }
-                    float row_sum = 0;
-                    if (is_bm25) {
-                        for (size_t k = 0; k < xb_sparse[j].size(); ++k) {
-                            auto [d, v] = xb_sparse[j][k];
-                            row_sum += v;
-                        }
-                    }
-                    auto dist = cur_query->dot(xb_sparse[j], sparse_computer, row_sum);
+                    auto dist = SparseRowDistance(*cur_query, xb_sparse[j], is_bm25, sparse_computer, buf);
                     if (dist > radius && dist <= range_filter) {
                         result.insert({dist, xid});
                     }
@@ -723,7 +943,7 @@ BruteForce::RangeSearch(const DataSetPtr base_dataset, const DataSetPtr query_da
     // LCOV_EXCL_STOP
 #endif
 
-    return res;
+    return canceller.Finish(res);
 }
 
 Status
@@ -790,19 +1010,13 @@ BruteForce::SearchSparseWithBuf(const DataSetPtr base_dataset, const DataSetPtr
                 return;
             }
             sparse::MaxMinHeap<float> heap(topk);
+            std::vector<float> buf;
             for (int64_t j = 0; j < rows; ++j) {
                 auto x_id = j + xb_id_offset;
                 if (!bitset.empty() && bitset.test(x_id)) {
                     continue;
                 }
-                float row_sum = 0;
-                if (is_bm25) {
-                    for (size_t k = 0; k < base[j].size(); ++k) {
-                        auto [d, v] = base[j][k];
-                        row_sum += v;
-                    }
-                }
-                float dist = row.dot(base[j], computer, row_sum);
+                float dist = SparseRowDistance(row, base[j], is_bm25, computer, buf);
                 if (dist > 0) {
                     heap.push(x_id, dist);
                 }
@@ -1075,19 +1289,13 @@ BruteForce::AnnIterator<knowhere::sparse::SparseRow<float>>(const DataSetPtr bas
                 const auto& row = xq[i];
                 std::vector<DistId> distances_ids;
                 if (row.size() > 0) {
+                    std::vector<float> buf;
                     for (int64_t j = 0; j < rows; ++j) {
                         auto xb_id = j + xb_id_offset;
                         if (!bitset.empty() && bitset.test(xb_id)) {
                             continue;
                         }
-                        float row_sum = 0;
-                        if (is_bm25) {
-                            for (size_t k = 0; k < base[j].size(); ++k) {
-                                auto [d, v] = base[j][k];
-                                row_sum += v;
-                            }
-                        }
-                        auto dist = row.dot(base[j], computer, row_sum);
+                        auto dist = SparseRowDistance(row, base[j], is_bm25, computer, buf);
                         if (dist > 0) {
                             distances_ids.emplace_back(xb_id, dist);
                         }
@@ -135,9 +135,23 @@ KnowhereConfig::SetClusteringType(const ClusteringType clustering_type) {
         case ClusteringType::K_MEANS_PLUS_PLUS:
             faiss::clustering_type = faiss::ClusteringType::K_MEANS_PLUS_PLUS;
             break;
+        case ClusteringType::K_MEANS_HIERARCHICAL:
+            faiss::clustering_type = faiss::ClusteringType::K_MEANS_HIERARCHICAL;
+            break;
     }
 }
 
+void
+KnowhereConfig::SetClusteringSizeSpread(const double size_spread) {
+    LOG_KNOWHERE_INFO_ << "Set faiss::clustering_size_spread to " << size_spread;
+    faiss::clustering_size_spread = size_spread;
+}
+
+double
+KnowhereConfig::GetClusteringSizeSpread() {
+    return faiss::clustering_size_spread;
+}
+
 bool
 KnowhereConfig::SetAioContextPool(size_t num_ctx) {
 #ifdef KNOWHERE_WITH_DISKANN
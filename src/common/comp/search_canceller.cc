@@ -0,0 +1,100 @@
+// Copyright (C) 2019-2023 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License
+
+#include "knowhere/comp/search_canceller.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "knowhere/comp/index_param.h"
+#include "knowhere/log.h"
+
+#if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
+#include "knowhere/prometheus_client.h"
+#endif
+
+namespace knowhere {
+
+SearchCanceller::SearchCanceller(const milvus::OpContext* op_context, const BaseConfig& cfg)
+    : allow_partial_result_(cfg.allow_partial_result.value_or(false)) {
+    if (op_context != nullptr) {
+        token_ = op_context->cancellation_token;
+    }
+    if (cfg.search_timeout_ms.has_value()) {
+        has_deadline_ = true;
+        deadline_ = steady_clock::now() + std::chrono::milliseconds(cfg.search_timeout_ms.value());
+    }
+}
+
+std::shared_ptr<SearchCanceller>
+SearchCanceller::MakeShared(const milvus::OpContext* op_context, const BaseConfig& cfg) {
+    return std::shared_ptr<SearchCanceller>(new SearchCanceller(op_context, cfg), [](SearchCanceller* canceller) {
+        canceller->Finish();
+        delete canceller;
+    });
+}
+
+bool
+SearchCanceller::CheckNow() const {
+    if (token_.has_value() && token_->isCancellationRequested()) {
+        cancelled_.store(true, std::memory_order_relaxed);
+        stopped_.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    if (has_deadline_ && steady_clock::now() >= deadline_) {
+        stopped_.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+Status
+SearchCanceller::Finish() const {
+    // the last queries may have completed right before the deadline, only a stop seen by the loops counts
+    if (!WasStopped()) {
+        return Status::success;
+    }
+#if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
+    knowhere_search_cancelled_requests.Increment();
+    knowhere_search_aborted_queries.Increment(aborted_queries_.load(std::memory_order_relaxed));
+#endif
+    auto status = cancelled_.load(std::memory_order_relaxed) ? Status::cancelled : Status::timeout;
+    if (allow_partial_result_) {
+        LOG_KNOWHERE_DEBUG_ << "search stopped (" << Status2String(status) << "), returning partial result, "
+                            << aborted_queries_.load(std::memory_order_relaxed) << " queries aborted";
+        return Status::success;
+    }
+    LOG_KNOWHERE_WARNING_ << "search stopped (" << Status2String(status) << ")";
+    return status;
+}
+
+expected<DataSetPtr>
+SearchCanceller::Finish(DataSetPtr result) const {
+    auto status = Finish();
+    if (status != Status::success) {
+        return expected<DataSetPtr>::Err(status, cancelled_.load(std::memory_order_relaxed)
+                                                     ? "search request is cancelled"
+                                                     : "search request exceeds search_timeout_ms");
+    }
+    if (WasStopped()) {
+        result->Set(meta::PARTIAL_RESULT, true);
+    }
+    return result;
+}
+
+void
+SearchCanceller::FillEmptyResult(int64_t* ids, float* distances, int64_t k, bool larger_is_closer) {
+    std::fill_n(ids, k, -1);
+    std::fill_n(distances, k,
+                larger_is_closer ? std::numeric_limits<float>::lowest() : std::numeric_limits<float>::max());
+}
+
+}  // namespace knowhere
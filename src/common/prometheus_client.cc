@@ -124,6 +124,14 @@ DEFINE_PROMETHEUS_HISTOGRAM_WITH_BUCKETS(hnsw_bitset_ratio, PROMETHEUS_LABEL_KNO
 DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(hnsw_search_hops, "HNSW search hops in layer 0")
 DEFINE_PROMETHEUS_HISTOGRAM(hnsw_search_hops, PROMETHEUS_LABEL_KNOWHERE)
 
+DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(hnsw_search_ndis, "HNSW distances computed per query, one per visited node")
+DEFINE_PROMETHEUS_HISTOGRAM(hnsw_search_ndis, PROMETHEUS_LABEL_KNOWHERE)
+
+const prometheus::Histogram::BucketBoundaries costRatioBuckets = {0.0625, 0.125, 0.25, 0.5, 1.0, 2.0, 4.0, 8.0, 16.0};
+DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(hnsw_bf_graph_cost_ratio,
+                                   "HNSW estimated brute force to graph search cost ratio, brute force is used up to 1")
+DEFINE_PROMETHEUS_HISTOGRAM_WITH_BUCKETS(hnsw_bf_graph_cost_ratio, PROMETHEUS_LABEL_KNOWHERE, costRatioBuckets)
+
 DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(diskann_bitset_ratio, "DISKANN bitset ratio for search and range search")
 DEFINE_PROMETHEUS_HISTOGRAM_WITH_BUCKETS(diskann_bitset_ratio, PROMETHEUS_LABEL_KNOWHERE, ratioBuckets)
 
@@ -135,6 +143,19 @@ DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(diskann_range_search_iters, "DISKANN range se
 DEFINE_PROMETHEUS_HISTOGRAM_WITH_BUCKETS(diskann_range_search_iters, PROMETHEUS_LABEL_KNOWHERE,
                                          diskannRangeSearchIterBuckets)
 
+DEFINE_PROMETHEUS_COUNTER_FAMILY(search_cancelled_requests, "search requests stopped by cancellation or timeout")
+DEFINE_PROMETHEUS_COUNTER(search_cancelled_requests, PROMETHEUS_LABEL_KNOWHERE)
+
+DEFINE_PROMETHEUS_COUNTER_FAMILY(search_aborted_queries, "queries skipped or cut short by cancellation or timeout")
+DEFINE_PROMETHEUS_COUNTER(search_aborted_queries, PROMETHEUS_LABEL_KNOWHERE)
+
+DEFINE_PROMETHEUS_COUNTER_FAMILY(ivf_batch_assign_queries, "IVF queries coarse assigned by the batched kernel")
+DEFINE_PROMETHEUS_COUNTER(ivf_batch_assign_queries, PROMETHEUS_LABEL_KNOWHERE)
+
+DEFINE_PROMETHEUS_COUNTER_FAMILY(ivf_batch_assign_fallbacks,
+                                 "IVF batched coarse assignments redone by the quantizer, the bf16 bound was not met")
+DEFINE_PROMETHEUS_COUNTER(ivf_batch_assign_fallbacks, PROMETHEUS_LABEL_KNOWHERE)
+
 DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(sparse_dataset_nnz_len, "sparse dataset nnz length")
 DEFINE_PROMETHEUS_HISTOGRAM_FAMILY(sparse_inverted_index_posting_list_len, "sparse inverted index posting list length")
 DEFINE_PROMETHEUS_GAUGE_FAMILY(sparse_inverted_index_size, "sparse inverted index size (MB)")
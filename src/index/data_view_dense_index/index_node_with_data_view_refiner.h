@@ -131,6 +131,12 @@ class IndexNodeWithDataViewRefiner : public IndexNode {
         return Status::not_implemented;
     }
 
+    Status
+    SerializeToFile(const std::string& filename) const override {
+        LOG_KNOWHERE_ERROR_ << "Data View Index is parasitic on the raw data structure, do not SerializeToFile.";
+        return Status::not_implemented;
+    }
+
     Status
     Deserialize(const BinarySet& binset, std::shared_ptr<Config> cfg) override {
         LOG_KNOWHERE_ERROR_ << "Data View Index is parasitic on the raw data structure, do not Deserialize";
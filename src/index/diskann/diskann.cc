@@ -20,6 +20,7 @@
 #include "fmt/core.h"
 #include "index/diskann/diskann_config.h"
 #include "knowhere/comp/index_param.h"
+#include "knowhere/comp/search_canceller.h"
 #include "knowhere/dataset.h"
 #include "knowhere/expected.h"
 #include "knowhere/feature.h"
@@ -630,14 +631,25 @@ DiskANNIndexNode<DataType>::Search(const DataSetPtr dataset, std::unique_ptr<Con
     auto p_id = std::make_unique<int64_t[]>(k * nq);
     auto p_dist = std::make_unique<DistType[]>(k * nq);
 
+    SearchCanceller canceller(op_context, search_conf);
+    const auto should_stop = canceller.StopCheck();
+    const bool larger_is_closer = IsMetricType(search_conf.metric_type.value(), metric::IP) ||
+                                  IsMetricType(search_conf.metric_type.value(), metric::COSINE);
+
     std::vector<folly::Future<folly::Unit>> futures;
     futures.reserve(nq);
     for (int64_t row = 0; row < nq; ++row) {
         futures.emplace_back(search_pool_->push([&, index = row, p_id_ptr = p_id.get(), p_dist_ptr = p_dist.get()]() {
+            if (canceller.IsStopped()) {
+                SearchCanceller::FillEmptyResult(p_id_ptr + (index * k), p_dist_ptr + (index * k), k,
+                                                 larger_is_closer);
+                canceller.AbortQueries();
+                return;
+            }
             diskann::QueryStats stats;
             pq_flash_index_->cached_beam_search(xq + (index * dim), k, lsearch, p_id_ptr + (index * k),
                                                 p_dist_ptr + (index * k), beamwidth, false, &stats, feder_result,
-                                                bitset, filter_ratio);
+                                                bitset, filter_ratio, should_stop);
 #ifdef NOT_COMPILE_FOR_SWIG
             knowhere_diskann_search_hops.Observe(stats.n_hops);
 #endif
@@ -658,7 +670,7 @@ DiskANNIndexNode<DataType>::Search(const DataSetPtr dataset, std::unique_ptr<Con
         res->SetJsonInfo(json_visit_info.dump());
         res->SetJsonIdSet(json_id_set.dump());
     }
-    return res;
+    return canceller.Finish(res);
 }
 
 /*
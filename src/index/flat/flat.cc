@@ -13,10 +13,13 @@
 #include "faiss/IndexBinaryFlat.h"
 #include "faiss/IndexFlat.h"
 #include "faiss/impl/AuxIndexStructures.h"
+#include "faiss/impl/zerocopy_io.h"
 #include "faiss/index_io.h"
+#include "faiss/utils/Heap.h"
 #include "index/flat/flat_config.h"
 #include "io/memory_io.h"
 #include "knowhere/bitsetview_idselector.h"
+#include "knowhere/comp/search_canceller.h"
 #include "knowhere/comp/task.h"
 #include "knowhere/feature.h"
 #include "knowhere/index/index_factory.h"
@@ -24,6 +27,7 @@
 #include "knowhere/log.h"
 #include "knowhere/range_util.h"
 #include "knowhere/utils.h"
+#include "simd/hook.h"
 
 namespace knowhere {
 
@@ -55,11 +59,30 @@ class FlatIndexNode : public IndexNode {
             bool is_cosine = IsMetricType(f_cfg.metric_type.value(), knowhere::metric::COSINE);
             index_ = std::make_unique<faiss::IndexFlat>(dataset->GetDim(), metric.value(), is_cosine);
         }
+        storage_is_view_ = false;
         return Status::success;
     }
 
     Status
     Add(const DataSetPtr dataset, std::shared_ptr<Config> cfg, bool use_knowhere_build_pool) override {
+        if (storage_is_view_) {
+            // the first add after an in-place load copies the vectors out of the binary or the mapped file
+            try {
+                RETURN_IF_ERROR(CopyViewedStorage(
+                    [&](auto& writer) {
+                        WriteIndex(&writer);
+                        return Status::success;
+                    },
+                    [&](MemoryIOReader& reader) {
+                        ReadIndex(&reader);
+                        return Status::success;
+                    }));
+            } catch (const std::exception& e) {
+                LOG_KNOWHERE_WARNING_ << "error inner faiss: " << e.what();
+                return Status::faiss_inner_error;
+            }
+            storage_is_view_ = false;
+        }
         auto x = dataset->GetTensor();
         auto n = dataset->GetRows();
         index_->add(n, (const DataType*)x);
@@ -84,6 +107,7 @@ class FlatIndexNode : public IndexNode {
         auto dim = dataset->GetDim();
 
         auto len = k * nq;
+        SearchCanceller canceller(op_context, f_cfg);
         int64_t* ids = nullptr;
         float* distances = nullptr;
         try {
@@ -96,6 +120,12 @@ class FlatIndexNode : public IndexNode {
                     ThreadPool::ScopedSearchOmpSetter setter(1);
                     auto cur_ids = ids + k * index;
                     auto cur_dis = distances + k * index;
+                    if (canceller.IsStopped()) {
+                        SearchCanceller::FillEmptyResult(cur_ids, cur_dis, k,
+                                                         faiss::is_similarity_metric(index_->metric_type));
+                        canceller.AbortQueries();
+                        return;
+                    }
 
                     BitsetViewIDSelector bw_idselector(bitset);
                     faiss::IDSelector* id_selector = (bitset.empty()) ? nullptr : &bw_idselector;
@@ -138,7 +168,90 @@ class FlatIndexNode : public IndexNode {
             LOG_KNOWHERE_WARNING_ << "error inner faiss: " << e.what();
             return expected<DataSetPtr>::Err(Status::faiss_inner_error, e.what());
         }
-        return GenResultDataSet(nq, k, ids, distances);
+        return canceller.Finish(GenResultDataSet(nq, k, ids, distances));
+    }
+
+    expected<std::vector<DataSetPtr>>
+    MultiSearch(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const std::vector<int64_t>& ks,
+                const std::vector<BitsetView>& bitsets, milvus::OpContext* op_context) const override {
+        if (!index_) {
+            LOG_KNOWHERE_WARNING_ << "search on empty index";
+            return expected<std::vector<DataSetPtr>>::Err(Status::empty_index, "index not loaded");
+        }
+
+        const FlatConfig& f_cfg = static_cast<const FlatConfig&>(*cfg);
+        bool is_cosine = IsMetricType(f_cfg.metric_type.value(), knowhere::metric::COSINE);
+
+        auto nq = dataset->GetRows();
+        auto x = dataset->GetTensor();
+        auto dim = dataset->GetDim();
+
+        // offsets of the per-query result slots, query i owns [k_offsets[i], k_offsets[i + 1])
+        std::vector<int64_t> k_offsets(nq + 1, 0);
+        for (int64_t i = 0; i < nq; ++i) {
+            k_offsets[i + 1] = k_offsets[i] + ks[i];
+        }
+        auto ids = std::make_unique<int64_t[]>(k_offsets[nq]);
+        auto distances = std::make_unique<float[]>(k_offsets[nq]);
+        try {
+            if constexpr (std::is_same<IndexType, faiss::IndexFlat>::value) {
+                auto xq = (const float*)x;
+                std::unique_ptr<float[]> normalized_queries = nullptr;
+                if (is_cosine) {
+                    normalized_queries = CopyAndNormalizeVecs(xq, nq, dim);
+                    xq = normalized_queries.get();
+                }
+                if (index_->metric_type == faiss::METRIC_L2) {
+                    MultiSearchScan<faiss::CMax<float, int64_t>>(xq, nq, k_offsets, bitsets, false, distances.get(),
+                                                                 ids.get());
+                } else {
+                    MultiSearchScan<faiss::CMin<float, int64_t>>(xq, nq, k_offsets, bitsets, is_cosine,
+                                                                 distances.get(), ids.get());
+                }
+            }
+            if constexpr (std::is_same<IndexType, faiss::IndexBinaryFlat>::value) {
+                // binary codes are too cheap to compare for the shared scan to pay off
+                std::vector<folly::Future<folly::Unit>> futs;
+                futs.reserve(nq);
+                for (int i = 0; i < nq; ++i) {
+                    futs.emplace_back(search_pool_->push([&, index = i] {
+                        ThreadPool::ScopedSearchOmpSetter setter(1);
+                        auto k = ks[index];
+                        auto cur_ids = ids.get() + k_offsets[index];
+                        auto cur_dis = distances.get() + k_offsets[index];
+                        auto cur_i_dis = reinterpret_cast<int32_t*>(cur_dis);
+
+                        BitsetViewIDSelector bw_idselector(bitsets[index]);
+                        faiss::SearchParameters search_params;
+                        search_params.sel = (bitsets[index].empty()) ? nullptr : &bw_idselector;
+
+                        index_->search(1, (const uint8_t*)x + index * ((dim + 7) / 8), k, cur_i_dis, cur_ids,
+                                       &search_params);
+
+                        if (index_->metric_type == faiss::METRIC_Hamming) {
+                            for (int64_t j = 0; j < k; j++) {
+                                cur_dis[j] = static_cast<float>(cur_i_dis[j]);
+                            }
+                        }
+                    }));
+                }
+                WaitAllSuccess(futs);
+            }
+        } catch (const std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "error inner faiss: " << e.what();
+            return expected<std::vector<DataSetPtr>>::Err(Status::faiss_inner_error, e.what());
+        }
+
+        std::vector<DataSetPtr> results(nq);
+        for (int64_t i = 0; i < nq; ++i) {
+            auto k = ks[i];
+            auto cur_ids = std::make_unique<int64_t[]>(k);
+            auto cur_dis = std::make_unique<float[]>(k);
+            std::copy_n(ids.get() + k_offsets[i], k, cur_ids.get());
+            std::copy_n(distances.get() + k_offsets[i], k, cur_dis.get());
+            results[i] = GenResultDataSet(1, k, std::move(cur_ids), std::move(cur_dis));
+        }
+        return results;
     }
 
     expected<DataSetPtr>
@@ -159,6 +272,7 @@ class FlatIndexNode : public IndexNode {
         float radius = f_cfg.radius.value();
         float range_filter = f_cfg.range_filter.value();
         bool is_ip = (index_->metric_type == faiss::METRIC_INNER_PRODUCT);
+        SearchCanceller canceller(op_context, f_cfg);
 
         RangeSearchResult range_search_result;
 
@@ -170,6 +284,10 @@ class FlatIndexNode : public IndexNode {
             futs.reserve(nq);
             for (int i = 0; i < nq; ++i) {
                 futs.emplace_back(search_pool_->push([&, index = i] {
+                    if (canceller.IsStopped()) {
+                        canceller.AbortQueries();
+                        return;
+                    }
                     ThreadPool::ScopedSearchOmpSetter setter(1);
                     faiss::RangeSearchResult res(1);
 
@@ -218,7 +336,7 @@ class FlatIndexNode : public IndexNode {
             return expected<DataSetPtr>::Err(Status::faiss_inner_error, e.what());
         }
 
-        return GenResultDataSet(nq, std::move(range_search_result));
+        return canceller.Finish(GenResultDataSet(nq, std::move(range_search_result)));
     }
 
     expected<DataSetPtr>
@@ -298,15 +416,31 @@ class FlatIndexNode : public IndexNode {
             return Status::empty_index;
         }
         try {
-            MemoryIOWriter writer;
-            if constexpr (std::is_same<IndexType, faiss::IndexFlat>::value) {
-                faiss::write_index(index_.get(), &writer);
-            }
-            if constexpr (std::is_same<IndexType, faiss::IndexBinaryFlat>::value) {
-                faiss::write_index_binary(index_.get(), &writer);
-            }
-            std::shared_ptr<uint8_t[]> data(writer.data());
-            binset.Append(Type(), data, writer.tellg());
+            std::shared_ptr<uint8_t[]> data;
+            size_t size = 0;
+            RETURN_IF_ERROR(SerializeSized(
+                [&](auto& writer) {
+                    WriteIndex(&writer);
+                    return Status::success;
+                },
+                data, size));
+            binset.Append(Type(), data, size);
+            return Status::success;
+        } catch (const std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "error inner faiss: " << e.what();
+            return Status::faiss_inner_error;
+        }
+    }
+
+    Status
+    SerializeToFile(const std::string& filename) const override {
+        if (!index_) {
+            LOG_KNOWHERE_ERROR_ << "Can not serialize empty index.";
+            return Status::empty_index;
+        }
+        try {
+            faiss::FileIOWriter writer(filename.c_str());
+            WriteIndex(&writer);
             return Status::success;
         } catch (const std::exception& e) {
             LOG_KNOWHERE_WARNING_ << "error inner faiss: " << e.what();
@@ -325,15 +459,11 @@ class FlatIndexNode : public IndexNode {
             return Status::invalid_binary_set;
         }
 
-        MemoryIOReader reader(binary->data.get(), binary->size);
-        if constexpr (std::is_same<IndexType, faiss::IndexFlat>::value) {
-            faiss::Index* index = faiss::read_index(&reader);
-            index_.reset(static_cast<IndexType*>(index));
-        }
-        if constexpr (std::is_same<IndexType, faiss::IndexBinaryFlat>::value) {
-            faiss::IndexBinary* index = faiss::read_index_binary(&reader);
-            index_.reset(static_cast<IndexType*>(index));
-        }
+        // the vectors are viewed in place, the binary is kept alive by the index
+        faiss::ZeroCopyIOReader reader(binary->data.get(), binary->size,
+                                       std::make_shared<BinaryViewOwner>(binary->data));
+        ReadIndex(&reader);
+        storage_is_view_ = true;
         return Status::success;
     }
 
@@ -354,6 +484,7 @@ class FlatIndexNode : public IndexNode {
             faiss::IndexBinary* index = faiss::read_index_binary(filename.data(), io_flags);
             index_.reset(static_cast<IndexType*>(index));
         }
+        storage_is_view_ = flat_cfg.enable_mmap.value();
         return Status::success;
     }
 
@@ -393,7 +524,116 @@ class FlatIndexNode : public IndexNode {
     }
 
  private:
+    // base rows are read in blocks small enough to stay in cache while every query of a multi search consumes them
+    static constexpr int64_t kMultiSearchBlockSize = 256;
+    static constexpr int64_t kMultiSearchMinRowsPerTask = 16 * kMultiSearchBlockSize;
+
+    // one pass over the base vectors for all the queries: each task owns a range of base rows and keeps a heap per
+    // query, every block of rows is loaded once and evaluated against each query with its own bitset and top-k.
+    template <class C>
+    void
+    MultiSearchScan(const float* xq, int64_t nq, const std::vector<int64_t>& k_offsets,
+                    const std::vector<BitsetView>& bitsets, bool is_cosine, float* distances, int64_t* ids) const {
+        const int64_t dim = index_->d;
+        const int64_t ntotal = index_->ntotal;
+        const float* xb = index_->get_xb();
+        const float* norms = is_cosine ? index_->get_norms() : nullptr;
+        const int64_t total_k = k_offsets[nq];
+
+        const int64_t max_tasks = std::max<int64_t>(1, search_pool_->size());
+        const int64_t n_tasks =
+            std::clamp<int64_t>((ntotal + kMultiSearchMinRowsPerTask - 1) / kMultiSearchMinRowsPerTask, 1, max_tasks);
+        const int64_t rows_per_task = (ntotal + n_tasks - 1) / n_tasks;
+
+        std::vector<float> task_dis(n_tasks * total_k);
+        std::vector<int64_t> task_ids(n_tasks * total_k);
+        std::vector<folly::Future<folly::Unit>> futs;
+        futs.reserve(n_tasks);
+        for (int64_t t = 0; t < n_tasks; ++t) {
+            futs.emplace_back(search_pool_->push([&, t] {
+                ThreadPool::ScopedSearchOmpSetter setter(1);
+                float* heap_dis = task_dis.data() + t * total_k;
+                int64_t* heap_ids = task_ids.data() + t * total_k;
+                for (int64_t i = 0; i < nq; ++i) {
+                    faiss::heap_heapify<C>(k_offsets[i + 1] - k_offsets[i], heap_dis + k_offsets[i],
+                                           heap_ids + k_offsets[i]);
+                }
+
+                const int64_t begin = t * rows_per_task;
+                const int64_t end = std::min(ntotal, begin + rows_per_task);
+                std::vector<float> block_dis(kMultiSearchBlockSize);
+                for (int64_t j0 = begin; j0 < end; j0 += kMultiSearchBlockSize) {
+                    const int64_t nj = std::min(kMultiSearchBlockSize, end - j0);
+                    const float* y = xb + j0 * dim;
+                    for (int64_t i = 0; i < nq; ++i) {
+                        const auto& bitset = bitsets[i];
+                        const int64_t k = k_offsets[i + 1] - k_offsets[i];
+                        float* dis_i = heap_dis + k_offsets[i];
+                        int64_t* ids_i = heap_ids + k_offsets[i];
+                        if constexpr (C::is_max) {
+                            faiss::fvec_L2sqr_ny(block_dis.data(), xq + i * dim, y, dim, nj);
+                        } else {
+                            faiss::fvec_inner_products_ny(block_dis.data(), xq + i * dim, y, dim, nj);
+                        }
+                        for (int64_t j = 0; j < nj; ++j) {
+                            if (!bitset.empty() && bitset.test(j0 + j)) {
+                                continue;
+                            }
+                            float dis = block_dis[j];
+                            if (norms != nullptr) {
+                                const float norm = norms[j0 + j];
+                                dis /= (norm == 0.0f ? 1.0f : norm);
+                            }
+                            if (C::cmp(dis_i[0], dis)) {
+                                faiss::heap_replace_top<C>(k, dis_i, ids_i, dis, j0 + j);
+                            }
+                        }
+                    }
+                }
+            }));
+        }
+        WaitAllSuccess(futs);
+
+        // merge the heaps of all the tasks into the first one, then sort each query's results
+        for (int64_t i = 0; i < nq; ++i) {
+            const int64_t k = k_offsets[i + 1] - k_offsets[i];
+            float* dis_i = task_dis.data() + k_offsets[i];
+            int64_t* ids_i = task_ids.data() + k_offsets[i];
+            for (int64_t t = 1; t < n_tasks; ++t) {
+                faiss::heap_addn<C>(k, dis_i, ids_i, task_dis.data() + t * total_k + k_offsets[i],
+                                    task_ids.data() + t * total_k + k_offsets[i], k);
+            }
+            faiss::heap_reorder<C>(k, dis_i, ids_i);
+            std::copy_n(dis_i, k, distances + k_offsets[i]);
+            std::copy_n(ids_i, k, ids + k_offsets[i]);
+        }
+    }
+
+    void
+    WriteIndex(faiss::IOWriter* writer) const {
+        if constexpr (std::is_same<IndexType, faiss::IndexFlat>::value) {
+            faiss::write_index(index_.get(), writer);
+        }
+        if constexpr (std::is_same<IndexType, faiss::IndexBinaryFlat>::value) {
+            faiss::write_index_binary(index_.get(), writer);
+        }
+    }
+
+    void
+    ReadIndex(faiss::IOReader* reader) {
+        if constexpr (std::is_same<IndexType, faiss::IndexFlat>::value) {
+            faiss::Index* index = faiss::read_index(reader);
+            index_.reset(static_cast<IndexType*>(index));
+        }
+        if constexpr (std::is_same<IndexType, faiss::IndexBinaryFlat>::value) {
+            faiss::IndexBinary* index = faiss::read_index_binary(reader);
+            index_.reset(static_cast<IndexType*>(index));
+        }
+    }
+
     std::unique_ptr<IndexType> index_;
+    // the vectors are a view over a binary or a mapped file, the first add copies them out
+    bool storage_is_view_ = false;
     std::shared_ptr<ThreadPool> search_pool_;
 };
 
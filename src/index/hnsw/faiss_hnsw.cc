@@ -13,25 +13,40 @@
 #include <faiss/cppcontrib/knowhere/impl/HnswSearcher.h>
 #include <faiss/cppcontrib/knowhere/utils/Bitset.h>
 #include <faiss/utils/Heap.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <exception>
 #include <functional>
 #include <limits>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <optional>
+#include <random>
 #include <stdexcept>
 #include <string>
+#include <typeinfo>
+#include <vector>
 
 #include "common/metric.h"
+#include "faiss/Clustering.h"
 #include "faiss/IndexBinaryHNSW.h"
 #include "faiss/IndexCosine.h"
+#include "faiss/IndexFlatCodes.h"
 #include "faiss/IndexHNSW.h"
 #include "faiss/IndexRefine.h"
 #include "faiss/impl/ScalarQuantizer.h"
 #include "faiss/impl/mapped_io.h"
+#include "faiss/impl/zerocopy_io.h"
 #include "faiss/index_io.h"
+#include "faiss/utils/distances.h"
 #include "index/hnsw/faiss_hnsw_config.h"
 #include "index/hnsw/hnsw.h"
 #include "index/hnsw/impl/DummyVisitor.h"
@@ -44,6 +59,7 @@
 #include "io/memory_io.h"
 #include "knowhere/bitsetview_idselector.h"
 #include "knowhere/comp/index_param.h"
+#include "knowhere/comp/search_canceller.h"
 #include "knowhere/comp/task.h"
 #include "knowhere/comp/time_recorder.h"
 #include "knowhere/config.h"
@@ -53,6 +69,7 @@
 #include "knowhere/log.h"
 #include "knowhere/range_util.h"
 #include "knowhere/utils.h"
+#include "simd/hook.h"
 
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
 #include "knowhere/prometheus_client.h"
@@ -102,12 +119,20 @@ class BaseFaissIndexNode : public IndexNode {
             return Status::faiss_inner_error;
         }
 
+        storage_is_view = false;
+        storage_is_mmapped = false;
+        CalibrateSearchCostModels(false);
         return tryObj.value();
     }
 
     Status
     Add(const DataSetPtr dataset, std::shared_ptr<Config> cfg, bool use_knowhere_build_pool) override {
-        const BaseConfig& base_cfg = static_cast<const FaissHnswConfig&>(*cfg);
+        if (storage_is_view) {
+            // the first add after an in-place load copies the graph and the codes out of the binary or the mapped file
+            RETURN_IF_ERROR(OwnViewedStorage());
+        }
+        const FaissHnswConfig& hnsw_cfg = static_cast<const FaissHnswConfig&>(*cfg);
+        const BaseConfig& base_cfg = hnsw_cfg;
 
         // use build_pool_ to make sure the OMP threads spawned by index_->train etc
         // can inherit the low nice value of threads in build_pool_.
@@ -120,7 +145,9 @@ class BaseFaissIndexNode : public IndexNode {
                     } else {
                         setter = std::make_unique<ThreadPool::ScopedBuildOmpSetter>();
                     }
-                    return AddInternal(dataset, *cfg);
+                    RETURN_IF_ERROR(AddInternal(dataset, *cfg));
+                    // the entry points follow the vectors, so they are picked once the graph is filled
+                    return TrainEntryPoints(hnsw_cfg.num_entry_points.value());
                 })
                 .getTry();
 
@@ -129,6 +156,47 @@ class BaseFaissIndexNode : public IndexNode {
             return Status::faiss_inner_error;
         }
 
+        CalibrateSearchCostModels(false);
+        return tryObj.value();
+    }
+
+    Status
+    Merge(const IndexNode& other, std::shared_ptr<Config> cfg, bool use_knowhere_build_pool) override {
+        auto other_node = dynamic_cast<const BaseFaissIndexNode*>(&other);
+        if (other_node == nullptr || other_node->Type() != Type()) {
+            LOG_KNOWHERE_ERROR_ << "Can not merge a " << other.Type() << " index into a " << Type() << " index.";
+            return Status::invalid_args;
+        }
+        if (emb_list_offset_ != nullptr || other_node->emb_list_offset_ != nullptr) {
+            LOG_KNOWHERE_ERROR_ << "Can not merge HNSW indexes of embedding lists.";
+            return Status::not_implemented;
+        }
+        if (storage_is_view) {
+            // the merge appends to the graph and the codes, they are copied out of the binary or the mapped file first
+            RETURN_IF_ERROR(OwnViewedStorage());
+        }
+        const BaseConfig& base_cfg = static_cast<const FaissHnswConfig&>(*cfg);
+
+        // the merge runs OMP loops, like the build
+        auto tryObj =
+            build_pool
+                ->push([&] {
+                    std::unique_ptr<ThreadPool::ScopedBuildOmpSetter> setter;
+                    if (base_cfg.num_build_thread.has_value()) {
+                        setter = std::make_unique<ThreadPool::ScopedBuildOmpSetter>(base_cfg.num_build_thread.value());
+                    } else {
+                        setter = std::make_unique<ThreadPool::ScopedBuildOmpSetter>();
+                    }
+                    return MergeInternal(*other_node, *cfg);
+                })
+                .getTry();
+
+        if (!tryObj.hasValue()) {
+            LOG_KNOWHERE_WARNING_ << "faiss internal error: " << tryObj.exception().what();
+            return Status::faiss_inner_error;
+        }
+
+        CalibrateSearchCostModels(false);
         return tryObj.value();
     }
 
@@ -141,6 +209,10 @@ class BaseFaissIndexNode : public IndexNode {
  protected:
     std::shared_ptr<ThreadPool> build_pool;
     std::shared_ptr<ThreadPool> search_pool;
+    // the graph and the codes are a view over a binary or a mapped file, the first add copies them out
+    bool storage_is_view = false;
+    // the codes are a view over a mapped file, reading them may fault pages in from the disk
+    bool storage_is_mmapped = false;
 
     // train impl
     virtual Status
@@ -149,6 +221,22 @@ class BaseFaissIndexNode : public IndexNode {
     // add impl
     virtual Status
     AddInternal(const DataSetPtr dataset, const Config& cfg) = 0;
+
+    // merge impl, other has the same type
+    virtual Status
+    MergeInternal(const BaseFaissIndexNode& other, const Config& cfg) = 0;
+
+    // called whenever the graphs were built, changed or loaded
+    virtual void
+    CalibrateSearchCostModels(const bool is_mmapped) = 0;
+
+    // picks the entry points into the level 0 of each graph, none if n_entry_points is 0
+    virtual Status
+    TrainEntryPoints(const size_t n_entry_points) = 0;
+
+    // copies the graphs and the codes loaded in place into memory the index owns
+    virtual Status
+    OwnViewedStorage() = 0;
 };
 
 // returns true if the text of FaissException is about non-recognizing fourcc
@@ -165,6 +253,85 @@ is_faiss_fourcc_error(const char* what) {
            (error_msg.find("not recognized") != std::string::npos);
 }
 
+// the cosine storages keep the inverse L2 norms of their vectors next to the codes
+template <typename CosineIndex>
+static bool
+append_inverse_l2_norms(faiss::Index* dst, const faiss::Index* src) {
+    auto dst_cosine = dynamic_cast<CosineIndex*>(dst);
+    auto src_cosine = dynamic_cast<const CosineIndex*>(src);
+    if (dst_cosine == nullptr || src_cosine == nullptr) {
+        return false;
+    }
+    auto& dst_norms = dst_cosine->inverse_norms_storage.inverse_l2_norms;
+    const auto& src_norms = src_cosine->inverse_norms_storage.inverse_l2_norms;
+    dst_norms.insert(dst_norms.end(), src_norms.begin(), src_norms.end());
+    return true;
+}
+
+// whether the codes of src mean the same in dst: both storages are of the same kind, and their encoding either needs
+// no training or was trained to the same parameters
+static bool
+has_same_encoding(const faiss::Index* dst, const faiss::Index* src) {
+    if (typeid(*dst) != typeid(*src) || dst->d != src->d || dst->metric_type != src->metric_type) {
+        return false;
+    }
+    if (dynamic_cast<const faiss::IndexFlat*>(dst) != nullptr) {
+        return true;
+    }
+    auto dst_sq = dynamic_cast<const faiss::IndexScalarQuantizer*>(dst);
+    auto src_sq = dynamic_cast<const faiss::IndexScalarQuantizer*>(src);
+    if (dst_sq == nullptr || src_sq == nullptr || dst_sq->sq.qtype != src_sq->sq.qtype) {
+        return false;
+    }
+    switch (dst_sq->sq.qtype) {
+        case faiss::ScalarQuantizer::QT_fp16:
+        case faiss::ScalarQuantizer::QT_bf16:
+        case faiss::ScalarQuantizer::QT_8bit_direct:
+        case faiss::ScalarQuantizer::QT_8bit_direct_signed:
+        case faiss::ScalarQuantizer::QT_1bit_direct:
+            return true;
+        default:
+            return dst_sq->sq.trained == src_sq->sq.trained;
+    }
+}
+
+// whether the vectors of src can be appended to dst, see append_storage(). Decoding quantized codes to encode them
+// again would add a second quantization error, so that needs the exact vectors in src_raw.
+static bool
+can_append_storage(const faiss::Index* dst, const faiss::Index* src, const faiss::Index* src_raw) {
+    return has_same_encoding(dst, src) || dynamic_cast<const faiss::IndexFlat*>(src_raw) != nullptr;
+}
+
+// appends the vectors of src to the flat code storage dst. The codes are copied when both sides encode the same way,
+// otherwise the exact vectors of src_raw are encoded with the trained parameters of dst.
+static void
+append_storage(faiss::Index* dst, const faiss::Index* src, const faiss::Index* src_raw) {
+    if (has_same_encoding(dst, src)) {
+        if (dynamic_cast<const faiss::HasInverseL2Norms*>(dst) != nullptr &&
+            !append_inverse_l2_norms<faiss::IndexFlatCosine>(dst, src) &&
+            !append_inverse_l2_norms<faiss::IndexScalarQuantizerCosine>(dst, src)) {
+            throw std::runtime_error("can not append to a cosine storage without its norms");
+        }
+        // src may be a view, only use data() and size() on it
+        auto dst_codes = static_cast<faiss::IndexFlatCodes*>(dst);
+        auto src_codes = static_cast<const faiss::IndexFlatCodes*>(src);
+        const size_t dst_size = dst_codes->codes.size();
+        const size_t src_size = src_codes->ntotal * src_codes->code_size;
+        dst_codes->codes.resize(dst_size + src_size);
+        std::memcpy(dst_codes->codes.data() + dst_size, src_codes->codes.data(), src_size);
+        dst->ntotal += src->ntotal;
+        return;
+    }
+
+    constexpr faiss::idx_t batch_size = 4096;
+    std::vector<float> buf(batch_size * src_raw->d);
+    for (faiss::idx_t i = 0; i < src_raw->ntotal; i += batch_size) {
+        const faiss::idx_t n = std::min(batch_size, src_raw->ntotal - i);
+        src_raw->reconstruct_n(i, n, buf.data());
+        dst->add(n, buf.data());
+    }
+}
+
 //
 class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
  public:
@@ -179,23 +346,32 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
         }
 
         try {
-            MemoryIOWriter writer;
-            if (indexes.size() > 1) {
-                // this is a hack for compatibility, faiss index has 4-byte header to indicate index category
-                // create a new one to distinguish MV faiss hnsw from faiss hnsw
-                faiss::write_mv(&writer);
-                writeHeader(&writer);
-                for (const auto& index : indexes) {
-                    faiss::write_index(index.get(), &writer);
-                }
+            std::shared_ptr<uint8_t[]> data;
+            size_t size = 0;
+            RETURN_IF_ERROR(SerializeSized(
+                [&](auto& writer) {
+                    WriteIndexes(&writer);
+                    return Status::success;
+                },
+                data, size));
+            binset.Append(Type(), data, size);
+        } catch (const std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
+            return Status::faiss_inner_error;
+        }
 
-                std::shared_ptr<uint8_t[]> data(writer.data());
-                binset.Append(Type(), data, writer.tellg());
-            } else {
-                faiss::write_index(indexes[0].get(), &writer);
-                std::shared_ptr<uint8_t[]> data(writer.data());
-                binset.Append(Type(), data, writer.tellg());
-            }
+        return Status::success;
+    }
+
+    Status
+    SerializeToFile(const std::string& filename) const override {
+        if (isIndexEmpty()) {
+            return Status::empty_index;
+        }
+
+        try {
+            faiss::FileIOWriter writer(filename.c_str());
+            WriteIndexes(&writer);
         } catch (const std::exception& e) {
             LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
             return Status::faiss_inner_error;
@@ -212,7 +388,9 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
             return Status::invalid_binary_set;
         }
 
-        MemoryIOReader reader(binary->data.get(), binary->size);
+        // the graph and the codes are viewed in place, the binary is kept alive by the index
+        faiss::ZeroCopyIOReader reader(binary->data.get(), binary->size,
+                                       std::make_shared<BinaryViewOwner>(binary->data));
         try {
             // this is a hack for compatibility, faiss index has 4-byte header to indicate index category
             // create a new one to distinguish MV faiss hnsw from faiss hnsw
@@ -231,6 +409,7 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
                 auto read_index = std::unique_ptr<faiss::Index>(faiss::read_index(&reader));
                 indexes[0].reset(read_index.release());
             }
+            readEntryPoints(&reader);
         } catch (const std::exception& e) {
             if (is_faiss_fourcc_error(e.what())) {
                 LOG_KNOWHERE_WARNING_ << "faiss does not recognize the input index: " << e.what();
@@ -241,6 +420,9 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
             }
         }
 
+        storage_is_view = true;
+        storage_is_mmapped = false;
+        CalibrateSearchCostModels(false);
         return Status::success;
     }
 
@@ -257,8 +439,8 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
             // this is a hack for compatibility, faiss index has 4-byte header to indicate index category
             // create a new one to distinguish MV faiss hnsw from faiss hnsw
             bool is_mv = faiss::read_is_mv(filename.data());
-            if (is_mv) {
-                auto read_index = [&](faiss::IOReader* r) {
+            auto read_index = [&](faiss::IOReader* r) {
+                if (is_mv) {
                     LOG_KNOWHERE_INFO_ << "start to load index by mv";
                     read_is_mv(r);
                     uint32_t v = readHeader(r);
@@ -268,19 +450,20 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
                         auto read_index = std::unique_ptr<faiss::Index>(faiss::read_index(r, io_flags));
                         indexes[i].reset(read_index.release());
                     }
-                };
-                if ((io_flags & faiss::IO_FLAG_MMAP_IFC) == faiss::IO_FLAG_MMAP_IFC) {
-                    // enable mmap-supporting IOReader
-                    auto owner = std::make_shared<faiss::MmappedFileMappingOwner>(filename.data());
-                    faiss::MappedFileIOReader reader(owner);
-                    read_index(&reader);
                 } else {
-                    faiss::FileIOReader reader(filename.data());
-                    read_index(&reader);
+                    auto read_index = std::unique_ptr<faiss::Index>(faiss::read_index(r, io_flags));
+                    indexes[0].reset(read_index.release());
                 }
+                readEntryPoints(r);
+            };
+            if ((io_flags & faiss::IO_FLAG_MMAP_IFC) == faiss::IO_FLAG_MMAP_IFC) {
+                // enable mmap-supporting IOReader
+                auto owner = std::make_shared<faiss::MmappedFileMappingOwner>(filename.data());
+                faiss::MappedFileIOReader reader(owner);
+                read_index(&reader);
             } else {
-                auto read_index = std::unique_ptr<faiss::Index>(faiss::read_index(filename.data(), io_flags));
-                indexes[0].reset(read_index.release());
+                faiss::FileIOReader reader(filename.data());
+                read_index(&reader);
             }
         } catch (const std::exception& e) {
             if (is_faiss_fourcc_error(e.what())) {
@@ -292,6 +475,9 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
             }
         }
 
+        storage_is_view = cfg.enable_mmap.value();
+        storage_is_mmapped = cfg.enable_mmap.value();
+        CalibrateSearchCostModels(storage_is_mmapped);
         return Status::success;
     }
 
@@ -330,6 +516,7 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
         for (const auto& index : indexes) {
             faiss::write_index(index.get(), &writer);
         }
+        writeEntryPoints(&writer);
 
         // todo
         return writer.total_size;
@@ -373,6 +560,10 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
     std::vector<std::shared_ptr<faiss::Index>> indexes;
     // each index's out ids(label), can be shared with FaissHnswIterator
     std::vector<std::shared_ptr<std::vector<uint32_t>>> labels;
+    // each index's estimate of the graph and the brute force search costs
+    std::vector<HnswSearchCostModel> cost_models;
+    // each index's entry points into the level 0, empty when a search descends the upper levels
+    std::vector<std::vector<faiss::HNSW::storage_idx_t>> entry_points;
 
     // index rows, help to locate index id by offset
     std::vector<uint32_t> index_rows_sum;
@@ -381,6 +572,19 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
     // internal offset to most external id, only for 1-hop bitset check
     std::vector<uint32_t> internal_offset_to_most_external_id;
 
+    void
+    CalibrateSearchCostModels(const bool is_mmapped) override {
+        cost_models.resize(indexes.size());
+        for (size_t i = 0; i < indexes.size(); i++) {
+            cost_models[i] = HnswSearchCostModel::Calibrate(indexes[i].get(), is_mmapped);
+        }
+    }
+
+    const HnswSearchCostModel*
+    getCostModel(const int index_id) const {
+        return (index_id < (int)cost_models.size()) ? &cost_models[index_id] : nullptr;
+    }
+
     int
     getIndexToSearchByScalarInfo(const BitsetView& bitset) const {
         if (indexes.size() == 1) {
@@ -408,6 +612,87 @@ class BaseFaissRegularIndexNode : public BaseFaissIndexNode {
         return std::distance(index_rows_sum.begin(), it) - 1;
     }
 
+    // the layout shared by Serialize and SerializeToFile
+    void
+    WriteIndexes(faiss::IOWriter* writer) const {
+        if (indexes.size() > 1) {
+            // this is a hack for compatibility, faiss index has 4-byte header to indicate index category
+            // create a new one to distinguish MV faiss hnsw from faiss hnsw
+            faiss::write_mv(writer);
+            writeHeader(writer);
+            for (const auto& index : indexes) {
+                faiss::write_index(index.get(), writer);
+            }
+        } else {
+            faiss::write_index(indexes[0].get(), writer);
+        }
+        writeEntryPoints(writer);
+    }
+
+    // the entry points are always copied on load, only the indexes are written out and read back
+    Status
+    OwnViewedStorage() override {
+        try {
+            for (auto& index : indexes) {
+                RETURN_IF_ERROR(CopyViewedStorage(
+                    [&](auto& writer) {
+                        faiss::write_index(index.get(), &writer);
+                        return Status::success;
+                    },
+                    [&](MemoryIOReader& reader) {
+                        index.reset(faiss::read_index(&reader));
+                        return Status::success;
+                    }));
+            }
+        } catch (const std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
+            return Status::faiss_inner_error;
+        }
+        storage_is_view = false;
+        storage_is_mmapped = false;
+        return Status::success;
+    }
+
+    // the entry points follow the indexes, a version that does not know them stops reading before
+    void
+    writeEntryPoints(faiss::IOWriter* f) const {
+        if (std::all_of(entry_points.begin(), entry_points.end(), [](const auto& points) { return points.empty(); })) {
+            return;
+        }
+        faiss::write_value(faiss::fourcc("HNEP"), f);
+        faiss::write_value(static_cast<uint32_t>(entry_points.size()), f);
+        for (const auto& points : entry_points) {
+            faiss::write_value(static_cast<uint32_t>(points.size()), f);
+            for (const auto node : points) {
+                faiss::write_value(static_cast<uint32_t>(node), f);
+            }
+        }
+    }
+
+    void
+    readEntryPoints(faiss::IOReader* f) {
+        entry_points.clear();
+        // nothing follows the indexes of an index without entry points
+        uint32_t h = 0;
+        if ((*f)(&h, sizeof(h), 1) != 1 || h != faiss::fourcc("HNEP")) {
+            return;
+        }
+        uint32_t size = faiss::read_value(f);
+        if (size != indexes.size()) {
+            throw std::runtime_error("the entry points do not match the indexes");
+        }
+        entry_points.resize(size);
+        for (uint32_t i = 0; i < size; ++i) {
+            entry_points[i].resize(faiss::read_value(f));
+            for (auto& node : entry_points[i]) {
+                node = faiss::read_value(f);
+                if (node < 0 || node >= indexes[i]->ntotal) {
+                    throw std::runtime_error("an entry point is out of range");
+                }
+            }
+        }
+    }
+
     void
     writeHeader(faiss::IOWriter* f) const {
         uint32_t version = 0;
@@ -620,6 +905,78 @@ convert_ds_to_float(const DataSetPtr& src, DataFormatEnum data_format) {
     return nullptr;
 }
 
+// the scalar quantizer type whose codes are the input rows themselves
+std::optional<faiss::ScalarQuantizer::QuantizerType>
+get_direct_sq_type(const DataFormatEnum data_format) {
+    if (data_format == DataFormatEnum::fp16) {
+        return faiss::ScalarQuantizer::QT_fp16;
+    } else if (data_format == DataFormatEnum::bf16) {
+        return faiss::ScalarQuantizer::QT_bf16;
+    } else if (data_format == DataFormatEnum::int8) {
+        return faiss::ScalarQuantizer::QT_8bit_direct_signed;
+    }
+    return std::nullopt;
+}
+
+// An HNSW over an fp16, bf16 or int8 direct SQ storage stores the input rows as they are (int8 with the sign bit
+// flipped). The rows are appended to the storage without going through fp32 and the graph is built from the storage.
+// The rows are the ones listed in ids, or all of them without ids.
+//
+// returns nullopt if the index does not store the input format directly
+std::optional<Status>
+add_to_index_natively(faiss::Index* const __restrict index, const void* const __restrict data,
+                      const DataFormatEnum data_format, const uint32_t* const __restrict ids, const int64_t rows,
+                      const int64_t dim) {
+    const auto sq_type = get_direct_sq_type(data_format);
+    auto index_hnsw = dynamic_cast<faiss::IndexHNSW*>(index);
+    if (!sq_type.has_value() || index_hnsw == nullptr) {
+        return std::nullopt;
+    }
+    auto index_sq = dynamic_cast<faiss::IndexScalarQuantizer*>(index_hnsw->storage);
+    if (index_sq == nullptr || index_sq->sq.qtype != sq_type.value() || !index_sq->is_trained) {
+        return std::nullopt;
+    }
+
+    const size_t code_size = index_sq->code_size;
+    const uint8_t* const src = reinterpret_cast<const uint8_t*>(data);
+    const int64_t n0 = index_sq->ntotal;
+    index_sq->codes.resize((n0 + rows) * code_size);
+    uint8_t* const dst = index_sq->codes.data() + n0 * code_size;
+    for (int64_t i = 0; i < rows; i++) {
+        const int64_t row = (ids == nullptr) ? i : ids[i];
+        std::memcpy(dst + i * code_size, src + row * code_size, code_size);
+    }
+    if (data_format == DataFormatEnum::int8) {
+        // QT_8bit_direct_signed stores x + 128
+        for (size_t j = 0; j < static_cast<size_t>(rows) * code_size; j++) {
+            dst[j] ^= 0x80;
+        }
+    }
+    index_sq->ntotal += rows;
+
+    auto index_sq_cosine = dynamic_cast<faiss::IndexScalarQuantizerCosine*>(index_sq);
+    if (index_sq_cosine != nullptr) {
+        std::vector<float> l2_norms(rows);
+        for (int64_t i = 0; i < rows; i++) {
+            const int64_t row = (ids == nullptr) ? i : ids[i];
+            const uint8_t* const x = src + row * code_size;
+            float l2sqr_norm = 0;
+            if (data_format == DataFormatEnum::fp16) {
+                l2sqr_norm = faiss::fp16_vec_norm_L2sqr(reinterpret_cast<const knowhere::fp16*>(x), dim);
+            } else if (data_format == DataFormatEnum::bf16) {
+                l2sqr_norm = faiss::bf16_vec_norm_L2sqr(reinterpret_cast<const knowhere::bf16*>(x), dim);
+            } else {
+                l2sqr_norm = faiss::int8_vec_norm_L2sqr(reinterpret_cast<const int8_t*>(x), dim);
+            }
+            l2_norms[i] = std::sqrt(l2sqr_norm);
+        }
+        index_sq_cosine->inverse_norms_storage.add_l2_norms(l2_norms.data(), rows);
+    }
+
+    index_hnsw->add_from_storage();
+    return Status::success;
+}
+
 Status
 add_to_index(faiss::Index* const __restrict index, const DataSetPtr& dataset, const DataFormatEnum data_format) {
     const auto* data = dataset->GetTensor();
@@ -630,6 +987,11 @@ add_to_index(faiss::Index* const __restrict index, const DataSetPtr& dataset, co
         // add as is
         index->add(rows, reinterpret_cast<const float*>(data));
     } else {
+        auto status = add_to_index_natively(index, data, data_format, nullptr, rows, dim);
+        if (status.has_value()) {
+            return status.value();
+        }
+
         // convert data into float in pieces and add to the index
         constexpr int64_t n_tmp_rows = 4096;
         std::unique_ptr<float[]> tmp = std::make_unique<float[]>(n_tmp_rows * dim);
@@ -664,6 +1026,11 @@ add_partial_dataset_to_index(faiss::Index* const __restrict index, const DataSet
     const int64_t rows = ids.size();
     const auto dim = dataset->GetDim();
 
+    auto status = add_to_index_natively(index, data, data_format, ids.data(), rows, dim);
+    if (status.has_value()) {
+        return status.value();
+    }
+
     // convert data into float in pieces and add to the index
     constexpr int64_t n_tmp_rows = 4096;
     std::unique_ptr<float[]> tmp = std::make_unique<float[]>(n_tmp_rows * dim);
@@ -685,6 +1052,55 @@ add_partial_dataset_to_index(faiss::Index* const __restrict index, const DataSet
     return Status::success;
 }
 
+// Builds the partitions of a materialized-view index, build_partition(i) only touches the index of partition i.
+//
+// A partition that is a large share of the total cost is built alone with all the build threads, faiss parallelizes
+// the insertion internally. The others are too small to keep the threads busy that way, they are built concurrently
+// with a thread each, the most expensive first.
+Status
+build_partitions(const std::vector<int64_t>& partition_rows, const std::function<Status(size_t)>& build_partition) {
+    const int n_threads = std::max(1, omp_get_max_threads());
+
+    // inserting n rows into an HNSW graph costs about n * log(n)
+    std::vector<double> costs(partition_rows.size());
+    double total_cost = 0;
+    for (size_t i = 0; i < partition_rows.size(); ++i) {
+        costs[i] = partition_rows[i] * std::log2(partition_rows[i] + 2.0);
+        total_cost += costs[i];
+    }
+
+    std::vector<size_t> small_partitions;
+    for (size_t i = 0; i < costs.size(); ++i) {
+        if (n_threads == 1 || costs[i] * n_threads >= total_cost) {
+            RETURN_IF_ERROR(build_partition(i));
+        } else {
+            small_partitions.push_back(i);
+        }
+    }
+    std::sort(small_partitions.begin(), small_partitions.end(),
+              [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
+
+    std::vector<Status> statuses(small_partitions.size(), Status::success);
+    std::vector<std::exception_ptr> exceptions(small_partitions.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+    for (int64_t j = 0; j < (int64_t)small_partitions.size(); ++j) {
+        // keep the faiss loops below on this thread
+        omp_set_num_threads(1);
+        try {
+            statuses[j] = build_partition(small_partitions[j]);
+        } catch (...) {
+            exceptions[j] = std::current_exception();
+        }
+    }
+    for (size_t j = 0; j < small_partitions.size(); ++j) {
+        if (exceptions[j] != nullptr) {
+            std::rethrow_exception(exceptions[j]);
+        }
+        RETURN_IF_ERROR(statuses[j]);
+    }
+    return Status::success;
+}
+
 // IndexFlat and IndexFlatCosine contain raw fp32 data
 // IndexScalarQuantizer and IndexScalarQuantizerCosine may contain rar bf16 and fp16 data
 //
@@ -724,14 +1140,88 @@ get_index_data_format(const faiss::Index* index) {
     return std::nullopt;
 }
 
-// cloned from IndexHNSW.cpp
-faiss::DistanceComputer*
-storage_distance_computer(const faiss::Index* storage) {
-    if (faiss::is_similarity_metric(storage->metric_type)) {
-        return new faiss::NegativeDistanceComputer(storage->get_distance_computer());
+// asks the kernel to read in the pages of a mapped storage that back the given codes, sorted by address,
+//   so that a scattered read faults them in with a few large parallel reads instead of one page at a time
+void
+advise_codes_will_be_needed(const std::vector<std::pair<const uint8_t*, int64_t>>& sorted_codes,
+                            const size_t code_size) {
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    uintptr_t range_begin = 0;
+    uintptr_t range_end = 0;
+    auto advise_range = [&]() {
+        if (range_end > range_begin) {
+            // only a hint, the codes are read anyway if it fails
+            madvise(reinterpret_cast<void*>(range_begin), range_end - range_begin, MADV_WILLNEED);
+        }
+    };
+    for (const auto& [code, row] : sorted_codes) {
+        const uintptr_t page_begin = reinterpret_cast<uintptr_t>(code) & ~(page_size - 1);
+        const uintptr_t page_end = (reinterpret_cast<uintptr_t>(code) + code_size + page_size - 1) & ~(page_size - 1);
+        if (page_begin >= range_begin && page_begin <= range_end) {
+            range_end = std::max(range_end, page_end);
+        } else {
+            advise_range();
+            range_begin = page_begin;
+            range_end = page_end;
+        }
+    }
+    advise_range();
+}
+
+// picks the entry points into the level 0 of an HNSW graph: the k-means centroids of a sample of the stored vectors,
+//   each one mapped to its nearest sampled node. A query starts from all of them instead of descending the graph.
+std::vector<faiss::HNSW::storage_idx_t>
+train_entry_points(const faiss::IndexHNSW* index_hnsw, const size_t n_entry_points) {
+    // the sample that faiss k-means would take anyway
+    constexpr size_t max_points_per_centroid = 256;
+
+    const size_t ntotal = index_hnsw->ntotal;
+    const size_t d = index_hnsw->d;
+    if (n_entry_points == 0 || ntotal <= n_entry_points) {
+        return {};
+    }
+
+    std::vector<faiss::idx_t> sample_ids(std::min(ntotal, n_entry_points * max_points_per_centroid));
+    if (sample_ids.size() == ntotal) {
+        std::iota(sample_ids.begin(), sample_ids.end(), 0);
     } else {
-        return storage->get_distance_computer();
+        std::mt19937_64 rng(ntotal);
+        std::uniform_int_distribution<faiss::idx_t> distrib(0, ntotal - 1);
+        for (auto& id : sample_ids) {
+            id = distrib(rng);
+        }
+        std::sort(sample_ids.begin(), sample_ids.end());
+        sample_ids.erase(std::unique(sample_ids.begin(), sample_ids.end()), sample_ids.end());
+    }
+    const size_t n_sample = sample_ids.size();
+    if (n_sample <= n_entry_points) {
+        return {};
+    }
+
+    std::vector<float> sample(n_sample * d);
+    for (size_t i = 0; i < n_sample; i++) {
+        index_hnsw->storage->reconstruct(sample_ids[i], sample.data() + i * d);
+    }
+
+    std::vector<float> centroids(n_entry_points * d);
+    faiss::kmeans_clustering(d, n_sample, n_entry_points, sample.data(), centroids.data());
+
+    std::vector<float> nearest_distances(n_entry_points);
+    std::vector<int64_t> nearest(n_entry_points);
+    faiss::knn_L2sqr(centroids.data(), sample.data(), d, n_entry_points, n_sample, 1, nearest_distances.data(),
+                     nearest.data());
+
+    std::vector<faiss::HNSW::storage_idx_t> entry_points;
+    entry_points.reserve(n_entry_points);
+    for (const auto j : nearest) {
+        if (j >= 0) {
+            entry_points.push_back(sample_ids[j]);
+        }
     }
+    // empty clusters may share a node
+    std::sort(entry_points.begin(), entry_points.end());
+    entry_points.erase(std::unique(entry_points.begin(), entry_points.end()), entry_points.end());
+    return entry_points;
 }
 
 // there are chances that each partition split by scalar distribution is too small that we could not even train pq on it
@@ -938,6 +1428,7 @@ class FaissHnswIterator : public IndexIterator {
 
         searcher_type searcher(*workspace.hnsw, *workspace.qdis, workspace.graph_visitor, workspace.visited_nodes,
                                filter, 1.0f, &workspace.search_params);
+        searcher.should_stop = stop_check();
 
         // whether to track hnsw stats
         constexpr bool track_hnsw_stats = true;
@@ -1134,112 +1625,104 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
             indexes_to_reconstruct_from[i] = index_to_reconstruct_from;
         }
 
-        // perform reconstruction
+        // the storages that hold the raw data encode it directly, fp16 and bf16 bit for bit, int8 shifted by 128
+        //   and bin1 byte for byte, so the codes are copied out without a round trip through fp32
+        std::vector<const faiss::IndexFlatCodes*> codes_to_copy_from(indexes.size());
+        for (auto i = 0; i < indexes.size(); ++i) {
+            codes_to_copy_from[i] = dynamic_cast<const faiss::IndexFlatCodes*>(indexes_to_reconstruct_from[i]);
+            if (codes_to_copy_from[i] == nullptr ||
+                codes_to_copy_from[i]->code_size != codes_to_copy_from[0]->code_size) {
+                return expected<DataSetPtr>::Err(Status::invalid_index_error,
+                                                 "index inner error, cannot proceed with GetVectorByIds");
+            }
+        }
+
         auto dim = Dim();
         auto rows = dataset->GetRows();
         auto ids = dataset->GetIds();
+        const size_t code_size = codes_to_copy_from[0]->code_size;
 
-        auto get_vector = [&](int64_t id, float* result) -> bool {
+        // locate the code of every requested row
+        std::vector<std::pair<const uint8_t*, int64_t>> codes(rows);
+        const int64_t count = Count();
+        for (int64_t i = 0; i < rows; i++) {
+            const int64_t id = ids[i];
+            if (id < 0 || id >= count) {
+                return expected<DataSetPtr>::Err(Status::invalid_args, "id out of range");
+            }
             if (indexes.size() == 1) {
-                indexes_to_reconstruct_from[0]->reconstruct(id, result);
+                codes[i] = {codes_to_copy_from[0]->codes.data() + id * code_size, i};
             } else {
                 auto it =
                     std::lower_bound(index_rows_sum.begin(), index_rows_sum.end(), label_to_internal_offset[id] + 1);
                 if (it == index_rows_sum.end()) {
-                    return false;
+                    return expected<DataSetPtr>::Err(Status::invalid_index_error,
+                                                     "index inner error, cannot proceed with GetVectorByIds");
                 }
                 auto index_id = std::distance(index_rows_sum.begin(), it) - 1;
-                indexes_to_reconstruct_from[index_id]->reconstruct(
-                    label_to_internal_offset[id] - index_rows_sum[index_id], result);
+                auto offset = label_to_internal_offset[id] - index_rows_sum[index_id];
+                codes[i] = {codes_to_copy_from[index_id]->codes.data() + offset * code_size, i};
             }
-            return true;
-        };
+        }
 
-        try {
-            // limit the parallel of reconstruction
-            ThreadPool::ScopedSearchOmpSetter setter(1);
+        // read the codes in the storage order, the rows that share a page or a cache line are read together
+        std::sort(codes.begin(), codes.end());
+        if (storage_is_mmapped) {
+            advise_codes_will_be_needed(codes, code_size);
+        }
 
-            if (data_format == DataFormatEnum::fp32) {
-                // perform a direct reconstruction for fp32 data
-                auto data = std::make_unique<float[]>(dim * rows);
-                for (int64_t i = 0; i < rows; i++) {
-                    const int64_t id = ids[i];
-                    assert(id >= 0 && id < Count());
-                    if (!get_vector(id, data.get() + i * dim)) {
-                        return expected<DataSetPtr>::Err(Status::invalid_index_error,
-                                                         "index inner error, cannot proceed with GetVectorByIds");
-                    }
+        auto copy_codes = [&](uint8_t* data, const int64_t begin, const int64_t end) {
+            constexpr int64_t prefetch_distance = 4;
+            for (int64_t i = begin; i < end; i++) {
+                if (i + prefetch_distance < end) {
+                    __builtin_prefetch(codes[i + prefetch_distance].first);
                 }
-                return GenResultDataSet(rows, dim, std::move(data));
-            } else if (data_format == DataFormatEnum::fp16) {
-                auto data = std::make_unique<knowhere::fp16[]>(dim * rows);
-                // faiss produces fp32 data format, we need some other format.
-                // Let's create a temporary fp32 buffer for this.
-                auto tmp = std::make_unique<float[]>(dim);
-                for (int64_t i = 0; i < rows; i++) {
-                    const int64_t id = ids[i];
-                    assert(id >= 0 && id < Count());
-                    if (!get_vector(id, tmp.get())) {
-                        return expected<DataSetPtr>::Err(Status::invalid_index_error,
-                                                         "index inner error, cannot proceed with GetVectorByIds");
-                    }
-                    if (!convert_rows_from_fp32(tmp.get(), data.get(), data_format, i, 1, dim)) {
-                        return expected<DataSetPtr>::Err(Status::invalid_args, "Unsupported data format");
+                const auto& [code, row] = codes[i];
+                uint8_t* dst = data + row * code_size;
+                if (data_format == DataFormatEnum::int8) {
+                    for (size_t j = 0; j < code_size; j++) {
+                        dst[j] = code[j] ^ 0x80;
                     }
+                } else {
+                    std::memcpy(dst, code, code_size);
                 }
-                return GenResultDataSet(rows, dim, std::move(data));
-            } else if (data_format == DataFormatEnum::bf16) {
-                auto data = std::make_unique<knowhere::bf16[]>(dim * rows);
-                // faiss produces fp32 data format, we need some other format.
-                // Let's create a temporary fp32 buffer for this.
-                auto tmp = std::make_unique<float[]>(dim);
-                for (int64_t i = 0; i < rows; i++) {
-                    const int64_t id = ids[i];
-                    assert(id >= 0 && id < Count());
-                    if (!get_vector(id, tmp.get())) {
-                        return expected<DataSetPtr>::Err(Status::invalid_index_error,
-                                                         "index inner error, cannot proceed with GetVectorByIds");
-                    }
-                    if (!convert_rows_from_fp32(tmp.get(), data.get(), data_format, i, 1, dim)) {
-                        return expected<DataSetPtr>::Err(Status::invalid_args, "Unsupported data format");
-                    }
+            }
+        };
+
+        auto gather = [&](auto data, const size_t row_size) -> expected<DataSetPtr> {
+            if (row_size != code_size) {
+                return expected<DataSetPtr>::Err(Status::invalid_index_error,
+                                                 "index inner error, cannot proceed with GetVectorByIds");
+            }
+            auto dst = reinterpret_cast<uint8_t*>(data.get());
+            // a large request is split into runs of consecutive codes, small ones are not worth a task
+            constexpr int64_t chunk_rows = 1024;
+            if (rows <= chunk_rows) {
+                copy_codes(dst, 0, rows);
+            } else {
+                std::vector<folly::Future<folly::Unit>> futs;
+                futs.reserve((rows + chunk_rows - 1) / chunk_rows);
+                for (int64_t begin = 0; begin < rows; begin += chunk_rows) {
+                    const int64_t end = std::min(begin + chunk_rows, rows);
+                    futs.emplace_back(search_pool->push([&, begin, end] { copy_codes(dst, begin, end); }));
                 }
-                return GenResultDataSet(rows, dim, std::move(data));
+                WaitAllSuccess(futs);
+            }
+            return GenResultDataSet(rows, dim, std::move(data));
+        };
+
+        try {
+            if (data_format == DataFormatEnum::fp32) {
+                return gather(std::make_unique<float[]>(dim * rows), dim * sizeof(float));
+            } else if (data_format == DataFormatEnum::fp16) {
+                return gather(std::make_unique<knowhere::fp16[]>(dim * rows), dim * sizeof(knowhere::fp16));
+            } else if (data_format == DataFormatEnum::bf16) {
+                return gather(std::make_unique<knowhere::bf16[]>(dim * rows), dim * sizeof(knowhere::bf16));
             } else if (data_format == DataFormatEnum::int8) {
-                auto data = std::make_unique<knowhere::int8[]>(dim * rows);
-                // faiss produces fp32 data format, we need some other format.
-                // Let's create a temporary fp32 buffer for this.
-                auto tmp = std::make_unique<float[]>(dim);
-                for (int64_t i = 0; i < rows; i++) {
-                    const int64_t id = ids[i];
-                    assert(id >= 0 && id < Count());
-                    if (!get_vector(id, tmp.get())) {
-                        return expected<DataSetPtr>::Err(Status::invalid_index_error,
-                                                         "index inner error, cannot proceed with GetVectorByIds");
-                    }
-                    if (!convert_rows_from_fp32(tmp.get(), data.get(), data_format, i, 1, dim)) {
-                        return expected<DataSetPtr>::Err(Status::invalid_args, "Unsupported data format");
-                    }
-                }
-                return GenResultDataSet(rows, dim, std::move(data));
+                return gather(std::make_unique<knowhere::int8[]>(dim * rows), dim * sizeof(knowhere::int8));
             } else if (data_format == DataFormatEnum::bin1) {
                 auto uint8_dim = (dim + 7) / 8;
-                auto data = std::make_unique<knowhere::bin1[]>(uint8_dim * rows);
-                // faiss produces fp32 data format, we need some other format.
-                // Let's create a temporary fp32 buffer for this.
-                auto tmp = std::make_unique<float[]>(uint8_dim);
-                for (int64_t i = 0; i < rows; i++) {
-                    const int64_t id = ids[i];
-                    assert(id >= 0 && id < Count());
-                    if (!get_vector(id, tmp.get())) {
-                        return expected<DataSetPtr>::Err(Status::invalid_index_error,
-                                                         "index inner error, cannot proceed with GetVectorByIds");
-                    }
-                    if (!convert_rows_from_fp32(tmp.get(), data.get(), data_format, i, 1, dim)) {
-                        return expected<DataSetPtr>::Err(Status::invalid_args, "Unsupported data format");
-                    }
-                }
-                return GenResultDataSet(rows, dim, std::move(data));
+                return gather(std::make_unique<knowhere::bin1[]>(uint8_dim * rows), uint8_dim * sizeof(knowhere::bin1));
             } else {
                 return expected<DataSetPtr>::Err(Status::invalid_args, "Unsupported data format");
             }
@@ -1313,7 +1796,8 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
         }
 
         // check for brute-force search
-        auto whether_bf_search = WhetherPerformBruteForceSearch(indexes[index_id].get(), hnsw_cfg, bitset);
+        auto whether_bf_search =
+            WhetherPerformBruteForceSearch(indexes[index_id].get(), hnsw_cfg, bitset, getCostModel(index_id));
 
         if (!whether_bf_search.has_value()) {
             return expected<DataSetPtr>::Err(Status::invalid_args, "k parameter is missing");
@@ -1356,12 +1840,42 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
         hnsw_search_params.feder = feder_result.get();
         // set up kAlpha
         hnsw_search_params.kAlpha = bitset.filter_ratio() * 0.7f;
+        hnsw_search_params.two_hop_filter = hnsw_cfg.two_hop_filter.value();
+        if (index_id < (int)entry_points.size()) {
+            hnsw_search_params.entry_points = entry_points[index_id].data();
+            hnsw_search_params.n_entry_points = entry_points[index_id].size();
+        }
+        // set up the adaptive termination, a ratio below 1 would cut the walk inside the top-k
+        hnsw_search_params.early_stop_patience = hnsw_cfg.early_stop_patience.value();
+        float early_stop_ratio = hnsw_cfg.early_stop_ratio.value();
+        if (early_stop_ratio == 0.0f && hnsw_cfg.learned_early_stop.value()) {
+            const HnswSearchCostModel* cost_model = getCostModel(index_id);
+            if (cost_model != nullptr && cost_model->IsCalibratedFor(indexes[index_id].get())) {
+                early_stop_ratio = cost_model->EarlyStopRatio(k);
+            }
+        }
+        hnsw_search_params.early_stop_ratio = (early_stop_ratio > 0.0f) ? std::max(early_stop_ratio, 1.0f) : 0.0f;
+
+        // a lazy refine reranks the candidates within the graph search, the refine wrapper is bypassed then
+        faiss::Index* lazy_refine_index_ptr = nullptr;
+        if (is_refined && hnsw_cfg.lazy_refine.value() && !whether_bf_search.value_or(false)) {
+            if (const auto* refine_wrapper = dynamic_cast<const faiss::IndexRefine*>(index_wrapper_ptr)) {
+                lazy_refine_index_ptr = refine_wrapper->base_index;
+                hnsw_search_params.refine_index = refine_wrapper->refine_index;
+                hnsw_search_params.rerank_window = (size_t)(k * hnsw_cfg.refine_k.value_or(1));
+                hnsw_search_params.rerank_error_margin = hnsw_cfg.lazy_refine_margin.value();
+            }
+        }
 
         // set up a selector
         BitsetViewIDSelector bw_idselector(bitset);
         faiss::IDSelector* id_selector = &bw_idselector;
         hnsw_search_params.sel = id_selector;
 
+        // set up cancellation
+        SearchCanceller canceller(op_context, hnsw_cfg);
+        const bool is_similarity_metric = faiss::is_similarity_metric(indexes[index_id]->metric_type);
+
         // run
         auto ids = std::make_unique<faiss::idx_t[]>(rows * k);
         auto distances = std::make_unique<float[]>(rows * k);
@@ -1373,10 +1887,26 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
             for (int64_t i = 0; i < rows; ++i) {
                 futs.emplace_back(search_pool->push([&, idx = i, is_refined = is_refined,
                                                      index_wrapper_ptr = index_wrapper_ptr,
-                                                     bf_index_wrapper_ptr = bf_index_wrapper_ptr]() {
+                                                     bf_index_wrapper_ptr = bf_index_wrapper_ptr,
+                                                     lazy_refine_index_ptr = lazy_refine_index_ptr]() {
                     // 1 thread per element
                     ThreadPool::ScopedSearchOmpSetter setter(1);
 
+                    // set up local results
+                    faiss::idx_t* const __restrict local_ids = ids.get() + k * idx;
+                    float* const __restrict local_distances = distances.get() + k * idx;
+
+                    if (canceller.IsStopped()) {
+                        SearchCanceller::FillEmptyResult(local_ids, local_distances, k, is_similarity_metric);
+                        canceller.AbortQueries();
+                        return;
+                    }
+
+                    // the query is counted as aborted if the traversal is cut short
+                    bool query_stopped = false;
+                    auto query_params = hnsw_search_params;
+                    query_params.should_stop = canceller.StopCheck(&query_stopped);
+
                     // set up a query
                     const float* cur_query = nullptr;
 
@@ -1388,10 +1918,6 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
                         cur_query = cur_query_tmp.data();
                     }
 
-                    // set up local results
-                    faiss::idx_t* const __restrict local_ids = ids.get() + k * idx;
-                    float* const __restrict local_distances = distances.get() + k * idx;
-
                     // check if we need to perform a brute-force search bcz of the lack of results
                     auto bf_search_needed = [&]() -> bool {
                         size_t real_topk = 0;
@@ -1403,30 +1929,47 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
                         }
                         if (real_topk < k && real_topk < bitset.size() - bitset.count() &&
                             bf_index_wrapper_ptr != nullptr) {
+                            // a stopped request keeps what the graph search has found
+                            if (canceller.IsStopped()) {
+                                query_stopped = true;
+                                return false;
+                            }
                             return true;
                         }
                         return false;
                     };
 
                     // perform the search
-                    if (is_refined) {
+                    if (lazy_refine_index_ptr != nullptr) {
+                        lazy_refine_index_ptr->search(1, cur_query, k, local_distances, local_ids, &query_params);
+                        if (bf_search_needed()) {
+                            faiss::IndexRefineSearchParameters refine_params;
+                            refine_params.k_factor = hnsw_cfg.refine_k.value_or(1);
+                            // a refine procedure itself does not need to care about filtering
+                            refine_params.sel = nullptr;
+                            refine_params.base_index_params = &query_params;
+                            bf_index_wrapper_ptr->search(1, cur_query, k, local_distances, local_ids, &refine_params);
+                        }
+                    } else if (is_refined) {
                         faiss::IndexRefineSearchParameters refine_params;
                         refine_params.k_factor = hnsw_cfg.refine_k.value_or(1);
                         // a refine procedure itself does not need to care about filtering
                         refine_params.sel = nullptr;
-                        refine_params.base_index_params = &hnsw_search_params;
+                        refine_params.base_index_params = &query_params;
 
                         index_wrapper_ptr->search(1, cur_query, k, local_distances, local_ids, &refine_params);
                         if (bf_search_needed()) {
                             bf_index_wrapper_ptr->search(1, cur_query, k, local_distances, local_ids, &refine_params);
                         }
                     } else {
-                        index_wrapper_ptr->search(1, cur_query, k, local_distances, local_ids, &hnsw_search_params);
+                        index_wrapper_ptr->search(1, cur_query, k, local_distances, local_ids, &query_params);
                         if (bf_search_needed()) {
-                            bf_index_wrapper_ptr->search(1, cur_query, k, local_distances, local_ids,
-                                                         &hnsw_search_params);
+                            bf_index_wrapper_ptr->search(1, cur_query, k, local_distances, local_ids, &query_params);
                         }
                     }
+                    if (query_stopped) {
+                        canceller.AbortQueries();
+                    }
 
                     if (!labels.empty()) {
                         for (auto j = 0; j < k; ++j) {
@@ -1454,7 +1997,7 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
             res->SetJsonIdSet(json_id_set.dump());
         }
 
-        return res;
+        return canceller.Finish(res);
     }
 
     std::optional<size_t>
@@ -1508,6 +2051,18 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
             return expected<DataSetPtr>::Err(Status::invalid_args, "partition key value not correctly set");
         }
 
+        // map the labels to the offsets inside the selected partition once, so that every query
+        //   can evaluate all of its distances with a single gathered batch
+        const faiss::idx_t* internal_ids = labels;
+        std::vector<faiss::idx_t> partition_ids;
+        if (indexes.size() > 1) {
+            partition_ids.resize(labels_len);
+            for (size_t j = 0; j < labels_len; j++) {
+                partition_ids[j] = label_to_internal_offset[labels[j]] - index_rows_sum[index_id];
+            }
+            internal_ids = partition_ids.data();
+        }
+
         try {
             std::vector<folly::Future<folly::Unit>> futs;
             futs.reserve(rows);
@@ -1534,13 +2089,7 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
                     }
 
                     dist_computer->set_query(cur_query);
-                    for (auto j = 0; j < labels_len; j++) {
-                        auto id = labels[j];
-                        if (indexes.size() > 1) {
-                            id = label_to_internal_offset[labels[j]] - index_rows_sum[index_id];
-                        }
-                        distances[idx * labels_len + j] = (*dist_computer)(id);
-                    }
+                    dist_computer->distances_by_ids(internal_ids, labels_len, distances.get() + idx * labels_len);
                 }));
             }
             // wait for the completion
@@ -1612,7 +2161,8 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
         }
 
         // check for brute-force search
-        auto whether_bf_search = WhetherPerformBruteForceRangeSearch(indexes[index_id].get(), hnsw_cfg, bitset);
+        auto whether_bf_search =
+            WhetherPerformBruteForceRangeSearch(indexes[index_id].get(), hnsw_cfg, bitset, getCostModel(index_id));
 
         if (!whether_bf_search.has_value()) {
             return expected<DataSetPtr>::Err(Status::invalid_args, "ef parameter is missing");
@@ -1644,12 +2194,20 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
         hnsw_search_params.feder = feder_result.get();
         // set up kAlpha
         hnsw_search_params.kAlpha = bitset.filter_ratio() * 0.7f;
+        hnsw_search_params.two_hop_filter = hnsw_cfg.two_hop_filter.value();
+        if (index_id < (int)entry_points.size()) {
+            hnsw_search_params.entry_points = entry_points[index_id].data();
+            hnsw_search_params.n_entry_points = entry_points[index_id].size();
+        }
 
         // set up a selector
         BitsetViewIDSelector bw_idselector(bitset);
         faiss::IDSelector* id_selector = &bw_idselector;
         hnsw_search_params.sel = id_selector;
 
+        // set up cancellation
+        SearchCanceller canceller(op_context, hnsw_cfg);
+
         ////////////////////////////////////////////////////////////////
         // run
         std::vector<std::vector<int64_t>> result_id_array(rows);
@@ -1665,9 +2223,19 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
 
             futs.emplace_back(
                 search_pool->push([&, idx = i, is_refined = is_refined, index_wrapper_ptr = index_wrapper_ptr] {
+                    if (canceller.IsStopped()) {
+                        canceller.AbortQueries();
+                        return;
+                    }
+
                     // 1 thread per element
                     ThreadPool::ScopedSearchOmpSetter setter(1);
 
+                    // the query is counted as aborted if the traversal is cut short
+                    bool query_stopped = false;
+                    auto query_params = hnsw_search_params;
+                    query_params.should_stop = canceller.StopCheck(&query_stopped);
+
                     // set up a query
                     const float* cur_query = nullptr;
 
@@ -1688,11 +2256,14 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
                         refine_params.k_factor = hnsw_cfg.refine_k.value_or(1);
                         // a refine procedure itself does not need to care about filtering
                         refine_params.sel = nullptr;
-                        refine_params.base_index_params = &hnsw_search_params;
+                        refine_params.base_index_params = &query_params;
 
                         index_wrapper_ptr->range_search(1, cur_query, radius, &res, &refine_params);
                     } else {
-                        index_wrapper_ptr->range_search(1, cur_query, radius, &res, &hnsw_search_params);
+                        index_wrapper_ptr->range_search(1, cur_query, radius, &res, &query_params);
+                    }
+                    if (query_stopped) {
+                        canceller.AbortQueries();
                     }
 
                     // post-process
@@ -1727,7 +2298,7 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
         RangeSearchResult range_search_result =
             GetRangeSearchResult(result_dist_array, result_id_array, is_similarity_metric, rows, radius, range_filter);
 
-        return GenResultDataSet(rows, std::move(range_search_result));
+        return canceller.Finish(GenResultDataSet(rows, std::move(range_search_result)));
     }
 
  protected:
@@ -1766,7 +2337,7 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
 
         try {
             for (const auto& [field_id, scalar_info] : scalar_info_map) {
-                for (auto i = 0; i < tmp_combined_scalar_ids.size(); ++i) {
+                return build_partitions(PartitionRows(scalar_info), [&](size_t i) {
                     for (auto j = 0; j < tmp_combined_scalar_ids[i].size(); ++j) {
                         auto id = tmp_combined_scalar_ids[i][j];
                         // hnsw
@@ -1778,13 +2349,118 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
                             return status;
                         }
                     }
+                    return Status::success;
+                });
+            }
+        } catch (const std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
+            return Status::faiss_inner_error;
+        }
+
+        return Status::success;
+    }
+
+    Status
+    TrainEntryPoints(const size_t n_entry_points) override {
+        entry_points.clear();
+        if (n_entry_points == 0) {
+            return Status::success;
+        }
+        // k-means needs float vectors
+        if (data_format == DataFormatEnum::bin1) {
+            LOG_KNOWHERE_WARNING_ << "Entry points are not supported for binary HNSW indexes, descending the graphs";
+            return Status::success;
+        }
+
+        try {
+            entry_points.resize(indexes.size());
+            for (size_t i = 0; i < indexes.size(); i++) {
+                auto refine = dynamic_cast<const faiss::IndexRefine*>(indexes[i].get());
+                auto hnsw =
+                    dynamic_cast<const faiss::IndexHNSW*>(refine != nullptr ? refine->base_index : indexes[i].get());
+                if (hnsw == nullptr) {
+                    entry_points.clear();
+                    return Status::invalid_index_error;
                 }
+                entry_points[i] = train_entry_points(hnsw, n_entry_points);
             }
         } catch (const std::exception& e) {
             LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
+            entry_points.clear();
             return Status::faiss_inner_error;
         }
+        return Status::success;
+    }
+
+    Status
+    MergeInternal(const BaseFaissIndexNode& other, const Config& cfg) override {
+        const auto& other_node = static_cast<const BaseFaissRegularIndexHNSWNode&>(other);
+        if (isIndexEmpty() || other_node.isIndexEmpty()) {
+            LOG_KNOWHERE_ERROR_ << "Can not merge empty HNSW indexes.";
+            return Status::empty_index;
+        }
+        if (data_format != other_node.data_format) {
+            LOG_KNOWHERE_ERROR_ << "Can not merge HNSW indexes of different data types.";
+            return Status::invalid_args;
+        }
+        if (indexes.size() != 1 || other_node.indexes.size() != 1) {
+            LOG_KNOWHERE_ERROR_ << "Can not merge HNSW indexes partitioned by scalar info.";
+            return Status::not_implemented;
+        }
+
+        auto refine = dynamic_cast<faiss::IndexRefine*>(indexes[0].get());
+        auto other_refine = dynamic_cast<const faiss::IndexRefine*>(other_node.indexes[0].get());
+        auto hnsw = dynamic_cast<faiss::IndexHNSW*>(refine != nullptr ? refine->base_index : indexes[0].get());
+        auto other_hnsw = dynamic_cast<const faiss::IndexHNSW*>(other_refine != nullptr ? other_refine->base_index
+                                                                                        : other_node.indexes[0].get());
+        // everything is checked before the first vector is appended
+        if (hnsw == nullptr || other_hnsw == nullptr || (refine == nullptr) != (other_refine == nullptr) ||
+            hnsw->d != other_hnsw->d || hnsw->metric_type != other_hnsw->metric_type ||
+            hnsw->hnsw.cum_nneighbor_per_level != other_hnsw->hnsw.cum_nneighbor_per_level ||
+            typeid(*hnsw->storage) != typeid(*other_hnsw->storage) ||
+            (refine != nullptr && typeid(*refine->refine_index) != typeid(*other_refine->refine_index))) {
+            LOG_KNOWHERE_ERROR_ << "Can not merge HNSW indexes built with different parameters.";
+            return Status::invalid_args;
+        }
+        // a quantized storage trained apart is encoded again from the refine data, if it keeps the exact vectors
+        const faiss::Index* other_raw = other_refine != nullptr ? other_refine->refine_index : other_hnsw->storage;
+        if (!can_append_storage(hnsw->storage, other_hnsw->storage, other_raw) ||
+            (refine != nullptr &&
+             !can_append_storage(refine->refine_index, other_refine->refine_index, other_refine->refine_index))) {
+            LOG_KNOWHERE_ERROR_ << "Can not merge HNSW indexes whose quantizers were trained differently.";
+            return Status::invalid_args;
+        }
+
+        const auto& hnsw_cfg = static_cast<const FaissHnswConfig&>(cfg);
+        knowhere::TimeRecorder merge_time("Merging HNSW indexes", 2);
+        const auto n0 = hnsw->ntotal;
+        try {
+            if (refine != nullptr) {
+                append_storage(refine->refine_index, other_refine->refine_index, other_refine->refine_index);
+            }
+            append_storage(hnsw->storage, other_hnsw->storage, other_raw);
 
+            hnsw->hnsw.efConstruction = hnsw_cfg.efConstruction.value();
+            hnsw->merge_graph_from(*other_hnsw);
+            if (refine != nullptr) {
+                refine->ntotal = hnsw->ntotal;
+            }
+
+            // both halves keep their entry points, a search starts from either one
+            if (!entry_points.empty() && !entry_points[0].empty() && !other_node.entry_points.empty() &&
+                !other_node.entry_points[0].empty()) {
+                for (const auto node : other_node.entry_points[0]) {
+                    entry_points[0].push_back(node + n0);
+                }
+            } else {
+                entry_points.clear();
+            }
+        } catch (const std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
+            return Status::faiss_inner_error;
+        }
+        merge_time.ElapseFromBegin("done");
+        LOG_KNOWHERE_INFO_ << "Merged " << other_hnsw->ntotal << " vectors into an HNSW index of " << n0 << " vectors";
         return Status::success;
     }
 
@@ -1835,44 +2511,58 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
         return index_to_reconstruct_from;
     }
 
+    // the number of rows of each combined partition
+    std::vector<int64_t>
+    PartitionRows(const std::vector<std::vector<uint32_t>>& scalar_info) const {
+        std::vector<int64_t> partition_rows(tmp_combined_scalar_ids.size(), 0);
+        for (size_t i = 0; i < tmp_combined_scalar_ids.size(); ++i) {
+            for (int j : tmp_combined_scalar_ids[i]) {
+                partition_rows[i] += scalar_info[j].size();
+            }
+        }
+        return partition_rows;
+    }
+
+    // train_index is called concurrently for different partitions. Without train_on_data it gets no vectors, for the
+    // indexes whose training does not look at them.
     Status
     TrainIndexByScalarInfo(std::function<Status(const float* data, const int i, const int64_t rows)> train_index,
                            const std::vector<std::vector<uint32_t>>& scalar_info, const void* data, const int64_t rows,
-                           const int64_t dim) {
+                           const int64_t dim, const bool train_on_data = true) {
+        const auto partition_rows = PartitionRows(scalar_info);
         label_to_internal_offset.resize(rows);
         index_rows_sum.resize(tmp_combined_scalar_ids.size() + 1);
         labels.resize(tmp_combined_scalar_ids.size());
         indexes.resize(tmp_combined_scalar_ids.size());
         for (auto i = 0; i < tmp_combined_scalar_ids.size(); ++i) {
-            size_t partition_size = 0;
-            for (int j : tmp_combined_scalar_ids[i]) {
-                partition_size += scalar_info[j].size();
-            }
-            std::unique_ptr<float[]> tmp_data = std::make_unique<float[]>(dim * partition_size);
-            labels[i] = std::make_shared<std::vector<uint32_t>>(partition_size);
-            index_rows_sum[i + 1] = index_rows_sum[i] + partition_size;
+            labels[i] = std::make_shared<std::vector<uint32_t>>(partition_rows[i]);
+            index_rows_sum[i + 1] = index_rows_sum[i] + partition_rows[i];
             size_t cur_size = 0;
-
-            for (size_t j = 0; j < tmp_combined_scalar_ids[i].size(); ++j) {
-                auto scalar_id = tmp_combined_scalar_ids[i][j];
-                if (!convert_rows_to_fp32(data, tmp_data.get() + dim * cur_size, data_format,
-                                          scalar_info[scalar_id].data(), scalar_info[scalar_id].size(), dim)) {
-                    LOG_KNOWHERE_ERROR_ << "Unsupported data format";
-                    return Status::invalid_args;
-                }
+            for (int scalar_id : tmp_combined_scalar_ids[i]) {
                 for (size_t m = 0; m < scalar_info[scalar_id].size(); ++m) {
                     labels[i]->operator[](cur_size + m) = scalar_info[scalar_id][m];
                     label_to_internal_offset[scalar_info[scalar_id][m]] = index_rows_sum[i] + cur_size + m;
                 }
                 cur_size += scalar_info[scalar_id].size();
             }
+        }
 
-            Status s = train_index((const float*)(tmp_data.get()), i, partition_size);
-            if (s != Status::success) {
-                return s;
+        return build_partitions(partition_rows, [&](size_t i) {
+            if (!train_on_data) {
+                return train_index(nullptr, i, partition_rows[i]);
             }
-        }
-        return Status::success;
+            std::unique_ptr<float[]> tmp_data = std::make_unique<float[]>(dim * partition_rows[i]);
+            size_t cur_size = 0;
+            for (int scalar_id : tmp_combined_scalar_ids[i]) {
+                if (!convert_rows_to_fp32(data, tmp_data.get() + dim * cur_size, data_format,
+                                          scalar_info[scalar_id].data(), scalar_info[scalar_id].size(), dim)) {
+                    LOG_KNOWHERE_ERROR_ << "Unsupported data format";
+                    return Status::invalid_args;
+                }
+                cur_size += scalar_info[scalar_id].size();
+            }
+            return train_index((const float*)(tmp_data.get()), i, partition_rows[i]);
+        });
     }
 
  public:
@@ -1930,6 +2620,7 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
         const bool larger_is_closer = (IsMetricType(hnsw_cfg.metric_type.value(), knowhere::metric::IP) || is_cosine);
 
         const auto ef = hnsw_cfg.ef.value_or(kIteratorSeedEf);
+        auto canceller = SearchCanceller::MakeShared(op_context, hnsw_cfg);
 
         try {
             for (int64_t i = 0; i < n_queries; i++) {
@@ -1967,6 +2658,7 @@ class BaseFaissRegularIndexHNSWNode : public BaseFaissRegularIndexNode {
                     indexes[index_id], labels.empty() ? nullptr : labels[index_id], std::move(cur_query), bitset, ef,
                     larger_is_closer, iterator_refine_ratio, label_to_internal_offset, mv_base_offset,
                     use_knowhere_search_pool);
+                it->set_canceller(canceller);
                 // store
                 vec[i] = it;
             }
@@ -2023,8 +2715,8 @@ class BaseFaissRegularIndexHNSWFlatNode : public BaseFaissRegularIndexHNSWNode {
         const bool is_cosine = IsMetricType(hnsw_cfg.metric_type.value(), metric::COSINE);
         const bool is_binary = data_format == DataFormatEnum::bin1;
 
-        std::unique_ptr<faiss::IndexHNSW> hnsw_index;
         auto train_index = [&](const float* data, const int i, const int64_t rows) {
+            std::unique_ptr<faiss::IndexHNSW> hnsw_index;
             if (is_binary) {
                 if (metric.value() == faiss::MetricType::METRIC_Hamming ||
                     metric.value() == faiss::MetricType::METRIC_Jaccard) {
@@ -2071,6 +2763,7 @@ class BaseFaissRegularIndexHNSWFlatNode : public BaseFaissRegularIndexHNSWNode {
             }
 
             hnsw_index->hnsw.efConstruction = hnsw_cfg.efConstruction.value();
+            hnsw_index->keep_max_size_level0 = hnsw_cfg.dense_level0.value();
             // train
             LOG_KNOWHERE_INFO_ << "Training HNSW Index";
             // this function does nothing for the given parameters and indices.
@@ -2103,7 +2796,8 @@ class BaseFaissRegularIndexHNSWFlatNode : public BaseFaissRegularIndexHNSWNode {
 
         LOG_KNOWHERE_INFO_ << "Train HNSW index with Scalar Info";
         for (const auto& [field_id, scalar_info] : scalar_info_map) {
-            return TrainIndexByScalarInfo(train_index, scalar_info, data, rows, dim);
+            // training a flat or a direct SQ storage does not look at the data
+            return TrainIndexByScalarInfo(train_index, scalar_info, data, rows, dim, /*train_on_data=*/false);
         }
         return Status::success;
     }
@@ -2164,6 +2858,20 @@ class HNSWIndexNodeWithFallback : public IndexNode {
         }
     }
 
+    Status
+    Merge(const IndexNode& other, std::shared_ptr<Config> cfg, bool use_knowhere_build_pool) override {
+        auto other_node = dynamic_cast<const HNSWIndexNodeWithFallback*>(&other);
+        if (other_node == nullptr || other_node->use_base_index != use_base_index) {
+            LOG_KNOWHERE_ERROR_ << "Can not merge a " << other.Type() << " index into a " << Type() << " index.";
+            return Status::invalid_args;
+        }
+        if (use_base_index) {
+            return base_index->Merge(*other_node->base_index, cfg, use_knowhere_build_pool);
+        } else {
+            return fallback_search_index->Merge(*other_node->fallback_search_index, cfg, use_knowhere_build_pool);
+        }
+    }
+
     expected<DataSetPtr>
     GetIndexMeta(std::unique_ptr<Config> cfg) const override {
         if (use_base_index) {
@@ -2182,6 +2890,15 @@ class HNSWIndexNodeWithFallback : public IndexNode {
         }
     }
 
+    Status
+    SerializeToFile(const std::string& filename) const override {
+        if (use_base_index) {
+            return base_index->SerializeToFile(filename);
+        } else {
+            return fallback_search_index->SerializeToFile(filename);
+        }
+    }
+
     Status
     Deserialize(const BinarySet& binset, std::shared_ptr<Config> config) override {
         if (use_base_index) {
@@ -2405,10 +3122,9 @@ class BaseFaissRegularIndexHNSWSQNode : public BaseFaissRegularIndexHNSWNode {
         // create an index
         const bool is_cosine = IsMetricType(hnsw_cfg.metric_type.value(), metric::COSINE);
 
-        // should refine be used?
-        std::unique_ptr<faiss::Index> final_index;
-
         auto train_index = [&](const float* data, const int i, const int64_t rows) {
+            // should refine be used?
+            std::unique_ptr<faiss::Index> final_index;
             std::unique_ptr<faiss::IndexHNSW> hnsw_index;
             if (is_cosine) {
                 hnsw_index = std::make_unique<faiss::IndexHNSWSQCosine>(dim, sq_type.value(), hnsw_cfg.M.value());
@@ -2418,6 +3134,7 @@ class BaseFaissRegularIndexHNSWSQNode : public BaseFaissRegularIndexHNSWNode {
             }
 
             hnsw_index->hnsw.efConstruction = hnsw_cfg.efConstruction.value();
+            hnsw_index->keep_max_size_level0 = hnsw_cfg.dense_level0.value();
 
             if (hnsw_cfg.refine.value_or(false) && hnsw_cfg.refine_type.has_value()) {
                 // yes
@@ -2458,8 +3175,15 @@ class BaseFaissRegularIndexHNSWSQNode : public BaseFaissRegularIndexHNSWNode {
             tmp_combined_scalar_ids =
                 scalar_info.size() > 1 ? combine_partitions(scalar_info, 128) : std::vector<std::vector<int>>();
         }
+        // a direct SQ storage for the input format needs no training, so the data is not converted to float then
+        const bool use_refine = hnsw_cfg.refine.value_or(false) && hnsw_cfg.refine_type.has_value();
+        const bool train_on_data = use_refine || sq_type.value() != get_direct_sq_type(data_format);
+
         // no scalar info or just one partition(after possible combination), build index on whole data
         if (scalar_info_map.empty() || tmp_combined_scalar_ids.size() <= 1) {
+            if (!train_on_data) {
+                return train_index(nullptr, 0, rows);
+            }
             // we have to convert the data to float, unfortunately, which costs extra RAM
             auto float_ds_ptr = convert_ds_to_float(dataset, data_format);
             if (float_ds_ptr == nullptr) {
@@ -2470,7 +3194,7 @@ class BaseFaissRegularIndexHNSWSQNode : public BaseFaissRegularIndexHNSWNode {
         }
         LOG_KNOWHERE_INFO_ << "Train HNSWSQ Index with Scalar Info";
         for (const auto& [field_id, scalar_info] : scalar_info_map) {
-            return TrainIndexByScalarInfo(train_index, scalar_info, data, rows, dim);
+            return TrainIndexByScalarInfo(train_index, scalar_info, data, rows, dim, train_on_data);
         }
         return Status::success;
     }
@@ -2559,6 +3283,7 @@ class BaseFaissRegularIndexHNSWPQNode : public BaseFaissRegularIndexHNSWNode {
             }
 
             hnsw_index->hnsw.efConstruction = hnsw_cfg.efConstruction.value();
+            hnsw_index->keep_max_size_level0 = hnsw_cfg.dense_level0.value();
 
             // pq
             std::unique_ptr<faiss::IndexPQ> pq_index;
@@ -2639,6 +3364,14 @@ class BaseFaissRegularIndexHNSWPQNode : public BaseFaissRegularIndexHNSWNode {
         return Status::success;
     }
 
+    // the codebooks are trained per index, so the vectors of other would be quantized twice, and the merged lists
+    // would be pruned on quantized distances while the graph was built on the raw vectors. Rebuild instead.
+    Status
+    MergeInternal(const BaseFaissIndexNode& other, const Config& cfg) override {
+        LOG_KNOWHERE_ERROR_ << "Can not merge HNSW indexes with a PQ storage.";
+        return Status::not_implemented;
+    }
+
     Status
     AddInternal(const DataSetPtr dataset, const Config&) override {
         if (isIndexEmpty()) {
@@ -2722,7 +3455,7 @@ class BaseFaissRegularIndexHNSWPQNode : public BaseFaissRegularIndexHNSWNode {
             LOG_KNOWHERE_INFO_ << "Add data to Index with Scalar Info";
 
             for (const auto& [field_id, scalar_info] : scalar_info_map) {
-                for (auto i = 0; i < tmp_combined_scalar_ids.size(); ++i) {
+                return build_partitions(PartitionRows(scalar_info), [&](size_t i) {
                     for (auto j = 0; j < tmp_combined_scalar_ids[i].size(); ++j) {
                         auto id = tmp_combined_scalar_ids[i][j];
                         // hnsw
@@ -2744,8 +3477,8 @@ class BaseFaissRegularIndexHNSWPQNode : public BaseFaissRegularIndexHNSWNode {
                             return status_pq;
                         }
                     }
-                    finalize_index(i);
-                }
+                    return finalize_index(i);
+                });
             }
 
         } catch (const std::exception& e) {
@@ -2834,6 +3567,7 @@ class BaseFaissRegularIndexHNSWPRQNode : public BaseFaissRegularIndexHNSWNode {
             }
 
             hnsw_index->hnsw.efConstruction = hnsw_cfg.efConstruction.value();
+            hnsw_index->keep_max_size_level0 = hnsw_cfg.dense_level0.value();
 
             // prq
             faiss::AdditiveQuantizer::Search_type_t prq_search_type =
@@ -2921,6 +3655,14 @@ class BaseFaissRegularIndexHNSWPRQNode : public BaseFaissRegularIndexHNSWNode {
         return Status::success;
     }
 
+    // the codebooks are trained per index, so the vectors of other would be quantized twice, and the merged lists
+    // would be pruned on quantized distances while the graph was built on the raw vectors. Rebuild instead.
+    Status
+    MergeInternal(const BaseFaissIndexNode& other, const Config& cfg) override {
+        LOG_KNOWHERE_ERROR_ << "Can not merge HNSW indexes with a PRQ storage.";
+        return Status::not_implemented;
+    }
+
     Status
     AddInternal(const DataSetPtr dataset, const Config&) override {
         if (isIndexEmpty()) {
@@ -3005,7 +3747,7 @@ class BaseFaissRegularIndexHNSWPRQNode : public BaseFaissRegularIndexHNSWNode {
             LOG_KNOWHERE_INFO_ << "Add data to Index with Scalar Info";
 
             for (const auto& [field_id, scalar_info] : scalar_info_map) {
-                for (auto i = 0; i < tmp_combined_scalar_ids.size(); ++i) {
+                return build_partitions(PartitionRows(scalar_info), [&](size_t i) {
                     for (auto j = 0; j < tmp_combined_scalar_ids[i].size(); ++j) {
                         auto id = tmp_combined_scalar_ids[i][j];
                         // hnsw
@@ -3027,8 +3769,8 @@ class BaseFaissRegularIndexHNSWPRQNode : public BaseFaissRegularIndexHNSWNode {
                             return status_prq;
                         }
                     }
-                    finalize_index(i);
-                }
+                    return finalize_index(i);
+                });
             }
 
         } catch (const std::exception& e) {
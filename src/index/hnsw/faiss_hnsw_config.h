@@ -29,6 +29,26 @@ class FaissHnswConfig : public BaseHnswConfig {
     CFG_FLOAT refine_k;
     // type of refine
     CFG_STRING refine_type;
+    // whether the level 0 neighbor lists are filled up to 2 * M
+    CFG_BOOL dense_level0;
+    // whether a filtered search expands the neighbors of the nodes that the filter rejects
+    CFG_BOOL two_hop_filter;
+    // the number of k-means entry points into the level 0 that replace the descent of the upper levels, 0 for none
+    CFG_INT num_entry_points;
+    // a top-k search ends once its top-k has not changed for this many expanded nodes, 0 to always reach ef
+    CFG_INT early_stop_patience;
+    // a top-k search ends once the next node to expand is farther from the best result than this many times the
+    //   spread of the top-k, 0 to always reach ef
+    CFG_FLOAT early_stop_ratio;
+    // whether a top-k search with no early_stop_ratio uses the one learned for its k from probe searches at build or
+    //   load time
+    CFG_BOOL learned_early_stop;
+    // whether a refined search computes the exact distances of the k * refine_k candidates lazily, stopping early
+    //   once a heuristic finds that the remaining ones are unlikely to enter the top-k
+    CFG_BOOL lazy_refine;
+    // how many times the largest quantization error seen so far the heuristic of lazy_refine allows for, a larger
+    //   margin reranks more candidates
+    CFG_FLOAT lazy_refine_margin;
 
     KNOHWERE_DECLARE_CONFIG(FaissHnswConfig) {
         KNOWHERE_CONFIG_DECLARE_FIELD(seed_ef)
@@ -51,6 +71,46 @@ class FaissHnswConfig : public BaseHnswConfig {
             .allow_empty_without_default()
             .for_train()
             .for_static();
+        KNOWHERE_CONFIG_DECLARE_FIELD(dense_level0)
+            .description("fill the level 0 neighbor lists up to 2 * M with the nearest pruned neighbors")
+            .set_default(false)
+            .for_train();
+        KNOWHERE_CONFIG_DECLARE_FIELD(two_hop_filter)
+            .description("expand the neighbors of the nodes rejected by the filter during a filtered search")
+            .set_default(false)
+            .for_search()
+            .for_range_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(num_entry_points)
+            .description("the number of k-means entry points into the level 0, a search starts from all of them "
+                         "instead of descending the upper levels")
+            .set_default(0)
+            .set_range(0, 4096)
+            .for_train();
+        KNOWHERE_CONFIG_DECLARE_FIELD(early_stop_patience)
+            .description("end a search once its top-k has not changed for this many expanded nodes, 0 to disable")
+            .set_default(0)
+            .set_range(0, std::numeric_limits<CFG_INT::value_type>::max())
+            .for_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(early_stop_ratio)
+            .description("end a search once the next node to expand is farther from the best result than this many "
+                         "times the spread of the top-k, at least 1, 0 to disable")
+            .set_default(0.0f)
+            .set_range(0.0f, std::numeric_limits<CFG_FLOAT::value_type>::max())
+            .for_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(learned_early_stop)
+            .description("end a search with the early stop ratio learned for the index and k if early_stop_ratio is 0")
+            .set_default(false)
+            .for_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(lazy_refine)
+            .description("rerank the k * refine_k candidates of a refined search by batches, until a heuristic finds "
+                         "that the remaining ones are unlikely to enter the top-k")
+            .set_default(false)
+            .for_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(lazy_refine_margin)
+            .description("the multiple of the largest quantization error seen so far that lazy_refine allows for")
+            .set_default(2.0f)
+            .set_range(0.0f, std::numeric_limits<CFG_FLOAT::value_type>::max())
+            .for_search();
     }
 
  protected:
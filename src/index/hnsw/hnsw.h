@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <new>
 #include <numeric>
 
@@ -18,6 +19,7 @@
 #include "hnswlib/hnswlib.h"
 #include "index/hnsw/hnsw_config.h"
 #include "knowhere/comp/index_param.h"
+#include "knowhere/comp/search_canceller.h"
 #include "knowhere/comp/task.h"
 #include "knowhere/comp/time_recorder.h"
 #include "knowhere/config.h"
@@ -137,43 +139,48 @@ class HnswIndexNode : public IndexNode {
         std::atomic<uint64_t> counter{0};
         uint64_t one_tenth_row = rows / 10;
 
-        std::vector<int> shuffle_batch_ids;
-        constexpr int64_t batch_size = 8192;  // same with diskann
-        int64_t round_num = std::ceil(float(rows - 1) / batch_size);
-        auto build_pool = ThreadPool::GetGlobalBuildThreadPool();
-        std::vector<folly::Future<folly::Unit>> futures;
-
+        // the points are handed out in contiguous chunks to one long running task per build thread, instead of one
+        // future per point and a barrier every batch. shuffle_build randomizes the order the chunks are taken in.
+        constexpr int64_t chunk_size = 64;
+        int64_t chunk_num = (rows - 1 + chunk_size - 1) / chunk_size;
+        std::vector<int64_t> chunk_ids(chunk_num);
+        std::iota(chunk_ids.begin(), chunk_ids.end(), 0);
         if (shuffle_build) {
-            shuffle_batch_ids.reserve(round_num);
-            for (int i = 0; i < round_num; ++i) {
-                shuffle_batch_ids.emplace_back(i);
-            }
             std::random_device rng;
             std::mt19937 urng(rng());
-            std::shuffle(shuffle_batch_ids.begin(), shuffle_batch_ids.end(), urng);
+            std::shuffle(chunk_ids.begin(), chunk_ids.end(), urng);
         }
+        auto build_pool = ThreadPool::GetGlobalBuildThreadPool();
+        int64_t worker_num = std::min<int64_t>(build_pool->size(), chunk_num);
+        std::vector<folly::Future<folly::Unit>> futures;
         try {
             index_->addPoint(tensor, 0);
 
-            futures.reserve(batch_size);
-            for (int64_t round_id = 0; round_id < round_num; round_id++) {
-                int64_t start_id = (shuffle_build ? shuffle_batch_ids[round_id] : round_id) * batch_size;
-                int64_t end_id =
-                    std::min(rows - 1, ((shuffle_build ? shuffle_batch_ids[round_id] : round_id) + 1) * batch_size);
-                for (int64_t i = start_id; i < end_id; ++i) {
-                    futures.emplace_back(build_pool->push([&, idx = i + 1]() {
-                        index_->addPoint(((const char*)tensor + index_->data_size_ * idx), idx);
-                        uint64_t added = counter.fetch_add(1);
-                        if (added % one_tenth_row == 0) {
-                            LOG_KNOWHERE_INFO_ << "HNSW build progress: " << (added / one_tenth_row) << "0%";
+            std::atomic<int64_t> next_chunk{0};
+            futures.reserve(worker_num);
+            for (int64_t w = 0; w < worker_num; ++w) {
+                futures.emplace_back(build_pool->push([&]() {
+                    for (int64_t c = next_chunk.fetch_add(1); c < chunk_num; c = next_chunk.fetch_add(1)) {
+                        // point 0 is the entry point added above
+                        int64_t start_id = chunk_ids[c] * chunk_size + 1;
+                        int64_t end_id = std::min(rows, start_id + chunk_size);
+                        for (int64_t idx = start_id; idx < end_id; ++idx) {
+                            index_->addPoint(((const char*)tensor + index_->data_size_ * idx), idx);
                         }
-                    }));
-                }
-                WaitAllSuccess(futures);
-                futures.clear();
+                        uint64_t added = counter.fetch_add(end_id - start_id) + (end_id - start_id);
+                        uint64_t tenths = one_tenth_row > 0 ? added / one_tenth_row : 0;
+                        if (tenths > 0 && (added - (end_id - start_id)) / one_tenth_row < tenths) {
+                            LOG_KNOWHERE_INFO_ << "HNSW build progress: " << tenths << "0%";
+                        }
+                    }
+                }));
             }
+            WaitAllSuccess(futures);
+            futures.clear();
 
-            build_time.RecordSection("graph build");
+            auto build_span = build_time.RecordSection("graph build");
+            LOG_KNOWHERE_INFO_ << "HNSW graph build: " << rows << " points by " << worker_num << " workers, "
+                               << rows / std::max(build_span, 1.0) * 1e6 << " points/s";
             std::vector<unsigned> unreached = index_->findUnreachableVectors();
             int unreached_num = unreached.size();
             LOG_KNOWHERE_INFO_ << "there are " << unreached_num << " points can not be reached";
@@ -185,7 +192,11 @@ class HnswIndexNode : public IndexNode {
                 }
                 WaitAllSuccess(futures);
             }
-            build_time.RecordSection("graph repair");
+            auto repair_span = build_time.RecordSection("graph repair");
+            if (unreached_num > 0) {
+                LOG_KNOWHERE_INFO_ << "HNSW graph repair: " << unreached_num / std::max(repair_span, 1.0) * 1e6
+                                   << " points/s";
+            }
             LOG_KNOWHERE_INFO_ << "HNSW built with #points num:" << index_->max_elements_ << " #M:" << index_->M_
                                << " #max level:" << index_->maxlevel_
                                << " #ef_construction:" << index_->ef_construction_
@@ -221,19 +232,33 @@ class HnswIndexNode : public IndexNode {
         auto p_id = std::make_unique<int64_t[]>(k * nq);
         auto p_dist = std::make_unique<DistType[]>(k * nq);
 
-        hnswlib::SearchParam param{(size_t)hnsw_cfg.ef.value()};
         bool transform =
             (index_->metric_type_ == hnswlib::Metric::INNER_PRODUCT || index_->metric_type_ == hnswlib::Metric::COSINE);
+        std::vector<uint8_t> filter_buf;
+        auto filter = WithDeleted(bitset, filter_buf);
+        SearchCanceller canceller(op_context, hnsw_cfg);
 
         std::vector<folly::Future<folly::Unit>> futs;
         futs.reserve(nq);
         for (int i = 0; i < nq; ++i) {
             futs.emplace_back(search_pool_->push([&, idx = i, p_id_ptr = p_id.get(), p_dist_ptr = p_dist.get()]() {
-                auto single_query = (const char*)xq + idx * index_->data_size_;
-                auto rst = index_->searchKnn(single_query, k, bitset, &param, feder_result);
-                size_t rst_size = rst.size();
                 auto p_single_dis = p_dist_ptr + idx * k;
                 auto p_single_id = p_id_ptr + idx * k;
+                if (canceller.IsStopped()) {
+                    std::fill_n(p_single_dis, k, DistType(1.0 / 0.0));
+                    std::fill_n(p_single_id, k, -1);
+                    canceller.AbortQueries();
+                    return;
+                }
+                // the query is counted as aborted if the traversal is cut short
+                bool stopped = false;
+                hnswlib::SearchParam param{(size_t)hnsw_cfg.ef.value(), canceller.StopCheck(&stopped)};
+                auto single_query = (const char*)xq + idx * index_->data_size_;
+                auto rst = index_->searchKnn(single_query, k, filter, &param, feder_result);
+                if (stopped) {
+                    canceller.AbortQueries();
+                }
+                size_t rst_size = rst.size();
                 for (size_t idx = 0; idx < rst_size; ++idx) {
                     const auto& [dist, id] = rst[idx];
                     p_single_dis[idx] = transform ? (-dist) : dist;
@@ -257,14 +282,17 @@ class HnswIndexNode : public IndexNode {
             res->SetJsonInfo(json_visit_info.dump());
             res->SetJsonIdSet(json_id_set.dump());
         }
-        return res;
+        return canceller.Finish(res);
     }
 
  private:
     class iterator : public IndexIterator {
      public:
+        // filter_buf: owns the bits of bitset when the deleted elements were merged in, shared by the iterators of
+        // one request.
         iterator(const hnswlib::HierarchicalNSW<DataType, DistType, quant_type>* index, const char* query,
-                 const bool transform, const BitsetView& bitset, const size_t ef = kIteratorSeedEf,
+                 const bool transform, const BitsetView& bitset,
+                 std::shared_ptr<const std::vector<uint8_t>> filter_buf, const size_t ef = kIteratorSeedEf,
                  const float refine_ratio = 0.5f, bool use_knowhere_search_pool = true)
             : IndexIterator(transform, use_knowhere_search_pool,
                             (hnswlib::HierarchicalNSW<DataType, DistType, quant_type>::sq_enabled &&
@@ -273,12 +301,14 @@ class HnswIndexNode : public IndexNode {
                                 : 0.0f),
               index_(index),
               transform_(transform),
+              filter_buf_(std::move(filter_buf)),
               workspace_(index_->getIteratorWorkspace(query, ef, bitset)) {
         }
 
      protected:
         void
         next_batch(std::function<void(const std::vector<DistId>&)> batch_handler) override {
+            workspace_->param->should_stop = stop_check();
             index_->getIteratorNextBatch(workspace_.get());
             if (transform_) {
                 for (auto& p : workspace_->dists) {
@@ -300,6 +330,7 @@ class HnswIndexNode : public IndexNode {
      private:
         const hnswlib::HierarchicalNSW<DataType, DistType, quant_type>* index_;
         const bool transform_;
+        std::shared_ptr<const std::vector<uint8_t>> filter_buf_;
         std::unique_ptr<hnswlib::IteratorWorkspace> workspace_;
     };
 
@@ -319,12 +350,16 @@ class HnswIndexNode : public IndexNode {
 
         bool transform =
             (index_->metric_type_ == hnswlib::Metric::INNER_PRODUCT || index_->metric_type_ == hnswlib::Metric::COSINE);
+        auto filter_buf = std::make_shared<std::vector<uint8_t>>();
+        auto filter = WithDeleted(bitset, *filter_buf);
+        auto canceller = SearchCanceller::MakeShared(op_context, hnsw_cfg);
         auto vec = std::vector<IndexNode::IteratorPtr>(nq, nullptr);
         try {
             for (int i = 0; i < nq; ++i) {
                 auto single_query = (const char*)xq + i * index_->data_size_;
-                auto it = std::make_shared<iterator>(this->index_, single_query, transform, bitset, ef,
+                auto it = std::make_shared<iterator>(this->index_, single_query, transform, filter, filter_buf, ef,
                                                      hnsw_cfg.iterator_refine_ratio.value(), use_knowhere_search_pool);
+                it->set_canceller(canceller);
                 vec[i] = it;
             }
         } catch (const std::exception& e) {
@@ -362,6 +397,8 @@ class HnswIndexNode : public IndexNode {
         }
 
         hnswlib::SearchParam param{(size_t)hnsw_cfg.ef.value()};
+        std::vector<uint8_t> filter_buf;
+        auto filter = WithDeleted(bitset, filter_buf);
 
         std::vector<std::vector<int64_t>> result_id_array(nq);
         std::vector<std::vector<DistType>> result_dist_array(nq);
@@ -371,7 +408,7 @@ class HnswIndexNode : public IndexNode {
         for (int64_t i = 0; i < nq; ++i) {
             futs.emplace_back(search_pool_->push([&, idx = i]() {
                 auto single_query = (const char*)xq + idx * index_->data_size_;
-                auto rst = index_->searchRange(single_query, radius_for_calc, bitset, &param, feder_result);
+                auto rst = index_->searchRange(single_query, radius_for_calc, filter, &param, feder_result);
                 auto elem_cnt = rst.size();
                 result_dist_array[idx].resize(elem_cnt);
                 result_id_array[idx].resize(elem_cnt);
@@ -475,10 +512,15 @@ class HnswIndexNode : public IndexNode {
             return Status::empty_index;
         }
         try {
-            MemoryIOWriter writer;
-            index_->saveIndex(writer);
-            std::shared_ptr<uint8_t[]> data(writer.data());
-            binset.Append(Type(), data, writer.tellg());
+            std::shared_ptr<uint8_t[]> data;
+            size_t size = 0;
+            RETURN_IF_ERROR(SerializeSized(
+                [&](auto& writer) {
+                    index_->saveIndex(writer);
+                    return Status::success;
+                },
+                data, size));
+            binset.Append(Type(), data, size);
         } catch (std::exception& e) {
             LOG_KNOWHERE_WARNING_ << "hnsw inner error: " << e.what();
             return Status::hnsw_inner_error;
@@ -540,6 +582,88 @@ class HnswIndexNode : public IndexNode {
         return StaticCreateConfig();
     }
 
+    Status
+    DeleteByIds(const DataSetPtr dataset) override {
+        if (!index_) {
+            LOG_KNOWHERE_ERROR_ << "Can not delete from empty HNSW index.";
+            return Status::empty_index;
+        }
+        auto rows = dataset->GetRows();
+        auto ids = dataset->GetIds();
+        for (int64_t i = 0; i < rows; ++i) {
+            if (ids[i] < 0 || (size_t)ids[i] >= index_->cur_element_count) {
+                LOG_KNOWHERE_ERROR_ << "delete id " << ids[i] << " out of range [0, " << index_->cur_element_count
+                                    << ")";
+                return Status::invalid_args;
+            }
+        }
+        for (int64_t i = 0; i < rows; ++i) {
+            index_->markDeleted(ids[i]);
+        }
+        return Status::success;
+    }
+
+    Status
+    Consolidate(bool use_knowhere_build_pool) override {
+        if (!index_) {
+            LOG_KNOWHERE_ERROR_ << "Can not consolidate empty HNSW index.";
+            return Status::empty_index;
+        }
+        if (index_->num_consolidated_ == index_->num_deleted_) {
+            return Status::success;
+        }
+        if (index_->mmap_enabled_) {
+            LOG_KNOWHERE_ERROR_ << "Can not consolidate a mmapped HNSW index.";
+            return Status::not_implemented;
+        }
+
+        knowhere::TimeRecorder consolidate_time("Consolidating HNSW deletes", 2);
+        auto pending = index_->num_deleted_ - index_->num_consolidated_;
+        constexpr int64_t chunk_size = 256;
+        int64_t n = index_->cur_element_count;
+        int64_t chunk_num = (n + chunk_size - 1) / chunk_size;
+        std::atomic<int64_t> repaired{0};
+        auto build_pool = ThreadPool::GetGlobalBuildThreadPool();
+        std::vector<folly::Future<folly::Unit>> futures;
+        try {
+            // with every element deleted there is no live list to repair, the graph is just emptied
+            if (index_->num_deleted_ == index_->cur_element_count) {
+                index_->finishConsolidation();
+                LOG_KNOWHERE_INFO_ << "HNSW consolidated " << pending << " deletes, all " << n << " points deleted";
+                return Status::success;
+            }
+            // every level is finished before the next one, a level only reads the lists of the deleted elements
+            for (int level = index_->maxlevel_; level >= 0; --level) {
+                RunOnBuildPool(chunk_num, [&](int64_t c) {
+                    int64_t end = std::min(n, (c + 1) * chunk_size);
+                    for (int64_t i = c * chunk_size; i < end; ++i) {
+                        if (index_->repairDeletedNeighbors(i, level)) {
+                            repaired.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                });
+            }
+            index_->finishConsolidation();
+            consolidate_time.RecordSection("neighbor repair");
+
+            std::vector<unsigned> unreached = index_->findUnreachableVectors();
+            futures.reserve(unreached.size());
+            for (size_t i = 0; i < unreached.size(); ++i) {
+                futures.emplace_back(
+                    build_pool->push([&, idx = i]() { index_->repairGraphConnectivity(unreached[idx]); }));
+            }
+            WaitAllSuccess(futures);
+            consolidate_time.RecordSection("graph repair");
+            LOG_KNOWHERE_INFO_ << "HNSW consolidated " << pending << " deletes, " << repaired.load()
+                               << " link lists rewritten, " << unreached.size() << " points reconnected, "
+                               << index_->num_deleted_ << " of " << n << " points deleted";
+        } catch (std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "hnsw inner error: " << e.what();
+            return Status::hnsw_inner_error;
+        }
+        return Status::success;
+    }
+
     int64_t
     Dim() const override {
         if (!index_) {
@@ -576,6 +700,61 @@ class HnswIndexNode : public IndexNode {
     }
 
  private:
+    // runs task(i) for every i in [0, num_tasks) on one long running job per build thread. The jobs pull the next
+    // task from a shared counter, so there is no future per task and no barrier until all of them are done.
+    template <typename Task>
+    static void
+    RunOnBuildPool(int64_t num_tasks, Task&& task) {
+        auto build_pool = ThreadPool::GetGlobalBuildThreadPool();
+        int64_t worker_num = std::min<int64_t>(build_pool->size(), num_tasks);
+        std::atomic<int64_t> next_task{0};
+        std::vector<folly::Future<folly::Unit>> futures;
+        futures.reserve(worker_num);
+        for (int64_t w = 0; w < worker_num; ++w) {
+            futures.emplace_back(build_pool->push([&]() {
+                for (int64_t t = next_task.fetch_add(1); t < num_tasks; t = next_task.fetch_add(1)) {
+                    task(t);
+                }
+            }));
+        }
+        WaitAllSuccess(futures);
+    }
+
+    // Adds the deleted elements to the filter of a request. Returns bitset itself if nothing was deleted, otherwise
+    // a view of the merged bits, which are stored in buf.
+    BitsetView
+    WithDeleted(const BitsetView& bitset, std::vector<uint8_t>& buf) const {
+        auto deleted = index_->getDeletedMask();
+        if (deleted == nullptr) {
+            return bitset;
+        }
+        size_t n = index_->cur_element_count;
+        buf.assign(deleted, deleted + index_->deletedMaskSize());
+        if (bitset.empty()) {
+            return BitsetView(buf.data(), n, index_->num_deleted_);
+        }
+
+        size_t i = 0;
+        if (!bitset.has_out_ids() && bitset.id_offset() == 0) {
+            // same layout, or the whole bytes together
+            auto bits = bitset.data();
+            for (size_t end = std::min(bitset.size(), n) / 8; i < end; ++i) {
+                buf[i] |= bits[i];
+            }
+            i *= 8;
+        }
+        for (; i < n; ++i) {
+            if (bitset.test(i)) {
+                buf[i >> 3] |= (0x1 << (i & 0x7));
+            }
+        }
+        size_t count = 0;
+        for (auto byte : buf) {
+            count += __builtin_popcount(byte);
+        }
+        return BitsetView(buf.data(), n, count);
+    }
+
     void
     UpdateLevelLinkList(int32_t level, feder::hnsw::HNSWMeta& meta, std::unordered_set<int64_t>& id_set) const {
         if (!(level > 0 && level <= index_->maxlevel_)) {
@@ -11,15 +11,24 @@
 
 #include "IndexConditionalWrapper.h"
 
+#include <faiss/cppcontrib/knowhere/impl/HnswSearcher.h>
+#include <faiss/cppcontrib/knowhere/utils/Bitset.h>
+#include <faiss/impl/AuxIndexStructures.h>
+#include <faiss/impl/DistanceComputer.h>
+
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include "faiss/IndexCosine.h"
 #include "faiss/IndexHNSW.h"
 #include "faiss/IndexRefine.h"
+#include "index/hnsw/impl/DummyVisitor.h"
 #include "index/hnsw/impl/IndexBruteForceWrapper.h"
 #include "index/hnsw/impl/IndexHNSWWrapper.h"
 #include "index/hnsw/impl/IndexWrapperCosine.h"
+#include "knowhere/log.h"
 #include "knowhere/utils.h"
 
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
@@ -28,11 +37,154 @@
 
 namespace knowhere {
 
+namespace {
+
+// the probe searches of the calibration, run from vectors spread over the index
+constexpr size_t kCostModelProbes = 16;
+constexpr int kCostModelProbeEfs[2] = {16, 128};
+
+// a walk fetches the neighbor list, checks the visited table and reads the code of every node it evaluates from a
+//   random location, which costs about as much as streaming this many bytes of codes in a scan. Pages of a mapped
+//   file that a walk touches may also need to be faulted in, while a scan is read ahead.
+constexpr float kGraphRandomAccessBytes = 256.0f;
+constexpr float kGraphRandomAccessBytesMmapped = 1024.0f;
+
+// picks the cheaper plan of a filtered search that keeps n_candidates candidates
+bool
+WhetherBruteForceIsCheaper(const HnswSearchCostModel& cost_model, const size_t n_candidates, const bool two_hop,
+                           const BitsetView& bitset, const size_t filtered_out_num) {
+    const float bf_cost = cost_model.BruteForceCost(bitset.size() - filtered_out_num);
+    const float graph_cost =
+        cost_model.GraphSearchCost(n_candidates, ((float)filtered_out_num) / bitset.size(), two_hop);
+    const float cost_ratio = bf_cost / std::max(graph_cost, 1.0f);
+#if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
+    knowhere::knowhere_hnsw_bf_graph_cost_ratio.Observe(cost_ratio);
+#endif
+    return cost_ratio <= 1.0f;
+}
+
+}  // namespace
+
+HnswSearchCostModel
+HnswSearchCostModel::Calibrate(const faiss::Index* index, const bool is_mmapped) {
+    HnswSearchCostModel model;
+
+    const faiss::IndexRefine* const index_refine = dynamic_cast<const faiss::IndexRefine*>(index);
+    const faiss::IndexHNSW* const index_hnsw =
+        dynamic_cast<const faiss::IndexHNSW*>((index_refine != nullptr) ? index_refine->base_index : index);
+    if (index_hnsw == nullptr || index_hnsw->storage == nullptr || index_hnsw->ntotal == 0 ||
+        index_hnsw->hnsw.entry_point == -1) {
+        return model;
+    }
+
+    const size_t ntotal = index_hnsw->ntotal;
+    const faiss::IndexFlatCodes* const storage_codes = dynamic_cast<const faiss::IndexFlatCodes*>(index_hnsw->storage);
+    const size_t code_size =
+        (storage_codes != nullptr) ? storage_codes->code_size : index_hnsw->storage->d * sizeof(float);
+
+    // count the distances computed by walks from stored vectors
+    using searcher_type =
+        faiss::cppcontrib::knowhere::v2_hnsw_searcher<faiss::DistanceComputer, DummyVisitor,
+                                                      faiss::cppcontrib::knowhere::Bitset, faiss::IDSelectorAll>;
+
+    double ndis[2] = {0, 0};
+    float max_improving_ratios[std::size(HnswSearchCostModel::kEarlyStopKs)] = {};
+    const size_t n_probes = std::min(kCostModelProbes, ntotal);
+    try {
+        std::unique_ptr<faiss::DistanceComputer> dis(storage_distance_computer(index_hnsw->storage));
+        faiss::cppcontrib::knowhere::Bitset visited_nodes =
+            faiss::cppcontrib::knowhere::Bitset::create_uninitialized(ntotal);
+        DummyVisitor graph_visitor;
+        faiss::IDSelectorAll sel_all;
+
+        std::vector<float> query(index_hnsw->d);
+        std::vector<float> other(index_hnsw->d);
+        std::vector<faiss::idx_t> labels;
+        std::vector<float> distances;
+        for (size_t i = 0; i < n_probes; i++) {
+            index_hnsw->storage->reconstruct(i * ntotal / n_probes, query.data());
+            dis->set_query(query.data());
+
+            for (size_t j = 0; j < 2; j++) {
+                faiss::SearchParametersHNSW params;
+                params.efSearch = kCostModelProbeEfs[j];
+
+                visited_nodes.clear();
+                searcher_type searcher{index_hnsw->hnsw, *(dis.get()), graph_visitor, visited_nodes,
+                                       sel_all,          0.0f,         &params};
+
+                faiss::idx_t label = -1;
+                float distance = 0;
+                ndis[j] += searcher.search(1, &distance, &label).ndis;
+            }
+
+            // learn the early stop ratios from walks that keep all the candidates of the high ef, run from the
+            //   midpoint of a pair of stored vectors, which unlike a stored vector itself is not found at once
+            index_hnsw->storage->reconstruct((i * ntotal / n_probes + ntotal / 2) % ntotal, other.data());
+            for (size_t j = 0; j < query.size(); j++) {
+                query[j] = 0.5f * (query[j] + other[j]);
+            }
+            dis->set_query(query.data());
+
+            for (size_t j = 0; j < std::size(HnswSearchCostModel::kEarlyStopKs); j++) {
+                const size_t k = HnswSearchCostModel::kEarlyStopKs[j];
+                faiss::SearchParametersHNSW params;
+                params.efSearch = kCostModelProbeEfs[1];
+
+                visited_nodes.clear();
+                searcher_type searcher{index_hnsw->hnsw, *(dis.get()), graph_visitor, visited_nodes,
+                                       sel_all,          0.0f,         &params};
+                searcher.max_improving_ratio = &max_improving_ratios[j];
+
+                labels.resize(k);
+                distances.resize(k);
+                searcher.search(k, distances.data(), labels.data());
+            }
+        }
+    } catch (const std::exception& e) {
+        LOG_KNOWHERE_WARNING_ << "failed to calibrate the HNSW search cost model: " << e.what();
+        return model;
+    }
+
+    const float ndis_low = ndis[0] / n_probes;
+    const float ndis_high = ndis[1] / n_probes;
+    model.ndis_per_candidate =
+        std::max((ndis_high - ndis_low) / (kCostModelProbeEfs[1] - kCostModelProbeEfs[0]), 1.0f);
+    model.ndis_upper = std::max(ndis_low - model.ndis_per_candidate * kCostModelProbeEfs[0], 0.0f);
+
+    const float random_access_bytes = is_mmapped ? kGraphRandomAccessBytesMmapped : kGraphRandomAccessBytes;
+    model.graph_distance_cost = 1.0f + random_access_bytes / std::max(code_size, (size_t)1);
+
+    for (size_t j = 0; j < std::size(HnswSearchCostModel::kEarlyStopKs); j++) {
+        model.early_stop_ratios[j] = std::max(max_improving_ratios[j], 1.0f);
+    }
+
+    model.ntotal = ntotal;
+    return model;
+}
+
+float
+HnswSearchCostModel::GraphSearchCost(const size_t n_candidates, const float filter_ratio, const bool two_hop) const {
+    if (two_hop) {
+        // distances are computed to the admitted nodes only, as many as without a filter, but reaching them also
+        //   reads the neighbor lists of about filter_ratio rejected nodes per distance
+        const float ndis = std::min(ndis_upper + ndis_per_candidate * n_candidates, (float)ntotal);
+        return ndis * (graph_distance_cost + filter_ratio * (graph_distance_cost - 1.0f));
+    }
+
+    // a walk reaches about 1 / (1 - filter_ratio) nodes per node that passes the filter, but the upper levels
+    //   are not filtered and no distance to a node is computed twice
+    const float pass_ratio = std::max(1.0f - filter_ratio, 1.0f / std::max(ntotal, (size_t)1));
+    const float ndis = std::min(ndis_upper + ndis_per_candidate * n_candidates / pass_ratio, (float)ntotal);
+    return ndis * graph_distance_cost;
+}
+
 // Decides whether a brute force should be used instead of a regular HNSW search.
 // This may be applicable in case of very large topk values or
 //   extremely high filtering levels.
 std::optional<bool>
-WhetherPerformBruteForceSearch(const faiss::Index* index, const BaseConfig& cfg, const BitsetView& bitset) {
+WhetherPerformBruteForceSearch(const faiss::Index* index, const BaseConfig& cfg, const BitsetView& bitset,
+                               const HnswSearchCostModel* cost_model) {
     // check if parameters have all we need
     if (!cfg.k.has_value() || index == nullptr) {
         return std::nullopt;
@@ -51,10 +203,26 @@ WhetherPerformBruteForceSearch(const faiss::Index* index, const BaseConfig& cfg,
         double ratio = ((double)filtered_out_num) / bitset.size();
         knowhere::knowhere_hnsw_bitset_ratio.Observe(ratio);
 #endif
-        if (filtered_out_num >= (bitset.size() * HnswSearchThresholds::kHnswSearchKnnBFFilterThreshold) ||
-            k >= (bitset.size() - filtered_out_num) * HnswSearchThresholds::kHnswSearchBFTopkThreshold) {
+        if (k >= (bitset.size() - filtered_out_num) * HnswSearchThresholds::kHnswSearchBFTopkThreshold) {
             return true;
         }
+
+        // the walk loses recall past this filter ratio whatever its cost, so the model may only pick a brute force
+        //   earlier
+        if (filtered_out_num >= (bitset.size() * HnswSearchThresholds::kHnswSearchKnnBFFilterThreshold)) {
+            return true;
+        }
+
+        if (cost_model != nullptr && cost_model->IsCalibratedFor(index)) {
+            // the walk keeps max(ef, k) candidates, ef falls back to the default of faiss
+            const auto* hnsw_cfg = dynamic_cast<const FaissHnswConfig*>(&cfg);
+            const size_t ef = (hnsw_cfg != nullptr && hnsw_cfg->ef.has_value())
+                                  ? hnsw_cfg->ef.value()
+                                  : faiss::SearchParametersHNSW().efSearch;
+            const bool two_hop = hnsw_cfg != nullptr && hnsw_cfg->two_hop_filter.value_or(false);
+            return WhetherBruteForceIsCheaper(*cost_model, std::max<size_t>(ef, k), two_hop, bitset,
+                                              filtered_out_num);
+        }
     }
 
     // the default value
@@ -65,7 +233,8 @@ WhetherPerformBruteForceSearch(const faiss::Index* index, const BaseConfig& cfg,
 // This may be applicable in case of very large topk values or
 //   extremely high filtering levels.
 std::optional<bool>
-WhetherPerformBruteForceRangeSearch(const faiss::Index* index, const FaissHnswConfig& cfg, const BitsetView& bitset) {
+WhetherPerformBruteForceRangeSearch(const faiss::Index* index, const FaissHnswConfig& cfg, const BitsetView& bitset,
+                                    const HnswSearchCostModel* cost_model) {
     // check if parameters have all we need
     if (!cfg.ef.has_value() || index == nullptr) {
         return std::nullopt;
@@ -84,10 +253,20 @@ WhetherPerformBruteForceRangeSearch(const faiss::Index* index, const FaissHnswCo
         double ratio = ((double)filtered_out_num) / bitset.size();
         knowhere::knowhere_hnsw_bitset_ratio.Observe(ratio);
 #endif
-        if (filtered_out_num >= (bitset.size() * HnswSearchThresholds::kHnswSearchRangeBFFilterThreshold) ||
-            ef >= (bitset.size() - filtered_out_num) * HnswSearchThresholds::kHnswSearchRangeBFFilterThreshold) {
+        if (ef >= (bitset.size() - filtered_out_num) * HnswSearchThresholds::kHnswSearchRangeBFFilterThreshold) {
             return true;
         }
+
+        // the walk loses recall past this filter ratio whatever its cost, so the model may only pick a brute force
+        //   earlier
+        if (filtered_out_num >= (bitset.size() * HnswSearchThresholds::kHnswSearchRangeBFFilterThreshold)) {
+            return true;
+        }
+
+        if (cost_model != nullptr && cost_model->IsCalibratedFor(index)) {
+            return WhetherBruteForceIsCheaper(*cost_model, ef, cfg.two_hop_filter.value_or(false), bitset,
+                                              filtered_out_num);
+        }
     }
 
     // the default value
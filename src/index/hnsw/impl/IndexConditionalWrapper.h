@@ -13,6 +13,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <memory>
 #include <optional>
 #include <tuple>
@@ -23,23 +24,81 @@
 
 namespace knowhere {
 
+// the filter thresholds are recall floors: past them a walk is not used, even if a cost model finds it cheaper
 struct HnswSearchThresholds {
     static constexpr float kHnswSearchKnnBFFilterThreshold = 0.93f;
     static constexpr float kHnswSearchRangeBFFilterThreshold = 0.97f;
     static constexpr float kHnswSearchBFTopkThreshold = 0.5f;
 };
 
+// Estimates the cost of the two plans of a filtered search, a walk over the graph and a brute force over the ids that
+//   pass the filter, in units of a distance computed by a sequential scan. It is calibrated once per graph, after a
+//   build or a load, so both plans are compared with the dimension, the code size, M and the mmap state of the index.
+struct HnswSearchCostModel {
+    // the number of vectors the model was calibrated on, 0 if it was not calibrated
+    size_t ntotal = 0;
+    // the distances computed by a walk, counted by probe searches at two ef values:
+    //   ndis ~= ndis_upper + ndis_per_candidate * max(ef, k)
+    float ndis_upper = 0.0f;
+    float ndis_per_candidate = 0.0f;
+    // the cost of a distance computed by a walk, relative to one computed by a scan: a walk also fetches the neighbor
+    //   list, checks the visited table and pays a random access to the code.
+    float graph_distance_cost = 1.0f;
+    // the top-k values of the probe searches that learn the early stop ratio
+    static constexpr size_t kEarlyStopKs[4] = {2, 8, 32, 128};
+    // for each of kEarlyStopKs, the largest ratio of the distance of an expanded node beyond the best candidate to
+    //   the spread of the top-k that still changed the top-k of a probe search, at least 1. A top-k search may end
+    //   once the next node to expand is past it, see SearchParametersHNSWWrapper::early_stop_ratio.
+    float early_stop_ratios[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    // returns an uncalibrated model for an empty or a non-HNSW index.
+    static HnswSearchCostModel
+    Calibrate(const faiss::Index* index, const bool is_mmapped);
+
+    // the ratio learned at the largest of kEarlyStopKs not above k, or at the smallest one for a smaller k. A
+    //   heuristic, not a bound: the top-k spread the ratio is scaled by usually grows with k, which tends to make the
+    //   stop looser, but a k between two probe sizes can still lose results to it.
+    float
+    EarlyStopRatio(const size_t k) const {
+        size_t i = 0;
+        while (i + 1 < std::size(kEarlyStopKs) && kEarlyStopKs[i + 1] <= k) {
+            i++;
+        }
+        return early_stop_ratios[i];
+    }
+
+    bool
+    IsCalibratedFor(const faiss::Index* index) const {
+        return ntotal > 0 && index != nullptr && ntotal == (size_t)index->ntotal;
+    }
+
+    // a walk keeping n_candidates candidates that only accepts a share of (1 - filter_ratio) of the nodes it reaches,
+    //   expanding the neighbors of the rejected nodes if two_hop is set
+    float
+    GraphSearchCost(const size_t n_candidates, const float filter_ratio, const bool two_hop = false) const;
+
+    float
+    BruteForceCost(const size_t n_valid) const {
+        return (float)n_valid;
+    }
+};
+
 // Decides whether a brute force should be used instead of a regular HNSW search.
 // This may be applicable in case of very large topk values or
 //   extremely high filtering levels.
+// With a filter, a brute force is always used past the fixed filter threshold, which keeps the recall of the walk.
+//   Below it, the cheaper plan of `cost_model` is picked if it was calibrated for `index`.
 std::optional<bool>
-WhetherPerformBruteForceSearch(const faiss::Index* index, const BaseConfig& cfg, const BitsetView& bitset);
+WhetherPerformBruteForceSearch(const faiss::Index* index, const BaseConfig& cfg, const BitsetView& bitset,
+                               const HnswSearchCostModel* cost_model = nullptr);
 
 // Decides whether a brute force should be used instead of a regular HNSW range search.
 // This may be applicable in case of very large topk values or
 //   extremely high filtering levels.
+// The fixed filter threshold and `cost_model` are used as for a regular search.
 std::optional<bool>
-WhetherPerformBruteForceRangeSearch(const faiss::Index* index, const FaissHnswConfig& cfg, const BitsetView& bitset);
+WhetherPerformBruteForceRangeSearch(const faiss::Index* index, const FaissHnswConfig& cfg, const BitsetView& bitset,
+                                    const HnswSearchCostModel* cost_model = nullptr);
 
 // first return arg: returns nullptr in case of invalid index
 // second return arg: returns whether an index does the refine
@@ -42,8 +42,6 @@ namespace knowhere {
  * Utilities
  **************************************************************/
 
-namespace {
-
 // cloned from IndexHNSW.cpp
 faiss::DistanceComputer*
 storage_distance_computer(const faiss::Index* storage) {
@@ -54,8 +52,6 @@ storage_distance_computer(const faiss::Index* storage) {
     }
 }
 
-}  // namespace
-
 /**************************************************************
  * IndexHNSWWrapper implementation
  **************************************************************/
@@ -94,11 +90,29 @@ IndexHNSWWrapper::search(idx_t n, const float* __restrict x, idx_t k, float* __r
     const faiss::HNSW& hnsw = index_hnsw->hnsw;
 
     float kAlpha = 0.0f;
+    bool two_hop_filter = false;
+    std::function<bool()> should_stop = nullptr;
+    const faiss::HNSW::storage_idx_t* entry_points = nullptr;
+    size_t n_entry_points = 0;
+    size_t early_stop_patience = 0;
+    float early_stop_ratio = 0.0f;
+    const faiss::Index* refine_index = nullptr;
+    size_t rerank_window = 0;
+    float rerank_error_margin = 2.0f;
     if (params_in) {
         params = dynamic_cast<const SearchParametersHNSWWrapper*>(params_in);
         FAISS_THROW_IF_NOT_MSG(params, "params type invalid");
 
         kAlpha = params->kAlpha;
+        two_hop_filter = params->two_hop_filter;
+        should_stop = params->should_stop;
+        entry_points = params->entry_points;
+        n_entry_points = params->n_entry_points;
+        early_stop_patience = params->early_stop_patience;
+        early_stop_ratio = params->early_stop_ratio;
+        refine_index = params->refine_index;
+        rerank_window = params->rerank_window;
+        rerank_error_margin = params->rerank_error_margin;
     }
 
     // set up hnsw_stats
@@ -116,11 +130,17 @@ IndexHNSWWrapper::search(idx_t n, const float* __restrict x, idx_t k, float* __r
 
     // create a distance computer
     std::unique_ptr<faiss::DistanceComputer> dis(storage_distance_computer(index_hnsw->storage));
+    // and a full precision one for a lazy refine
+    std::unique_ptr<faiss::DistanceComputer> refine_dis(
+        (refine_index == nullptr) ? nullptr : storage_distance_computer(refine_index));
 
     // no parallelism by design
     for (idx_t i = 0; i < n; i++) {
         // prepare the query
         dis->set_query(x + i * index->d);
+        if (refine_dis != nullptr) {
+            refine_dis->set_query(x + i * index->d);
+        }
 
         // prepare the table of visited elements
         bitset_visited_nodes.clear();
@@ -153,6 +173,16 @@ IndexHNSWWrapper::search(idx_t n, const float* __restrict x, idx_t k, float* __r
                 searcher_type searcher{hnsw,           *(dis.get()), graph_visitor, bitset_visited_nodes,
                                        *bw_idselector, kAlpha,       params};
 
+                searcher.should_stop = should_stop;
+                searcher.entry_points = entry_points;
+                searcher.n_entry_points = n_entry_points;
+                searcher.early_stop_patience = early_stop_patience;
+                searcher.early_stop_ratio = early_stop_ratio;
+                searcher.refine_dis = refine_dis.get();
+                searcher.rerank_window = rerank_window;
+                searcher.rerank_error_margin = rerank_error_margin;
+                searcher.expand_filtered_out = two_hop_filter;
+
                 local_stats = searcher.search(k, distances + i * k, labels + i * k);
             } else {
                 // use feder
@@ -166,6 +196,16 @@ IndexHNSWWrapper::search(idx_t n, const float* __restrict x, idx_t k, float* __r
                 searcher_type searcher{hnsw,           *(dis.get()), graph_visitor, bitset_visited_nodes,
                                        *bw_idselector, kAlpha,       params};
 
+                searcher.should_stop = should_stop;
+                searcher.entry_points = entry_points;
+                searcher.n_entry_points = n_entry_points;
+                searcher.early_stop_patience = early_stop_patience;
+                searcher.early_stop_ratio = early_stop_ratio;
+                searcher.refine_dis = refine_dis.get();
+                searcher.rerank_window = rerank_window;
+                searcher.rerank_error_margin = rerank_error_margin;
+                searcher.expand_filtered_out = two_hop_filter;
+
                 local_stats = searcher.search(k, distances + i * k, labels + i * k);
             }
         } else {
@@ -183,6 +223,15 @@ IndexHNSWWrapper::search(idx_t n, const float* __restrict x, idx_t k, float* __r
                 searcher_type searcher{hnsw,    *(dis.get()), graph_visitor, bitset_visited_nodes,
                                        sel_all, kAlpha,       params};
 
+                searcher.should_stop = should_stop;
+                searcher.entry_points = entry_points;
+                searcher.n_entry_points = n_entry_points;
+                searcher.early_stop_patience = early_stop_patience;
+                searcher.early_stop_ratio = early_stop_ratio;
+                searcher.refine_dis = refine_dis.get();
+                searcher.rerank_window = rerank_window;
+                searcher.rerank_error_margin = rerank_error_margin;
+
                 local_stats = searcher.search(k, distances + i * k, labels + i * k);
             } else {
                 // use feder
@@ -194,6 +243,15 @@ IndexHNSWWrapper::search(idx_t n, const float* __restrict x, idx_t k, float* __r
                 searcher_type searcher{hnsw,    *(dis.get()), graph_visitor, bitset_visited_nodes,
                                        sel_all, kAlpha,       params};
 
+                searcher.should_stop = should_stop;
+                searcher.entry_points = entry_points;
+                searcher.n_entry_points = n_entry_points;
+                searcher.early_stop_patience = early_stop_patience;
+                searcher.early_stop_ratio = early_stop_ratio;
+                searcher.refine_dis = refine_dis.get();
+                searcher.rerank_window = rerank_window;
+                searcher.rerank_error_margin = rerank_error_margin;
+
                 local_stats = searcher.search(k, distances + i * k, labels + i * k);
             }
         }
@@ -201,6 +259,7 @@ IndexHNSWWrapper::search(idx_t n, const float* __restrict x, idx_t k, float* __r
         // record some statistics
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
         knowhere::knowhere_hnsw_search_hops.Observe(local_stats.nhops);
+        knowhere::knowhere_hnsw_search_ndis.Observe(local_stats.ndis);
 #endif
 
         // update stats if possible
@@ -245,11 +304,19 @@ IndexHNSWWrapper::range_search(idx_t n, const float* __restrict x, float radius_
     const faiss::HNSW& hnsw = index_hnsw->hnsw;
 
     float kAlpha = 0.0f;
+    bool two_hop_filter = false;
+    std::function<bool()> should_stop = nullptr;
+    const faiss::HNSW::storage_idx_t* entry_points = nullptr;
+    size_t n_entry_points = 0;
     if (params_in) {
         params = dynamic_cast<const SearchParametersHNSWWrapper*>(params_in);
         FAISS_THROW_IF_NOT_MSG(params, "params type invalid");
 
         kAlpha = params->kAlpha;
+        two_hop_filter = params->two_hop_filter;
+        should_stop = params->should_stop;
+        entry_points = params->entry_points;
+        n_entry_points = params->n_entry_points;
     }
 
     // set up hnsw_stats
@@ -318,6 +385,11 @@ IndexHNSWWrapper::range_search(idx_t n, const float* __restrict x, float radius_
                 searcher_type searcher{hnsw,           *(dis.get()), graph_visitor, bitset_visited_nodes,
                                        *bw_idselector, kAlpha,       params};
 
+                searcher.should_stop = should_stop;
+                searcher.entry_points = entry_points;
+                searcher.n_entry_points = n_entry_points;
+                searcher.expand_filtered_out = two_hop_filter;
+
                 local_stats = searcher.range_search(radius, &res_min);
             } else {
                 // use feder
@@ -331,6 +403,11 @@ IndexHNSWWrapper::range_search(idx_t n, const float* __restrict x, float radius_
                 searcher_type searcher{hnsw,           *(dis.get()), graph_visitor, bitset_visited_nodes,
                                        *bw_idselector, kAlpha,       params};
 
+                searcher.should_stop = should_stop;
+                searcher.entry_points = entry_points;
+                searcher.n_entry_points = n_entry_points;
+                searcher.expand_filtered_out = two_hop_filter;
+
                 local_stats = searcher.range_search(radius, &res_min);
             }
         } else {
@@ -348,6 +425,10 @@ IndexHNSWWrapper::range_search(idx_t n, const float* __restrict x, float radius_
                 searcher_type searcher{hnsw,    *(dis.get()), graph_visitor, bitset_visited_nodes,
                                        sel_all, kAlpha,       params};
 
+                searcher.should_stop = should_stop;
+                searcher.entry_points = entry_points;
+                searcher.n_entry_points = n_entry_points;
+
                 local_stats = searcher.range_search(radius, &res_min);
             } else {
                 // use feder
@@ -359,6 +440,10 @@ IndexHNSWWrapper::range_search(idx_t n, const float* __restrict x, float radius_
                 searcher_type searcher{hnsw,    *(dis.get()), graph_visitor, bitset_visited_nodes,
                                        sel_all, kAlpha,       params};
 
+                searcher.should_stop = should_stop;
+                searcher.entry_points = entry_points;
+                searcher.n_entry_points = n_entry_points;
+
                 local_stats = searcher.range_search(radius, &res_min);
             }
         }
@@ -366,6 +451,7 @@ IndexHNSWWrapper::range_search(idx_t n, const float* __restrict x, float radius_
         // record some statistics
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
         knowhere::knowhere_hnsw_search_hops.Observe(local_stats.nhops);
+        knowhere::knowhere_hnsw_search_ndis.Observe(local_stats.ndis);
 #endif
 
         // update stats if possible
@@ -13,9 +13,11 @@
 
 #include <faiss/IndexHNSW.h>
 #include <faiss/cppcontrib/knowhere/IndexWrapper.h>
+#include <faiss/impl/DistanceComputer.h>
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 
 #include "knowhere/feder/HNSW.h"
 
@@ -29,11 +31,35 @@ struct SearchParametersHNSWWrapper : public faiss::SearchParametersHNSW {
     knowhere::feder::hnsw::FederResult* feder = nullptr;
     // filtering parameter
     float kAlpha = 1.0f;
+    // the walk takes the neighbors of the nodes rejected by the filter instead of them, kAlpha is unused then
+    bool two_hop_filter = false;
+    // the graph traversal stops early once it returns true, keeping the candidates found so far.
+    std::function<bool()> should_stop = nullptr;
+    // the entry points into the level 0 that replace the descent of the upper levels, if any. not owned.
+    const faiss::HNSW::storage_idx_t* entry_points = nullptr;
+    size_t n_entry_points = 0;
+    // a top-k search ends once its top-k has not changed for this many expanded nodes, if not 0
+    size_t early_stop_patience = 0;
+    // a top-k search ends once the next node to expand is farther from the best candidate than this many times the
+    //   spread of the top-k, if not 0
+    float early_stop_ratio = 0.0f;
+    // a top-k search picks its results by the exact distances of this index, computed lazily for at most
+    //   rerank_window candidates, if it is set. The walk keeps at least rerank_window candidates then, and the
+    //   rerank stops early by a heuristic that allows for rerank_error_margin times the largest quantization error
+    //   seen so far, see v2_hnsw_searcher::refine_dis. not owned.
+    const faiss::Index* refine_index = nullptr;
+    size_t rerank_window = 0;
+    float rerank_error_margin = 2.0f;
 
     inline ~SearchParametersHNSWWrapper() {
     }
 };
 
+// a distance computer over the storage of an IndexHNSW that negates similarities, so that smaller is always
+//   better, as IndexHNSW.cpp does. The caller owns the result.
+faiss::DistanceComputer*
+storage_distance_computer(const faiss::Index* storage);
+
 // TODO:
 // Please note that this particular searcher is int32_t based, so won't
 //   work correctly for 2B+ samples. This can be easily changed, if needed.
@@ -112,6 +112,31 @@ Index<T>::Add(const DataSetPtr dataset, const Json& json, bool use_knowhere_buil
     return this->node->AddEmbListIfNeed(dataset, std::move(cfg), use_knowhere_build_pool);
 }
 
+template <typename T>
+inline Status
+Index<T>::DeleteByIds(const DataSetPtr dataset) {
+    return this->node->DeleteByIds(dataset);
+}
+
+template <typename T>
+inline Status
+Index<T>::Consolidate(bool use_knowhere_build_pool) {
+    return this->node->Consolidate(use_knowhere_build_pool);
+}
+
+template <typename T>
+inline Status
+Index<T>::Merge(const Index<T>& other, const Json& json, bool use_knowhere_build_pool) {
+    if (other.node == nullptr) {
+        LOG_KNOWHERE_ERROR_ << "Can not merge an empty index.";
+        return Status::empty_index;
+    }
+    auto cfg = this->node->CreateConfig();
+    std::string msg;
+    RETURN_IF_ERROR(LoadConfig(cfg.get(), json, knowhere::TRAIN, "Merge", &msg));
+    return this->node->Merge(*other.node, std::move(cfg), use_knowhere_build_pool);
+}
+
 template <typename T>
 inline expected<DataSetPtr>
 Index<T>::Search(const DataSetPtr dataset, const Json& json, const BitsetView& bitset_,
@@ -181,6 +206,61 @@ Index<T>::Search(const DataSetPtr dataset, const Json& json, const BitsetView& b
     return res;
 }
 
+template <typename T>
+inline expected<std::vector<DataSetPtr>>
+Index<T>::MultiSearch(const DataSetPtr dataset, const Json& json, const std::vector<int64_t>& ks,
+                      const std::vector<BitsetView>& bitsets_, milvus::OpContext* op_context) const {
+    auto cfg = this->node->CreateConfig();
+    std::string msg;
+    const Status load_status = LoadConfig(cfg.get(), json, knowhere::SEARCH, "MultiSearch", &msg);
+    if (load_status != Status::success) {
+        return expected<std::vector<DataSetPtr>>::Err(load_status, msg);
+    }
+    auto rows = dataset->GetRows();
+    if (ks.size() != (size_t)rows || bitsets_.size() != (size_t)rows) {
+        msg = fmt::format("ks and bitsets should have one entry per query, but we get nq: {}, ks: {}, bitsets: {}",
+                          rows, ks.size(), bitsets_.size());
+        LOG_KNOWHERE_ERROR_ << msg;
+        return expected<std::vector<DataSetPtr>>::Err(Status::invalid_args, msg);
+    }
+
+    std::vector<BitsetView> bitsets(rows);
+    int64_t max_k = 0;
+    for (int64_t i = 0; i < rows; ++i) {
+        if (ks[i] <= 0) {
+            msg = fmt::format("k should be positive, but we get k: {} for query {}", ks[i], i);
+            LOG_KNOWHERE_ERROR_ << msg;
+            return expected<std::vector<DataSetPtr>>::Err(Status::invalid_args, msg);
+        }
+        max_k = std::max(max_k, ks[i]);
+        // see Search for why the bitset size must not exceed the data count
+        const auto& bitset_ = bitsets_[i];
+        if (bitset_.size() > (size_t)this->Count()) {
+            msg = fmt::format("bitset size should be <= data count, but we get bitset size: {}, data count: {}",
+                              bitset_.size(), this->Count());
+            LOG_KNOWHERE_ERROR_ << msg;
+            return expected<std::vector<DataSetPtr>>::Err(Status::invalid_args, msg);
+        }
+        if (bitset_.count() == 0) {
+            bitsets[i] = BitsetView(bitset_.data(), bitset_.size(), bitset_.get_filtered_out_num_());
+        } else {
+            bitsets[i] = bitset_;
+        }
+    }
+
+#if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
+    TimeRecorder rc("MultiSearch");
+    auto res = this->node->MultiSearch(dataset, std::move(cfg), ks, bitsets, op_context);
+    auto time = rc.ElapseFromBegin("done");
+    time *= 0.001;  // convert to ms
+    knowhere_search_latency.Observe(time);
+    knowhere_search_topk.Observe(max_k);
+#else
+    auto res = this->node->MultiSearch(dataset, std::move(cfg), ks, bitsets, op_context);
+#endif
+    return res;
+}
+
 template <typename T>
 inline expected<std::vector<std::shared_ptr<IndexNode::iterator>>>
 Index<T>::AnnIterator(const DataSetPtr dataset, const Json& json, const BitsetView& bitset_,
@@ -317,6 +397,12 @@ Index<T>::Serialize(BinarySet& binset) const {
     return this->node->SerializeEmbListIfNeed(binset);
 }
 
+template <typename T>
+inline Status
+Index<T>::SerializeToFile(const std::string& filename) const {
+    return this->node->SerializeToFile(filename);
+}
+
 template <typename T>
 inline Status
 Index<T>::Deserialize(const BinarySet& binset, const Json& json) {
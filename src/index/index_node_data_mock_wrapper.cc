@@ -60,6 +60,15 @@ IndexNodeDataMockWrapper<DataType>::RangeSearch(const DataSetPtr dataset, std::u
     return index_node_->RangeSearch(ds_ptr, std::move(cfg), bitset, op_context);
 }
 
+template <typename DataType>
+expected<std::vector<DataSetPtr>>
+IndexNodeDataMockWrapper<DataType>::MultiSearch(const DataSetPtr dataset, std::unique_ptr<Config> cfg,
+                                                const std::vector<int64_t>& ks, const std::vector<BitsetView>& bitsets,
+                                                milvus::OpContext* op_context) const {
+    auto ds_ptr = ConvertFromDataTypeIfNeeded<DataType>(dataset);
+    return index_node_->MultiSearch(ds_ptr, std::move(cfg), ks, bitsets, op_context);
+}
+
 template <typename DataType>
 expected<std::vector<IndexNode::IteratorPtr>>
 IndexNodeDataMockWrapper<DataType>::AnnIterator(const DataSetPtr dataset, std::unique_ptr<Config> cfg,
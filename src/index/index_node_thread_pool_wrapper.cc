@@ -50,4 +50,13 @@ IndexNodeThreadPoolWrapper::RangeSearch(const DataSetPtr dataset, std::unique_pt
         .get();
 }
 
+expected<std::vector<DataSetPtr>>
+IndexNodeThreadPoolWrapper::MultiSearch(const DataSetPtr dataset, std::unique_ptr<Config> cfg,
+                                        const std::vector<int64_t>& ks, const std::vector<BitsetView>& bitsets,
+                                        milvus::OpContext* op_context) const {
+    return thread_pool_
+        ->push([&]() { return this->index_node_->MultiSearch(dataset, std::move(cfg), ks, bitsets, op_context); })
+        .get();
+}
+
 }  // namespace knowhere
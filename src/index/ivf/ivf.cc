@@ -14,20 +14,27 @@
 #include "faiss/IndexBinaryIVF.h"
 #include "faiss/IndexFlat.h"
 #include "faiss/IndexFlatElkan.h"
+#include "faiss/IndexHNSW.h"
 #include "faiss/IndexIVFFlat.h"
 #include "faiss/IndexIVFPQ.h"
 #include "faiss/IndexIVFPQFastScan.h"
 #include "faiss/IndexIVFRaBitQ.h"
 #include "faiss/IndexIVFScalarQuantizerCC.h"
+#include "faiss/IndexRefine.h"
 #include "faiss/IndexScaNN.h"
 #include "faiss/IndexScalarQuantizer.h"
 #include "faiss/VectorTransform.h"
+#include "faiss/impl/zerocopy_io.h"
 #include "faiss/index_io.h"
+#include "faiss/utils/Heap.h"
+#include "faiss/utils/distances.h"
 #include "index/data_view_dense_index/index_node_with_data_view_refiner.h"
 #include "index/ivf/ivf_config.h"
 #include "index/ivf/ivfrbq_wrapper.h"
 #include "io/memory_io.h"
 #include "knowhere/bitsetview_idselector.h"
+#include "knowhere/comp/index_param.h"
+#include "knowhere/comp/search_canceller.h"
 #include "knowhere/dataset.h"
 #include "knowhere/expected.h"
 #include "knowhere/feature.h"
@@ -39,6 +46,10 @@
 #include "knowhere/thread_pool.h"
 #include "knowhere/utils.h"
 
+#if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
+#include "knowhere/prometheus_client.h"
+#endif
+
 namespace knowhere {
 struct IVFBaseTag {};
 struct IVFFlatTag {};
@@ -53,6 +64,26 @@ struct IndexDispatch<faiss::IndexIVFFlat> {
     using Tag = IVFFlatTag;
 };
 
+// the feder meta only needs contiguous lists, so it is shared with the quantized indexes
+template <>
+struct IndexDispatch<faiss::IndexIVFPQ> {
+    using Tag = IVFFlatTag;
+};
+
+template <>
+struct IndexDispatch<faiss::IndexIVFScalarQuantizer> {
+    using Tag = IVFFlatTag;
+};
+
+template <>
+struct IndexDispatch<IndexIVFRaBitQWrapper> {
+    using Tag = IVFFlatTag;
+};
+
+namespace {
+struct CoarseCentroidCache;
+}  // namespace
+
 template <typename DataType, typename IndexType>
 class IvfIndexNode : public IndexNode {
  public:
@@ -81,6 +112,9 @@ class IvfIndexNode : public IndexNode {
     expected<DataSetPtr>
     RangeSearch(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const BitsetView& bitset,
                 milvus::OpContext* op_context) const override;
+    expected<std::vector<DataSetPtr>>
+    MultiSearch(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const std::vector<int64_t>& ks,
+                const std::vector<BitsetView>& bitsets, milvus::OpContext* op_context) const override;
     static constexpr bool
     is_ann_iterator_supported() {
         return (std::is_same<faiss::IndexIVFFlatCC, IndexType>::value ||
@@ -181,6 +215,8 @@ class IvfIndexNode : public IndexNode {
         return this->SerializeImpl(binset);
     }
     Status
+    SerializeToFile(const std::string& filename) const override;
+    Status
     Deserialize(const BinarySet& binset, std::shared_ptr<Config> cfg) override;
     Status
     DeserializeFromFile(const std::string& filename, std::shared_ptr<Config> cfg) override;
@@ -325,6 +361,12 @@ class IvfIndexNode : public IndexNode {
     Status
     SerializeImpl(BinarySet& binset) const;
 
+    void
+    WriteIndex(faiss::IOWriter* writer) const;
+
+    Status
+    ReadIndex(faiss::IOReader* reader);
+
     Status
     TrainInternal(const DataSetPtr dataset, std::shared_ptr<Config> cfg);
 
@@ -344,7 +386,7 @@ class IvfIndexNode : public IndexNode {
     class iterator : public IndexIterator {
      public:
         iterator(const IndexType* index, std::unique_ptr<float[]>&& copied_query, const BitsetView& bitset,
-                 size_t nprobe, bool larger_is_closer, const float refine_ratio = 0.5f,
+                 size_t nprobe, bool adaptive_nprobe, bool larger_is_closer, const float refine_ratio = 0.5f,
                  bool use_knowhere_search_pool = true)
             : IndexIterator(larger_is_closer, use_knowhere_search_pool, refine_ratio),
               index_(index),
@@ -356,6 +398,7 @@ class IvfIndexNode : public IndexNode {
 
             ivf_search_params_.nprobe = nprobe;
             ivf_search_params_.max_codes = 0;
+            ivf_search_params_.adaptive_nprobe = adaptive_nprobe;
 
             workspace_ = index_->getIteratorWorkspace(copied_query_.get(), &ivf_search_params_);
         }
@@ -363,6 +406,12 @@ class IvfIndexNode : public IndexNode {
      protected:
         void
         next_batch(std::function<void(const std::vector<DistId>&)> batch_handler) override {
+            // the adaptive nprobe bounds only apply to L2, whose sign_ is 1. They bound exact distances, so with
+            // refinement only the refined results count, not the estimates in res_.
+            const auto& exact_res = this->refine_ ? this->refined_res_ : this->res_;
+            workspace_->best_backup_dis =
+                exact_res.empty() ? std::numeric_limits<float>::max() : exact_res.top().val;
+            workspace_->refine_dists = this->refine_;
             index_->getIteratorNextBatch(workspace_.get(), this->res_.size());
             batch_handler(workspace_->dists);
             workspace_->dists.clear();
@@ -389,6 +438,19 @@ class IvfIndexNode : public IndexNode {
     };
 
     std::unique_ptr<IndexType> index_;
+    // the inverted lists are a view over a binary or a mapped file, the first add copies them out. The CC lists are
+    // always copied on load.
+    bool storage_is_view_ = false;
+    // the indexes whose flat coarse quantizer may be searched by BatchCoarseAssign()
+    static constexpr bool kHasBatchCoarseAssign =
+        std::is_same_v<IndexType, faiss::IndexIVFFlat> || std::is_same_v<IndexType, faiss::IndexIVFPQ> ||
+        std::is_same_v<IndexType, faiss::IndexIVFScalarQuantizer> || std::is_same_v<IndexType, faiss::IndexIVFFlatCC> ||
+        std::is_same_v<IndexType, faiss::IndexIVFScalarQuantizerCC>;
+    // the centered centroids of the coarse quantizer, set when it is trained or loaded. The quantizer does not change
+    // when vectors are added.
+    std::shared_ptr<const CoarseCentroidCache> coarse_centroids_;
+    static constexpr bool kHasGrowableLists = std::is_same_v<IndexType, faiss::IndexIVFFlatCC> ||
+                                              std::is_same_v<IndexType, faiss::IndexIVFScalarQuantizerCC>;
     std::shared_ptr<ThreadPool> search_pool_;
     // Faiss uses OpenMP for training/building the index and we have no control
     // over those threads. build_pool_ is used to make sure the OMP threads
@@ -442,6 +504,77 @@ to_index_flat(std::unique_ptr<faiss::IndexFlat>&& index) {
     return std::make_unique<faiss::IndexFlat>(std::move(*index));
 }
 
+// the IndexIVF that holds the inverted lists and the coarse quantizer of a knowhere IVF index
+template <typename IndexType>
+auto
+get_ivf_index(IndexType* index) {
+    using IvfType = std::conditional_t<std::is_const_v<IndexType>, const faiss::IndexIVF, faiss::IndexIVF>;
+    if constexpr (std::is_same_v<std::remove_const_t<IndexType>, faiss::IndexScaNN>) {
+        return dynamic_cast<IvfType*>(index->base_index);
+    } else if constexpr (std::is_same_v<std::remove_const_t<IndexType>, IndexIVFRaBitQWrapper>) {
+        return static_cast<IvfType*>(index->get_ivfrabitq_index());
+    } else {
+        return static_cast<IvfType*>(index);
+    }
+}
+
+constexpr int kCoarseHnswEfConstruction = 200;
+
+// replace the trained flat quantizer with the one picked by coarse_quantizer, for probing lists at search time. It
+// keeps the fp32 centroids in a flat index, which IndexIVF::assign_for_add scans to put added vectors in their exact
+// nearest lists.
+Status
+BuildCoarseQuantizer(faiss::IndexIVF* index, const IvfConfig& cfg) {
+    const auto& type = cfg.coarse_quantizer.value();
+    if (type == coarse_quantizer_type::FLAT) {
+        return Status::success;
+    }
+    auto flat = dynamic_cast<const faiss::IndexFlat*>(index->quantizer);
+    if (flat == nullptr || !index->own_fields) {
+        LOG_KNOWHERE_ERROR_ << "coarse quantizer " << type << " can not replace the trained quantizer";
+        return Status::invalid_args;
+    }
+    const auto nlist = flat->ntotal;
+    const auto* centroids = flat->get_xb();
+
+    std::unique_ptr<faiss::Index> qzr;
+    if (type == coarse_quantizer_type::HNSW) {
+        auto hnsw = std::make_unique<faiss::IndexHNSWFlat>(flat->d, cfg.coarse_hnsw_m.value(), flat->metric_type);
+        hnsw->hnsw.efConstruction = std::max<int>(kCoarseHnswEfConstruction, cfg.coarse_hnsw_ef.value());
+        // faiss searches with max(efSearch, k), so a large nprobe widens the beam on its own
+        hnsw->hnsw.efSearch = cfg.coarse_hnsw_ef.value();
+        hnsw->add(nlist, centroids);
+        qzr = std::move(hnsw);
+    } else {
+        auto sq = std::make_unique<faiss::IndexScalarQuantizer>(
+            flat->d, faiss::ScalarQuantizer::QuantizerType::QT_8bit, flat->metric_type);
+        // the refine index keeps the fp32 centroids to rerank the sq8 candidates, and to reconstruct them
+        auto refine = std::make_unique<faiss::IndexRefineFlat>(sq.release());
+        refine->own_fields = true;
+        refine->k_factor = cfg.coarse_refine_k.value();
+        refine->train(nlist, centroids);
+        refine->add(nlist, centroids);
+        qzr = std::move(refine);
+    }
+    LOG_KNOWHERE_INFO_ << "built a " << type << " coarse quantizer over " << nlist << " centroids";
+
+    delete index->quantizer;
+    index->quantizer = qzr.release();
+    return Status::success;
+}
+
+// the name of the coarse quantizer type, as in coarse_quantizer
+const char*
+GetCoarseQuantizerType(const faiss::Index* quantizer) {
+    if (dynamic_cast<const faiss::IndexHNSWFlat*>(quantizer) != nullptr) {
+        return coarse_quantizer_type::HNSW;
+    }
+    if (dynamic_cast<const faiss::IndexRefine*>(quantizer) != nullptr) {
+        return coarse_quantizer_type::SQ8;
+    }
+    return coarse_quantizer_type::FLAT;
+}
+
 expected<faiss::ScalarQuantizer::QuantizerType>
 get_ivf_sq_quantizer_type(int code_size) {
     switch (code_size) {
@@ -458,6 +591,487 @@ get_ivf_sq_quantizer_type(int code_size) {
                 Status::invalid_args, fmt::format("current code size {} not in (4, 6, 8, 16)", code_size));
     }
 }
+
+// below this number of queries, the per-query quantizer search is cheaper than packing tiles
+constexpr int64_t kBatchCoarseAssignMinQueries = 16;
+constexpr int64_t kBatchCoarseAssignQueryBlock = 64;
+constexpr int64_t kBatchCoarseAssignListBlock = 1024;
+
+// lists kept beyond nprobe on the bf16 products, re-checked in fp32 before the final selection. The window grows
+// with nprobe so that the lists left out sit clear of the bf16 error bound of the nprobe-th one.
+constexpr int64_t kBatchCoarseAssignRecheck = 8;
+
+// the centroids of a flat coarse quantizer, centered on their mean for the batched assignment. The bf16 rounding
+// error of <q, c> grows with ||q|| * ||c||, centering both sides keeps it at the scale of the spread of the
+// centroids instead of their offset from the origin. Computed once when the quantizer is trained or loaded.
+struct CoarseCentroidCache {
+    std::vector<float> mean;
+    // c - mean for every list
+    std::vector<float> centered;
+    // ||c - mean||^2 for L2 and <mean, c - mean> for IP, the part of the distance that only depends on the list
+    std::vector<float> bias;
+    float max_centered_norm = 0;
+};
+
+// returns nullptr if the quantizer cannot be served by the batched kernel
+std::shared_ptr<const CoarseCentroidCache>
+CacheCoarseCentroids(const faiss::IndexIVF* index) {
+    const auto* quantizer = dynamic_cast<const faiss::IndexFlat*>(index->quantizer);
+    if (quantizer == nullptr || quantizer->ntotal == 0 ||
+        (quantizer->metric_type != faiss::METRIC_L2 && quantizer->metric_type != faiss::METRIC_INNER_PRODUCT)) {
+        return nullptr;
+    }
+    const auto* centroids = quantizer->get_xb();
+    const int64_t dim = quantizer->d;
+    const int64_t nlist = quantizer->ntotal;
+    auto cache = std::make_shared<CoarseCentroidCache>();
+    cache->mean.assign(dim, 0.0f);
+    for (int64_t j = 0; j < nlist; j++) {
+        for (int64_t d = 0; d < dim; d++) {
+            cache->mean[d] += centroids[j * dim + d];
+        }
+    }
+    for (auto& m : cache->mean) {
+        m /= nlist;
+    }
+    cache->centered.resize(nlist * dim);
+    cache->bias.resize(nlist);
+    for (int64_t j = 0; j < nlist; j++) {
+        auto* c = cache->centered.data() + j * dim;
+        for (int64_t d = 0; d < dim; d++) {
+            c[d] = centroids[j * dim + d] - cache->mean[d];
+        }
+        const float norm = faiss::fvec_norm_L2sqr(c, dim);
+        cache->bias[j] = quantizer->metric_type == faiss::METRIC_L2
+                             ? norm
+                             : faiss::fvec_inner_product(cache->mean.data(), c, dim);
+        cache->max_centered_norm = std::max(cache->max_centered_norm, std::sqrt(norm));
+    }
+    return cache;
+}
+
+// pick the nprobe closest lists of nq queries with the batched (AMX) inner product kernel.
+// The bf16 products are taken between the centered queries and centroids, and the query and list terms are added
+// back so that the approximate distances are in the same space as the exact ones. The 2 * nprobe +
+// kBatchCoarseAssignRecheck best lists on them are re-checked in fp32 and the nprobe best of them are kept. The
+// selection is certified with the bf16 error bound: a list left out is at least as far as the worst candidate minus
+// that bound, and if it could still beat the nprobe-th exact distance the query falls back to quantizer->search(),
+// so search_preassigned() always sees what quantizer->search() would return. Returns the number of fallbacks.
+template <class C>
+int64_t
+BatchCoarseAssignBlock(const faiss::IndexFlat* quantizer, const CoarseCentroidCache& cache, const float* xq,
+                       int64_t nq, int64_t nprobe, int64_t* coarse_ids, float* coarse_dis) {
+    const bool is_l2 = (quantizer->metric_type == faiss::METRIC_L2);
+    const auto* centroids = quantizer->get_xb();
+    const int64_t dim = quantizer->d;
+    const int64_t nlist = quantizer->ntotal;
+    const int64_t ncand = std::min(2 * nprobe + kBatchCoarseAssignRecheck, nlist);
+
+    // q - mean, and the part of the distance that only depends on the query: ||q - mean||^2 for L2, <q, mean> for IP
+    std::vector<float> xq_centered(nq * dim);
+    std::vector<float> query_norms(nq);
+    std::vector<float> query_offsets(nq);
+    for (int64_t i = 0; i < nq; i++) {
+        const float* q = xq + i * dim;
+        auto* qc = xq_centered.data() + i * dim;
+        for (int64_t d = 0; d < dim; d++) {
+            qc[d] = q[d] - cache.mean[d];
+        }
+        query_norms[i] = faiss::fvec_norm_L2sqr(qc, dim);
+        query_offsets[i] = is_l2 ? query_norms[i] : faiss::fvec_inner_product(q, cache.mean.data(), dim);
+    }
+
+    std::vector<float> cand_dis(nq * ncand);
+    std::vector<int64_t> cand_ids(nq * ncand);
+    std::vector<float> ip(nq * kBatchCoarseAssignListBlock);
+    for (int64_t i = 0; i < nq; i++) {
+        faiss::heap_heapify<C>(ncand, cand_dis.data() + i * ncand, cand_ids.data() + i * ncand);
+    }
+    for (int64_t j0 = 0; j0 < nlist; j0 += kBatchCoarseAssignListBlock) {
+        const int64_t nj = std::min(kBatchCoarseAssignListBlock, nlist - j0);
+        faiss::fvec_inner_products_batch_bf16(ip.data(), xq_centered.data(), cache.centered.data() + j0 * dim, dim,
+                                              nq, nj);
+        for (int64_t i = 0; i < nq; i++) {
+            auto* heap_dis = cand_dis.data() + i * ncand;
+            auto* heap_ids = cand_ids.data() + i * ncand;
+            const float* ip_i = ip.data() + i * nj;
+            for (int64_t j = 0; j < nj; j++) {
+                // the query offset is the same for all the lists of a query, it is added back below
+                const float dis = is_l2 ? cache.bias[j0 + j] - 2 * ip_i[j] : cache.bias[j0 + j] + ip_i[j];
+                if (C::cmp(heap_dis[0], dis)) {
+                    faiss::heap_replace_top<C>(ncand, heap_dis, heap_ids, dis, j0 + j);
+                }
+            }
+        }
+    }
+    int64_t fallbacks = 0;
+    for (int64_t i = 0; i < nq; i++) {
+        auto* heap_dis = coarse_dis + i * nprobe;
+        auto* heap_ids = coarse_ids + i * nprobe;
+        const float* q = xq + i * dim;
+        const float worst_approx = cand_dis[i * ncand] + query_offsets[i];
+        faiss::heap_heapify<C>(nprobe, heap_dis, heap_ids);
+        for (int64_t j = 0; j < ncand; j++) {
+            const int64_t id = cand_ids[i * ncand + j];
+            if (id < 0) {
+                continue;
+            }
+            const float* c = centroids + id * dim;
+            const float dis = is_l2 ? faiss::fvec_L2sqr(q, c, dim) : faiss::fvec_inner_product(q, c, dim);
+            if (C::cmp(heap_dis[0], dis)) {
+                faiss::heap_replace_top<C>(nprobe, heap_dis, heap_ids, dis, id);
+            }
+        }
+        if (ncand < nlist) {
+            const float err = (is_l2 ? 2 : 1) * faiss::kBf16InnerProductRelError * std::sqrt(query_norms[i]) *
+                              cache.max_centered_norm;
+            const float bound = is_l2 ? worst_approx - err : worst_approx + err;
+            if (C::cmp(heap_dis[0], bound)) {
+                quantizer->search(1, q, nprobe, heap_dis, heap_ids);
+                fallbacks++;
+                continue;
+            }
+        }
+        faiss::heap_reorder<C>(nprobe, heap_dis, heap_ids);
+    }
+    return fallbacks;
+}
+
+// returns false if the quantizer cannot be served by the batched kernel
+bool
+BatchCoarseAssign(const faiss::IndexIVF* index, const CoarseCentroidCache* cache, const float* xq, int64_t nq,
+                  int64_t nprobe, const std::shared_ptr<ThreadPool>& pool, int64_t* coarse_ids, float* coarse_dis) {
+    if (cache == nullptr) {
+        return false;
+    }
+    const auto* quantizer = static_cast<const faiss::IndexFlat*>(index->quantizer);
+
+    std::atomic<int64_t> fallbacks{0};
+    std::vector<folly::Future<folly::Unit>> futs;
+    futs.reserve((nq + kBatchCoarseAssignQueryBlock - 1) / kBatchCoarseAssignQueryBlock);
+    for (int64_t i0 = 0; i0 < nq; i0 += kBatchCoarseAssignQueryBlock) {
+        futs.emplace_back(pool->push([&, i0] {
+            ThreadPool::ScopedSearchOmpSetter setter(1);
+            const int64_t ni = std::min(kBatchCoarseAssignQueryBlock, nq - i0);
+            const auto* q = xq + i0 * quantizer->d;
+            if (quantizer->metric_type == faiss::METRIC_L2) {
+                fallbacks += BatchCoarseAssignBlock<faiss::CMax<float, int64_t>>(
+                    quantizer, *cache, q, ni, nprobe, coarse_ids + i0 * nprobe, coarse_dis + i0 * nprobe);
+            } else {
+                fallbacks += BatchCoarseAssignBlock<faiss::CMin<float, int64_t>>(
+                    quantizer, *cache, q, ni, nprobe, coarse_ids + i0 * nprobe, coarse_dis + i0 * nprobe);
+            }
+        }));
+    }
+    WaitAllSuccess(futs);
+#if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
+    knowhere_ivf_batch_assign_queries.Increment(nq);
+    knowhere_ivf_batch_assign_fallbacks.Increment(fallbacks.load());
+#endif
+    return true;
+}
+
+// below this number of queries probing a list, the list is scanned by the per-query scanners instead of being decoded
+constexpr size_t kMultiSearchSharedScanMinQueries = 2;
+constexpr size_t kMultiSearchDecodeBlock = 256;
+
+// decode n codes of a list into full vectors, with the list centroid added back for residual codes. IVF_FLAT codes
+// are the vectors themselves and are returned in place.
+const float*
+DecodeListCodes(const faiss::IndexIVF* index, const float* centroid, const uint8_t* codes, size_t n,
+                std::vector<float>& buf) {
+    if (dynamic_cast<const faiss::IndexIVFFlat*>(index) != nullptr) {
+        return reinterpret_cast<const float*>(codes);
+    }
+    const size_t dim = index->d;
+    buf.resize(n * dim);
+    if (const auto* ivfsq = dynamic_cast<const faiss::IndexIVFScalarQuantizer*>(index); ivfsq != nullptr) {
+        ivfsq->sq.decode(codes, buf.data(), n);
+    } else if (const auto* ivfpq = dynamic_cast<const faiss::IndexIVFPQ*>(index); ivfpq != nullptr) {
+        ivfpq->pq.decode(codes, buf.data(), n);
+    } else {
+        throw std::runtime_error("unsupported IVF index type for the shared list scan");
+    }
+    if (index->by_residual) {
+        for (size_t j = 0; j < n; ++j) {
+            for (size_t l = 0; l < dim; ++l) {
+                buf[j * dim + l] += centroid[l];
+            }
+        }
+    }
+    return buf.data();
+}
+
+// scan the lists probed by a batch of queries so that every list is read once for all the queries probing it.
+// Each task owns a subset of the lists and keeps one heap per query. A list probed by several queries is decoded
+// block by block once, and every block is evaluated against all these queries with their own filter and heap; a list
+// probed by a single query goes through that query's scanner.
+//
+// max_codes[i] and ensure_topk_full follow IndexIVF::search_preassigned(): query i stops after the first list that
+// brings its count of scanned codes to max_codes[i] (and to its top-k if ensure_topk_full), 0 means no limit. The
+// shared pass covers the shortest prefix of the probed lists whose sizes reach that count, the codes filtered out
+// are not counted, so the queries short of it then go on with their next lists one at a time.
+template <class C>
+void
+MultiSearchScanLists(const faiss::IndexIVF* index, const float* xq, int64_t nq, int64_t nprobe,
+                     const int64_t* coarse_ids, const float* coarse_dis, const std::vector<int64_t>& k_offsets,
+                     const std::vector<BitsetView>& bitsets, const std::vector<size_t>& max_codes,
+                     bool ensure_topk_full, const std::shared_ptr<ThreadPool>& pool, const SearchCanceller& canceller,
+                     float* distances, int64_t* ids) {
+    const int64_t dim = index->d;
+    const bool apply_code_norms = dynamic_cast<const faiss::IndexIVFFlat*>(index) != nullptr;
+    auto stop_count = [&](int64_t i) -> size_t {
+        const size_t k = k_offsets[i + 1] - k_offsets[i];
+        if (max_codes[i] == 0) {
+            return std::numeric_limits<size_t>::max();
+        }
+        return ensure_topk_full ? std::max(max_codes[i], k) : max_codes[i];
+    };
+
+    // queries probing each list in the shared pass, with their coarse distance to the list
+    std::vector<int64_t> shared_nprobe(nq, nprobe);
+    std::vector<std::vector<std::pair<int64_t, float>>> list_queries(index->nlist);
+    for (int64_t i = 0; i < nq; ++i) {
+        const size_t stop = stop_count(i);
+        size_t list_sizes = 0;
+        for (int64_t j = 0; j < nprobe; ++j) {
+            const auto list_no = coarse_ids[i * nprobe + j];
+            if (list_no < 0 || index->invlists->is_empty(list_no)) {
+                continue;
+            }
+            list_queries[list_no].emplace_back(i, coarse_dis[i * nprobe + j]);
+            list_sizes += index->invlists->list_size(list_no);
+            if (list_sizes >= stop) {
+                shared_nprobe[i] = j + 1;
+                break;
+            }
+        }
+    }
+    std::vector<int64_t> active_lists;
+    for (size_t list_no = 0; list_no < index->nlist; ++list_no) {
+        if (!list_queries[list_no].empty()) {
+            active_lists.push_back(list_no);
+        }
+    }
+
+    const int64_t total_k = k_offsets[nq];
+    const int64_t n_tasks =
+        std::clamp<int64_t>(active_lists.size(), 1, std::max<int64_t>(1, static_cast<int64_t>(pool->size())));
+    std::vector<float> task_dis(n_tasks * total_k);
+    std::vector<int64_t> task_ids(n_tasks * total_k);
+    std::vector<size_t> task_nscan(n_tasks * nq, 0);
+    std::vector<BitsetViewIDSelector> selectors(bitsets.begin(), bitsets.end());
+    auto make_scanner = [&](int64_t i) {
+        const faiss::IDSelector* sel = bitsets[i].empty() ? nullptr : &selectors[i];
+        std::unique_ptr<faiss::InvertedListScanner> scanner(index->get_InvertedListScanner(false, sel));
+        scanner->set_query(xq + i * dim);
+        return scanner;
+    };
+    // scan one list for query i with its scanner, returns the number of codes that passed the filter
+    auto scan_list = [&](faiss::InvertedListScanner* scanner, int64_t i, int64_t list_no, float list_dis,
+                         float* heap_dis, int64_t* heap_ids) -> size_t {
+        const size_t k = k_offsets[i + 1] - k_offsets[i];
+        scanner->set_list(list_no, list_dis);
+        size_t scan_cnt = 0;
+        if (index->invlists->use_iterator) {
+            std::unique_ptr<faiss::InvertedListsIterator> it(index->invlists->get_iterator(list_no));
+            scanner->iterate_codes(it.get(), heap_dis, heap_ids, k, scan_cnt);
+            return scan_cnt;
+        }
+        const size_t segment_num = index->invlists->get_segment_num(list_no);
+        for (size_t segment_idx = 0; segment_idx < segment_num; ++segment_idx) {
+            const size_t segment_size = index->invlists->get_segment_size(list_no, segment_idx);
+            const size_t segment_offset = index->invlists->get_segment_offset(list_no, segment_idx);
+            faiss::InvertedLists::ScopedCodes scodes(index->invlists, list_no, segment_offset);
+            faiss::InvertedLists::ScopedIds sids(index->invlists, list_no, segment_offset);
+            faiss::InvertedLists::ScopedCodeNorms scode_norms(index->invlists, list_no, segment_offset);
+            scanner->scan_codes(segment_size, scodes.get(), scode_norms.get(), sids.get(), heap_dis, heap_ids, k,
+                                scan_cnt);
+        }
+        return scan_cnt;
+    };
+
+    std::vector<folly::Future<folly::Unit>> futs;
+    futs.reserve(n_tasks);
+    for (int64_t t = 0; t < n_tasks; ++t) {
+        futs.emplace_back(pool->push([&, t] {
+            ThreadPool::ScopedSearchOmpSetter setter(1);
+            float* heap_dis = task_dis.data() + t * total_k;
+            int64_t* heap_ids = task_ids.data() + t * total_k;
+            size_t* nscan = task_nscan.data() + t * nq;
+            for (int64_t i = 0; i < nq; ++i) {
+                faiss::heap_heapify<C>(k_offsets[i + 1] - k_offsets[i], heap_dis + k_offsets[i],
+                                       heap_ids + k_offsets[i]);
+            }
+            std::vector<std::unique_ptr<faiss::InvertedListScanner>> scanners(nq);
+            std::vector<float> centroid(dim);
+            std::vector<float> decoded;
+            std::vector<float> block_dis(kMultiSearchDecodeBlock);
+
+            // lists are dealt round-robin, neighbouring lists tend to have similar sizes
+            for (size_t l = t; l < active_lists.size(); l += n_tasks) {
+                // a stopped request keeps the lists scanned so far
+                if (canceller.IsStopped()) {
+                    break;
+                }
+                const auto list_no = active_lists[l];
+                const auto& queries = list_queries[list_no];
+                if (index->invlists->use_iterator || queries.size() < kMultiSearchSharedScanMinQueries) {
+                    for (const auto& [i, dis] : queries) {
+                        if (scanners[i] == nullptr) {
+                            scanners[i] = make_scanner(i);
+                        }
+                        nscan[i] += scan_list(scanners[i].get(), i, list_no, dis, heap_dis + k_offsets[i],
+                                              heap_ids + k_offsets[i]);
+                    }
+                    continue;
+                }
+                if (index->by_residual) {
+                    index->quantizer->reconstruct(list_no, centroid.data());
+                }
+                const size_t segment_num = index->invlists->get_segment_num(list_no);
+                for (size_t segment_idx = 0; segment_idx < segment_num; ++segment_idx) {
+                    const size_t segment_size = index->invlists->get_segment_size(list_no, segment_idx);
+                    const size_t segment_offset = index->invlists->get_segment_offset(list_no, segment_idx);
+                    faiss::InvertedLists::ScopedCodes scodes(index->invlists, list_no, segment_offset);
+                    faiss::InvertedLists::ScopedIds sids(index->invlists, list_no, segment_offset);
+                    faiss::InvertedLists::ScopedCodeNorms scode_norms(index->invlists, list_no, segment_offset);
+                    const float* code_norms = apply_code_norms ? scode_norms.get() : nullptr;
+                    for (size_t j0 = 0; j0 < segment_size; j0 += kMultiSearchDecodeBlock) {
+                        const size_t nj = std::min(kMultiSearchDecodeBlock, segment_size - j0);
+                        const float* y = DecodeListCodes(index, centroid.data(),
+                                                         scodes.get() + j0 * index->code_size, nj, decoded);
+                        const int64_t* block_ids = sids.get() + j0;
+                        for (const auto& [i, list_dis] : queries) {
+                            const auto& bitset = bitsets[i];
+                            const int64_t k = k_offsets[i + 1] - k_offsets[i];
+                            float* dis_i = heap_dis + k_offsets[i];
+                            int64_t* ids_i = heap_ids + k_offsets[i];
+                            if constexpr (C::is_max) {
+                                faiss::fvec_L2sqr_ny(block_dis.data(), xq + i * dim, y, dim, nj);
+                            } else {
+                                faiss::fvec_inner_products_ny(block_dis.data(), xq + i * dim, y, dim, nj);
+                            }
+                            for (size_t j = 0; j < nj; ++j) {
+                                if (!bitset.empty() && bitset.test(block_ids[j])) {
+                                    continue;
+                                }
+                                nscan[i]++;
+                                float dis = block_dis[j];
+                                if (code_norms != nullptr) {
+                                    dis /= code_norms[j0 + j];
+                                }
+                                if (C::cmp(dis_i[0], dis)) {
+                                    faiss::heap_replace_top<C>(k, dis_i, ids_i, dis, block_ids[j]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }));
+    }
+    WaitAllSuccess(futs);
+
+    // merge the heaps of all the tasks into the first one
+    std::vector<int64_t> unfinished;
+    for (int64_t i = 0; i < nq; ++i) {
+        const int64_t k = k_offsets[i + 1] - k_offsets[i];
+        float* dis_i = task_dis.data() + k_offsets[i];
+        int64_t* ids_i = task_ids.data() + k_offsets[i];
+        for (int64_t t = 1; t < n_tasks; ++t) {
+            faiss::heap_addn<C>(k, dis_i, ids_i, task_dis.data() + t * total_k + k_offsets[i],
+                                task_ids.data() + t * total_k + k_offsets[i], k);
+            task_nscan[i] += task_nscan[t * nq + i];
+        }
+        if (shared_nprobe[i] < nprobe && task_nscan[i] < stop_count(i)) {
+            unfinished.push_back(i);
+        }
+    }
+
+    // the queries whose filters left them short of their count of codes go on list by list in coarse order
+    futs.clear();
+    for (const auto i : unfinished) {
+        futs.emplace_back(pool->push([&, i] {
+            ThreadPool::ScopedSearchOmpSetter setter(1);
+            auto scanner = make_scanner(i);
+            const size_t stop = stop_count(i);
+            size_t nscan = task_nscan[i];
+            for (int64_t j = shared_nprobe[i]; j < nprobe && nscan < stop; ++j) {
+                const auto list_no = coarse_ids[i * nprobe + j];
+                if (canceller.IsStopped()) {
+                    break;
+                }
+                if (list_no < 0 || index->invlists->is_empty(list_no)) {
+                    continue;
+                }
+                nscan += scan_list(scanner.get(), i, list_no, coarse_dis[i * nprobe + j],
+                                   task_dis.data() + k_offsets[i], task_ids.data() + k_offsets[i]);
+            }
+        }));
+    }
+    WaitAllSuccess(futs);
+
+    for (int64_t i = 0; i < nq; ++i) {
+        const int64_t k = k_offsets[i + 1] - k_offsets[i];
+        float* dis_i = task_dis.data() + k_offsets[i];
+        int64_t* ids_i = task_ids.data() + k_offsets[i];
+        faiss::heap_reorder<C>(k, dis_i, ids_i);
+        std::copy_n(dis_i, k, distances + k_offsets[i]);
+        std::copy_n(ids_i, k, ids + k_offsets[i]);
+    }
+}
+
+// below this number of queries per task, the batched RaBitQ scan has too few queries per list to pay off
+constexpr int64_t kRaBitQBatchMinQueries = 8;
+
+// search IVF_RABITQ with the list-major batched scan, the queries are split into one contiguous group per task,
+// and each group reads every list it probes once, evaluating all the queries of the group against each code.
+// refine_params wraps ivf_params if the candidates are refined. The scan of a group stops between two lists once the
+// request is stopped, all the queries of the group are then counted as aborted.
+void
+RaBitQBatchSearch(const IndexIVFRaBitQWrapper* index, const float* xq, int64_t nq, int64_t k,
+                  const faiss::IVFRaBitQSearchParameters& ivf_params,
+                  const faiss::IndexRefineSearchParameters* refine_params, bool refine_by_lower_bounds,
+                  const std::shared_ptr<ThreadPool>& pool, const SearchCanceller& canceller, float* distances,
+                  int64_t* ids) {
+    const int64_t n_tasks =
+        std::clamp<int64_t>(nq / kRaBitQBatchMinQueries, 1, std::max<int64_t>(1, static_cast<int64_t>(pool->size())));
+    const int64_t group_size = (nq + n_tasks - 1) / n_tasks;
+
+    std::vector<folly::Future<folly::Unit>> futs;
+    futs.reserve(n_tasks);
+    for (int64_t i0 = 0; i0 < nq; i0 += group_size) {
+        futs.emplace_back(pool->push([&, i0] {
+            ThreadPool::ScopedSearchOmpSetter setter(1);
+            const int64_t ni = std::min(group_size, nq - i0);
+            if (canceller.IsStopped()) {
+                for (int64_t i = i0; i < i0 + ni; ++i) {
+                    SearchCanceller::FillEmptyResult(ids + i * k, distances + i * k, k,
+                                                     faiss::is_similarity_metric(index->metric_type));
+                }
+                canceller.AbortQueries(ni);
+                return;
+            }
+            bool stopped = false;
+            faiss::IVFRaBitQSearchParameters group_ivf_params = ivf_params;
+            group_ivf_params.should_stop = canceller.StopCheck(&stopped);
+            faiss::IndexRefineSearchParameters group_refine_params;
+            const faiss::SearchParameters* params = &group_ivf_params;
+            if (refine_params != nullptr) {
+                group_refine_params = *refine_params;
+                group_refine_params.base_index_params = &group_ivf_params;
+                params = &group_refine_params;
+            }
+            index->search_batched(ni, xq + i0 * index->d, k, distances + i0 * k, ids + i0 * k, params,
+                                  refine_by_lower_bounds);
+            if (stopped) {
+                canceller.AbortQueries(ni);
+            }
+        }));
+    }
+    WaitAllSuccess(futs);
+}
 }  // namespace
 
 template <typename DataType, typename IndexType>
@@ -688,7 +1302,14 @@ IvfIndexNode<DataType, IndexType>::TrainInternal(const DataSetPtr dataset, std::
         index = std::move(result.value());
         index->train(rows, (const float*)data);
     }
+    if constexpr (!std::is_same_v<faiss::IndexBinaryIVF, IndexType>) {
+        RETURN_IF_ERROR(BuildCoarseQuantizer(get_ivf_index(index.get()), static_cast<const IvfConfig&>(*cfg)));
+    }
     index_ = std::move(index);
+    storage_is_view_ = false;
+    if constexpr (kHasBatchCoarseAssign) {
+        coarse_centroids_ = CacheCoarseCentroids(index_.get());
+    }
 
     return Status::success;
 }
@@ -701,6 +1322,21 @@ IvfIndexNode<DataType, IndexType>::Add(const DataSetPtr dataset, std::shared_ptr
         LOG_KNOWHERE_ERROR_ << "Can not add data to empty IVF index.";
         return Status::empty_index;
     }
+    if (storage_is_view_) {
+        // the first add after an in-place load copies the lists out of the binary or the mapped file
+        try {
+            RETURN_IF_ERROR(CopyViewedStorage(
+                [&](auto& writer) {
+                    WriteIndex(&writer);
+                    return Status::success;
+                },
+                [&](MemoryIOReader& reader) { return ReadIndex(&reader); }));
+        } catch (const std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
+            return Status::faiss_inner_error;
+        }
+        storage_is_view_ = false;
+    }
     auto data = dataset->GetTensor();
     auto rows = dataset->GetRows();
     const BaseConfig& base_cfg = static_cast<const IvfConfig&>(*cfg);
@@ -752,16 +1388,86 @@ IvfIndexNode<DataType, IndexType>::Search(const DataSetPtr dataset, std::unique_
 
     auto k = ivf_cfg.k.value();
     auto nprobe = ivf_cfg.nprobe.value();
+    SearchCanceller canceller(op_context, ivf_cfg);
 
     auto ids = std::make_unique<int64_t[]>(rows * k);
     auto distances = std::make_unique<float[]>(rows * k);
     try {
+        // with AMX, the coarse assignment of a batch of queries is done as a single tile matmul
+        // against the centroids, and every query then only scans its preassigned lists.
+        std::unique_ptr<float[]> normalized_queries = nullptr;
+        std::unique_ptr<int64_t[]> coarse_ids = nullptr;
+        std::unique_ptr<float[]> coarse_dis = nullptr;
+        int64_t coarse_nprobe = 0;
+        if constexpr (std::is_same_v<IndexType, faiss::IndexIVFFlat> || std::is_same_v<IndexType, faiss::IndexIVFPQ> ||
+                      std::is_same_v<IndexType, faiss::IndexIVFScalarQuantizer>) {
+            if (faiss::support_amx && rows >= kBatchCoarseAssignMinQueries) {
+                auto xq = (const float*)data;
+                if (is_cosine) {
+                    normalized_queries = CopyAndNormalizeVecs(xq, rows, dim);
+                    xq = normalized_queries.get();
+                }
+                coarse_nprobe = std::min<int64_t>(nprobe, index_->nlist);
+                coarse_ids = std::make_unique<int64_t[]>(rows * coarse_nprobe);
+                coarse_dis = std::make_unique<float[]>(rows * coarse_nprobe);
+                if (!BatchCoarseAssign(index_.get(), coarse_centroids_.get(), xq, rows, coarse_nprobe, search_pool_,
+                                       coarse_ids.get(), coarse_dis.get())) {
+                    normalized_queries.reset();
+                    coarse_ids.reset();
+                    coarse_dis.reset();
+                }
+            }
+        }
+
+        if constexpr (std::is_same_v<IndexType, IndexIVFRaBitQWrapper>) {
+            const faiss::IndexIVFRaBitQ* ivf_rabitq = index_->get_ivfrabitq_index();
+            // the adaptive nprobe stops the scan per query, which does not fit the list-major batched scan
+            if (rows >= kRaBitQBatchMinQueries && !ivf_cfg.adaptive_nprobe.value() && ivf_rabitq != nullptr &&
+                !ivf_rabitq->invlists->use_iterator) {
+                const IvfRaBitQConfig& ivf_rabitq_cfg = static_cast<const IvfRaBitQConfig&>(*cfg);
+                auto xq = (const float*)data;
+                if (is_cosine) {
+                    normalized_queries = CopyAndNormalizeVecs(xq, rows, dim);
+                    xq = normalized_queries.get();
+                }
+
+                BitsetViewIDSelector bw_idselector(bitset);
+                faiss::IDSelector* id_selector = (bitset.empty()) ? nullptr : &bw_idselector;
+
+                faiss::IVFRaBitQSearchParameters ivf_search_params;
+                ivf_search_params.nprobe = nprobe;
+                ivf_search_params.max_codes = 0;
+                ivf_search_params.sel = id_selector;
+                ivf_search_params.qb = ivf_rabitq_cfg.rbq_bits_query.value_or(0);
+
+                faiss::IndexRefineSearchParameters refine_search_params;
+                refine_search_params.sel = id_selector;
+                refine_search_params.k_factor = ivf_rabitq_cfg.refine_k.value_or(1);
+                refine_search_params.base_index_params = &ivf_search_params;
+
+                const bool use_refine =
+                    index_->get_refine_index() != nullptr && ivf_rabitq_cfg.refine_k.has_value();
+                RaBitQBatchSearch(index_.get(), xq, rows, k, ivf_search_params,
+                                  use_refine ? &refine_search_params : nullptr,
+                                  ivf_rabitq_cfg.rbq_refine_by_lower_bound.value(), search_pool_, canceller,
+                                  distances.get(), ids.get());
+                auto res = GenResultDataSet(rows, k, std::move(ids), std::move(distances));
+                return canceller.Finish(res);
+            }
+        }
+
         std::vector<folly::Future<folly::Unit>> futs;
         futs.reserve(rows);
         for (int i = 0; i < rows; ++i) {
             futs.emplace_back(search_pool_->push([&, index = i] {
                 ThreadPool::ScopedSearchOmpSetter setter(1);
                 auto offset = k * index;
+                if (canceller.IsStopped()) {
+                    SearchCanceller::FillEmptyResult(ids.get() + offset, distances.get() + offset, k,
+                                                     faiss::is_similarity_metric(index_->metric_type));
+                    canceller.AbortQueries();
+                    return;
+                }
                 std::unique_ptr<float[]> copied_query = nullptr;
 
                 BitsetViewIDSelector bw_idselector(bitset);
@@ -794,6 +1500,7 @@ IvfIndexNode<DataType, IndexType>::Search(const DataSetPtr dataset, std::unique_
                     faiss::IVFSearchParameters ivf_search_params;
 
                     ivf_search_params.sel = id_selector;
+                    ivf_search_params.adaptive_nprobe = ivf_cfg.adaptive_nprobe.value();
                     ivf_search_params.ensure_topk_full = ivf_cfg.ensure_topk_full.value();
                     if (ivf_search_params.ensure_topk_full) {
                         ivf_search_params.nprobe = index_->nlist;
@@ -862,6 +1569,7 @@ IvfIndexNode<DataType, IndexType>::Search(const DataSetPtr dataset, std::unique_
                     ivf_search_params.nprobe = nprobe;
                     ivf_search_params.max_codes = 0;
                     ivf_search_params.sel = id_selector;
+                    ivf_search_params.adaptive_nprobe = ivf_cfg.adaptive_nprobe.value();
                     ivf_search_params.qb = ivf_rabitq_cfg.rbq_bits_query.value_or(0);
 
                     if (use_refine && whether_to_enable_refine) {
@@ -879,18 +1587,29 @@ IvfIndexNode<DataType, IndexType>::Search(const DataSetPtr dataset, std::unique_
                                        &ivf_search_params);
                     }
                 } else {
-                    auto cur_query = (const float*)data + index * dim;
-                    if (is_cosine) {
-                        copied_query = CopyAndNormalizeVecs(cur_query, 1, dim);
-                        cur_query = copied_query.get();
-                    }
-
                     faiss::IVFSearchParameters ivf_search_params;
                     ivf_search_params.nprobe = nprobe;
                     ivf_search_params.max_codes = 0;
                     ivf_search_params.sel = id_selector;
-
-                    index_->search(1, cur_query, k, distances.get() + offset, ids.get() + offset, &ivf_search_params);
+                    ivf_search_params.adaptive_nprobe = ivf_cfg.adaptive_nprobe.value();
+
+                    if (coarse_ids != nullptr) {
+                        auto xq = normalized_queries != nullptr ? normalized_queries.get() : (const float*)data;
+                        auto cur_query = xq + index * dim;
+                        ivf_search_params.nprobe = coarse_nprobe;
+                        index_->search_preassigned(1, cur_query, k, coarse_ids.get() + index * coarse_nprobe,
+                                                   coarse_dis.get() + index * coarse_nprobe,
+                                                   distances.get() + offset, ids.get() + offset, false,
+                                                   &ivf_search_params);
+                    } else {
+                        auto cur_query = (const float*)data + index * dim;
+                        if (is_cosine) {
+                            copied_query = CopyAndNormalizeVecs(cur_query, 1, dim);
+                            cur_query = copied_query.get();
+                        }
+                        index_->search(1, cur_query, k, distances.get() + offset, ids.get() + offset,
+                                       &ivf_search_params);
+                    }
                 }
             }));
         }
@@ -902,7 +1621,115 @@ IvfIndexNode<DataType, IndexType>::Search(const DataSetPtr dataset, std::unique_
     }
 
     auto res = GenResultDataSet(rows, k, std::move(ids), std::move(distances));
-    return res;
+    return canceller.Finish(res);
+}
+
+template <typename DataType, typename IndexType>
+expected<std::vector<DataSetPtr>>
+IvfIndexNode<DataType, IndexType>::MultiSearch(const DataSetPtr dataset, std::unique_ptr<Config> cfg,
+                                               const std::vector<int64_t>& ks, const std::vector<BitsetView>& bitsets,
+                                               milvus::OpContext* op_context) const {
+    // the list-shared scan relies on the plain IndexIVF scanners, the wrapped indexes are not covered
+    constexpr bool shared_scan_supported =
+        std::is_same_v<IndexType, faiss::IndexIVFFlat> || std::is_same_v<IndexType, faiss::IndexIVFPQ> ||
+        std::is_same_v<IndexType, faiss::IndexIVFScalarQuantizer> || std::is_same_v<IndexType, faiss::IndexIVFFlatCC> ||
+        std::is_same_v<IndexType, faiss::IndexIVFScalarQuantizerCC>;
+    // the CC indexes honor ensure_topk_full in Search(), see there
+    constexpr bool honor_ensure_topk_full = std::is_same_v<IndexType, faiss::IndexIVFFlatCC> ||
+                                            std::is_same_v<IndexType, faiss::IndexIVFScalarQuantizerCC>;
+    if constexpr (!shared_scan_supported) {
+        return IndexNode::MultiSearch(dataset, std::move(cfg), ks, bitsets, op_context);
+    } else {
+        if (!this->index_) {
+            LOG_KNOWHERE_WARNING_ << "search on empty index";
+            return expected<std::vector<DataSetPtr>>::Err(Status::empty_index, "index not loaded");
+        }
+        if (!this->index_->is_trained) {
+            LOG_KNOWHERE_WARNING_ << "index not trained";
+            return expected<std::vector<DataSetPtr>>::Err(Status::index_not_trained, "index not trained");
+        }
+
+        auto dim = dataset->GetDim();
+        auto rows = dataset->GetRows();
+        auto xq = (const float*)dataset->GetTensor();
+
+        const IvfConfig& ivf_cfg = static_cast<const IvfConfig&>(*cfg);
+        bool is_cosine = IsMetricType(ivf_cfg.metric_type.value(), knowhere::metric::COSINE);
+        auto nprobe = std::min<int64_t>(ivf_cfg.nprobe.value(), index_->nlist);
+        SearchCanceller canceller(op_context, ivf_cfg);
+
+        std::vector<int64_t> k_offsets(rows + 1, 0);
+        for (int64_t i = 0; i < rows; ++i) {
+            k_offsets[i + 1] = k_offsets[i] + ks[i];
+        }
+        // with ensure_topk_full, every list may be probed and the scan stops on a count of codes instead
+        const bool ensure_topk_full = honor_ensure_topk_full && ivf_cfg.ensure_topk_full.value();
+        std::vector<size_t> max_codes(rows, 0);
+        if (ensure_topk_full) {
+            for (int64_t i = 0; i < rows; ++i) {
+                max_codes[i] = (nprobe * 1.0 / index_->nlist) * (index_->ntotal - bitsets[i].count());
+            }
+            nprobe = index_->nlist;
+        }
+        auto ids = std::make_unique<int64_t[]>(k_offsets[rows]);
+        auto distances = std::make_unique<float[]>(k_offsets[rows]);
+        try {
+            std::unique_ptr<float[]> normalized_queries = nullptr;
+            if (is_cosine) {
+                normalized_queries = CopyAndNormalizeVecs(xq, rows, dim);
+                xq = normalized_queries.get();
+            }
+
+            auto coarse_ids = std::make_unique<int64_t[]>(rows * nprobe);
+            auto coarse_dis = std::make_unique<float[]>(rows * nprobe);
+            bool batch_assigned = faiss::support_amx && rows >= kBatchCoarseAssignMinQueries &&
+                                  BatchCoarseAssign(index_.get(), coarse_centroids_.get(), xq, rows, nprobe,
+                                                    search_pool_, coarse_ids.get(), coarse_dis.get());
+            if (!batch_assigned) {
+                std::vector<folly::Future<folly::Unit>> futs;
+                futs.reserve(rows);
+                for (int64_t i = 0; i < rows; ++i) {
+                    futs.emplace_back(search_pool_->push([&, index = i] {
+                        ThreadPool::ScopedSearchOmpSetter setter(1);
+                        index_->quantizer->search(1, xq + index * dim, nprobe, coarse_dis.get() + index * nprobe,
+                                                  coarse_ids.get() + index * nprobe);
+                    }));
+                }
+                WaitAllSuccess(futs);
+            }
+
+            if (index_->metric_type == faiss::METRIC_INNER_PRODUCT) {
+                MultiSearchScanLists<faiss::CMin<float, int64_t>>(
+                    index_.get(), xq, rows, nprobe, coarse_ids.get(), coarse_dis.get(), k_offsets, bitsets, max_codes,
+                    ensure_topk_full, search_pool_, canceller, distances.get(), ids.get());
+            } else {
+                MultiSearchScanLists<faiss::CMax<float, int64_t>>(
+                    index_.get(), xq, rows, nprobe, coarse_ids.get(), coarse_dis.get(), k_offsets, bitsets, max_codes,
+                    ensure_topk_full, search_pool_, canceller, distances.get(), ids.get());
+            }
+        } catch (const std::exception& e) {
+            LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
+            return expected<std::vector<DataSetPtr>>::Err(Status::faiss_inner_error, e.what());
+        }
+        if (auto status = canceller.Finish(); status != Status::success) {
+            return expected<std::vector<DataSetPtr>>::Err(status,
+                                                          "search request is stopped: " + Status2String(status));
+        }
+
+        std::vector<DataSetPtr> results(rows);
+        for (int64_t i = 0; i < rows; ++i) {
+            auto k = ks[i];
+            auto cur_ids = std::make_unique<int64_t[]>(k);
+            auto cur_dis = std::make_unique<float[]>(k);
+            std::copy_n(ids.get() + k_offsets[i], k, cur_ids.get());
+            std::copy_n(distances.get() + k_offsets[i], k, cur_dis.get());
+            results[i] = GenResultDataSet(1, k, std::move(cur_ids), std::move(cur_dis));
+            if (canceller.WasStopped()) {
+                results[i]->Set(meta::PARTIAL_RESULT, true);
+            }
+        }
+        return results;
+    }
 }
 
 template <typename DataType, typename IndexType>
@@ -933,6 +1760,7 @@ IvfIndexNode<DataType, IndexType>::RangeSearch(const DataSetPtr dataset, std::un
     float radius = ivf_cfg.radius.value();
     float range_filter = ivf_cfg.range_filter.value();
     bool is_ip = (index_->metric_type == faiss::METRIC_INNER_PRODUCT);
+    SearchCanceller canceller(op_context, ivf_cfg);
 
     RangeSearchResult range_search_result;
 
@@ -944,6 +1772,10 @@ IvfIndexNode<DataType, IndexType>::RangeSearch(const DataSetPtr dataset, std::un
         futs.reserve(nq);
         for (int i = 0; i < nq; ++i) {
             futs.emplace_back(search_pool_->push([&, index = i] {
+                if (canceller.IsStopped()) {
+                    canceller.AbortQueries();
+                    return;
+                }
                 ThreadPool::ScopedSearchOmpSetter setter(1);
                 faiss::RangeSearchResult res(1);
                 std::unique_ptr<float[]> copied_query = nullptr;
@@ -1062,7 +1894,7 @@ IvfIndexNode<DataType, IndexType>::RangeSearch(const DataSetPtr dataset, std::un
         return expected<DataSetPtr>::Err(Status::faiss_inner_error, e.what());
     }
 
-    return GenResultDataSet(nq, std::move(range_search_result));
+    return canceller.Finish(GenResultDataSet(nq, std::move(range_search_result)));
 }
 
 template <typename DataType, typename IndexType>
@@ -1115,7 +1947,8 @@ IvfIndexNode<DataType, IndexType>::AnnIterator(const DataSetPtr dataset, std::un
 
                 // iterator only own the copied_query.
                 auto it = std::make_shared<iterator>(index_.get(), std::move(copied_query), bitset, nprobe,
-                                                     larger_is_closer, iterator_refine_ratio, use_knowhere_search_pool);
+                                                     ivf_cfg.adaptive_nprobe.value(), larger_is_closer,
+                                                     iterator_refine_ratio, use_knowhere_search_pool);
                 vec[i] = it;
             }
 
@@ -1206,27 +2039,31 @@ IvfIndexNode<DataType, IndexType>::GetIndexMetaImpl(std::unique_ptr<Config>, IVF
         return expected<DataSetPtr>::Err(Status::empty_index, "index not loaded");
     }
 
-    auto ivf_index = dynamic_cast<faiss::IndexIVF*>(index_.get());
-    auto ivf_quantizer = dynamic_cast<faiss::IndexFlat*>(ivf_index->quantizer);
+    auto ivf_index = get_ivf_index(index_.get());
+    auto ivf_quantizer = ivf_index->quantizer;
 
     int64_t dim = ivf_index->d;
     int64_t nlist = ivf_index->nlist;
     int64_t ntotal = ivf_index->ntotal;
 
-    feder::ivfflat::IVFFlatMeta meta(nlist, dim, ntotal);
+    feder::ivfflat::IVFFlatMeta meta(nlist, dim, ntotal, GetCoarseQuantizerType(ivf_quantizer));
     std::unordered_set<int64_t> id_set;
 
+    // the hnsw and sq8 quantizers do not expose a flat array, reconstruct the fp32 centroids
+    std::vector<float> centroids(nlist * dim);
+    ivf_quantizer->reconstruct_n(0, nlist, centroids.data());
+
     for (int32_t i = 0; i < nlist; i++) {
         // copy from IndexIVF::search_preassigned
         std::unique_ptr<faiss::InvertedLists::ScopedIds> sids =
-            std::make_unique<faiss::InvertedLists::ScopedIds>(index_->invlists, i);
+            std::make_unique<faiss::InvertedLists::ScopedIds>(ivf_index->invlists, i);
 
         // node ids
-        auto node_num = index_->invlists->list_size(i);
+        auto node_num = ivf_index->invlists->list_size(i);
         auto node_id_codes = sids->get();
 
         // centroid vector
-        auto centroid_vec = ivf_quantizer->get_xb() + i * dim;
+        auto centroid_vec = centroids.data() + i * dim;
 
         meta.AddCluster(i, node_id_codes, node_num, centroid_vec, dim);
     }
@@ -1245,16 +2082,32 @@ IvfIndexNode<DataType, IndexType>::SerializeImpl(BinarySet& binset) const {
             LOG_KNOWHERE_WARNING_ << "index can not be serialized for empty index";
             return Status::empty_index;
         }
-        MemoryIOWriter writer;
-        if constexpr (std::is_same<IndexType, faiss::IndexBinaryIVF>::value) {
-            faiss::write_index_binary(index_.get(), &writer);
-        } else if constexpr (std::is_same<IndexType, IndexIVFRaBitQWrapper>::value) {
-            faiss::write_index(index_->index.get(), &writer);
-        } else {
-            faiss::write_index(index_.get(), &writer);
+        std::shared_ptr<uint8_t[]> data;
+        size_t size = 0;
+        RETURN_IF_ERROR(SerializeSized(
+            [&](auto& writer) {
+                WriteIndex(&writer);
+                return Status::success;
+            },
+            data, size));
+        binset.Append(Type(), data, size);
+        return Status::success;
+    } catch (const std::exception& e) {
+        LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
+        return Status::faiss_inner_error;
+    }
+}
+
+template <typename DataType, typename IndexType>
+Status
+IvfIndexNode<DataType, IndexType>::SerializeToFile(const std::string& filename) const {
+    try {
+        if (!this->index_) {
+            LOG_KNOWHERE_WARNING_ << "index can not be serialized for empty index";
+            return Status::empty_index;
         }
-        std::shared_ptr<uint8_t[]> data(writer.data());
-        binset.Append(Type(), data, writer.tellg());
+        faiss::FileIOWriter writer(filename.c_str());
+        WriteIndex(&writer);
         return Status::success;
     } catch (const std::exception& e) {
         LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
@@ -1262,6 +2115,45 @@ IvfIndexNode<DataType, IndexType>::SerializeImpl(BinarySet& binset) const {
     }
 }
 
+template <typename DataType, typename IndexType>
+void
+IvfIndexNode<DataType, IndexType>::WriteIndex(faiss::IOWriter* writer) const {
+    if constexpr (std::is_same<IndexType, faiss::IndexBinaryIVF>::value) {
+        faiss::write_index_binary(index_.get(), writer);
+    } else if constexpr (std::is_same<IndexType, IndexIVFRaBitQWrapper>::value) {
+        faiss::write_index(index_->index.get(), writer);
+    } else {
+        faiss::write_index(index_.get(), writer);
+    }
+}
+
+template <typename DataType, typename IndexType>
+Status
+IvfIndexNode<DataType, IndexType>::ReadIndex(faiss::IOReader* reader) {
+    if constexpr (std::is_same<IndexType, IndexIVFRaBitQWrapper>::value) {
+        // a special case for IVFRaBitQ, bcz a wrapper is involved.
+
+        // deserialize
+        auto index_raw = std::unique_ptr<faiss::Index>(faiss::read_index(reader));
+        auto index_wr = IndexIVFRaBitQWrapper::from_deserialized(std::move(index_raw));
+        if (index_wr == nullptr) {
+            LOG_KNOWHERE_ERROR_ << "The deserialized index does not look like an IVFRaBitQ";
+            return Status::invalid_serialized_index_type;
+        }
+
+        // use the wrapper
+        index_ = std::move(index_wr);
+    } else if constexpr (std::is_same<IndexType, faiss::IndexBinaryIVF>::value) {
+        index_.reset(static_cast<IndexType*>(faiss::read_index_binary(reader)));
+    } else {
+        index_.reset(static_cast<IndexType*>(faiss::read_index(reader)));
+    }
+    if constexpr (kHasBatchCoarseAssign) {
+        coarse_centroids_ = CacheCoarseCentroids(index_.get());
+    }
+    return Status::success;
+}
+
 template <typename DataType, typename IndexType>
 Status
 IvfIndexNode<DataType, IndexType>::Deserialize(const BinarySet& binset, std::shared_ptr<Config> cfg) {
@@ -1274,41 +2166,23 @@ IvfIndexNode<DataType, IndexType>::Deserialize(const BinarySet& binset, std::sha
         return Status::invalid_binary_set;
     }
 
-    MemoryIOReader reader(binary->data.get(), binary->size);
+    // the lists are viewed in place, the binary is kept alive by the index
+    faiss::ZeroCopyIOReader reader(binary->data.get(), binary->size, std::make_shared<BinaryViewOwner>(binary->data));
     try {
-        if constexpr (std::is_same<IndexType, IndexIVFRaBitQWrapper>::value) {
-            // a special case for IVFRaBitQ, bcz a wrapper is involved.
-
-            // deserialize
-            auto index_raw = std::unique_ptr<faiss::Index>(faiss::read_index(&reader));
-            auto index_wr = IndexIVFRaBitQWrapper::from_deserialized(std::move(index_raw));
-            if (index_wr == nullptr) {
-                LOG_KNOWHERE_ERROR_ << "The deserialized index does not look like an IVFRaBitQ";
-                return Status::invalid_serialized_index_type;
-            }
-
-            // use the wrapper
-            index_ = std::move(index_wr);
-        } else {
-            // the default case for a regular index
-            if constexpr (std::is_same<IndexType, faiss::IndexBinaryIVF>::value) {
-                index_.reset(static_cast<IndexType*>(faiss::read_index_binary(&reader)));
-            } else {
-                index_.reset(static_cast<IndexType*>(faiss::read_index(&reader)));
-            }
-
-            if constexpr (!std::is_same_v<IndexType, faiss::IndexScaNN> &&
-                          !std::is_same_v<IndexType, faiss::IndexIVFScalarQuantizerCC>) {
-                const BaseConfig& base_cfg = static_cast<const BaseConfig&>(*cfg);
-                if (HasRawData(base_cfg.metric_type.value())) {
-                    index_->make_direct_map(true);
-                }
+        RETURN_IF_ERROR(ReadIndex(&reader));
+        if constexpr (!std::is_same_v<IndexType, IndexIVFRaBitQWrapper> &&
+                      !std::is_same_v<IndexType, faiss::IndexScaNN> &&
+                      !std::is_same_v<IndexType, faiss::IndexIVFScalarQuantizerCC>) {
+            const BaseConfig& base_cfg = static_cast<const BaseConfig&>(*cfg);
+            if (HasRawData(base_cfg.metric_type.value())) {
+                index_->make_direct_map(true);
             }
         }
     } catch (const std::exception& e) {
         LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
         return Status::faiss_inner_error;
     }
+    storage_is_view_ = !kHasGrowableLists;
     return Status::success;
 }
 
@@ -1349,11 +2223,15 @@ IvfIndexNode<DataType, IndexType>::DeserializeFromFile(const std::string& filena
                     index_->make_direct_map(true);
                 }
             }
+            if constexpr (kHasBatchCoarseAssign) {
+                coarse_centroids_ = CacheCoarseCentroids(index_.get());
+            }
         }
     } catch (const std::exception& e) {
         LOG_KNOWHERE_WARNING_ << "faiss inner error: " << e.what();
         return Status::faiss_inner_error;
     }
+    storage_is_view_ = cfg.enable_mmap.value() && !kHasGrowableLists;
     return Status::success;
 }
 // bin1
@@ -22,6 +22,16 @@
 #include "simd/hook.h"
 
 namespace knowhere {
+
+namespace coarse_quantizer_type {
+// brute force over all the fp32 centroids
+constexpr const char* FLAT = "flat";
+// HNSW graph over the fp32 centroids
+constexpr const char* HNSW = "hnsw";
+// SQ8 scan over the centroids, the best coarse_refine_k * nprobe candidates are reranked exactly
+constexpr const char* SQ8 = "sq8";
+}  // namespace coarse_quantizer_type
+
 class IvfConfig : public BaseConfig {
  public:
     CFG_INT nlist;
@@ -29,6 +39,12 @@ class IvfConfig : public BaseConfig {
     CFG_BOOL use_elkan;
     CFG_BOOL ensure_topk_full;  // internal config, used for temp index
     CFG_INT max_empty_result_buckets;
+    CFG_BOOL adaptive_nprobe;
+    // the coarse quantizer is persisted in the index, it is not a search time choice
+    CFG_STRING coarse_quantizer;
+    CFG_INT coarse_hnsw_m;
+    CFG_INT coarse_hnsw_ef;
+    CFG_FLOAT coarse_refine_k;
     KNOHWERE_DECLARE_CONFIG(IvfConfig) {
         KNOWHERE_CONFIG_DECLARE_FIELD(nlist)
             .description("number of inverted lists.")
@@ -55,6 +71,47 @@ class IvfConfig : public BaseConfig {
             .description("the maximum of continuous buckets with empty result")
             .for_range_search()
             .set_range(1, 65536);
+        KNOWHERE_CONFIG_DECLARE_FIELD(adaptive_nprobe)
+            .set_default(false)
+            .description(
+                "L2 with a flat coarse quantizer and lists uncapped by clustering_size_spread only, skip the probed "
+                "lists that can not improve the top-k, nprobe is an upper bound.")
+            .for_search()
+            .for_iterator();
+        KNOWHERE_CONFIG_DECLARE_FIELD(coarse_quantizer)
+            .set_default(coarse_quantizer_type::FLAT)
+            .description("index over the centroids used to pick the probed lists, flat, hnsw or sq8.")
+            .for_train();
+        KNOWHERE_CONFIG_DECLARE_FIELD(coarse_hnsw_m)
+            .set_default(32)
+            .description("M of the hnsw coarse quantizer.")
+            .for_train()
+            .set_range(2, 2048);
+        KNOWHERE_CONFIG_DECLARE_FIELD(coarse_hnsw_ef)
+            .set_default(64)
+            .description("minimal ef of the hnsw coarse quantizer, the search always uses at least nprobe.")
+            .for_train()
+            .set_range(1, std::numeric_limits<CFG_INT::value_type>::max());
+        KNOWHERE_CONFIG_DECLARE_FIELD(coarse_refine_k)
+            .set_default(4)
+            .description("candidates per probe that the sq8 coarse quantizer reranks with the fp32 centroids.")
+            .for_train()
+            .set_range(1, 1024);
+    }
+
+    Status
+    CheckAndAdjust(PARAM_TYPE param_type, std::string* err_msg) override {
+        if (param_type == PARAM_TYPE::TRAIN) {
+            auto type = str_to_lower(coarse_quantizer.value());
+            if (type != coarse_quantizer_type::FLAT && type != coarse_quantizer_type::HNSW &&
+                type != coarse_quantizer_type::SQ8) {
+                std::string msg = "invalid coarse quantizer : " + coarse_quantizer.value() +
+                                  ", optional types are [flat, hnsw, sq8]";
+                return HandleError(err_msg, msg, Status::invalid_args);
+            }
+            coarse_quantizer = type;
+        }
+        return Status::success;
     }
 };
 
@@ -84,6 +141,11 @@ class IvfPqConfig : public IvfConfig {
 
     Status
     CheckAndAdjust(PARAM_TYPE param_type, std::string* err_msg) override {
+        // check the base class
+        const auto base_status = IvfConfig::CheckAndAdjust(param_type, err_msg);
+        if (base_status != Status::success) {
+            return base_status;
+        }
         switch (param_type) {
             case PARAM_TYPE::TRAIN: {
                 if (dim.has_value() && m.has_value()) {
@@ -135,6 +197,11 @@ class ScannConfig : public IvfFlatConfig {
 
     Status
     CheckAndAdjust(PARAM_TYPE param_type, std::string* err_msg) override {
+        // check the base class
+        const auto base_status = IvfConfig::CheckAndAdjust(param_type, err_msg);
+        if (base_status != Status::success) {
+            return base_status;
+        }
         switch (param_type) {
             case PARAM_TYPE::TRAIN: {
                 // TODO: handle vec_dim % vec_sub_dim != 0 with scann
@@ -193,6 +260,9 @@ class IvfBinConfig : public IvfConfig {
                 std::string msg = "metric type " + metric + " not found or not supported, supported: [HAMMING JACCARD]";
                 return HandleError(err_msg, msg, Status::invalid_metric_type);
             }
+            if (str_to_lower(coarse_quantizer.value()) != coarse_quantizer_type::FLAT) {
+                return HandleError(err_msg, "binary IVF only supports the flat coarse quantizer", Status::invalid_args);
+            }
         }
         return Status::success;
     }
@@ -219,6 +289,11 @@ class IvfSqCcConfig : public IvfFlatCcConfig {
     };
     Status
     CheckAndAdjust(PARAM_TYPE param_type, std::string* err_msg) override {
+        // check the base class
+        const auto base_status = IvfConfig::CheckAndAdjust(param_type, err_msg);
+        if (base_status != Status::success) {
+            return base_status;
+        }
         if (param_type == PARAM_TYPE::TRAIN) {
             auto code_size_v = code_size.value();
             auto legal_code_size_list = std::vector<int>{4, 6, 8, 16};
@@ -245,6 +320,9 @@ class IvfRaBitQConfig : public IvfConfig {
     // the value `0` means that the query won't be quantized and will
     //   be processed as is.
     CFG_INT rbq_bits_query;
+    // the batched search keeps and refines the candidates by their error-bound lower bounds, which trades a little
+    //   recall for fewer refined candidates. L2 only.
+    CFG_BOOL rbq_refine_by_lower_bound;
     KNOHWERE_DECLARE_CONFIG(IvfRaBitQConfig) {
         KNOWHERE_CONFIG_DECLARE_FIELD(rbq_bits_query)
             .description("rbq_bits_query")
@@ -252,6 +330,10 @@ class IvfRaBitQConfig : public IvfConfig {
             .set_range(0, 8)
             .for_search()
             .for_range_search();
+        KNOWHERE_CONFIG_DECLARE_FIELD(rbq_refine_by_lower_bound)
+            .description("refine the candidates of a batched L2 search by their lower bounds, stopping early")
+            .set_default(false)
+            .for_search();
         KNOWHERE_CONFIG_DECLARE_FIELD(refine)
             .description("whether the refine is used during the train")
             .set_default(false)
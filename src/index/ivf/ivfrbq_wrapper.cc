@@ -11,13 +11,17 @@
 
 #include "index/ivf/ivfrbq_wrapper.h"
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "faiss/IndexCosine.h"
 #include "faiss/IndexFlat.h"
 #include "faiss/IndexPreTransform.h"
 #include "faiss/cppcontrib/knowhere/impl/CountSizeIOWriter.h"
+#include "faiss/impl/FaissAssert.h"
 #include "faiss/index_io.h"
+#include "faiss/utils/Heap.h"
 #include "index/refine/refine_utils.h"
 
 namespace knowhere {
@@ -108,6 +112,90 @@ IndexIVFRaBitQWrapper::search(faiss::idx_t n, const float* x, faiss::idx_t k, fl
     index->search(n, x, k, distances, labels, params);
 }
 
+namespace {
+
+// refines the candidates of a single query, sorted by their distance estimates or their lower bounds
+template <typename C>
+void
+refine_candidates(faiss::DistanceComputer& dc, const faiss::idx_t k_base, const float* base_distances,
+                  const faiss::idx_t* base_labels, const bool sorted_by_lower_bounds, const faiss::idx_t k,
+                  float* distances, faiss::idx_t* labels) {
+    faiss::heap_heapify<C>(k, distances, labels);
+    for (faiss::idx_t j = 0; j < k_base; j++) {
+        const auto id = base_labels[j];
+        if (id < 0) {
+            break;
+        }
+        // the rest of the candidates are even further, none of them can enter the top-k
+        if (sorted_by_lower_bounds && !C::cmp(distances[0], base_distances[j])) {
+            break;
+        }
+        const float dis = dc(id);
+        if (C::cmp(distances[0], dis)) {
+            faiss::heap_replace_top<C>(k, distances, labels, dis, id);
+        }
+    }
+    faiss::heap_reorder<C>(k, distances, labels);
+}
+
+}  // namespace
+
+void
+IndexIVFRaBitQWrapper::search_batched(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances,
+                                      faiss::idx_t* labels, const faiss::SearchParameters* params,
+                                      bool refine_by_lower_bounds) const {
+    const faiss::IndexRefine* index_refine = get_refine_index();
+    const faiss::Index* index_for_pt = (index_refine != nullptr) ? index_refine->base_index : index.get();
+    const faiss::IndexPreTransform* index_pt = dynamic_cast<const faiss::IndexPreTransform*>(index_for_pt);
+    const faiss::IndexIVFRaBitQ* index_rbq = get_ivfrabitq_index();
+    FAISS_THROW_IF_NOT_MSG(index_pt != nullptr && index_rbq != nullptr, "not an IVFRaBitQ index");
+
+    const auto refine_params = dynamic_cast<const faiss::IndexRefineSearchParameters*>(params);
+    const auto ivf_params = dynamic_cast<const faiss::IVFRaBitQSearchParameters*>(
+        (refine_params != nullptr) ? refine_params->base_index_params : params);
+
+    // rotate the queries and assign them to the lists
+    const float* xt = index_pt->apply_chain(n, x);
+    std::unique_ptr<const float[]> xt_del((xt == x) ? nullptr : xt);
+
+    const auto nprobe = std::min<faiss::idx_t>(
+        index_rbq->nlist, (ivf_params != nullptr) ? ivf_params->nprobe : index_rbq->nprobe);
+    std::vector<faiss::idx_t> assign(n * nprobe);
+    std::vector<float> coarse_dis(n * nprobe);
+    index_rbq->quantizer->search(n, xt, nprobe, coarse_dis.data(), assign.data(),
+                                 (ivf_params != nullptr) ? ivf_params->quantizer_params : nullptr);
+
+    if (index_refine == nullptr) {
+        index_rbq->search_preassigned_batched(n, xt, k, assign.data(), distances, labels, ivf_params);
+        return;
+    }
+
+    const float k_factor = (refine_params != nullptr) ? refine_params->k_factor : index_refine->k_factor;
+    const auto k_base = std::max<faiss::idx_t>(k, static_cast<faiss::idx_t>(k * k_factor));
+    // the lower bounds are known for L2 only, otherwise the candidates are kept by their estimates and all refined,
+    //   as search() does
+    const bool use_lower_bounds = refine_by_lower_bounds && (index_rbq->metric_type == faiss::METRIC_L2);
+
+    std::vector<float> base_distances(n * k_base);
+    std::vector<faiss::idx_t> base_labels(n * k_base);
+    index_rbq->search_preassigned_batched(n, xt, k_base, assign.data(), base_distances.data(), base_labels.data(),
+                                          ivf_params, use_lower_bounds);
+
+    std::unique_ptr<faiss::DistanceComputer> dc(index_refine->refine_index->get_distance_computer());
+    for (faiss::idx_t i = 0; i < n; i++) {
+        dc->set_query(x + i * d);
+        if (faiss::is_similarity_metric(metric_type)) {
+            refine_candidates<faiss::CMin<float, faiss::idx_t>>(*dc, k_base, base_distances.data() + i * k_base,
+                                                                base_labels.data() + i * k_base, use_lower_bounds,
+                                                                k, distances + i * k, labels + i * k);
+        } else {
+            refine_candidates<faiss::CMax<float, faiss::idx_t>>(*dc, k_base, base_distances.data() + i * k_base,
+                                                                base_labels.data() + i * k_base, use_lower_bounds,
+                                                                k, distances + i * k, labels + i * k);
+        }
+    }
+}
+
 void
 IndexIVFRaBitQWrapper::range_search(faiss::idx_t n, const float* x, float radius, faiss::RangeSearchResult* result,
                                     const faiss::SearchParameters* params) const {
@@ -59,6 +59,16 @@ struct IndexIVFRaBitQWrapper : faiss::Index {
     search(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances, faiss::idx_t* labels,
            const faiss::SearchParameters* params) const override;
 
+    // the same as search(), but the inverted lists are scanned list-major for the whole group of queries,
+    //   so a list probed by several queries is read once (see IndexIVFRaBitQ::search_preassigned_batched()).
+    //   With the refine and METRIC_L2, refine_by_lower_bounds keeps the candidates by their lower bounds
+    //   instead of their estimates, refines them in that order and stops at the first one that cannot enter
+    //   the top-k anymore. The bounds hold with a high probability only, so this may cost some recall.
+    // params are either IVFRaBitQSearchParameters or IndexRefineSearchParameters wrapping them.
+    void
+    search_batched(faiss::idx_t n, const float* x, faiss::idx_t k, float* distances, faiss::idx_t* labels,
+                   const faiss::SearchParameters* params, bool refine_by_lower_bounds = false) const;
+
     void
     range_search(faiss::idx_t n, const float* x, float radius, faiss::RangeSearchResult* result,
                  const faiss::SearchParameters* params) const override;
@@ -11,7 +11,10 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
 #include <exception>
+#include <memory>
+#include <mutex>
 
 #include "index/sparse/sparse_inverted_index.h"
 #include "index/sparse/sparse_inverted_index_config.h"
@@ -130,11 +133,14 @@ class SparseInvertedIndexNode : public IndexNode {
         auto p_id = std::make_unique<sparse::label_t[]>(nq * k);
         auto p_dist = std::make_unique<float[]>(nq * k);
 
+        // all the queries of a request read the same rows, even if rows are added concurrently
+        auto pinned = index_->Pin();
         std::vector<folly::Future<folly::Unit>> futs;
         futs.reserve(nq);
         for (int64_t idx = 0; idx < nq; ++idx) {
             futs.emplace_back(search_pool_->push([&, idx = idx, p_id = p_id.get(), p_dist = p_dist.get()]() {
-                index_->Search(queries[idx], k, p_dist + idx * k, p_id + idx * k, bitset, computer, approx_params);
+                index_->Search(queries[idx], k, p_dist + idx * k, p_id + idx * k, bitset, computer, approx_params,
+                               pinned);
             }));
         }
         WaitAllSuccess(futs);
@@ -276,6 +282,7 @@ class SparseInvertedIndexNode : public IndexNode {
         if (version_use_raw_data()) {
             RETURN_IF_ERROR(index_->SerializeV0(writer));
         } else {
+            // sizes its output from the section headers, no sizing pass is needed
             RETURN_IF_ERROR(index_->Serialize(writer));
         }
         std::shared_ptr<uint8_t[]> data(writer.data());
@@ -477,7 +484,9 @@ class SparseInvertedIndexNode : public IndexNode {
 
 // Concurrent version of SparseInvertedIndexNode
 //
-// Thread safety: only the overridden methods are allowed to be called concurrently.
+// Thread safety: Add, Search, AnnIterator, RangeSearch, GetVectorByIds, Dim, Size and Count are allowed to be
+// called concurrently. Add calls are serialized among themselves, readers never wait for them: every query reads
+// the snapshot of the index published by the last finished Add, rows being added are invisible to it.
 template <typename T, bool use_wand>
 class SparseInvertedIndexNodeCC : public SparseInvertedIndexNode<T, use_wand> {
     static_assert(std::is_same_v<T, knowhere::sparse_u32_f32>, "SparseInvertedIndexNode only support sparse_u32_f32");
@@ -490,75 +499,29 @@ class SparseInvertedIndexNodeCC : public SparseInvertedIndexNode<T, use_wand> {
 
     Status
     Add(const DataSetPtr dataset, std::shared_ptr<Config> config, bool use_knowhere_build_pool) override {
-        std::unique_lock<std::mutex> lock(mutex_);
-        uint64_t task_id = next_task_id_++;
-        add_tasks_.push(task_id);
-
-        // add task is allowed to run only after all search tasks that come before it have finished.
-        cv_.wait(lock, [this, task_id]() { return current_task_id_ == task_id && active_readers_ == 0; });
-
-        auto res = SparseInvertedIndexNode<T, use_wand>::Add(dataset, config, use_knowhere_build_pool);
+        std::lock_guard<std::mutex> lock(add_mutex_);
 
         auto cfg = static_cast<const SparseInvertedIndexConfig&>(*config);
-        if (IsMetricType(cfg.metric_type.value(), metric::IP)) {
-            // insert dataset to raw data if metric type is IP
+        auto rows = dataset->GetRows();
+        auto prev_raw_data = std::atomic_load(&raw_data_);
+        if (IsMetricType(cfg.metric_type.value(), metric::IP) && rows > 0) {
+            // keep a copy of the rows for GetVectorByIds. It is published before the index rows, so that every id
+            // a search may return can be fetched.
             auto data = static_cast<const sparse::SparseRow<value_type>*>(dataset->GetTensor());
-            auto rows = dataset->GetRows();
-            raw_data_.insert(raw_data_.end(), data, data + rows);
+            auto next = std::make_shared<RawDataSnapshot>(*prev_raw_data);
+            next->chunks.emplace_back(
+                std::make_shared<const std::vector<sparse::SparseRow<value_type>>>(data, data + rows));
+            next->offsets.push_back(next->offsets.back() + rows);
+            std::atomic_store(&raw_data_, std::shared_ptr<const RawDataSnapshot>(std::move(next)));
         }
 
-        add_tasks_.pop();
-        current_task_id_++;
-        lock.unlock();
-        cv_.notify_all();
+        auto res = SparseInvertedIndexNode<T, use_wand>::Add(dataset, config, use_knowhere_build_pool);
+        if (res != Status::success) {
+            std::atomic_store(&raw_data_, std::move(prev_raw_data));
+        }
         return res;
     }
 
-    expected<DataSetPtr>
-    Search(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const BitsetView& bitset,
-           milvus::OpContext* op_context) const override {
-        ReadPermission permission(*this);
-        return SparseInvertedIndexNode<T, use_wand>::Search(dataset, std::move(cfg), bitset, op_context);
-    }
-
-    expected<std::vector<IndexNode::IteratorPtr>>
-    AnnIterator(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const BitsetView& bitset,
-                bool use_knowhere_search_pool, milvus::OpContext* op_context) const override {
-        ReadPermission permission(*this);
-        // Always uses PrecomputedDistanceIterator for SparseInvertedIndexNodeCC:
-        // If we want to use RefineIterator, it needs to get another ReadPermission when calling
-        // index_->GetRawDistance(). If an Add task is added in between, there will be a deadlock.
-        auto config = static_cast<const knowhere::SparseInvertedIndexConfig&>(*cfg);
-        config.drop_ratio_search = 0.0f;
-        return SparseInvertedIndexNode<T, use_wand>::AnnIterator(dataset, std::move(cfg), bitset,
-                                                                 use_knowhere_search_pool, op_context);
-    }
-
-    expected<DataSetPtr>
-    RangeSearch(const DataSetPtr dataset, std::unique_ptr<Config> cfg, const BitsetView& bitset,
-                milvus::OpContext* op_context) const override {
-        ReadPermission permission(*this);
-        return SparseInvertedIndexNode<T, use_wand>::RangeSearch(dataset, std::move(cfg), bitset, op_context);
-    }
-
-    int64_t
-    Dim() const override {
-        ReadPermission permission(*this);
-        return SparseInvertedIndexNode<T, use_wand>::Dim();
-    }
-
-    int64_t
-    Size() const override {
-        ReadPermission permission(*this);
-        return SparseInvertedIndexNode<T, use_wand>::Size();
-    }
-
-    int64_t
-    Count() const override {
-        ReadPermission permission(*this);
-        return SparseInvertedIndexNode<T, use_wand>::Count();
-    }
-
     std::string
     Type() const override {
         return use_wand ? knowhere::IndexEnum::INDEX_SPARSE_WAND_CC
@@ -567,9 +530,9 @@ class SparseInvertedIndexNodeCC : public SparseInvertedIndexNode<T, use_wand> {
 
     expected<DataSetPtr>
     GetVectorByIds(const DataSetPtr dataset, milvus::OpContext* op_context) const override {
-        ReadPermission permission(*this);
-
-        if (raw_data_.empty()) {
+        auto raw_data = std::atomic_load(&raw_data_);
+        auto n_raw = raw_data->offsets.back();
+        if (n_raw == 0) {
             return expected<DataSetPtr>::Err(Status::invalid_args, "GetVectorByIds failed: raw data is empty");
         }
 
@@ -578,13 +541,15 @@ class SparseInvertedIndexNodeCC : public SparseInvertedIndexNode<T, use_wand> {
         auto data = std::make_unique<sparse::SparseRow<value_type>[]>(rows);
         int64_t dim = 0;
 
-        try {
-            for (int64_t i = 0; i < rows; ++i) {
-                data[i] = raw_data_[ids[i]];
-                dim = std::max(dim, data[i].dim());
+        for (int64_t i = 0; i < rows; ++i) {
+            if (ids[i] < 0 || ids[i] >= n_raw) {
+                return expected<DataSetPtr>::Err(
+                    Status::invalid_args, "GetVectorByIds failed: id " + std::to_string(ids[i]) + " out of range");
             }
-        } catch (std::exception& e) {
-            return expected<DataSetPtr>::Err(Status::invalid_args, "GetVectorByIds failed: " + std::string(e.what()));
+            auto it = std::upper_bound(raw_data->offsets.begin(), raw_data->offsets.end(), ids[i]);
+            auto chunk = std::distance(raw_data->offsets.begin(), it) - 1;
+            data[i] = (*raw_data->chunks[chunk])[ids[i] - raw_data->offsets[chunk]];
+            dim = std::max(dim, data[i].dim());
         }
 
         auto res = GenResultDataSet(rows, dim, data.release());
@@ -617,35 +582,15 @@ class SparseInvertedIndexNodeCC : public SparseInvertedIndexNode<T, use_wand> {
     }
 
  private:
-    struct ReadPermission {
-        ReadPermission(const SparseInvertedIndexNodeCC& node) : node_(node) {
-            std::unique_lock<std::mutex> lock(node_.mutex_);
-            uint64_t task_id = node_.next_task_id_++;
-            // read task may execute only after all add tasks that come before it have finished.
-            if (!node_.add_tasks_.empty() && task_id > node_.add_tasks_.front()) {
-                node_.cv_.wait(
-                    lock, [this, task_id]() { return node_.add_tasks_.empty() || task_id < node_.add_tasks_.front(); });
-            }
-            // read task is allowed to run, block all add tasks
-            node_.active_readers_++;
-        }
-
-        ~ReadPermission() {
-            std::unique_lock<std::mutex> lock(node_.mutex_);
-            node_.active_readers_--;
-            node_.current_task_id_++;
-            node_.cv_.notify_all();
-        }
-        const SparseInvertedIndexNodeCC& node_;
+    // Rows kept for GetVectorByIds, one immutable chunk per Add. offsets[i] is the id of the first row of
+    // chunks[i], offsets.back() the number of rows.
+    struct RawDataSnapshot {
+        std::vector<std::shared_ptr<const std::vector<sparse::SparseRow<value_type>>>> chunks;
+        std::vector<int64_t> offsets = {0};
     };
 
-    mutable std::mutex mutex_;
-    mutable std::condition_variable cv_;
-    mutable int64_t active_readers_ = 0;
-    mutable std::queue<uint64_t> add_tasks_;
-    mutable uint64_t next_task_id_ = 0;
-    mutable uint64_t current_task_id_ = 0;
-    mutable std::vector<sparse::SparseRow<value_type>> raw_data_ = {};
+    std::mutex add_mutex_;
+    std::shared_ptr<const RawDataSnapshot> raw_data_ = std::make_shared<const RawDataSnapshot>();
 };  // class SparseInvertedIndexNodeCC
 
 #ifdef KNOWHERE_WITH_CARDINAL
@@ -34,6 +34,7 @@
 #include "knowhere/prometheus_client.h"
 #include "knowhere/sparse_utils.h"
 #include "knowhere/utils.h"
+#include "simd/hook.h"
 
 namespace knowhere::sparse {
 
@@ -94,9 +95,16 @@ class BaseInvertedIndex {
     virtual Status
     Add(const SparseRow<T>* data, size_t rows, int64_t dim) = 0;
 
+    // Pins the rows currently visible to searches. All the queries searched with the returned handle read the same
+    // rows, even if Add runs meanwhile.
+    [[nodiscard]] virtual std::shared_ptr<const void>
+    Pin() const = 0;
+
+    // pinned: a handle returned by Pin(), or nullptr to search the rows visible right now.
     virtual void
     Search(const SparseRow<T>& query, size_t k, float* distances, label_t* labels, const BitsetView& bitset,
-           const DocValueComputer<T>& computer, InvertedIndexApproxSearchParams& approx_params) const = 0;
+           const DocValueComputer<T>& computer, InvertedIndexApproxSearchParams& approx_params,
+           const std::shared_ptr<const void>& pinned) const = 0;
 
     virtual std::vector<float>
     GetAllDistances(const SparseRow<T>& query, float drop_ratio_search, const BitsetView& bitset,
@@ -229,38 +237,38 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
          *        2. DType val (when QType is different from DType, the QType value of val is stored as a DType with
          *           precision loss)
          *
-         * inverted_index_ids_spans_, inverted_index_vals_spans_ and max_score_in_dim_spans_ are
-         * not serialized, they will be constructed dynamically during
-         * deserialization.
+         * the posting list spans and max_score_in_dim_ are not serialized,
+         * they will be constructed dynamically during deserialization.
          *
          * Data are densely packed in serialized bytes and no padding is added.
          */
+        const auto s = snapshot();
         DType deprecated_value_threshold = 0;
-        writeBinaryPOD(writer, n_rows_internal_);
-        writeBinaryPOD(writer, max_dim_);
+        writeBinaryPOD(writer, s->n_rows);
+        writeBinaryPOD(writer, s->max_dim);
         writeBinaryPOD(writer, deprecated_value_threshold);
         BitsetView bitset(nullptr, 0);
 
         auto dim_map_reverse = std::unordered_map<uint32_t, table_t>();
-        for (const auto& [dim, dim_id] : dim_map_) {
+        for (const auto& [dim, dim_id] : *s->dim_map) {
             dim_map_reverse[dim_id] = dim;
         }
 
-        std::vector<size_t> row_sizes(n_rows_internal_, 0);
-        for (auto inverted_index_ids_span : inverted_index_ids_spans_) {
+        std::vector<size_t> row_sizes(s->n_rows, 0);
+        for (auto inverted_index_ids_span : s->ids_spans) {
             for (const auto& id : inverted_index_ids_span) {
                 row_sizes[id]++;
             }
         }
 
-        std::vector<SparseRow<DType>> raw_rows(n_rows_internal_);
-        for (size_t i = 0; i < n_rows_internal_; ++i) {
+        std::vector<SparseRow<DType>> raw_rows(s->n_rows);
+        for (size_t i = 0; i < s->n_rows; ++i) {
             raw_rows[i] = std::move(SparseRow<DType>(row_sizes[i]));
         }
 
-        for (size_t i = 0; i < inverted_index_ids_spans_.size(); ++i) {
-            const auto& ids = inverted_index_ids_spans_[i];
-            const auto& vals = inverted_index_vals_spans_[i];
+        for (size_t i = 0; i < s->ids_spans.size(); ++i) {
+            const auto& ids = s->ids_spans[i];
+            const auto& vals = s->vals_spans[i];
             const auto dim = dim_map_reverse[i];
             for (size_t j = 0; j < ids.size(); ++j) {
                 raw_rows[ids[j]].set_at(raw_rows[ids[j]].size() - row_sizes[ids[j]], dim, vals[j]);
@@ -268,7 +276,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
             }
         }
 
-        for (table_t vec_id = 0; vec_id < n_rows_internal_; ++vec_id) {
+        for (table_t vec_id = 0; vec_id < s->n_rows; ++vec_id) {
             writeBinaryPOD(writer, raw_rows[vec_id].size());
             if (raw_rows[vec_id].size() > 0) {
                 writer.write(raw_rows[vec_id].data(), raw_rows[vec_id].size() * SparseRow<DType>::element_size());
@@ -290,6 +298,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         readBinaryPOD(reader, max_dim_);
         readBinaryPOD(reader, deprecated_value_threshold);
 
+        const auto published = snapshot();
         if constexpr (mmapped) {
             RETURN_IF_ERROR(PrepareMmap(reader, rows, map_flags, supplement_target_filename));
         } else {
@@ -317,23 +326,16 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
                     reader.read(raw_row.data(), count * SparseRow<DType>::element_size());
                 }
             }
-            add_row_to_index(raw_row, i);
+            add_row_to_index(raw_row, i, *published);
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
             index_dataset_nnz_len_histogram_->Observe(count);
 #endif
         }
         LOG_KNOWHERE_INFO_ << "Sparse Inverted Index loading progress: 100%";
 
-#if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
-        for (size_t i = 0; i < dim_map_.size(); ++i) {
-            index_posting_list_len_histogram_->Observe(inverted_index_ids_[i].size());
-        }
-        index_size_gauge_->Set((double)size() / 1024.0 / 1024.0);
-#endif
-
         n_rows_internal_ = rows;
 
-        nr_inner_dims_ = dim_map_.size();
+        nr_inner_dims_ = dim_map_->size();
 
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
         build_stats_.posting_list_length_stats_.resize(nr_inner_dims_);
@@ -341,22 +343,14 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
             build_stats_.posting_list_length_stats_[i] = inverted_index_ids_[i].size();
         }
 #endif
-        // mapping data to spans
-        inverted_index_ids_spans_.reserve(nr_inner_dims_);
-        inverted_index_vals_spans_.reserve(nr_inner_dims_);
-        for (size_t i = 0; i < nr_inner_dims_; ++i) {
-            inverted_index_ids_spans_.emplace_back(inverted_index_ids_[i].data(), inverted_index_ids_[i].size());
-            inverted_index_vals_spans_.emplace_back(inverted_index_vals_[i].data(), inverted_index_vals_[i].size());
-        }
-
-        if (max_score_in_dim_.size() > 0) {
-            max_score_in_dim_spans_ = boost::span<const float>(max_score_in_dim_.data(), max_score_in_dim_.size());
-        }
+        publish_containers();
 
-        if (metric_type_ == SparseMetricType::METRIC_BM25) {
-            bm25_params_->row_sums_spans_ =
-                boost::span<const float>(bm25_params_->row_sums.data(), bm25_params_->row_sums.size());
+#if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
+        for (size_t i = 0; i < nr_inner_dims_; ++i) {
+            index_posting_list_len_histogram_->Observe(inverted_index_ids_[i].size());
         }
+        index_size_gauge_->Set((double)size() / 1024.0 / 1024.0);
+#endif
 
         return Status::success;
     }
@@ -393,12 +387,16 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
 
         // write index header data
         const uint32_t index_format_version = 1;
+        const auto s = snapshot();
+        const uint32_t n_rows = s->n_rows;
+        const uint32_t max_dim = s->max_dim;
+        const uint32_t nr_inner_dims = s->ids_spans.size();
 
         // Index File Header (v1)
         writer.write(&index_format_version, sizeof(uint32_t));    // index format version
-        writer.write(&this->n_rows_internal_, sizeof(uint32_t));  // number of rows
-        writer.write(&this->max_dim_, sizeof(uint32_t));          // number of cols, or maximum dimension id
-        writer.write(&this->nr_inner_dims_, sizeof(uint32_t));    // number of inner dimensions
+        writer.write(&n_rows, sizeof(uint32_t));         // number of rows
+        writer.write(&max_dim, sizeof(uint32_t));        // number of cols, or maximum dimension id
+        writer.write(&nr_inner_dims, sizeof(uint32_t));  // number of inner dimensions
         auto reserved =
             std::array<uint8_t, InvertedIndex::index_file_v1_header_reserved_size>();  // reserved for future use
         writer.write(reserved.data(), reserved.size());
@@ -409,7 +407,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         if (metric_type_ == SparseMetricType::METRIC_BM25) {
             nr_sections += 1;  // row sums
         }
-        if (max_score_in_dim_spans_.size() > 0) {
+        if (s->max_score_in_dim.size() > 0) {
             nr_sections += 1;  // max scores per dim
         }
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOHWERE_WITH_LIGHT)
@@ -425,32 +423,32 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         section_headers[0].type = InvertedIndexSectionType::POSTING_LISTS;
         section_headers[0].offset = used_offset;
         uint64_t posting_lists_size = sizeof(uint32_t);                       // used to store encoding type
-        posting_lists_size += sizeof(uint64_t) * (this->nr_inner_dims_ + 1);  // used to store dim offsets
-        for (size_t i = 0; i < this->nr_inner_dims_; ++i) {
-            posting_lists_size += this->inverted_index_ids_spans_[i].size() * sizeof(uint32_t) +
-                                  this->inverted_index_vals_spans_[i].size() * sizeof(QType);
+        posting_lists_size += sizeof(uint64_t) * (nr_inner_dims + 1);  // used to store dim offsets
+        for (size_t i = 0; i < nr_inner_dims; ++i) {
+            posting_lists_size += s->ids_spans[i].size() * sizeof(uint32_t) +
+                                  s->vals_spans[i].size() * sizeof(QType);
         }
         section_headers[0].size = posting_lists_size;
         used_offset += section_headers[0].size;
 
         section_headers[1].type = InvertedIndexSectionType::DIM_MAP;
         section_headers[1].offset = used_offset;
-        section_headers[1].size = sizeof(uint32_t) * this->nr_inner_dims_;
+        section_headers[1].size = sizeof(uint32_t) * nr_inner_dims;
         used_offset += section_headers[1].size;
 
         uint32_t curr_section_idx = 2;
         if (metric_type_ == SparseMetricType::METRIC_BM25) {
             section_headers[curr_section_idx].type = InvertedIndexSectionType::ROW_SUMS;
             section_headers[curr_section_idx].offset = used_offset;
-            section_headers[curr_section_idx].size = sizeof(float) * n_rows_internal_;
+            section_headers[curr_section_idx].size = sizeof(float) * n_rows;
             used_offset += section_headers[curr_section_idx].size;
             curr_section_idx++;
         }
 
-        if (max_score_in_dim_spans_.size() > 0) {
+        if (s->max_score_in_dim.size() > 0) {
             section_headers[curr_section_idx].type = InvertedIndexSectionType::MAX_SCORES_PER_DIM;
             section_headers[curr_section_idx].offset = used_offset;
-            section_headers[curr_section_idx].size = sizeof(float) * this->nr_inner_dims_;
+            section_headers[curr_section_idx].size = sizeof(float) * nr_inner_dims;
             used_offset += section_headers[curr_section_idx].size;
             curr_section_idx++;
         }
@@ -459,54 +457,57 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         section_headers[curr_section_idx].type = InvertedIndexSectionType::PROMETHEUS_BUILD_STATS;
         section_headers[curr_section_idx].offset = used_offset;
         section_headers[curr_section_idx].size =
-            sizeof(uint32_t) * this->n_rows_internal_ + sizeof(uint32_t) * this->nr_inner_dims_;
+            sizeof(uint32_t) * n_rows + sizeof(uint32_t) * nr_inner_dims;
         used_offset += section_headers[curr_section_idx].size;
         curr_section_idx++;
 #endif
 
         assert(curr_section_idx == nr_sections);
 
+        // the sections end the layout, so the whole output is written into a single allocation
+        writer.reserve(used_offset);
+
         // write section headers table
         writer.write(section_headers.data(), sizeof(InvertedIndexSectionHeader), nr_sections);
 
         // write index encoding type and index
         uint32_t index_encoding_type = 0;  // not used for now
         writer.write(&index_encoding_type, sizeof(uint32_t));
-        std::vector<uint64_t> inverted_index_offsets(this->nr_inner_dims_ + 1);
+        std::vector<uint64_t> inverted_index_offsets(nr_inner_dims + 1);
         inverted_index_offsets[0] = 0;
-        for (size_t i = 1; i <= this->nr_inner_dims_; ++i) {
-            inverted_index_offsets[i] = inverted_index_offsets[i - 1] + this->inverted_index_ids_spans_[i - 1].size();
+        for (size_t i = 1; i <= nr_inner_dims; ++i) {
+            inverted_index_offsets[i] = inverted_index_offsets[i - 1] + s->ids_spans[i - 1].size();
         }
         writer.write(inverted_index_offsets.data(), sizeof(uint64_t), inverted_index_offsets.size());
-        for (size_t i = 0; i < this->nr_inner_dims_; ++i) {
-            writer.write(this->inverted_index_ids_spans_[i].data(), sizeof(uint32_t),
-                         this->inverted_index_ids_spans_[i].size());
+        for (size_t i = 0; i < nr_inner_dims; ++i) {
+            writer.write(s->ids_spans[i].data(), sizeof(uint32_t),
+                         s->ids_spans[i].size());
         }
-        for (size_t i = 0; i < this->nr_inner_dims_; ++i) {
-            writer.write(this->inverted_index_vals_spans_[i].data(), sizeof(QType),
-                         this->inverted_index_vals_spans_[i].size());
+        for (size_t i = 0; i < nr_inner_dims; ++i) {
+            writer.write(s->vals_spans[i].data(), sizeof(QType),
+                         s->vals_spans[i].size());
         }
 
         // write dim map
-        auto dim_map_reverse = std::vector<uint32_t>(this->nr_inner_dims_);
-        for (const auto& [dim, dim_id] : this->dim_map_) {
+        auto dim_map_reverse = std::vector<uint32_t>(nr_inner_dims);
+        for (const auto& [dim, dim_id] : *s->dim_map) {
             dim_map_reverse[dim_id] = dim;
         }
-        writer.write(dim_map_reverse.data(), sizeof(uint32_t), this->nr_inner_dims_);
+        writer.write(dim_map_reverse.data(), sizeof(uint32_t), nr_inner_dims);
 
         // write index meta data
         if (metric_type_ == SparseMetricType::METRIC_BM25) {
-            writer.write(bm25_params_->row_sums_spans_.data(), sizeof(float), this->n_rows_internal_);
+            writer.write(s->row_sums.data(), sizeof(float), n_rows);
         }
 
-        if (max_score_in_dim_spans_.size() > 0) {
-            writer.write(max_score_in_dim_spans_.data(), sizeof(float), this->nr_inner_dims_);
+        if (s->max_score_in_dim.size() > 0) {
+            writer.write(s->max_score_in_dim.data(), sizeof(float), nr_inner_dims);
         }
 
         // write prometheus build stats
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOHWERE_WITH_LIGHT)
-        writer.write(this->build_stats_.dataset_nnz_stats_.data(), sizeof(uint32_t), this->n_rows_internal_);
-        writer.write(this->build_stats_.posting_list_length_stats_.data(), sizeof(uint32_t), this->nr_inner_dims_);
+        writer.write(this->build_stats_.dataset_nnz_stats_.data(), sizeof(uint32_t), n_rows);
+        writer.write(this->build_stats_.posting_list_length_stats_.data(), sizeof(uint32_t), nr_inner_dims);
 #endif
 
         return Status::success;
@@ -514,6 +515,11 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
 
     Status
     Deserialize(MemoryIOReader& reader) override {
+        std::vector<boost::span<const table_t>> ids_spans;
+        std::vector<boost::span<const QType>> vals_spans;
+        boost::span<const float> max_score_in_dim;
+        boost::span<const float> row_sums;
+
         auto file_header_handler = [&]() {
             uint32_t index_format_version = 0;
             reader.read(&index_format_version, sizeof(uint32_t));
@@ -522,9 +528,13 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
                 return Status::invalid_serialized_index_type;
             }
 
-            reader.read(&this->n_rows_internal_, sizeof(uint32_t));
-            reader.read(&this->max_dim_, sizeof(uint32_t));
+            uint32_t n_rows = 0;
+            uint32_t max_dim = 0;
+            reader.read(&n_rows, sizeof(uint32_t));
+            reader.read(&max_dim, sizeof(uint32_t));
             reader.read(&this->nr_inner_dims_, sizeof(uint32_t));
+            this->n_rows_internal_ = n_rows;
+            this->max_dim_ = max_dim;
             // skip reserved bytes
             reader.advance(InvertedIndex::index_file_v1_header_reserved_size);
 
@@ -554,19 +564,19 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
                         auto inverted_index_offsets_span = boost::span<const uint64_t>(
                             reinterpret_cast<uint64_t*>(reader.data() + reader.tellg()), this->nr_inner_dims_ + 1);
                         reader.advance(sizeof(uint64_t) * (this->nr_inner_dims_ + 1));
-                        inverted_index_ids_spans_.resize(this->nr_inner_dims_);
-                        inverted_index_vals_spans_.resize(this->nr_inner_dims_);
+                        ids_spans.resize(this->nr_inner_dims_);
+                        vals_spans.resize(this->nr_inner_dims_);
                         for (size_t i = 0; i < this->nr_inner_dims_; ++i) {
-                            inverted_index_ids_spans_[i] = boost::span<const uint32_t>(
+                            ids_spans[i] = boost::span<const uint32_t>(
                                 reinterpret_cast<uint32_t*>(reader.data() + reader.tellg()),
                                 inverted_index_offsets_span[i + 1] - inverted_index_offsets_span[i]);
-                            reader.advance(inverted_index_ids_spans_[i].size() * sizeof(uint32_t));
+                            reader.advance(ids_spans[i].size() * sizeof(uint32_t));
                         }
                         for (size_t i = 0; i < this->nr_inner_dims_; ++i) {
-                            inverted_index_vals_spans_[i] = boost::span<const QType>(
+                            vals_spans[i] = boost::span<const QType>(
                                 reinterpret_cast<QType*>(reader.data() + reader.tellg()),
                                 inverted_index_offsets_span[i + 1] - inverted_index_offsets_span[i]);
-                            reader.advance(inverted_index_vals_spans_[i].size() * sizeof(QType));
+                            reader.advance(vals_spans[i].size() * sizeof(QType));
                         }
                         break;
                     }
@@ -575,20 +585,20 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
                         for (uint32_t i = 0; i < this->nr_inner_dims_; ++i) {
                             uint32_t dim = 0;
                             reader.read(&dim, sizeof(uint32_t));
-                            this->dim_map_[dim] = i;
+                            (*this->dim_map_)[dim] = i;
                         }
                         break;
                     }
                     case InvertedIndexSectionType::ROW_SUMS: {
                         reader.seekg(section_header.offset);
-                        bm25_params_->row_sums_spans_ = boost::span<const float>(
+                        row_sums = boost::span<const float>(
                             reinterpret_cast<float*>(reader.data() + section_header.offset), this->n_rows_internal_);
                         reader.advance(sizeof(float) * this->n_rows_internal_);
                         break;
                     }
                     case InvertedIndexSectionType::MAX_SCORES_PER_DIM: {
                         reader.seekg(section_header.offset);
-                        max_score_in_dim_spans_ = boost::span<const float>(
+                        max_score_in_dim = boost::span<const float>(
                             reinterpret_cast<float*>(reader.data() + section_header.offset), this->nr_inner_dims_);
                         reader.advance(sizeof(float) * this->nr_inner_dims_);
                         break;
@@ -625,6 +635,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         if (auto status = sections_handler(); status != Status::success) {
             return status;
         }
+        publish(std::move(ids_spans), std::move(vals_spans), max_score_in_dim, row_sums);
 
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
         this->index_size_gauge_->Set((double)size() / 1024.0 / 1024.0);
@@ -747,7 +758,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         }
         size_t dim_id = 0;
         for (const auto& [idx, count] : idx_counts) {
-            dim_map_[idx] = dim_id;
+            (*dim_map_)[idx] = dim_id;
             if constexpr (algo == InvertedIndexAlgo::DAAT_WAND || algo == InvertedIndexAlgo::DAAT_MAXSCORE) {
                 max_score_in_dim_.emplace_back(0.0f);
             }
@@ -775,20 +786,31 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         if constexpr (mmapped) {
             throw std::invalid_argument("mmapped InvertedIndex does not support Add");
         } else {
+            // searches keep running on the published snapshot while the rows are added, nothing it may read is
+            // modified in place.
+            const auto published = snapshot();
             auto current_rows = n_rows_internal_;
             if ((size_t)dim > max_dim_) {
                 max_dim_ = dim;
             }
 
             if (metric_type_ == SparseMetricType::METRIC_BM25) {
-                bm25_params_->row_sums.reserve(current_rows + rows);
+                reserve_published(bm25_params_->row_sums, current_rows + rows, published->row_sums.data());
+            }
+            if constexpr (algo == InvertedIndexAlgo::DAAT_WAND || algo == InvertedIndexAlgo::DAAT_MAXSCORE) {
+                // the max scores are updated in place, copy them first if they are published
+                if (!max_score_in_dim_.empty() && max_score_in_dim_.data() == published->max_score_in_dim.data()) {
+                    std::vector<float> max_score_in_dim(max_score_in_dim_);
+                    std::swap(max_score_in_dim_, max_score_in_dim);
+                    retired_.push_back(std::make_shared<std::vector<float>>(std::move(max_score_in_dim)));
+                }
             }
             for (size_t i = 0; i < rows; ++i) {
-                add_row_to_index(data[i], current_rows + i);
+                add_row_to_index(data[i], current_rows + i, *published);
             }
             n_rows_internal_ += rows;
 
-            nr_inner_dims_ = dim_map_.size();
+            nr_inner_dims_ = dim_map_->size();
 
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
             build_stats_.posting_list_length_stats_.resize(nr_inner_dims_);
@@ -797,33 +819,21 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
             }
 #endif
 
-            inverted_index_ids_spans_.clear();
-            inverted_index_vals_spans_.clear();
-            inverted_index_ids_spans_.reserve(nr_inner_dims_);
-            inverted_index_vals_spans_.reserve(nr_inner_dims_);
-
-            // mapping data to spans
-            for (size_t i = 0; i < nr_inner_dims_; ++i) {
-                inverted_index_ids_spans_.emplace_back(inverted_index_ids_[i].data(), inverted_index_ids_[i].size());
-                inverted_index_vals_spans_.emplace_back(inverted_index_vals_[i].data(), inverted_index_vals_[i].size());
-            }
-
-            if (max_score_in_dim_.size() > 0) {
-                max_score_in_dim_spans_ = boost::span<const float>(max_score_in_dim_.data(), max_score_in_dim_.size());
-            }
-
-            if (metric_type_ == SparseMetricType::METRIC_BM25) {
-                bm25_params_->row_sums_spans_ =
-                    boost::span<const float>(bm25_params_->row_sums.data(), bm25_params_->row_sums.size());
-            }
+            publish_containers();
 
             return Status::success;
         }
     }
 
+    [[nodiscard]] std::shared_ptr<const void>
+    Pin() const override {
+        return snapshot();
+    }
+
     void
     Search(const SparseRow<DType>& query, size_t k, float* distances, label_t* labels, const BitsetView& bitset,
-           const DocValueComputer<float>& computer, InvertedIndexApproxSearchParams& approx_params) const override {
+           const DocValueComputer<float>& computer, InvertedIndexApproxSearchParams& approx_params,
+           const std::shared_ptr<const void>& pinned) const override {
         // initially set result distances to NaN and labels to -1
         std::fill(distances, distances + k, std::numeric_limits<float>::quiet_NaN());
         std::fill(labels, labels + k, -1);
@@ -831,7 +841,9 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
             return;
         }
 
-        auto q_vec = parse_query(query, approx_params.drop_ratio_search);
+        const auto current = pinned == nullptr ? snapshot() : nullptr;
+        const auto* s = pinned == nullptr ? current.get() : static_cast<const Snapshot*>(pinned.get());
+        auto q_vec = parse_query(*s, query, approx_params.drop_ratio_search);
         if (q_vec.empty()) {
             return;
         }
@@ -839,17 +851,17 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         MaxMinHeap<float> heap(k * approx_params.refine_factor);
         // DAAT_WAND and DAAT_MAXSCORE are based on the implementation in PISA.
         if constexpr (algo == InvertedIndexAlgo::DAAT_WAND) {
-            search_daat_wand(q_vec, heap, bitset, computer, approx_params.dim_max_score_ratio);
+            search_daat_wand(*s, q_vec, heap, bitset, computer, approx_params.dim_max_score_ratio);
         } else if constexpr (algo == InvertedIndexAlgo::DAAT_MAXSCORE) {
-            search_daat_maxscore(q_vec, heap, bitset, computer, approx_params.dim_max_score_ratio);
+            search_daat_maxscore(*s, q_vec, heap, bitset, computer, approx_params.dim_max_score_ratio);
         } else {
-            search_taat_naive(q_vec, heap, bitset, computer);
+            search_taat_naive(*s, q_vec, heap, bitset, computer);
         }
 
         if (approx_params.refine_factor == 1) {
             collect_result(heap, distances, labels);
         } else {
-            refine_and_collect(query, heap, k, distances, labels, computer, approx_params);
+            refine_and_collect(*s, query, heap, k, distances, labels, computer);
         }
     }
 
@@ -864,9 +876,10 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         for (size_t i = 0; i < query.size(); ++i) {
             values[i] = std::abs(query[i].val);
         }
-        auto q_vec = parse_query(query, drop_ratio_search);
+        const auto s = snapshot();
+        auto q_vec = parse_query(*s, query, drop_ratio_search);
 
-        auto distances = compute_all_distances(q_vec, computer);
+        auto distances = compute_all_distances(*s, q_vec, computer);
         if (!bitset.empty()) {
             for (size_t i = 0; i < distances.size(); ++i) {
                 if (bitset.test(i)) {
@@ -880,22 +893,23 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
     float
     GetRawDistance(const label_t vec_id, const SparseRow<DType>& query,
                    const DocValueComputer<float>& computer) const override {
+        const auto s = snapshot();
         float distance = 0.0f;
 
         for (size_t i = 0; i < query.size(); ++i) {
             auto [dim, val] = query[i];
-            auto dim_it = dim_map_.find(dim);
-            if (dim_it == dim_map_.cend()) {
+            auto dim_it = s->dim_map->find(dim);
+            if (dim_it == s->dim_map->cend()) {
                 continue;
             }
-            auto& plist_ids = inverted_index_ids_spans_[dim_it->second];
+            auto& plist_ids = s->ids_spans[dim_it->second];
             auto it = std::lower_bound(plist_ids.begin(), plist_ids.end(), vec_id,
                                        [](const auto& x, table_t y) { return x < y; });
             if (it != plist_ids.end() && *it == vec_id) {
                 distance +=
                     val *
-                    computer(inverted_index_vals_spans_[dim_it->second][it - plist_ids.begin()],
-                             metric_type_ == SparseMetricType::METRIC_BM25 ? bm25_params_->row_sums_spans_[vec_id] : 0);
+                    computer(s->vals_spans[dim_it->second][it - plist_ids.begin()],
+                             metric_type_ == SparseMetricType::METRIC_BM25 ? s->row_sums[vec_id] : 0);
             }
         }
 
@@ -904,26 +918,23 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
 
     [[nodiscard]] size_t
     size() const override {
+        const auto s = snapshot();
         size_t res = sizeof(*this);
-        res += dim_map_.size() *
-               (sizeof(typename decltype(dim_map_)::key_type) + sizeof(typename decltype(dim_map_)::mapped_type));
+        res += s->dim_map->size() * (sizeof(table_t) + sizeof(uint32_t));
 
         if constexpr (mmapped) {
             return res + map_byte_size_;
         } else {
-            res += sizeof(typename decltype(inverted_index_ids_spans_)::value_type) * inverted_index_ids_spans_.size();
-            for (auto inverted_index_ids_span : inverted_index_ids_spans_) {
-                res += sizeof(typename decltype(inverted_index_ids_spans_)::value_type::value_type) *
-                       inverted_index_ids_span.size();
+            res += sizeof(boost::span<const table_t>) * s->ids_spans.size();
+            for (auto inverted_index_ids_span : s->ids_spans) {
+                res += sizeof(table_t) * inverted_index_ids_span.size();
             }
-            res +=
-                sizeof(typename decltype(inverted_index_vals_spans_)::value_type) * inverted_index_vals_spans_.size();
-            for (auto inverted_index_vals_span : inverted_index_vals_spans_) {
-                res += sizeof(typename decltype(inverted_index_vals_spans_)::value_type::value_type) *
-                       inverted_index_vals_span.size();
+            res += sizeof(boost::span<const QType>) * s->vals_spans.size();
+            for (auto inverted_index_vals_span : s->vals_spans) {
+                res += sizeof(QType) * inverted_index_vals_span.size();
             }
             if constexpr (algo == InvertedIndexAlgo::DAAT_WAND || algo == InvertedIndexAlgo::DAAT_MAXSCORE) {
-                res += sizeof(typename decltype(max_score_in_dim_spans_)::value_type) * max_score_in_dim_spans_.size();
+                res += sizeof(float) * s->max_score_in_dim.size();
             }
             return res;
         }
@@ -931,15 +942,129 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
 
     [[nodiscard]] size_t
     n_rows() const override {
-        return n_rows_internal_;
+        return snapshot()->n_rows;
     }
 
     [[nodiscard]] size_t
     n_cols() const override {
-        return max_dim_;
+        return snapshot()->max_dim;
     }
 
  private:
+    // Buffers replaced right before a snapshot was published. An epoch keeps all the later epochs alive, so a
+    // retired buffer is freed only after every search that holds an older snapshot has finished. next is linked by
+    // the writer while searches may be releasing the chain, hence the atomic accesses.
+    struct Epoch {
+        std::vector<std::shared_ptr<void>> retired;
+        std::shared_ptr<Epoch> next;
+
+        ~Epoch() {
+            // release a long chain iteratively instead of recursing through the destructors
+            auto epoch = std::atomic_exchange(&next, std::shared_ptr<Epoch>());
+            while (epoch != nullptr && epoch.use_count() == 1) {
+                epoch = std::atomic_exchange(&epoch->next, std::shared_ptr<Epoch>());
+            }
+        }
+    };
+
+    // Everything a search reads, published as a whole after each change so that searches never wait for Add.
+    // Add only appends past the recorded sizes and copies a buffer before it would be reallocated or updated in
+    // place, the replaced buffer is retired to the epoch published next, which the older snapshots keep alive.
+    struct Snapshot {
+        std::shared_ptr<const std::unordered_map<table_t, uint32_t>> dim_map =
+            std::make_shared<const std::unordered_map<table_t, uint32_t>>();
+        std::vector<boost::span<const table_t>> ids_spans;
+        std::vector<boost::span<const QType>> vals_spans;
+        boost::span<const float> max_score_in_dim;
+        boost::span<const float> row_sums;
+        size_t n_rows = 0;
+        size_t max_dim = 0;
+        std::shared_ptr<Epoch> epoch = std::make_shared<Epoch>();
+    };
+
+    std::shared_ptr<const Snapshot>
+    snapshot() const {
+        return std::atomic_load(&snapshot_);
+    }
+
+    // single writer only.
+    void
+    publish(std::vector<boost::span<const table_t>>&& ids_spans, std::vector<boost::span<const QType>>&& vals_spans,
+            boost::span<const float> max_score_in_dim, boost::span<const float> row_sums) {
+        auto next = std::make_shared<Snapshot>();
+        next->dim_map = dim_map_;
+        next->ids_spans = std::move(ids_spans);
+        next->vals_spans = std::move(vals_spans);
+        next->max_score_in_dim = max_score_in_dim;
+        next->row_sums = row_sums;
+        next->n_rows = n_rows_internal_;
+        next->max_dim = max_dim_;
+
+        next->epoch->retired = std::move(retired_);
+        retired_.clear();
+        std::atomic_store(&snapshot()->epoch->next, next->epoch);
+        std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(next)));
+    }
+
+    // publishes the posting lists, max scores and row sums held in the containers of this index.
+    void
+    publish_containers() {
+        std::vector<boost::span<const table_t>> ids_spans;
+        std::vector<boost::span<const QType>> vals_spans;
+        ids_spans.reserve(nr_inner_dims_);
+        vals_spans.reserve(nr_inner_dims_);
+        for (size_t i = 0; i < nr_inner_dims_; ++i) {
+            ids_spans.emplace_back(inverted_index_ids_[i].data(), inverted_index_ids_[i].size());
+            vals_spans.emplace_back(inverted_index_vals_[i].data(), inverted_index_vals_[i].size());
+        }
+
+        boost::span<const float> max_score_in_dim;
+        if (max_score_in_dim_.size() > 0) {
+            max_score_in_dim = boost::span<const float>(max_score_in_dim_.data(), max_score_in_dim_.size());
+        }
+
+        boost::span<const float> row_sums;
+        if (metric_type_ == SparseMetricType::METRIC_BM25) {
+            row_sums = boost::span<const float>(bm25_params_->row_sums.data(), bm25_params_->row_sums.size());
+        }
+
+        publish(std::move(ids_spans), std::move(vals_spans), max_score_in_dim, row_sums);
+    }
+
+    template <typename U>
+    static const U*
+    published_data(const std::vector<boost::span<const U>>& spans, size_t i) {
+        return i < spans.size() ? spans[i].data() : nullptr;
+    }
+
+    // makes room for n elements in vec. The old buffer is retired instead of freed if it is the published one.
+    template <typename U>
+    void
+    reserve_published(Vector<U>& vec, size_t n, const U* published) {
+        if constexpr (!mmapped) {
+            if (n <= vec.capacity()) {
+                return;
+            }
+            auto capacity = std::max(n, 2 * vec.capacity());
+            if (published == nullptr || vec.data() != published) {
+                vec.reserve(capacity);
+                return;
+            }
+            std::vector<U> grown;
+            grown.reserve(capacity);
+            grown.assign(vec.begin(), vec.end());
+            std::swap(vec, grown);
+            retired_.push_back(std::make_shared<std::vector<U>>(std::move(grown)));
+        }
+    }
+
+    template <typename U>
+    void
+    append_published(Vector<U>& vec, const U& val, const U* published) {
+        reserve_published(vec, vec.size() + 1, published);
+        vec.emplace_back(val);
+    }
+
     // Given a vector of values, returns the threshold value.
     // All values strictly smaller than the threshold will be ignored.
     // values will be modified in this function.
@@ -957,17 +1082,16 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
     }
 
     std::vector<float>
-    compute_all_distances(const std::vector<std::pair<size_t, DType>>& q_vec,
+    compute_all_distances(const Snapshot& s, const std::vector<std::pair<size_t, DType>>& q_vec,
                           const DocValueComputer<float>& computer) const {
-        std::vector<float> scores(n_rows_internal_, 0.0f);
+        std::vector<float> scores(s.n_rows, 0.0f);
         for (size_t i = 0; i < q_vec.size(); ++i) {
-            auto& plist_ids = inverted_index_ids_spans_[q_vec[i].first];
-            auto& plist_vals = inverted_index_vals_spans_[q_vec[i].first];
+            auto& plist_ids = s.ids_spans[q_vec[i].first];
+            auto& plist_vals = s.vals_spans[q_vec[i].first];
             // TODO: improve with SIMD
             for (size_t j = 0; j < plist_ids.size(); ++j) {
                 auto doc_id = plist_ids[j];
-                float val_sum =
-                    metric_type_ == SparseMetricType::METRIC_BM25 ? bm25_params_->row_sums_spans_[doc_id] : 0;
+                float val_sum = metric_type_ == SparseMetricType::METRIC_BM25 ? s.row_sums[doc_id] : 0;
                 scores[doc_id] += q_vec[i].second * computer(plist_vals[j], val_sum);
             }
         }
@@ -1038,7 +1162,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
     };  // struct Cursor
 
     std::vector<std::pair<size_t, DType>>
-    parse_query(const SparseRow<DType>& query, float drop_ratio_search) const {
+    parse_query(const Snapshot& s, const SparseRow<DType>& query, float drop_ratio_search) const {
         DType q_threshold = 0;
         if (drop_ratio_search != 0) {
             std::vector<DType> values(query.size());
@@ -1051,8 +1175,8 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         std::vector<std::pair<size_t, DType>> filtered_query;
         for (size_t i = 0; i < query.size(); ++i) {
             auto [dim, val] = query[i];
-            auto dim_it = dim_map_.find(dim);
-            if (dim_it == dim_map_.cend() || std::abs(val) < q_threshold) {
+            auto dim_it = s.dim_map->find(dim);
+            if (dim_it == s.dim_map->cend() || std::abs(val) < q_threshold) {
                 continue;
             }
             filtered_query.emplace_back(dim_it->second, val);
@@ -1063,16 +1187,16 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
 
     template <typename DocIdFilter>
     std::vector<Cursor<DocIdFilter>>
-    make_cursors(const std::vector<std::pair<size_t, DType>>& q_vec, const DocValueComputer<float>& computer,
-                 DocIdFilter& filter, float dim_max_score_ratio) const {
+    make_cursors(const Snapshot& s, const std::vector<std::pair<size_t, DType>>& q_vec,
+                 const DocValueComputer<float>& computer, DocIdFilter& filter, float dim_max_score_ratio) const {
         std::vector<Cursor<DocIdFilter>> cursors;
         cursors.reserve(q_vec.size());
         for (auto q_dim : q_vec) {
-            auto& plist_ids = inverted_index_ids_spans_[q_dim.first];
-            auto& plist_vals = inverted_index_vals_spans_[q_dim.first];
-            cursors.emplace_back(plist_ids, plist_vals, n_rows_internal_,
-                                 max_score_in_dim_spans_[q_dim.first] * q_dim.second * dim_max_score_ratio,
-                                 q_dim.second, filter);
+            auto& plist_ids = s.ids_spans[q_dim.first];
+            auto& plist_vals = s.vals_spans[q_dim.first];
+            cursors.emplace_back(plist_ids, plist_vals, s.n_rows,
+                                 s.max_score_in_dim[q_dim.first] * q_dim.second * dim_max_score_ratio, q_dim.second,
+                                 filter);
         }
         return cursors;
     }
@@ -1082,10 +1206,10 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
     // TODO: may switch to row-wise brute force if filter rate is high. Benchmark needed.
     template <typename DocIdFilter>
     void
-    search_taat_naive(const std::vector<std::pair<size_t, DType>>& q_vec, MaxMinHeap<float>& heap, DocIdFilter& filter,
-                      const DocValueComputer<float>& computer) const {
-        auto scores = compute_all_distances(q_vec, computer);
-        for (size_t i = 0; i < n_rows_internal_; ++i) {
+    search_taat_naive(const Snapshot& s, const std::vector<std::pair<size_t, DType>>& q_vec, MaxMinHeap<float>& heap,
+                      DocIdFilter& filter, const DocValueComputer<float>& computer) const {
+        auto scores = compute_all_distances(s, q_vec, computer);
+        for (size_t i = 0; i < s.n_rows; ++i) {
             if ((filter.empty() || !filter.test(i)) && scores[i] != 0) {
                 heap.push(i, scores[i]);
             }
@@ -1094,9 +1218,9 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
 
     template <typename DocIdFilter>
     void
-    search_daat_wand(const std::vector<std::pair<size_t, DType>>& q_vec, MaxMinHeap<float>& heap, DocIdFilter& filter,
-                     const DocValueComputer<float>& computer, float dim_max_score_ratio) const {
-        std::vector<Cursor<DocIdFilter>> cursors = make_cursors(q_vec, computer, filter, dim_max_score_ratio);
+    search_daat_wand(const Snapshot& s, const std::vector<std::pair<size_t, DType>>& q_vec, MaxMinHeap<float>& heap,
+                     DocIdFilter& filter, const DocValueComputer<float>& computer, float dim_max_score_ratio) const {
+        std::vector<Cursor<DocIdFilter>> cursors = make_cursors(s, q_vec, computer, filter, dim_max_score_ratio);
         std::vector<Cursor<DocIdFilter>*> cursor_ptrs(cursors.size());
         for (size_t i = 0; i < cursors.size(); ++i) {
             cursor_ptrs[i] = &cursors[i];
@@ -1115,7 +1239,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
 
             bool found_pivot = false;
             for (pivot = 0; pivot < q_vec.size(); ++pivot) {
-                if (cursor_ptrs[pivot]->cur_vec_id_ >= n_rows_internal_) {
+                if (cursor_ptrs[pivot]->cur_vec_id_ >= s.n_rows) {
                     break;
                 }
                 upper_bound += cursor_ptrs[pivot]->max_score_;
@@ -1131,8 +1255,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
             table_t pivot_id = cursor_ptrs[pivot]->cur_vec_id_;
             if (pivot_id == cursor_ptrs[0]->cur_vec_id_) {
                 float score = 0;
-                float cur_vec_sum =
-                    metric_type_ == SparseMetricType::METRIC_BM25 ? bm25_params_->row_sums_spans_[pivot_id] : 0;
+                float cur_vec_sum = metric_type_ == SparseMetricType::METRIC_BM25 ? s.row_sums[pivot_id] : 0;
                 for (auto& cursor_ptr : cursor_ptrs) {
                     if (cursor_ptr->cur_vec_id_ != pivot_id) {
                         break;
@@ -1159,13 +1282,14 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
 
     template <typename DocIdFilter>
     void
-    search_daat_maxscore(std::vector<std::pair<size_t, DType>>& q_vec, MaxMinHeap<float>& heap, DocIdFilter& filter,
-                         const DocValueComputer<float>& computer, float dim_max_score_ratio) const {
-        std::sort(q_vec.begin(), q_vec.end(), [this](auto& a, auto& b) {
-            return a.second * max_score_in_dim_spans_[a.first] > b.second * max_score_in_dim_spans_[b.first];
+    search_daat_maxscore(const Snapshot& s, std::vector<std::pair<size_t, DType>>& q_vec, MaxMinHeap<float>& heap,
+                         DocIdFilter& filter, const DocValueComputer<float>& computer,
+                         float dim_max_score_ratio) const {
+        std::sort(q_vec.begin(), q_vec.end(), [&s](auto& a, auto& b) {
+            return a.second * s.max_score_in_dim[a.first] > b.second * s.max_score_in_dim[b.first];
         });
 
-        std::vector<Cursor<DocIdFilter>> cursors = make_cursors(q_vec, computer, filter, dim_max_score_ratio);
+        std::vector<Cursor<DocIdFilter>> cursors = make_cursors(s, q_vec, computer, filter, dim_max_score_ratio);
 
         float threshold = heap.full() ? heap.top().val : 0;
 
@@ -1176,7 +1300,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
             upper_bounds[i] = bound_sum;
         }
 
-        table_t next_cand_vec_id = n_rows_internal_;
+        table_t next_cand_vec_id = s.n_rows;
         for (size_t i = 0; i < cursors.size(); ++i) {
             if (cursors[i].cur_vec_id_ < next_cand_vec_id) {
                 next_cand_vec_id = cursors[i].cur_vec_id_;
@@ -1196,20 +1320,20 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         float curr_cand_score = 0.0f;
         table_t curr_cand_vec_id = 0;
 
-        while (curr_cand_vec_id < n_rows_internal_) {
+        while (curr_cand_vec_id < s.n_rows) {
             auto found_cand = false;
             while (found_cand == false) {
                 // start find from next_vec_id
-                if (next_cand_vec_id >= n_rows_internal_) {
+                if (next_cand_vec_id >= s.n_rows) {
                     return;
                 }
                 // get current candidate vector
                 curr_cand_vec_id = next_cand_vec_id;
                 curr_cand_score = 0.0f;
                 // update next_cand_vec_id
-                next_cand_vec_id = n_rows_internal_;
+                next_cand_vec_id = s.n_rows;
                 float cur_vec_sum =
-                    metric_type_ == SparseMetricType::METRIC_BM25 ? bm25_params_->row_sums_spans_[curr_cand_vec_id] : 0;
+                    metric_type_ == SparseMetricType::METRIC_BM25 ? s.row_sums[curr_cand_vec_id] : 0;
 
                 for (size_t i = 0; i < first_ne_idx; ++i) {
                     if (cursors[i].cur_vec_id_ == curr_cand_vec_id) {
@@ -1247,10 +1371,12 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         }
     }
 
+    // computes the exact scores of the candidates in inacc_heap and collects the top k of them. The candidates are
+    // sorted, so their postings in each dimension of the query are found by a sorted intersection with the posting
+    // list instead of a new search over the whole posting lists.
     void
-    refine_and_collect(const SparseRow<DType>& query, MaxMinHeap<float>& inacc_heap, size_t k, float* distances,
-                       label_t* labels, const DocValueComputer<float>& computer,
-                       InvertedIndexApproxSearchParams& approx_params) const {
+    refine_and_collect(const Snapshot& s, const SparseRow<DType>& query, MaxMinHeap<float>& inacc_heap, size_t k,
+                       float* distances, label_t* labels, const DocValueComputer<float>& computer) const {
         std::vector<table_t> docids;
         MaxMinHeap<float> heap(k);
 
@@ -1260,21 +1386,31 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
             docids.emplace_back(u);
         }
 
-        auto q_vec = parse_query(query, 0);
+        auto q_vec = parse_query(s, query, 0);
         if (q_vec.empty()) {
             return;
         }
 
-        // dim_max_score_ratio for refine process should be >= 1.0
-        float dim_max_score_ratio = std::max(approx_params.dim_max_score_ratio, 1.0f);
+        std::sort(docids.begin(), docids.end());
+        std::vector<float> scores(docids.size(), 0.0f);
+        std::vector<uint32_t> docid_pos(docids.size());
+        std::vector<uint32_t> plist_pos(docids.size());
+        for (const auto& [dim_id, q_val] : q_vec) {
+            const auto& plist_ids = s.ids_spans[dim_id];
+            const auto& plist_vals = s.vals_spans[dim_id];
+            const size_t n = faiss::u32_sorted_intersect(docids.data(), docids.size(), plist_ids.data(),
+                                                         plist_ids.size(), docid_pos.data(), plist_pos.data());
+            for (size_t i = 0; i < n; ++i) {
+                const auto doc_id = docids[docid_pos[i]];
+                float val_sum = metric_type_ == SparseMetricType::METRIC_BM25 ? s.row_sums[doc_id] : 0;
+                scores[docid_pos[i]] += q_val * computer(plist_vals[plist_pos[i]], val_sum);
+            }
+        }
 
-        DocIdFilterByVector filter(std::move(docids));
-        if constexpr (algo == InvertedIndexAlgo::DAAT_WAND) {
-            search_daat_wand(q_vec, heap, filter, computer, dim_max_score_ratio);
-        } else if constexpr (algo == InvertedIndexAlgo::DAAT_MAXSCORE) {
-            search_daat_maxscore(q_vec, heap, filter, computer, dim_max_score_ratio);
-        } else {
-            search_taat_naive(q_vec, heap, filter, computer);
+        for (size_t i = 0; i < docids.size(); ++i) {
+            if (scores[i] != 0) {
+                heap.push(docids[i], scores[i]);
+            }
         }
         collect_result(heap, distances, labels);
     }
@@ -1291,7 +1427,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
     }
 
     inline void
-    add_row_to_index(const SparseRow<DType>& row, table_t vec_id) {
+    add_row_to_index(const SparseRow<DType>& row, table_t vec_id, const Snapshot& published) {
         [[maybe_unused]] float row_sum = 0;
         for (size_t j = 0; j < row.size(); ++j) {
             auto [dim, val] = row[j];
@@ -1303,20 +1439,26 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
             if (val == 0) {
                 continue;
             }
-            auto dim_it = dim_map_.find(dim);
-            if (dim_it == dim_map_.cend()) {
+            auto dim_it = dim_map_->find(dim);
+            if (dim_it == dim_map_->cend()) {
                 if constexpr (mmapped) {
                     throw std::runtime_error("unexpected vector dimension in mmapped InvertedIndex");
                 }
-                dim_it = dim_map_.insert({dim, next_dim_id_++}).first;
+                if (dim_map_ == published.dim_map) {
+                    // searches on the published snapshot are looking up this map
+                    dim_map_ = std::make_shared<std::unordered_map<table_t, uint32_t>>(*dim_map_);
+                }
+                dim_it = dim_map_->insert({dim, next_dim_id_++}).first;
                 inverted_index_ids_.emplace_back();
                 inverted_index_vals_.emplace_back();
                 if constexpr (algo == InvertedIndexAlgo::DAAT_WAND || algo == InvertedIndexAlgo::DAAT_MAXSCORE) {
-                    max_score_in_dim_.emplace_back(0.0f);
+                    append_published(max_score_in_dim_, 0.0f, published.max_score_in_dim.data());
                 }
             }
-            inverted_index_ids_[dim_it->second].emplace_back(vec_id);
-            inverted_index_vals_[dim_it->second].emplace_back(get_quant_val(val));
+            const auto dim_id = dim_it->second;
+            append_published(inverted_index_ids_[dim_id], vec_id, published_data(published.ids_spans, dim_id));
+            append_published(inverted_index_vals_[dim_id], get_quant_val(val),
+                             published_data(published.vals_spans, dim_id));
         }
 #if defined(NOT_COMPILE_FOR_SWIG) && !defined(KNOWHERE_WITH_LIGHT)
         build_stats_.dataset_nnz_stats_.push_back(row.size());
@@ -1328,8 +1470,8 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
                 if (val == 0) {
                     continue;
                 }
-                auto dim_it = dim_map_.find(dim);
-                if (dim_it == dim_map_.cend()) {
+                auto dim_it = dim_map_->find(dim);
+                if (dim_it == dim_map_->cend()) {
                     throw std::runtime_error("unexpected vector dimension in InvertedIndex");
                 }
                 auto score = static_cast<float>(val);
@@ -1340,7 +1482,7 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
             }
         }
         if (metric_type_ == SparseMetricType::METRIC_BM25) {
-            bm25_params_->row_sums.emplace_back(row_sum);
+            append_published(bm25_params_->row_sums, row_sum, published.row_sums.data());
         }
     }
 
@@ -1360,17 +1502,20 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         }
     }
 
-    // key is raw sparse vector dim/idx, value is the mapped dim/idx id in the index.
-    std::unordered_map<table_t, uint32_t> dim_map_;
+    // key is raw sparse vector dim/idx, value is the mapped dim/idx id in the index. Shared with the published
+    // snapshots and copied before a new dim is inserted.
+    std::shared_ptr<std::unordered_map<table_t, uint32_t>> dim_map_ =
+        std::make_shared<std::unordered_map<table_t, uint32_t>>();
     uint32_t nr_inner_dims_ = 0;
 
     // reserve, [], size, emplace_back
     Vector<Vector<table_t>> inverted_index_ids_;
     Vector<Vector<QType>> inverted_index_vals_;
-    std::vector<boost::span<const table_t>> inverted_index_ids_spans_;
-    std::vector<boost::span<const QType>> inverted_index_vals_spans_;
     Vector<float> max_score_in_dim_;
-    boost::span<const float> max_score_in_dim_spans_;
+
+    std::shared_ptr<const Snapshot> snapshot_ = std::make_shared<const Snapshot>();
+    // buffers replaced by the current Add that the published snapshot may still read, see publish().
+    std::vector<std::shared_ptr<void>> retired_;
 
     SparseMetricType metric_type_;
 
@@ -1388,7 +1533,6 @@ class InvertedIndex : public BaseInvertedIndex<DType> {
         // row_sums is used to cache the sum of values of each row, which
         // corresponds to the document length of each doc in the BM25 formula.
         Vector<float> row_sums;
-        boost::span<const float> row_sums_spans_;
 
         DocValueComputer<float> max_score_computer;
 
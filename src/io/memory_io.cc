@@ -47,6 +47,20 @@ MemoryIOWriter::operator()(const void* ptr, size_t size, size_t nitems) {
     return nitems;
 }
 
+void
+MemoryIOWriter::reserve(size_t capacity) {
+    if (capacity <= total_) {
+        return;
+    }
+    auto new_data = new uint8_t[capacity];
+    if (data_) {
+        memcpy(new_data, data_, rp_);
+        delete[] data_;
+    }
+    data_ = new_data;
+    total_ = capacity;
+}
+
 size_t
 MemoryIOReader::operator()(void* ptr, size_t size, size_t nitems) {
     if (rp_ >= total_) {
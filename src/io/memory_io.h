@@ -11,7 +11,14 @@
 
 #pragma once
 
+#include <faiss/cppcontrib/knowhere/impl/CountSizeIOWriter.h>
 #include <faiss/impl/io.h>
+#include <faiss/impl/maybe_owned_vector.h>
+
+#include <memory>
+#include <utility>
+
+#include "knowhere/expected.h"
 
 namespace knowhere {
 
@@ -79,6 +86,10 @@ struct MemoryIOWriter : public faiss::IOWriter {
     size_t
     operator()(const void* ptr, size_t size, size_t nitems) override;
 
+    // allocates the buffer up front, writes that fit in it never reallocate
+    void
+    reserve(size_t capacity);
+
     template <typename T>
     size_t
     write(T* ptr, size_t size, size_t nitems = 1) {
@@ -162,4 +173,45 @@ struct MemoryIOReader : public faiss::IOReader {
     }
 };
 
+// Runs write_func twice, first over a CountSizeIOWriter and then over a buffer allocated once with the exact size. The
+// growing MemoryIOWriter reallocates and copies on the way and may hold up to twice the serialized size at its peak,
+// this one holds it once. write_func is called with both writers and returns a Status, faiss exceptions go through.
+template <typename WriteFunc>
+Status
+SerializeSized(WriteFunc&& write_func, std::shared_ptr<uint8_t[]>& data, size_t& size) {
+    faiss::cppcontrib::knowhere::CountSizeIOWriter counter;
+    RETURN_IF_ERROR(write_func(counter));
+    MemoryIOWriter writer;
+    writer.reserve(counter.total_size);
+    auto status = write_func(writer);
+    data.reset(writer.data());
+    if (status != Status::success) {
+        return status;
+    }
+    size = writer.tellg();
+    return Status::success;
+}
+
+// Copies faiss storage that is viewed in place, over a Binary or a mapped file, into memory the index owns, so that it
+// can grow again. write_func writes the index as for SerializeSized, read_func reads it back from a MemoryIOReader,
+// which copies everything it reads. Both return a Status, faiss exceptions go through.
+template <typename WriteFunc, typename ReadFunc>
+Status
+CopyViewedStorage(WriteFunc&& write_func, ReadFunc&& read_func) {
+    std::shared_ptr<uint8_t[]> data;
+    size_t size = 0;
+    RETURN_IF_ERROR(SerializeSized(std::forward<WriteFunc>(write_func), data, size));
+    MemoryIOReader reader(data.get(), size);
+    return read_func(reader);
+}
+
+// Keeps the buffer of a Binary alive for as long as faiss storage loaded over it with a faiss::ZeroCopyIOReader
+// views it. Vectors, codes, inverted lists and graph links are then read in place instead of being copied out.
+struct BinaryViewOwner : public faiss::MaybeOwnedVectorOwner {
+    explicit BinaryViewOwner(std::shared_ptr<uint8_t[]> data) : data_(std::move(data)) {
+    }
+
+    std::shared_ptr<uint8_t[]> data_;
+};
+
 }  // namespace knowhere
@@ -0,0 +1,255 @@
+// Copyright (C) 2019-2025 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#if defined(__x86_64__)
+
+#include "distances_amx.h"
+
+#include <immintrin.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace faiss {
+
+namespace {
+
+// AMX tiles are at most 16 rows of 64 bytes. Both TDPBF16PS and TDPBSSD consume the
+// reduction dimension in 4-byte groups (2 x bf16 or 4 x int8), so a tile row always
+// holds 16 groups. All the packing below is expressed in these 4-byte groups.
+constexpr size_t kTileRows = 16;
+constexpr size_t kTileGroups = 16;
+// every block is computed as 2 x 2 tiles, i.e. 32 x-vectors times 32 y-vectors
+constexpr size_t kBlock = 2 * kTileRows;
+
+struct alignas(64) TileConfig {
+    uint8_t palette_id;
+    uint8_t start_row;
+    uint8_t reserved[14];
+    uint16_t colsb[16];
+    uint8_t rows[16];
+};
+
+void
+load_tile_config() {
+    TileConfig cfg;
+    std::memset(&cfg, 0, sizeof(cfg));
+    cfg.palette_id = 1;
+    // tmm0..tmm3: accumulators, tmm4..tmm5: x tiles, tmm6..tmm7: y tiles
+    for (int i = 0; i < 8; i++) {
+        cfg.rows[i] = kTileRows;
+        cfg.colsb[i] = kTileGroups * sizeof(uint32_t);
+    }
+    _tile_loadconfig(&cfg);
+}
+
+inline uint32_t
+fp32_pair_to_bf16_group(const float a, const float b) {
+    return (fp32_to_bits(bf16_float(a)) >> 16) | (fp32_to_bits(bf16_float(b)) & 0xFFFF0000);
+}
+
+// pack rows [0, n) of a row-major matrix into `dst`, n_pad rows x k_groups groups, zero padded.
+// With `residual`, float rows are packed as the bf16 rounding of what bf16 leaves out, x - bf16(x), so that a
+// product with the plain and the residual packing of x adds up to x in fp32 times the other side in bf16.
+template <typename T, bool residual = false>
+void
+pack_rows(uint32_t* dst, const T* src, size_t d, size_t n, size_t n_pad, size_t k_groups) {
+    std::memset(dst, 0, n_pad * k_groups * sizeof(uint32_t));
+    for (size_t i = 0; i < n; i++) {
+        uint32_t* row = dst + i * k_groups;
+        if constexpr (std::is_same_v<T, float>) {
+            const float* x = src + i * d;
+            auto value = [x](size_t j) { return residual ? x[j] - bf16_float(x[j]) : x[j]; };
+            size_t j = 0;
+            for (; j + 2 <= d; j += 2) {
+                row[j / 2] = fp32_pair_to_bf16_group(value(j), value(j + 1));
+            }
+            if (j < d) {
+                row[j / 2] = fp32_pair_to_bf16_group(value(j), 0.0f);
+            }
+        } else {
+            std::memcpy(row, src + i * d, d * sizeof(T));
+        }
+    }
+}
+
+// re-layout a block of packed y rows into the VNNI form expected by the B operand:
+// for every k-step, 16 rows (one per group) of 16 columns (one per y-vector).
+void
+pack_vnni(uint32_t* dst, const uint32_t* rows, size_t k_groups) {
+    const size_t k_steps = k_groups / kTileGroups;
+    for (size_t half = 0; half < 2; half++) {
+        const uint32_t* src = rows + half * kTileRows * k_groups;
+        uint32_t* out = dst + half * k_groups * kTileRows;
+        for (size_t s = 0; s < k_steps; s++) {
+            for (size_t g = 0; g < kTileGroups; g++) {
+                for (size_t n = 0; n < kTileRows; n++) {
+                    out[(s * kTileGroups + g) * kTileRows + n] = src[n * k_groups + s * kTileGroups + g];
+                }
+            }
+        }
+    }
+}
+
+// a_lo is the residual packing of the a rows, or nullptr if a is only taken at bf16 precision
+template <bool is_int8>
+void
+compute_block(const uint32_t* a, const uint32_t* a_lo, const uint32_t* b, size_t k_groups, void* c) {
+    const size_t a_stride = k_groups * sizeof(uint32_t);
+    const size_t b_stride = kTileRows * sizeof(uint32_t);
+    const size_t k_steps = k_groups / kTileGroups;
+    const uint32_t* b1 = b + k_groups * kTileRows;
+
+    _tile_zero(0);
+    _tile_zero(1);
+    _tile_zero(2);
+    _tile_zero(3);
+    for (size_t s = 0; s < k_steps; s++) {
+        _tile_loadd(4, a + s * kTileGroups, a_stride);
+        _tile_loadd(5, a + kTileRows * k_groups + s * kTileGroups, a_stride);
+        _tile_loadd(6, b + s * kTileGroups * kTileRows, b_stride);
+        _tile_loadd(7, b1 + s * kTileGroups * kTileRows, b_stride);
+        if constexpr (is_int8) {
+            _tile_dpbssd(0, 4, 6);
+            _tile_dpbssd(1, 4, 7);
+            _tile_dpbssd(2, 5, 6);
+            _tile_dpbssd(3, 5, 7);
+        } else {
+            _tile_dpbf16ps(0, 4, 6);
+            _tile_dpbf16ps(1, 4, 7);
+            _tile_dpbf16ps(2, 5, 6);
+            _tile_dpbf16ps(3, 5, 7);
+            if (a_lo != nullptr) {
+                _tile_loadd(4, a_lo + s * kTileGroups, a_stride);
+                _tile_loadd(5, a_lo + kTileRows * k_groups + s * kTileGroups, a_stride);
+                _tile_dpbf16ps(0, 4, 6);
+                _tile_dpbf16ps(1, 4, 7);
+                _tile_dpbf16ps(2, 5, 6);
+                _tile_dpbf16ps(3, 5, 7);
+            }
+        }
+    }
+    // c is a 32 x 32 block of 4-byte values
+    char* out = (char*)c;
+    const size_t c_stride = kBlock * 4;
+    _tile_stored(0, out, c_stride);
+    _tile_stored(1, out + kTileRows * 4, c_stride);
+    _tile_stored(2, out + kTileRows * c_stride, c_stride);
+    _tile_stored(3, out + kTileRows * c_stride + kTileRows * 4, c_stride);
+}
+
+// with split_x, the fp32 x rows are taken as the sum of two bf16 rows, which keeps x at about 16 bits of mantissa
+// while y is rounded to bf16, the same as the fp32-as-bf16 patch kernels
+template <typename T, bool split_x = false>
+void
+inner_products_batch_amx(float* dis, const T* x, const T* y, size_t d, size_t nx, size_t ny) {
+    if (nx == 0 || ny == 0) {
+        return;
+    }
+    constexpr bool is_int8 = std::is_same_v<T, int8_t>;
+    // number of 4-byte groups per vector, padded to a full tile row
+    const size_t d_bytes = std::is_same_v<T, float> ? d * 2 : d * sizeof(T);
+    const size_t k_groups = (d_bytes + 4 * kTileGroups - 1) / (4 * kTileGroups) * kTileGroups;
+    const size_t nx_pad = (nx + kBlock - 1) / kBlock * kBlock;
+
+    thread_local std::vector<uint32_t> x_buf;
+    thread_local std::vector<uint32_t> x_lo_buf;
+    thread_local std::vector<uint32_t> y_rows;
+    thread_local std::vector<uint32_t> y_vnni;
+    x_buf.resize(nx_pad * k_groups);
+    y_rows.resize(kBlock * k_groups);
+    y_vnni.resize(kBlock * k_groups);
+    alignas(64) uint32_t c_buf[kBlock * kBlock];
+
+    pack_rows(x_buf.data(), x, d, nx, nx_pad, k_groups);
+    if constexpr (split_x) {
+        x_lo_buf.resize(nx_pad * k_groups);
+        pack_rows<T, true>(x_lo_buf.data(), x, d, nx, nx_pad, k_groups);
+    }
+
+    load_tile_config();
+    for (size_t j0 = 0; j0 < ny; j0 += kBlock) {
+        const size_t nj = std::min(kBlock, ny - j0);
+        pack_rows(y_rows.data(), y + j0 * d, d, nj, kBlock, k_groups);
+        pack_vnni(y_vnni.data(), y_rows.data(), k_groups);
+        for (size_t i0 = 0; i0 < nx; i0 += kBlock) {
+            const size_t ni = std::min(kBlock, nx - i0);
+            const uint32_t* x_lo = split_x ? x_lo_buf.data() + i0 * k_groups : nullptr;
+            compute_block<is_int8>(x_buf.data() + i0 * k_groups, x_lo, y_vnni.data(), k_groups, c_buf);
+            for (size_t i = 0; i < ni; i++) {
+                float* out = dis + (i0 + i) * ny + j0;
+                if constexpr (is_int8) {
+                    const int32_t* c = (const int32_t*)c_buf + i * kBlock;
+                    for (size_t j = 0; j < nj; j++) {
+                        out[j] = (float)c[j];
+                    }
+                } else {
+                    std::memcpy(out, (const float*)c_buf + i * kBlock, nj * sizeof(float));
+                }
+            }
+        }
+    }
+    _tile_release();
+}
+
+}  // namespace
+
+bool
+amx_request_tile_permission() {
+#if defined(__linux__)
+    constexpr int ARCH_GET_XCOMP_PERM = 0x1022;
+    constexpr int ARCH_REQ_XCOMP_PERM = 0x1023;
+    constexpr int XFEATURE_XTILEDATA = 18;
+    // the permission is granted to the whole process, so this only needs to succeed once
+    if (syscall(SYS_arch_prctl, ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA) != 0) {
+        return false;
+    }
+    unsigned long bitmask = 0;
+    if (syscall(SYS_arch_prctl, ARCH_GET_XCOMP_PERM, &bitmask) != 0) {
+        return false;
+    }
+    return (bitmask & (1UL << XFEATURE_XTILEDATA)) != 0;
+#else
+    return false;
+#endif
+}
+
+void
+fvec_inner_products_batch_amx(float* dis, const float* x, const float* y, size_t d, size_t nx, size_t ny) {
+    inner_products_batch_amx<float, true>(dis, x, y, d, nx, ny);
+}
+
+void
+fvec_inner_products_batch_bf16_amx(float* dis, const float* x, const float* y, size_t d, size_t nx, size_t ny) {
+    inner_products_batch_amx<float>(dis, x, y, d, nx, ny);
+}
+
+void
+bf16_vec_inner_products_batch_amx(float* dis, const knowhere::bf16* x, const knowhere::bf16* y, size_t d, size_t nx,
+                                  size_t ny) {
+    inner_products_batch_amx<uint16_t>(dis, (const uint16_t*)x, (const uint16_t*)y, d, nx, ny);
+}
+
+void
+int8_vec_inner_products_batch_amx(float* dis, const int8_t* x, const int8_t* y, size_t d, size_t nx, size_t ny) {
+    inner_products_batch_amx<int8_t>(dis, x, y, d, nx, ny);
+}
+
+}  // namespace faiss
+
+#endif
@@ -0,0 +1,44 @@
+// Copyright (C) 2019-2025 Zilliz. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License"); you may not use this file except in compliance
+// with the License. You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software distributed under the License
+// is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+// or implied. See the License for the specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "knowhere/operands.h"
+
+namespace faiss {
+
+/// ask the kernel for the permission to use the AMX tile data state (arch_prctl).
+/// return false if the kernel refuses, in which case no AMX instruction can be issued.
+bool
+amx_request_tile_permission();
+
+///////////////////////////////////////////////////////////////////////////////
+// batched inner products, dis[i * ny + j] = <x_i, y_j>
+
+// y is rounded to bf16 while x keeps about 16 bits of mantissa, as in the fp32-as-bf16 patch kernels
+void
+fvec_inner_products_batch_amx(float* dis, const float* x, const float* y, size_t d, size_t nx, size_t ny);
+
+// both x and y are rounded to bf16, see kBf16InnerProductRelError
+void
+fvec_inner_products_batch_bf16_amx(float* dis, const float* x, const float* y, size_t d, size_t nx, size_t ny);
+
+void
+bf16_vec_inner_products_batch_amx(float* dis, const knowhere::bf16* x, const knowhere::bf16* y, size_t d, size_t nx,
+                                  size_t ny);
+
+void
+int8_vec_inner_products_batch_amx(float* dis, const int8_t* x, const int8_t* y, size_t d, size_t nx, size_t ny);
+
+}  // namespace faiss
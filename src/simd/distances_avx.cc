@@ -15,7 +15,10 @@
 
 #include <immintrin.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <type_traits>
 
 #include "faiss/impl/platform_macros.h"
 #include "xxhash.h"
@@ -966,6 +969,132 @@ int8_vec_L2sqr_batch_4_avx(const int8_t* x, const int8_t* y0, const int8_t* y1,
 }
 FAISS_PRAGMA_IMPRECISE_FUNCTION_END
 
+///////////////////////////////////////////////////////////////////////////////
+// ny by ids
+
+namespace {
+
+// number of bytes of every upcoming vector to prefetch, the rest is left to the hardware prefetcher
+constexpr size_t kByIdsPrefetchBytes = 256;
+
+inline void
+prefetch_by_ids(const float* y, const int64_t* ids, size_t n, size_t d) {
+    const size_t bytes = std::min(d * sizeof(float), kByIdsPrefetchBytes);
+    for (size_t j = 0; j < n; j++) {
+        const char* p = (const char*)(y + ids[j] * d);
+        for (size_t b = 0; b < bytes; b += 64) {
+            _mm_prefetch(p + b, _MM_HINT_T0);
+        }
+    }
+}
+
+// loads 8 elements, rounded to bf16 under the fp32-as-bf16 patch
+template <bool bf16_patch = false>
+inline __m256
+load_fp32x8(const float* p) {
+    const __m256 v = _mm256_loadu_ps(p);
+    if constexpr (bf16_patch) {
+        // same rounding as bf16_float()
+        const __m256i bits = _mm256_add_epi32(_mm256_castps_si256(v), _mm256_set1_epi32(0x8000));
+        return _mm256_castsi256_ps(_mm256_and_si256(bits, _mm256_set1_epi32(0xFFFF0000)));
+    } else {
+        return v;
+    }
+}
+
+// computes B distances at once, keeping B accumulators in registers and loading x only once per step
+template <size_t B, bool is_l2, bool bf16_patch>
+inline void
+ny_by_ids_block(float* dis, const float* x, const float* y, const int64_t* ids, size_t d) {
+    __m256 acc[B];
+    const float* yb[B];
+    for (size_t b = 0; b < B; b++) {
+        acc[b] = _mm256_setzero_ps();
+        yb[b] = y + ids[b] * d;
+    }
+    auto step = [&](const float* xp, const float* const* yp) {
+        const __m256 mx = load_fp32x8(xp);
+        for (size_t b = 0; b < B; b++) {
+            const __m256 my = load_fp32x8<bf16_patch>(yp[b]);
+            if constexpr (is_l2) {
+                const __m256 diff = _mm256_sub_ps(mx, my);
+                acc[b] = _mm256_fmadd_ps(diff, diff, acc[b]);
+            } else {
+                acc[b] = _mm256_fmadd_ps(mx, my, acc[b]);
+            }
+        }
+    };
+    const size_t d8 = d / 8 * 8;
+    for (size_t i = 0; i < d8; i += 8) {
+        const float* yp[B];
+        for (size_t b = 0; b < B; b++) {
+            yp[b] = yb[b] + i;
+        }
+        step(x + i, yp);
+    }
+    if (d8 < d) {
+        // zero padded tails, zeros do not change neither ip nor l2
+        float x_tail[8] = {};
+        float y_tail[B][8] = {};
+        const float* yp[B];
+        std::memcpy(x_tail, x + d8, (d - d8) * sizeof(float));
+        for (size_t b = 0; b < B; b++) {
+            std::memcpy(y_tail[b], yb[b] + d8, (d - d8) * sizeof(float));
+            yp[b] = y_tail[b];
+        }
+        step(x_tail, yp);
+    }
+    for (size_t b = 0; b < B; b++) {
+        dis[b] = _mm256_reduce_add_ps(acc[b]);
+    }
+}
+
+// avx2 has 16 ymm registers, so at most 8 distances are computed at once
+template <bool is_l2, bool bf16_patch = false>
+void
+ny_by_ids(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    auto block = [&](auto b_tag, size_t j) {
+        ny_by_ids_block<decltype(b_tag)::value, is_l2, bf16_patch>(dis + j, x, y, ids + j, d);
+    };
+    prefetch_by_ids(y, ids, std::min<size_t>(ny, 8), d);
+    size_t j = 0;
+    for (; j + 8 <= ny; j += 8) {
+        prefetch_by_ids(y, ids + j + 8, std::min<size_t>(ny - j - 8, 8), d);
+        block(std::integral_constant<size_t, 8>{}, j);
+    }
+    if (j + 4 <= ny) {
+        block(std::integral_constant<size_t, 4>{}, j);
+        j += 4;
+    }
+    for (; j < ny; j++) {
+        block(std::integral_constant<size_t, 1>{}, j);
+    }
+}
+
+}  // namespace
+
+void
+fvec_inner_products_ny_by_ids_avx(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    ny_by_ids<false>(dis, x, y, ids, d, ny);
+}
+
+void
+fvec_L2sqr_ny_by_ids_avx(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    ny_by_ids<true>(dis, x, y, ids, d, ny);
+}
+
+void
+fvec_inner_products_ny_by_ids_bf16_patch_avx(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                             size_t ny) {
+    ny_by_ids<false, true>(dis, x, y, ids, d, ny);
+}
+
+void
+fvec_L2sqr_ny_by_ids_bf16_patch_avx(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                    size_t ny) {
+    ny_by_ids<true, true>(dis, x, y, ids, d, ny);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // for cardinal
 
@@ -1145,5 +1274,153 @@ calculate_hash_avx2(const char* data, size_t size) {
     return XXH3_64bits(data, size);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// sparse
+
+namespace {
+
+// Same block intersection as in distances_avx512.cc, with blocks of 8 ids.
+// A block of x is compared against the 8 rotations of a block of y, then the
+// block with the smaller maximum is advanced. The payload of each id is the
+// value of a sparse row, or the position for plain id lists.
+
+// loads up to 8 (index, value) pairs of a packed sparse row. The lanes come out
+// in the order 0, 1, 4, 5, 2, 3, 6, 7 for both ids and values.
+inline void
+load_sparse_block(const char* row, size_t count, __m256i& ids, __m256& vals, __m256i& valid) {
+    const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+    const int count_lo = (int)std::min<size_t>(count, 4);
+    const int count_hi = (int)count - count_lo;
+    const __m256i mask_lo = _mm256_cmpgt_epi32(_mm256_set1_epi32(2 * count_lo), iota);
+    const __m256i mask_hi = _mm256_cmpgt_epi32(_mm256_set1_epi32(2 * count_hi), iota);
+    const __m256 lo = _mm256_castsi256_ps(_mm256_maskload_epi32((const int*)row, mask_lo));
+    const __m256 hi = _mm256_castsi256_ps(_mm256_maskload_epi32((const int*)(row + 32), mask_hi));
+    ids = _mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+    vals = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    valid = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)count), order);
+}
+
+// loads up to 8 ids, the payload is the position of each id
+inline void
+load_u32_block(const uint32_t* data, size_t offset, size_t count, __m256i& ids, __m256& vals, __m256i& valid) {
+    const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    valid = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)count), iota);
+    ids = _mm256_maskload_epi32((const int*)(data + offset), valid);
+    vals = _mm256_castsi256_ps(_mm256_add_epi32(iota, _mm256_set1_epi32((int)offset)));
+}
+
+template <typename Loader, typename IdAt, typename Sink>
+inline void
+intersect_blocks_avx(size_t nx, size_t ny, Loader load, IdAt id_at, Sink&& sink) {
+    const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+    size_t i = 0;
+    size_t j = 0;
+    while (i < nx && j < ny) {
+        const size_t cx = std::min<size_t>(nx - i, 8);
+        const size_t cy = std::min<size_t>(ny - j, 8);
+        const uint32_t x_min = id_at(true, i);
+        const uint32_t x_max = id_at(true, i + cx - 1);
+        const uint32_t y_min = id_at(false, j);
+        const uint32_t y_max = id_at(false, j + cy - 1);
+
+        // skip the comparison if the ranges of the blocks do not overlap
+        if (x_max >= y_min && y_max >= x_min) {
+            __m256i x_ids, y_ids, x_valid, y_valid;
+            __m256 x_vals, y_vals;
+            load(true, i, cx, x_ids, x_vals, x_valid);
+            load(false, j, cy, y_ids, y_vals, y_valid);
+            for (size_t r = 0; r < 8; r++) {
+                // lanes past the end of a partial block never match
+                const __m256i valid = _mm256_and_si256(x_valid, y_valid);
+                const __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi32(x_ids, y_ids), valid);
+                const int m = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+                if (m != 0) {
+                    sink(m, _mm256_castsi256_ps(eq), x_vals, y_vals);
+                }
+                y_ids = _mm256_permutevar8x32_epi32(y_ids, rotate);
+                y_vals = _mm256_permutevar8x32_ps(y_vals, rotate);
+                y_valid = _mm256_permutevar8x32_epi32(y_valid, rotate);
+            }
+        }
+
+        if (x_max <= y_max) {
+            i += cx;
+        }
+        if (y_max <= x_max) {
+            j += cy;
+        }
+    }
+}
+
+inline uint32_t
+sparse_id_at(const char* row, size_t i) {
+    uint32_t id;
+    std::memcpy(&id, row + i * 8, sizeof(id));
+    return id;
+}
+
+template <typename Sink>
+inline void
+sparse_intersect_avx(const char* x, size_t nx, const char* y, size_t ny, Sink&& sink) {
+    auto load = [&](bool is_x, size_t offset, size_t count, __m256i& ids, __m256& vals, __m256i& valid) {
+        load_sparse_block((is_x ? x : y) + offset * 8, count, ids, vals, valid);
+    };
+    auto id_at = [&](bool is_x, size_t offset) { return sparse_id_at(is_x ? x : y, offset); };
+    intersect_blocks_avx(nx, ny, load, id_at, sink);
+}
+
+// stores the payloads of the matched lanes
+template <typename T>
+inline size_t
+compress_store(int m, __m256 xv, __m256 yv, T* x_out, T* y_out) {
+    ALIGNED(32) T x_buf[8];
+    ALIGNED(32) T y_buf[8];
+    _mm256_store_ps((float*)x_buf, xv);
+    _mm256_store_ps((float*)y_buf, yv);
+    size_t n = 0;
+    while (m != 0) {
+        const int lane = __builtin_ctz(m);
+        x_out[n] = x_buf[lane];
+        y_out[n] = y_buf[lane];
+        n++;
+        m &= m - 1;
+    }
+    return n;
+}
+
+}  // namespace
+
+float
+sparse_inner_product_avx(const char* x, size_t nx, const char* y, size_t ny) {
+    __m256 acc = _mm256_setzero_ps();
+    sparse_intersect_avx(x, nx, y, ny, [&](int, __m256 eq, __m256 x_vals, __m256 y_vals) {
+        acc = _mm256_add_ps(acc, _mm256_and_ps(_mm256_mul_ps(x_vals, y_vals), eq));
+    });
+    return _mm256_reduce_add_ps(acc);
+}
+
+size_t
+sparse_intersect_values_avx(const char* x, size_t nx, const char* y, size_t ny, float* x_vals, float* y_vals) {
+    size_t n = 0;
+    sparse_intersect_avx(x, nx, y, ny, [&](int m, __m256, __m256 xv, __m256 yv) {
+        n += compress_store(m, xv, yv, x_vals + n, y_vals + n);
+    });
+    return n;
+}
+
+size_t
+u32_sorted_intersect_avx(const uint32_t* x, size_t nx, const uint32_t* y, size_t ny, uint32_t* x_pos, uint32_t* y_pos) {
+    auto load = [&](bool is_x, size_t offset, size_t count, __m256i& ids, __m256& vals, __m256i& valid) {
+        load_u32_block(is_x ? x : y, offset, count, ids, vals, valid);
+    };
+    auto id_at = [&](bool is_x, size_t offset) { return is_x ? x[offset] : y[offset]; };
+    size_t n = 0;
+    intersect_blocks_avx(nx, ny, load, id_at, [&](int m, __m256, __m256 xv, __m256 yv) {
+        n += compress_store(m, xv, yv, x_pos + n, y_pos + n);
+    });
+    return n;
+}
+
 }  // namespace faiss
 #endif
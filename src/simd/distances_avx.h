@@ -127,6 +127,22 @@ void
 int8_vec_L2sqr_batch_4_avx(const int8_t* x, const int8_t* y0, const int8_t* y1, const int8_t* y2, const int8_t* y3,
                            const size_t d, float& dis0, float& dis1, float& dis2, float& dis3);
 
+///////////////////////////////////////////////////////////////////////////////
+// ny by ids
+void
+fvec_inner_products_ny_by_ids_avx(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny);
+
+void
+fvec_L2sqr_ny_by_ids_avx(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny);
+
+void
+fvec_inner_products_ny_by_ids_bf16_patch_avx(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                             size_t ny);
+
+void
+fvec_L2sqr_ny_by_ids_bf16_patch_avx(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                    size_t ny);
+
 ///////////////////////////////////////////////////////////////////////////////
 // for cardinal
 
@@ -157,4 +173,13 @@ rabitq_dp_popcnt_avx(const uint8_t* q, const uint8_t* x, const size_t d, const s
 uint64_t
 calculate_hash_avx2(const char* data, size_t size);
 
+///////////////////////////////////////////////////////////////////////////////
+// sparse
+float
+sparse_inner_product_avx(const char* x, size_t nx, const char* y, size_t ny);
+size_t
+sparse_intersect_values_avx(const char* x, size_t nx, const char* y, size_t ny, float* x_vals, float* y_vals);
+size_t
+u32_sorted_intersect_avx(const uint32_t* x, size_t nx, const uint32_t* y, size_t ny, uint32_t* x_pos, uint32_t* y_pos);
+
 }  // namespace faiss
@@ -15,10 +15,13 @@
 
 #include <immintrin.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <type_traits>
 
 #include "faiss/impl/platform_macros.h"
 #include "xxhash.h"
@@ -849,6 +852,117 @@ fvec_L2sqr_batch_4_bf16_patch_avx512(const float* x, const float* y0, const floa
 }
 FAISS_PRAGMA_IMPRECISE_FUNCTION_END
 
+///////////////////////////////////////////////////////////////////////////////
+// ny by ids
+
+namespace {
+
+// number of bytes of every upcoming vector to prefetch, the rest is left to the hardware prefetcher
+constexpr size_t kByIdsPrefetchBytes = 256;
+
+inline void
+prefetch_by_ids(const float* y, const int64_t* ids, size_t n, size_t d) {
+    const size_t bytes = std::min(d * sizeof(float), kByIdsPrefetchBytes);
+    for (size_t j = 0; j < n; j++) {
+        const char* p = (const char*)(y + ids[j] * d);
+        for (size_t b = 0; b < bytes; b += 64) {
+            _mm_prefetch(p + b, _MM_HINT_T0);
+        }
+    }
+}
+
+// loads (up to) 16 elements, rounded to bf16 under the fp32-as-bf16 patch
+template <bool bf16_patch = false>
+inline __m512
+load_fp32x16(const __mmask16 mask, const float* p) {
+    const __m512 v = _mm512_maskz_loadu_ps(mask, p);
+    if constexpr (bf16_patch) {
+        // same rounding as bf16_float()
+        const __m512i bits = _mm512_add_epi32(_mm512_castps_si512(v), _mm512_set1_epi32(0x8000));
+        return _mm512_castsi512_ps(_mm512_and_si512(bits, _mm512_set1_epi32(0xFFFF0000)));
+    } else {
+        return v;
+    }
+}
+
+// computes B distances at once, keeping B accumulators in registers and loading x only once per step
+template <size_t B, bool is_l2, bool bf16_patch>
+inline void
+ny_by_ids_block(float* dis, const float* x, const float* y, const int64_t* ids, size_t d) {
+    __m512 acc[B];
+    const float* yb[B];
+    for (size_t b = 0; b < B; b++) {
+        acc[b] = _mm512_setzero_ps();
+        yb[b] = y + ids[b] * d;
+    }
+    for (size_t i = 0; i < d; i += 16) {
+        const __mmask16 mask = (i + 16 <= d) ? (__mmask16)0xFFFF : (__mmask16)((1U << (d - i)) - 1U);
+        const __m512 mx = load_fp32x16(mask, x + i);
+        for (size_t b = 0; b < B; b++) {
+            const __m512 my = load_fp32x16<bf16_patch>(mask, yb[b] + i);
+            if constexpr (is_l2) {
+                const __m512 diff = _mm512_sub_ps(mx, my);
+                acc[b] = _mm512_fmadd_ps(diff, diff, acc[b]);
+            } else {
+                acc[b] = _mm512_fmadd_ps(mx, my, acc[b]);
+            }
+        }
+    }
+    for (size_t b = 0; b < B; b++) {
+        dis[b] = _mm512_reduce_add_ps(acc[b]);
+    }
+}
+
+template <bool is_l2, bool bf16_patch = false>
+void
+ny_by_ids(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    auto block = [&](auto b_tag, size_t j) {
+        ny_by_ids_block<decltype(b_tag)::value, is_l2, bf16_patch>(dis + j, x, y, ids + j, d);
+    };
+    prefetch_by_ids(y, ids, std::min<size_t>(ny, 16), d);
+    size_t j = 0;
+    for (; j + 16 <= ny; j += 16) {
+        prefetch_by_ids(y, ids + j + 16, std::min<size_t>(ny - j - 16, 16), d);
+        block(std::integral_constant<size_t, 16>{}, j);
+    }
+    if (j + 8 <= ny) {
+        block(std::integral_constant<size_t, 8>{}, j);
+        j += 8;
+    }
+    if (j + 4 <= ny) {
+        block(std::integral_constant<size_t, 4>{}, j);
+        j += 4;
+    }
+    for (; j < ny; j++) {
+        block(std::integral_constant<size_t, 1>{}, j);
+    }
+}
+
+}  // namespace
+
+void
+fvec_inner_products_ny_by_ids_avx512(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                     size_t ny) {
+    ny_by_ids<false>(dis, x, y, ids, d, ny);
+}
+
+void
+fvec_L2sqr_ny_by_ids_avx512(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    ny_by_ids<true>(dis, x, y, ids, d, ny);
+}
+
+void
+fvec_inner_products_ny_by_ids_bf16_patch_avx512(float* dis, const float* x, const float* y, const int64_t* ids,
+                                                size_t d, size_t ny) {
+    ny_by_ids<false, true>(dis, x, y, ids, d, ny);
+}
+
+void
+fvec_L2sqr_ny_by_ids_bf16_patch_avx512(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                       size_t ny) {
+    ny_by_ids<true, true>(dis, x, y, ids, d, ny);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // rabitq
 float
@@ -1208,5 +1322,138 @@ u64_jaccard_distance_batch_4_avx512(const char* x, const char* y0, const char* y
     dis2 = float(d2) / element_length;
     dis3 = float(d3) / element_length;
 }
+///////////////////////////////////////////////////////////////////////////////
+// sparse
+
+namespace {
+
+// Sorted set intersection by all-pairs block comparison: a block of 16 ids of x
+// is compared against the 16 rotations of a block of y, so every pair of the
+// two blocks is tested with 16 compares and no data dependent branches. Then
+// the block with the smaller maximum is advanced. Each id travels with a
+// payload (the value of a sparse row, or its position for plain id lists),
+// the sink consumes the payloads of the matched lanes.
+
+// loads up to 16 (index, value) pairs of a packed sparse row
+inline void
+load_sparse_block(const char* row, size_t count, __m512i& ids, __m512& vals) {
+    const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    const size_t count_lo = std::min<size_t>(count, 8);
+    const size_t count_hi = count - count_lo;
+    const __mmask16 mask_lo = (__mmask16)((1U << (2 * count_lo)) - 1U);
+    const __mmask16 mask_hi = (__mmask16)((1U << (2 * count_hi)) - 1U);
+    const __m512i lo = _mm512_maskz_loadu_epi32(mask_lo, row);
+    const __m512i hi = _mm512_maskz_loadu_epi32(mask_hi, row + 64);
+    ids = _mm512_permutex2var_epi32(lo, even, hi);
+    vals = _mm512_castsi512_ps(_mm512_permutex2var_epi32(lo, odd, hi));
+}
+
+// loads up to 16 ids, the payload is the position of each id
+inline void
+load_u32_block(const uint32_t* data, size_t offset, size_t count, __m512i& ids, __m512& vals) {
+    const __m512i iota = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    ids = _mm512_maskz_loadu_epi32((__mmask16)((1U << count) - 1U), data + offset);
+    vals = _mm512_castsi512_ps(_mm512_add_epi32(iota, _mm512_set1_epi32((int)offset)));
+}
+
+template <typename Loader, typename IdAt, typename Sink>
+inline void
+intersect_blocks_avx512(size_t nx, size_t ny, Loader load, IdAt id_at, Sink&& sink) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < nx && j < ny) {
+        const size_t cx = std::min<size_t>(nx - i, 16);
+        const size_t cy = std::min<size_t>(ny - j, 16);
+        const uint32_t x_min = id_at(true, i);
+        const uint32_t x_max = id_at(true, i + cx - 1);
+        const uint32_t y_min = id_at(false, j);
+        const uint32_t y_max = id_at(false, j + cy - 1);
+
+        // skip the comparison if the ranges of the blocks do not overlap
+        if (x_max >= y_min && y_max >= x_min) {
+            __m512i x_ids, y_ids;
+            __m512 x_vals, y_vals;
+            load(true, i, cx, x_ids, x_vals);
+            load(false, j, cy, y_ids, y_vals);
+            // lanes past the end of a partial block never match
+            const uint32_t x_valid = (1U << cx) - 1U;
+            uint32_t y_valid = (1U << cy) - 1U;
+            for (size_t r = 0; r < 16; r++) {
+                const __mmask16 m = _mm512_mask_cmpeq_epi32_mask((__mmask16)(x_valid & y_valid), x_ids, y_ids);
+                if (m != 0) {
+                    sink(m, x_vals, y_vals);
+                }
+                y_ids = _mm512_alignr_epi32(y_ids, y_ids, 1);
+                y_vals = _mm512_castsi512_ps(
+                    _mm512_alignr_epi32(_mm512_castps_si512(y_vals), _mm512_castps_si512(y_vals), 1));
+                y_valid = ((y_valid >> 1) | (y_valid << 15)) & 0xFFFFU;
+            }
+        }
+
+        if (x_max <= y_max) {
+            i += cx;
+        }
+        if (y_max <= x_max) {
+            j += cy;
+        }
+    }
+}
+
+inline uint32_t
+sparse_id_at(const char* row, size_t i) {
+    uint32_t id;
+    std::memcpy(&id, row + i * 8, sizeof(id));
+    return id;
+}
+
+template <typename Sink>
+inline void
+sparse_intersect_avx512(const char* x, size_t nx, const char* y, size_t ny, Sink&& sink) {
+    auto load = [&](bool is_x, size_t offset, size_t count, __m512i& ids, __m512& vals) {
+        load_sparse_block((is_x ? x : y) + offset * 8, count, ids, vals);
+    };
+    auto id_at = [&](bool is_x, size_t offset) { return sparse_id_at(is_x ? x : y, offset); };
+    intersect_blocks_avx512(nx, ny, load, id_at, sink);
+}
+
+}  // namespace
+
+float
+sparse_inner_product_avx512(const char* x, size_t nx, const char* y, size_t ny) {
+    __m512 acc = _mm512_setzero_ps();
+    sparse_intersect_avx512(x, nx, y, ny, [&](__mmask16 m, __m512 x_vals, __m512 y_vals) {
+        acc = _mm512_mask3_fmadd_ps(x_vals, y_vals, acc, m);
+    });
+    return _mm512_reduce_add_ps(acc);
+}
+
+size_t
+sparse_intersect_values_avx512(const char* x, size_t nx, const char* y, size_t ny, float* x_vals, float* y_vals) {
+    size_t n = 0;
+    sparse_intersect_avx512(x, nx, y, ny, [&](__mmask16 m, __m512 xv, __m512 yv) {
+        _mm512_mask_compressstoreu_ps(x_vals + n, m, xv);
+        _mm512_mask_compressstoreu_ps(y_vals + n, m, yv);
+        n += __builtin_popcount(m);
+    });
+    return n;
+}
+
+size_t
+u32_sorted_intersect_avx512(const uint32_t* x, size_t nx, const uint32_t* y, size_t ny, uint32_t* x_pos,
+                            uint32_t* y_pos) {
+    auto load = [&](bool is_x, size_t offset, size_t count, __m512i& ids, __m512& vals) {
+        load_u32_block(is_x ? x : y, offset, count, ids, vals);
+    };
+    auto id_at = [&](bool is_x, size_t offset) { return is_x ? x[offset] : y[offset]; };
+    size_t n = 0;
+    intersect_blocks_avx512(nx, ny, load, id_at, [&](__mmask16 m, __m512 xv, __m512 yv) {
+        _mm512_mask_compressstoreu_epi32(x_pos + n, m, _mm512_castps_si512(xv));
+        _mm512_mask_compressstoreu_epi32(y_pos + n, m, _mm512_castps_si512(yv));
+        n += __builtin_popcount(m);
+    });
+    return n;
+}
+
 }  // namespace faiss
 #endif
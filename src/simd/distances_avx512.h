@@ -139,6 +139,23 @@ void
 fvec_L2sqr_batch_4_bf16_patch_avx512(const float* x, const float* y0, const float* y1, const float* y2, const float* y3,
                                      const size_t d, float& dis0, float& dis1, float& dis2, float& dis3);
 
+///////////////////////////////////////////////////////////////////////////////
+// ny by ids
+void
+fvec_inner_products_ny_by_ids_avx512(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                     size_t ny);
+
+void
+fvec_L2sqr_ny_by_ids_avx512(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny);
+
+void
+fvec_inner_products_ny_by_ids_bf16_patch_avx512(float* dis, const float* x, const float* y, const int64_t* ids,
+                                                size_t d, size_t ny);
+
+void
+fvec_L2sqr_ny_by_ids_bf16_patch_avx512(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                       size_t ny);
+
 ///////////////////////////////////////////////////////////////////////////////
 // rabitq
 float
@@ -165,4 +182,13 @@ u64_jaccard_distance_avx512(const char*, const char*, size_t size, size_t);
 void
 u64_jaccard_distance_batch_4_avx512(const char*, const char*, const char*, const char*, const char*, size_t, size_t,
                                     float&, float&, float&, float&);
+///////////////////////////////////////////////////////////////////////////////
+// sparse
+float
+sparse_inner_product_avx512(const char* x, size_t nx, const char* y, size_t ny);
+size_t
+sparse_intersect_values_avx512(const char* x, size_t nx, const char* y, size_t ny, float* x_vals, float* y_vals);
+size_t
+u32_sorted_intersect_avx512(const uint32_t* x, size_t nx, const uint32_t* y, size_t ny, uint32_t* x_pos,
+                            uint32_t* y_pos);
 }  // namespace faiss
@@ -13,10 +13,12 @@
 
 #include <immintrin.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 
 #include "distances_avx512.h"
+#include "distances_ref.h"
 
 namespace faiss {
 
@@ -89,6 +91,50 @@ rabitq_dp_q(const uint8_t* q, const uint8_t* x, const size_t d) {
     return sum_64le;
 }
 
+// the same as rabitq_dp_q, but for 4 queries at once, so that every chunk of the code is loaded a single time
+template <size_t qb>
+static void
+rabitq_dp_q_batch4(const uint8_t* q, const size_t q_stride, const uint8_t* x, const size_t d, int* dp) {
+    __m512i sum_512[4];
+    for (size_t k = 0; k < 4; k++) {
+        sum_512[k] = _mm512_setzero_si512();
+    }
+
+    const size_t di_8b = (d + 7) / 8;
+
+    for (size_t i = 0; i < di_8b; i += 64) {
+        const size_t leftovers = std::min<size_t>(64, di_8b - i);
+        const __mmask64 mask = (leftovers == 64) ? ~__mmask64(0) : ((__mmask64(1) << leftovers) - 1);
+
+        const __m512i v_x = _mm512_maskz_loadu_epi8(mask, x + i);
+        for (size_t j = 0; j < qb; j++) {
+            for (size_t k = 0; k < 4; k++) {
+                const __m512i v_q = _mm512_maskz_loadu_epi8(mask, q + k * q_stride + j * di_8b + i);
+                const __m512i v_popcnt = _mm512_popcnt_epi64(_mm512_and_si512(v_q, v_x));
+                sum_512[k] = _mm512_add_epi64(sum_512[k], _mm512_slli_epi64(v_popcnt, j));
+            }
+        }
+    }
+
+    for (size_t k = 0; k < 4; k++) {
+        dp[k] = static_cast<int>(_mm512_reduce_add_epi64(sum_512[k]));
+    }
+}
+
+template <size_t qb>
+static void
+rabitq_dp_q_batch(const uint8_t* q, const size_t nq, const uint8_t* x, const size_t d, int* dp) {
+    const size_t q_stride = qb * ((d + 7) / 8);
+
+    size_t i = 0;
+    for (; i + 4 <= nq; i += 4) {
+        rabitq_dp_q_batch4<qb>(q + i * q_stride, q_stride, x, d, dp + i);
+    }
+    for (; i < nq; i++) {
+        dp[i] = rabitq_dp_q<qb>(q + i * q_stride, x, d);
+    }
+}
+
 }  // namespace
 
 int
@@ -115,5 +161,30 @@ rabitq_dp_popcnt_avx512icx(const uint8_t* q, const uint8_t* x, const size_t d, c
     return 0;
 }
 
+void
+rabitq_dp_popcnt_batch_avx512icx(const uint8_t* q, const size_t nq, const uint8_t* x, const size_t d, const size_t nb,
+                                 int* dp) {
+    switch (nb) {
+        case 1:
+            return rabitq_dp_q_batch<1>(q, nq, x, d, dp);
+        case 2:
+            return rabitq_dp_q_batch<2>(q, nq, x, d, dp);
+        case 3:
+            return rabitq_dp_q_batch<3>(q, nq, x, d, dp);
+        case 4:
+            return rabitq_dp_q_batch<4>(q, nq, x, d, dp);
+        case 5:
+            return rabitq_dp_q_batch<5>(q, nq, x, d, dp);
+        case 6:
+            return rabitq_dp_q_batch<6>(q, nq, x, d, dp);
+        case 7:
+            return rabitq_dp_q_batch<7>(q, nq, x, d, dp);
+        case 8:
+            return rabitq_dp_q_batch<8>(q, nq, x, d, dp);
+        default:
+            return rabitq_dp_popcnt_batch_ref(q, nq, x, d, nb, dp);
+    }
+}
+
 }  // namespace faiss
 #endif
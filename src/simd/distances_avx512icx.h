@@ -20,5 +20,8 @@ namespace faiss {
 // rabitq
 int
 rabitq_dp_popcnt_avx512icx(const uint8_t* q, const uint8_t* x, const size_t d, const size_t nb);
+void
+rabitq_dp_popcnt_batch_avx512icx(const uint8_t* q, const size_t nq, const uint8_t* x, const size_t d, const size_t nb,
+                                 int* dp);
 
 }  // namespace faiss
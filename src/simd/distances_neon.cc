@@ -17,6 +17,10 @@
 #include <arm_neon.h>
 #include <math.h>
 
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
 namespace faiss {
 
 namespace {
@@ -2927,6 +2931,130 @@ int8_vec_L2sqr_batch_4_neon(const int8_t* x, const int8_t* y0, const int8_t* y1,
     dis3 = static_cast<float>(vaddvq_s32(sum3) + rem_sum3);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// ny by ids
+
+namespace {
+
+// number of bytes of every upcoming vector to prefetch, the rest is left to the hardware prefetcher
+constexpr size_t kByIdsPrefetchBytes = 256;
+
+inline void
+prefetch_by_ids(const float* y, const int64_t* ids, size_t n, size_t d) {
+    const size_t bytes = std::min(d * sizeof(float), kByIdsPrefetchBytes);
+    for (size_t j = 0; j < n; j++) {
+        const char* p = (const char*)(y + ids[j] * d);
+        for (size_t b = 0; b < bytes; b += 64) {
+            __builtin_prefetch(p + b, 0, 3);
+        }
+    }
+}
+
+// loads 4 elements, rounded to bf16 under the fp32-as-bf16 patch
+template <bool bf16_patch = false>
+inline float32x4_t
+load_fp32x4(const float* p) {
+    const float32x4_t v = vld1q_f32(p);
+    if constexpr (bf16_patch) {
+        return bf16_float_neon(v);
+    } else {
+        return v;
+    }
+}
+
+// computes B distances at once, keeping B accumulators in registers and loading x only once per step
+template <size_t B, bool is_l2, bool bf16_patch>
+inline void
+ny_by_ids_block(float* dis, const float* x, const float* y, const int64_t* ids, size_t d) {
+    float32x4_t acc[B];
+    const float* yb[B];
+    for (size_t b = 0; b < B; b++) {
+        acc[b] = vdupq_n_f32(0.0f);
+        yb[b] = y + ids[b] * d;
+    }
+    auto step = [&](const float* xp, const float* const* yp) {
+        const float32x4_t mx = load_fp32x4(xp);
+        for (size_t b = 0; b < B; b++) {
+            const float32x4_t my = load_fp32x4<bf16_patch>(yp[b]);
+            if constexpr (is_l2) {
+                const float32x4_t diff = vsubq_f32(mx, my);
+                acc[b] = vmlaq_f32(acc[b], diff, diff);
+            } else {
+                acc[b] = vmlaq_f32(acc[b], mx, my);
+            }
+        }
+    };
+    const size_t d4 = d / 4 * 4;
+    for (size_t i = 0; i < d4; i += 4) {
+        const float* yp[B];
+        for (size_t b = 0; b < B; b++) {
+            yp[b] = yb[b] + i;
+        }
+        step(x + i, yp);
+    }
+    if (d4 < d) {
+        // zero padded tails, zeros do not change neither ip nor l2
+        float x_tail[4] = {};
+        float y_tail[B][4] = {};
+        const float* yp[B];
+        std::memcpy(x_tail, x + d4, (d - d4) * sizeof(float));
+        for (size_t b = 0; b < B; b++) {
+            std::memcpy(y_tail[b], yb[b] + d4, (d - d4) * sizeof(float));
+            yp[b] = y_tail[b];
+        }
+        step(x_tail, yp);
+    }
+    for (size_t b = 0; b < B; b++) {
+        dis[b] = vaddvq_f32(acc[b]);
+    }
+}
+
+template <bool is_l2, bool bf16_patch = false>
+void
+ny_by_ids(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    auto block = [&](auto b_tag, size_t j) {
+        ny_by_ids_block<decltype(b_tag)::value, is_l2, bf16_patch>(dis + j, x, y, ids + j, d);
+    };
+    prefetch_by_ids(y, ids, std::min<size_t>(ny, 8), d);
+    size_t j = 0;
+    for (; j + 8 <= ny; j += 8) {
+        prefetch_by_ids(y, ids + j + 8, std::min<size_t>(ny - j - 8, 8), d);
+        block(std::integral_constant<size_t, 8>{}, j);
+    }
+    if (j + 4 <= ny) {
+        block(std::integral_constant<size_t, 4>{}, j);
+        j += 4;
+    }
+    for (; j < ny; j++) {
+        block(std::integral_constant<size_t, 1>{}, j);
+    }
+}
+
+}  // namespace
+
+void
+fvec_inner_products_ny_by_ids_neon(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                   size_t ny) {
+    ny_by_ids<false>(dis, x, y, ids, d, ny);
+}
+
+void
+fvec_L2sqr_ny_by_ids_neon(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    ny_by_ids<true>(dis, x, y, ids, d, ny);
+}
+
+void
+fvec_inner_products_ny_by_ids_bf16_patch_neon(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                              size_t ny) {
+    ny_by_ids<false, true>(dis, x, y, ids, d, ny);
+}
+
+void
+fvec_L2sqr_ny_by_ids_bf16_patch_neon(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                     size_t ny) {
+    ny_by_ids<true, true>(dis, x, y, ids, d, ny);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // for cardinal
 
@@ -144,6 +144,22 @@ void
 int8_vec_L2sqr_batch_4_neon(const int8_t* x, const int8_t* y0, const int8_t* y1, const int8_t* y2, const int8_t* y3,
                             const size_t d, float& dis0, float& dis1, float& dis2, float& dis3);
 
+///////////////////////////////////////////////////////////////////////////////
+// ny by ids
+void
+fvec_inner_products_ny_by_ids_neon(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny);
+
+void
+fvec_L2sqr_ny_by_ids_neon(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny);
+
+void
+fvec_inner_products_ny_by_ids_bf16_patch_neon(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                              size_t ny);
+
+void
+fvec_L2sqr_ny_by_ids_bf16_patch_neon(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                     size_t ny);
+
 ///////////////////////////////////////////////////////////////////////////////
 // for cardinal
 
@@ -12,6 +12,7 @@
 #include "distances_ref.h"
 
 #include <cmath>
+#include <cstring>
 
 #include "knowhere/operands.h"
 #include "xxhash.h"
@@ -208,6 +209,29 @@ fvec_L2sqr_batch_4_ref(const float* x, const float* y0, const float* y1, const f
     dis3 = d3;
 }
 
+void
+fvec_inner_products_batch_ref(float* dis, const float* x, const float* y, size_t d, size_t nx, size_t ny) {
+    for (size_t i = 0; i < nx; i++) {
+        for (size_t j = 0; j < ny; j++) {
+            dis[i * ny + j] = fvec_inner_product_ref(x + i * d, y + j * d, d);
+        }
+    }
+}
+
+void
+fvec_inner_products_ny_by_ids_ref(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    for (size_t i = 0; i < ny; i++) {
+        dis[i] = fvec_inner_product_ref(x, y + ids[i] * d, d);
+    }
+}
+
+void
+fvec_L2sqr_ny_by_ids_ref(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    for (size_t i = 0; i < ny; i++) {
+        dis[i] = fvec_L2sqr_ref(x, y + ids[i] * d, d);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // for hnsw sq, obsolete
 
@@ -380,6 +404,16 @@ bf16_vec_L2sqr_batch_4_ref(const knowhere::bf16* x, const knowhere::bf16* y0, co
     dis3 = d3;
 }
 
+void
+bf16_vec_inner_products_batch_ref(float* dis, const knowhere::bf16* x, const knowhere::bf16* y, size_t d, size_t nx,
+                                  size_t ny) {
+    for (size_t i = 0; i < nx; i++) {
+        for (size_t j = 0; j < ny; j++) {
+            dis[i * ny + j] = bf16_vec_inner_product_ref(x + i * d, y + j * d, d);
+        }
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // int8
 
@@ -454,6 +488,15 @@ int8_vec_L2sqr_batch_4_ref(const int8_t* x, const int8_t* y0, const int8_t* y1,
     dis3 = (float)d3;
 }
 
+void
+int8_vec_inner_products_batch_ref(float* dis, const int8_t* x, const int8_t* y, size_t d, size_t nx, size_t ny) {
+    for (size_t i = 0; i < nx; i++) {
+        for (size_t j = 0; j < ny; j++) {
+            dis[i * ny + j] = int8_vec_inner_product_ref(x + i * d, y + j * d, d);
+        }
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // for cardinal
 
@@ -518,6 +561,22 @@ fvec_L2sqr_batch_4_bf16_patch_ref(const float* x, const float* y0, const float*
     dis3 = d3;
 }
 
+void
+fvec_inner_products_ny_by_ids_bf16_patch_ref(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                             size_t ny) {
+    for (size_t i = 0; i < ny; i++) {
+        dis[i] = fvec_inner_product_bf16_patch_ref(x, y + ids[i] * d, d);
+    }
+}
+
+void
+fvec_L2sqr_ny_by_ids_bf16_patch_ref(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                    size_t ny) {
+    for (size_t i = 0; i < ny; i++) {
+        dis[i] = fvec_L2sqr_bf16_patch_ref(x, y + ids[i] * d, d);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // rabitq
 float
@@ -567,6 +626,15 @@ rabitq_dp_popcnt_ref(const uint8_t* q, const uint8_t* x, const size_t d, const s
     return dot;
 }
 
+void
+rabitq_dp_popcnt_batch_ref(const uint8_t* q, const size_t nq, const uint8_t* x, const size_t d, const size_t nb,
+                           int* dp) {
+    const size_t q_stride = nb * ((d + 7) / 8);
+    for (size_t i = 0; i < nq; i++) {
+        dp[i] = rabitq_dp_popcnt_ref(q + i * q_stride, x, d, nb);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // minhash
 float
@@ -729,4 +797,94 @@ u64_jaccard_distance_batch_4_ref(const char* x, const char* y0, const char* y1,
     return;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// sparse
+
+namespace {
+
+// a sparse row is a packed array of (uint32_t index, float value) pairs
+constexpr size_t kSparseElementSize = sizeof(uint32_t) + sizeof(float);
+
+inline uint32_t
+sparse_index_at(const char* row, size_t i) {
+    uint32_t index;
+    std::memcpy(&index, row + i * kSparseElementSize, sizeof(index));
+    return index;
+}
+
+inline float
+sparse_value_at(const char* row, size_t i) {
+    float value;
+    std::memcpy(&value, row + i * kSparseElementSize + sizeof(uint32_t), sizeof(value));
+    return value;
+}
+
+}  // namespace
+
+float
+sparse_inner_product_ref(const char* x, size_t nx, const char* y, size_t ny) {
+    float res = 0.0f;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < nx && j < ny) {
+        const uint32_t xi = sparse_index_at(x, i);
+        const uint32_t yj = sparse_index_at(y, j);
+        if (xi < yj) {
+            ++i;
+        } else if (xi > yj) {
+            ++j;
+        } else {
+            res += sparse_value_at(x, i) * sparse_value_at(y, j);
+            ++i;
+            ++j;
+        }
+    }
+    return res;
+}
+
+size_t
+sparse_intersect_values_ref(const char* x, size_t nx, const char* y, size_t ny, float* x_vals, float* y_vals) {
+    size_t n = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < nx && j < ny) {
+        const uint32_t xi = sparse_index_at(x, i);
+        const uint32_t yj = sparse_index_at(y, j);
+        if (xi < yj) {
+            ++i;
+        } else if (xi > yj) {
+            ++j;
+        } else {
+            x_vals[n] = sparse_value_at(x, i);
+            y_vals[n] = sparse_value_at(y, j);
+            ++n;
+            ++i;
+            ++j;
+        }
+    }
+    return n;
+}
+
+size_t
+u32_sorted_intersect_ref(const uint32_t* x, size_t nx, const uint32_t* y, size_t ny, uint32_t* x_pos,
+                         uint32_t* y_pos) {
+    size_t n = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < nx && j < ny) {
+        if (x[i] < y[j]) {
+            ++i;
+        } else if (x[i] > y[j]) {
+            ++j;
+        } else {
+            x_pos[n] = i;
+            y_pos[n] = j;
+            ++n;
+            ++i;
+            ++j;
+        }
+    }
+    return n;
+}
+
 }  // namespace faiss
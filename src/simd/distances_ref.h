@@ -84,6 +84,19 @@ void
 fvec_L2sqr_batch_4_ref(const float* x, const float* y0, const float* y1, const float* y2, const float* y3,
                        const size_t d, float& dis0, float& dis1, float& dis2, float& dis3);
 
+/// compute the inner products between nx vectors x and ny vectors y,
+/// dis[i * ny + j] = <x_i, y_j>
+void
+fvec_inner_products_batch_ref(float* dis, const float* x, const float* y, size_t d, size_t nx, size_t ny);
+
+/// compute the distances between x and the ny vectors of y selected by ids,
+/// dis[j] = dis(x, y + ids[j] * d)
+void
+fvec_inner_products_ny_by_ids_ref(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny);
+
+void
+fvec_L2sqr_ny_by_ids_ref(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny);
+
 ///////////////////////////////////////////////////////////////////////////////
 // for hnsw sq, obsolete
 int32_t
@@ -134,6 +147,10 @@ bf16_vec_L2sqr_batch_4_ref(const knowhere::bf16* x, const knowhere::bf16* y0, co
                            const knowhere::bf16* y2, const knowhere::bf16* y3, const size_t d, float& dis0, float& dis1,
                            float& dis2, float& dis3);
 
+void
+bf16_vec_inner_products_batch_ref(float* dis, const knowhere::bf16* x, const knowhere::bf16* y, size_t d, size_t nx,
+                                  size_t ny);
+
 ///////////////////////////////////////////////////////////////////////////////
 // int8
 float
@@ -154,6 +171,9 @@ void
 int8_vec_L2sqr_batch_4_ref(const int8_t* x, const int8_t* y0, const int8_t* y1, const int8_t* y2, const int8_t* y3,
                            const size_t d, float& dis0, float& dis1, float& dis2, float& dis3);
 
+void
+int8_vec_inner_products_batch_ref(float* dis, const int8_t* x, const int8_t* y, size_t d, size_t nx, size_t ny);
+
 ///////////////////////////////////////////////////////////////////////////////
 // for cardinal
 float
@@ -171,12 +191,23 @@ void
 fvec_L2sqr_batch_4_bf16_patch_ref(const float* x, const float* y0, const float* y1, const float* y2, const float* y3,
                                   const size_t d, float& dis0, float& dis1, float& dis2, float& dis3);
 
+void
+fvec_inner_products_ny_by_ids_bf16_patch_ref(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                             size_t ny);
+
+void
+fvec_L2sqr_ny_by_ids_bf16_patch_ref(float* dis, const float* x, const float* y, const int64_t* ids, size_t d,
+                                    size_t ny);
+
 ///////////////////////////////////////////////////////////////////////////////
 // rabitq
 float
 fvec_masked_sum_ref(const float* q, const uint8_t* x, const size_t d);
 int
 rabitq_dp_popcnt_ref(const uint8_t* q, const uint8_t* x, const size_t d, const size_t nb);
+void
+rabitq_dp_popcnt_batch_ref(const uint8_t* q, const size_t nq, const uint8_t* x, const size_t d, const size_t nb,
+                           int* dp);
 
 ///////////////////////////////////////////////////////////////////////////////
 // minhash
@@ -199,4 +230,14 @@ void
 u64_jaccard_distance_batch_4_ref(const char*, const char*, const char*, const char*, const char*, size_t, size_t,
                                  float&, float&, float&, float&);
 
+///////////////////////////////////////////////////////////////////////////////
+// sparse
+float
+sparse_inner_product_ref(const char* x, size_t nx, const char* y, size_t ny);
+size_t
+sparse_intersect_values_ref(const char* x, size_t nx, const char* y, size_t ny, float* x_vals, float* y_vals);
+size_t
+u32_sorted_intersect_ref(const uint32_t* x, size_t nx, const uint32_t* y, size_t ny, uint32_t* x_pos,
+                         uint32_t* y_pos);
+
 }  // namespace faiss
@@ -13,6 +13,7 @@
 
 #include <arm_sve.h>
 
+#include <algorithm>
 #include <cmath>
 
 #include "faiss/impl/platform_macros.h"
@@ -974,6 +975,131 @@ bf16_vec_inner_product_batch_4_sve(const knowhere::bf16* x, const knowhere::bf16
     dis3 = svaddv_f32(svptrue_b32(), acc3);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// ny by ids
+
+namespace {
+
+// number of bytes of every upcoming vector to prefetch, the rest is left to the hardware prefetcher
+constexpr size_t kByIdsPrefetchBytes = 256;
+
+inline void
+prefetch_by_ids(const float* y, const int64_t* ids, size_t n, size_t d) {
+    const size_t bytes = std::min(d * sizeof(float), kByIdsPrefetchBytes);
+    for (size_t j = 0; j < n; j++) {
+        const char* p = (const char*)(y + ids[j] * d);
+        for (size_t b = 0; b < bytes; b += 64) {
+            __builtin_prefetch(p + b, 0, 3);
+        }
+    }
+}
+
+template <bool is_l2>
+inline svfloat32_t
+by_ids_accumulate(const svbool_t pg, const svfloat32_t acc, const svfloat32_t vx, const float* y) {
+    const svfloat32_t vy = svld1_f32(pg, y);
+    if constexpr (is_l2) {
+        const svfloat32_t diff = svsub_f32_m(pg, vx, vy);
+        return svmla_f32_m(pg, acc, diff, diff);
+    } else {
+        return svmla_f32_m(pg, acc, vx, vy);
+    }
+}
+
+// sizeless sve types cannot be stored in arrays, so the 8 accumulators are spelled out
+template <bool is_l2>
+void
+fvec_ny_by_ids_batch_8_sve(float* dis, const float* x, const float* y, const int64_t* ids, size_t d) {
+    const float* y0 = y + ids[0] * d;
+    const float* y1 = y + ids[1] * d;
+    const float* y2 = y + ids[2] * d;
+    const float* y3 = y + ids[3] * d;
+    const float* y4 = y + ids[4] * d;
+    const float* y5 = y + ids[5] * d;
+    const float* y6 = y + ids[6] * d;
+    const float* y7 = y + ids[7] * d;
+
+    svfloat32_t acc0 = svdup_f32(0.0f);
+    svfloat32_t acc1 = svdup_f32(0.0f);
+    svfloat32_t acc2 = svdup_f32(0.0f);
+    svfloat32_t acc3 = svdup_f32(0.0f);
+    svfloat32_t acc4 = svdup_f32(0.0f);
+    svfloat32_t acc5 = svdup_f32(0.0f);
+    svfloat32_t acc6 = svdup_f32(0.0f);
+    svfloat32_t acc7 = svdup_f32(0.0f);
+
+    size_t i = 0;
+    svbool_t pg = svptrue_b32();
+    while (i < d) {
+        if (d - i < svcntw())
+            pg = svwhilelt_b32(i, d);
+
+        const svfloat32_t vx = svld1_f32(pg, x + i);
+        acc0 = by_ids_accumulate<is_l2>(pg, acc0, vx, y0 + i);
+        acc1 = by_ids_accumulate<is_l2>(pg, acc1, vx, y1 + i);
+        acc2 = by_ids_accumulate<is_l2>(pg, acc2, vx, y2 + i);
+        acc3 = by_ids_accumulate<is_l2>(pg, acc3, vx, y3 + i);
+        acc4 = by_ids_accumulate<is_l2>(pg, acc4, vx, y4 + i);
+        acc5 = by_ids_accumulate<is_l2>(pg, acc5, vx, y5 + i);
+        acc6 = by_ids_accumulate<is_l2>(pg, acc6, vx, y6 + i);
+        acc7 = by_ids_accumulate<is_l2>(pg, acc7, vx, y7 + i);
+
+        i += svcntw();
+    }
+
+    const svbool_t all = svptrue_b32();
+    dis[0] = svaddv_f32(all, acc0);
+    dis[1] = svaddv_f32(all, acc1);
+    dis[2] = svaddv_f32(all, acc2);
+    dis[3] = svaddv_f32(all, acc3);
+    dis[4] = svaddv_f32(all, acc4);
+    dis[5] = svaddv_f32(all, acc5);
+    dis[6] = svaddv_f32(all, acc6);
+    dis[7] = svaddv_f32(all, acc7);
+}
+
+template <bool is_l2>
+void
+fvec_ny_by_ids_sve(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    prefetch_by_ids(y, ids, std::min<size_t>(ny, 8), d);
+    size_t j = 0;
+    for (; j + 8 <= ny; j += 8) {
+        prefetch_by_ids(y, ids + j + 8, std::min<size_t>(ny - j - 8, 8), d);
+        fvec_ny_by_ids_batch_8_sve<is_l2>(dis + j, x, y, ids + j, d);
+    }
+    if (j + 4 <= ny) {
+        const float* y0 = y + ids[j] * d;
+        const float* y1 = y + ids[j + 1] * d;
+        const float* y2 = y + ids[j + 2] * d;
+        const float* y3 = y + ids[j + 3] * d;
+        if constexpr (is_l2) {
+            fvec_L2sqr_batch_4_sve(x, y0, y1, y2, y3, d, dis[j], dis[j + 1], dis[j + 2], dis[j + 3]);
+        } else {
+            fvec_inner_product_batch_4_sve(x, y0, y1, y2, y3, d, dis[j], dis[j + 1], dis[j + 2], dis[j + 3]);
+        }
+        j += 4;
+    }
+    for (; j < ny; j++) {
+        if constexpr (is_l2) {
+            dis[j] = fvec_L2sqr_sve(x, y + ids[j] * d, d);
+        } else {
+            dis[j] = fvec_inner_product_sve(x, y + ids[j] * d, d);
+        }
+    }
+}
+
+}  // namespace
+
+void
+fvec_inner_products_ny_by_ids_sve(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    fvec_ny_by_ids_sve<false>(dis, x, y, ids, d, ny);
+}
+
+void
+fvec_L2sqr_ny_by_ids_sve(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny) {
+    fvec_ny_by_ids_sve<true>(dis, x, y, ids, d, ny);
+}
+
 }  // namespace faiss
 
 #endif
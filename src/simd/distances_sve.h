@@ -109,5 +109,11 @@ bf16_vec_inner_product_batch_4_sve(const knowhere::bf16* x, const knowhere::bf16
                                    const knowhere::bf16* y2, const knowhere::bf16* y3, const size_t d, float& dis0,
                                    float& dis1, float& dis2, float& dis3);
 
+void
+fvec_inner_products_ny_by_ids_sve(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny);
+
+void
+fvec_L2sqr_ny_by_ids_sve(float* dis, const float* x, const float* y, const int64_t* ids, size_t d, size_t ny);
+
 }  // namespace faiss
 #endif
@@ -16,6 +16,7 @@
 #include "faiss/FaissHook.h"
 
 #if defined(__x86_64__)
+#include "distances_amx.h"
 #include "distances_avx.h"
 #include "distances_avx512.h"
 #include "distances_avx512icx.h"
@@ -52,9 +53,11 @@ namespace faiss {
 bool use_avx512 = true;
 bool use_avx2 = true;
 bool use_sse4_2 = true;
+bool use_amx = true;
 #endif
 
 bool support_pq_fast_scan = true;
+bool support_amx = false;
 
 ///////////////////////////////////////////////////////////////////////////////
 decltype(fvec_inner_product) fvec_inner_product = fvec_inner_product_ref;
@@ -75,6 +78,11 @@ decltype(fvec_L2sqr_ny_transposed) fvec_L2sqr_ny_transposed = fvec_L2sqr_ny_tran
 
 decltype(fvec_inner_product_batch_4) fvec_inner_product_batch_4 = fvec_inner_product_batch_4_ref;
 decltype(fvec_L2sqr_batch_4) fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_ref;
+decltype(fvec_inner_products_ny_by_ids) fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_ref;
+decltype(fvec_L2sqr_ny_by_ids) fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_ref;
+
+decltype(fvec_inner_products_batch) fvec_inner_products_batch = fvec_inner_products_batch_ref;
+decltype(fvec_inner_products_batch_bf16) fvec_inner_products_batch_bf16 = fvec_inner_products_batch_ref;
 
 // for hnsw sq, obsolete
 decltype(ivec_inner_product) ivec_inner_product = ivec_inner_product_ref;
@@ -95,6 +103,7 @@ decltype(bf16_vec_norm_L2sqr) bf16_vec_norm_L2sqr = bf16_vec_norm_L2sqr_ref;
 
 decltype(bf16_vec_inner_product_batch_4) bf16_vec_inner_product_batch_4 = bf16_vec_inner_product_batch_4_ref;
 decltype(bf16_vec_L2sqr_batch_4) bf16_vec_L2sqr_batch_4 = bf16_vec_L2sqr_batch_4_ref;
+decltype(bf16_vec_inner_products_batch) bf16_vec_inner_products_batch = bf16_vec_inner_products_batch_ref;
 
 // int8
 decltype(int8_vec_L2sqr) int8_vec_L2sqr = int8_vec_L2sqr_ref;
@@ -103,10 +112,17 @@ decltype(int8_vec_norm_L2sqr) int8_vec_norm_L2sqr = int8_vec_norm_L2sqr_ref;
 
 decltype(int8_vec_inner_product_batch_4) int8_vec_inner_product_batch_4 = int8_vec_inner_product_batch_4_ref;
 decltype(int8_vec_L2sqr_batch_4) int8_vec_L2sqr_batch_4 = int8_vec_L2sqr_batch_4_ref;
+decltype(int8_vec_inner_products_batch) int8_vec_inner_products_batch = int8_vec_inner_products_batch_ref;
 
 // rabitq
 decltype(fvec_masked_sum) fvec_masked_sum = fvec_masked_sum_ref;
 decltype(rabitq_dp_popcnt) rabitq_dp_popcnt = rabitq_dp_popcnt_ref;
+decltype(rabitq_dp_popcnt_batch) rabitq_dp_popcnt_batch = rabitq_dp_popcnt_batch_ref;
+
+// sparse
+decltype(sparse_inner_product) sparse_inner_product = sparse_inner_product_ref;
+decltype(sparse_intersect_values) sparse_intersect_values = sparse_intersect_values_ref;
+decltype(u32_sorted_intersect) u32_sorted_intersect = u32_sorted_intersect_ref;
 
 // minhash
 decltype(u64_binary_search_eq) u64_binary_search_eq = u64_binary_search_eq_ref;
@@ -142,6 +158,12 @@ cpu_support_f16c() {
     InstructionSet& instruction_set_inst = InstructionSet::GetInstance();
     return (instruction_set_inst.F16C());
 }
+
+bool
+cpu_support_amx() {
+    InstructionSet& instruction_set_inst = InstructionSet::GetInstance();
+    return (instruction_set_inst.AMX_TILE() && instruction_set_inst.AMX_BF16() && instruction_set_inst.AMX_INT8());
+}
 #endif
 
 #if defined(__aarch64__)
@@ -160,10 +182,12 @@ supports_sve() {
 #endif
 
 static std::mutex patch_bf16_mutex;
+static bool patch_bf16_enabled = false;
 
 void
 enable_patch_for_fp32_bf16() {
     std::lock_guard<std::mutex> lock(patch_bf16_mutex);
+    patch_bf16_enabled = true;
 #if defined(__x86_64__)
     if (use_avx512 && cpu_support_avx512()) {
         // Cloud branch
@@ -172,12 +196,20 @@ enable_patch_for_fp32_bf16() {
 
         fvec_L2sqr = fvec_L2sqr_bf16_patch_avx512;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_bf16_patch_avx512;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_bf16_patch_avx512;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_bf16_patch_avx512;
+
+        if (support_amx) {
+            fvec_inner_products_batch = fvec_inner_products_batch_amx;
+        }
     } else if (use_avx2 && cpu_support_avx2()) {
         fvec_inner_product = fvec_inner_product_bf16_patch_avx;
         fvec_inner_product_batch_4 = fvec_inner_product_batch_4_bf16_patch_avx;
 
         fvec_L2sqr = fvec_L2sqr_bf16_patch_avx;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_bf16_patch_avx;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_bf16_patch_avx;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_bf16_patch_avx;
     } else if (use_sse4_2 && cpu_support_sse4_2()) {
         // The branch that can't be reached
     } else {
@@ -186,6 +218,8 @@ enable_patch_for_fp32_bf16() {
 
         fvec_L2sqr = fvec_L2sqr_bf16_patch_ref;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_bf16_patch_ref;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_bf16_patch_ref;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_bf16_patch_ref;
     }
 #endif
 
@@ -198,6 +232,8 @@ enable_patch_for_fp32_bf16() {
 
     fvec_L2sqr = fvec_L2sqr_bf16_patch_neon;
     fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_bf16_patch_neon;
+    fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_bf16_patch_neon;
+    fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_bf16_patch_neon;
 
 #endif
 
@@ -207,6 +243,7 @@ enable_patch_for_fp32_bf16() {
 void
 disable_patch_for_fp32_bf16() {
     std::lock_guard<std::mutex> lock(patch_bf16_mutex);
+    patch_bf16_enabled = false;
 #if defined(__x86_64__)
     if (use_avx512 && cpu_support_avx512()) {
         // Cloud branch
@@ -215,12 +252,18 @@ disable_patch_for_fp32_bf16() {
 
         fvec_L2sqr = fvec_L2sqr_avx512;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_avx512;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_avx512;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_avx512;
+
+        fvec_inner_products_batch = fvec_inner_products_batch_ref;
     } else if (use_avx2 && cpu_support_avx2()) {
         fvec_inner_product = fvec_inner_product_avx;
         fvec_inner_product_batch_4 = fvec_inner_product_batch_4_avx;
 
         fvec_L2sqr = fvec_L2sqr_avx;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_avx;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_avx;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_avx;
     } else if (use_sse4_2 && cpu_support_sse4_2()) {
         // The branch that can't be reached
     } else {
@@ -229,10 +272,18 @@ disable_patch_for_fp32_bf16() {
 
         fvec_L2sqr = fvec_L2sqr_ref;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_ref;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_ref;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_ref;
     }
 #endif
 }
 
+bool
+is_patch_for_fp32_bf16_enabled() {
+    std::lock_guard<std::mutex> lock(patch_bf16_mutex);
+    return patch_bf16_enabled;
+}
+
 void
 fvec_hook(std::string& simd_type) {
     static std::mutex hook_mutex;
@@ -252,6 +303,8 @@ fvec_hook(std::string& simd_type) {
 
         fvec_inner_product_batch_4 = fvec_inner_product_batch_4_avx512;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_avx512;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_avx512;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_avx512;
         fvec_L2sqr_ny_nearest = fvec_L2sqr_ny_nearest_avx;  // avx2 compute small dim faster than avx512
 
         // for hnsw sq, obsolete
@@ -286,9 +339,15 @@ fvec_hook(std::string& simd_type) {
         fvec_masked_sum = fvec_masked_sum_avx512;
         if (InstructionSet::GetInstance().AVX512VPOPCNTDQ()) {
             rabitq_dp_popcnt = rabitq_dp_popcnt_avx512icx;
+            rabitq_dp_popcnt_batch = rabitq_dp_popcnt_batch_avx512icx;
         } else {
             rabitq_dp_popcnt = rabitq_dp_popcnt_avx512;
+            rabitq_dp_popcnt_batch = rabitq_dp_popcnt_batch_ref;
         }
+        // sparse
+        sparse_inner_product = sparse_inner_product_avx512;
+        sparse_intersect_values = sparse_intersect_values_avx512;
+        u32_sorted_intersect = u32_sorted_intersect_avx512;
         // minhash
         u64_binary_search_eq = u64_binary_search_eq_avx512;
         u64_binary_search_ge = u64_binary_search_ge_avx512;
@@ -297,6 +356,20 @@ fvec_hook(std::string& simd_type) {
         u32_jaccard_distance_batch_4 = u32_jaccard_distance_batch_4_ref;
         u64_jaccard_distance = u64_jaccard_distance_ref;
         u64_jaccard_distance_batch_4 = u64_jaccard_distance_batch_4_ref;
+
+        // amx, the kernel has to grant the tile data state before the first tile instruction
+        fvec_inner_products_batch = fvec_inner_products_batch_ref;
+        if (use_amx && cpu_support_amx() && amx_request_tile_permission()) {
+            fvec_inner_products_batch_bf16 = fvec_inner_products_batch_bf16_amx;
+            bf16_vec_inner_products_batch = bf16_vec_inner_products_batch_amx;
+            int8_vec_inner_products_batch = int8_vec_inner_products_batch_amx;
+            support_amx = true;
+        } else {
+            fvec_inner_products_batch_bf16 = fvec_inner_products_batch_ref;
+            bf16_vec_inner_products_batch = bf16_vec_inner_products_batch_ref;
+            int8_vec_inner_products_batch = int8_vec_inner_products_batch_ref;
+            support_amx = false;
+        }
         //
         simd_type = "AVX512";
         support_pq_fast_scan = true;
@@ -314,6 +387,8 @@ fvec_hook(std::string& simd_type) {
 
         fvec_inner_product_batch_4 = fvec_inner_product_batch_4_avx;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_avx;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_avx;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_avx;
         fvec_L2sqr_ny_nearest = fvec_L2sqr_ny_nearest_avx;
 
         // for hnsw sq, obsolete
@@ -347,6 +422,19 @@ fvec_hook(std::string& simd_type) {
         // rabitq
         fvec_masked_sum = fvec_masked_sum_avx;
         rabitq_dp_popcnt = rabitq_dp_popcnt_avx;
+        rabitq_dp_popcnt_batch = rabitq_dp_popcnt_batch_ref;
+
+        // sparse
+        sparse_inner_product = sparse_inner_product_avx;
+        sparse_intersect_values = sparse_intersect_values_avx;
+        u32_sorted_intersect = u32_sorted_intersect_avx;
+
+        // amx
+        fvec_inner_products_batch = fvec_inner_products_batch_ref;
+        fvec_inner_products_batch_bf16 = fvec_inner_products_batch_ref;
+        bf16_vec_inner_products_batch = bf16_vec_inner_products_batch_ref;
+        int8_vec_inner_products_batch = int8_vec_inner_products_batch_ref;
+        support_amx = false;
 
         //
         simd_type = "AVX2";
@@ -365,6 +453,8 @@ fvec_hook(std::string& simd_type) {
 
         fvec_inner_product_batch_4 = fvec_inner_product_batch_4_ref;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_ref;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_ref;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_ref;
 
         // for hnsw sq, obsolete
         ivec_inner_product = ivec_inner_product_sse;
@@ -397,6 +487,19 @@ fvec_hook(std::string& simd_type) {
         // rabitq
         fvec_masked_sum = fvec_masked_sum_sse;
         rabitq_dp_popcnt = rabitq_dp_popcnt_sse;
+        rabitq_dp_popcnt_batch = rabitq_dp_popcnt_batch_ref;
+
+        // sparse
+        sparse_inner_product = sparse_inner_product_ref;
+        sparse_intersect_values = sparse_intersect_values_ref;
+        u32_sorted_intersect = u32_sorted_intersect_ref;
+
+        // amx
+        fvec_inner_products_batch = fvec_inner_products_batch_ref;
+        fvec_inner_products_batch_bf16 = fvec_inner_products_batch_ref;
+        bf16_vec_inner_products_batch = bf16_vec_inner_products_batch_ref;
+        int8_vec_inner_products_batch = int8_vec_inner_products_batch_ref;
+        support_amx = false;
 
         //
         simd_type = "SSE4_2";
@@ -415,6 +518,8 @@ fvec_hook(std::string& simd_type) {
 
         fvec_inner_product_batch_4 = fvec_inner_product_batch_4_ref;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_ref;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_ref;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_ref;
 
         // for hnsw sq, obsolete
         ivec_inner_product = ivec_inner_product_ref;
@@ -447,6 +552,19 @@ fvec_hook(std::string& simd_type) {
         // rabitq
         fvec_masked_sum = fvec_masked_sum_ref;
         rabitq_dp_popcnt = rabitq_dp_popcnt_ref;
+        rabitq_dp_popcnt_batch = rabitq_dp_popcnt_batch_ref;
+
+        // sparse
+        sparse_inner_product = sparse_inner_product_ref;
+        sparse_intersect_values = sparse_intersect_values_ref;
+        u32_sorted_intersect = u32_sorted_intersect_ref;
+
+        // amx
+        fvec_inner_products_batch = fvec_inner_products_batch_ref;
+        fvec_inner_products_batch_bf16 = fvec_inner_products_batch_ref;
+        bf16_vec_inner_products_batch = bf16_vec_inner_products_batch_ref;
+        int8_vec_inner_products_batch = int8_vec_inner_products_batch_ref;
+        support_amx = false;
 
         //
         simd_type = "GENERIC";
@@ -483,6 +601,8 @@ fvec_hook(std::string& simd_type) {
         bf16_vec_L2sqr = bf16_vec_L2sqr_sve;
         bf16_vec_norm_L2sqr = bf16_vec_norm_L2sqr_sve;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_sve;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_sve;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_sve;
         fvec_inner_product_batch_4 = fvec_inner_product_batch_4_sve;
 
         bf16_vec_L2sqr_batch_4 = bf16_vec_L2sqr_batch_4_sve;
@@ -517,6 +637,8 @@ fvec_hook(std::string& simd_type) {
 
         fvec_inner_product_batch_4 = fvec_inner_product_batch_4_neon;
         fvec_L2sqr_batch_4 = fvec_L2sqr_batch_4_neon;
+        fvec_inner_products_ny_by_ids = fvec_inner_products_ny_by_ids_neon;
+        fvec_L2sqr_ny_by_ids = fvec_L2sqr_ny_by_ids_neon;
 
         // fp16
         fp16_vec_inner_product = fp16_vec_inner_product_neon;
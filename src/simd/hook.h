@@ -22,10 +22,14 @@ namespace faiss {
 extern bool use_avx512;
 extern bool use_avx2;
 extern bool use_sse4_2;
+extern bool use_amx;
 #endif
 
 extern bool support_pq_fast_scan;
 
+/// whether the *_inner_products_batch kernels run on AMX tiles
+extern bool support_amx;
+
 /// inner product
 extern float (*fvec_inner_product)(const float*, const float*, size_t);
 
@@ -81,6 +85,31 @@ extern void (*fvec_inner_product_batch_4)(const float*, const float*, const floa
 extern void (*fvec_L2sqr_batch_4)(const float*, const float*, const float*, const float*, const float*, const size_t,
                                   float&, float&, float&, float&);
 
+/// compute the inner products between a block of nx vectors x and a block of
+/// ny vectors y, dis[i * ny + j] = <x_i, y_j>. Backed by AMX tiles if
+/// support_amx, otherwise by a reference loop, so callers are expected to
+/// check support_amx before preferring it over the per-query kernels.
+/// The fp32 version only runs on AMX while the fp32-as-bf16 patch is enabled,
+/// and then only rounds y to bf16, the same as the patch kernels.
+extern void (*fvec_inner_products_batch)(float*, const float*, const float*, size_t, size_t, size_t);
+
+/// same as fvec_inner_products_batch, but the inputs may be rounded to bf16.
+/// Only meant for candidate selection (coarse assignment, k-means), the
+/// exact distances of the selected candidates have to be recomputed.
+extern void (*fvec_inner_products_batch_bf16)(float*, const float*, const float*, size_t, size_t, size_t);
+
+/// bound of |<x, y>_bf16 - <x, y>| / (||x|| * ||y||) for fvec_inner_products_batch_bf16, i.e. the bf16 rounding of
+/// both inputs plus some slack for the fp32 accumulation. Selections made on the bf16 products are exact once the
+/// candidates within this bound of the cut-off have been re-checked in fp32.
+constexpr float kBf16InnerProductRelError = 1.0f / 128;
+
+/// compute the distances between x and the ny vectors of y selected by ids,
+/// dis[j] = dis(x, y + ids[j] * d). Meant for graph traversal and refinement,
+/// where the neighbors are scattered: several gathered vectors are accumulated
+/// in registers at once and the next block of them is prefetched.
+extern void (*fvec_inner_products_ny_by_ids)(float*, const float*, const float*, const int64_t*, size_t, size_t);
+extern void (*fvec_L2sqr_ny_by_ids)(float*, const float*, const float*, const int64_t*, size_t, size_t);
+
 // for hnsw sq, obsolete
 extern int32_t (*ivec_inner_product)(const int8_t*, const int8_t*, size_t);
 extern int32_t (*ivec_L2sqr)(const int8_t*, const int8_t*, size_t);
@@ -108,6 +137,8 @@ extern void (*bf16_vec_inner_product_batch_4)(const knowhere::bf16*, const knowh
 extern void (*bf16_vec_L2sqr_batch_4)(const knowhere::bf16*, const knowhere::bf16*, const knowhere::bf16*,
                                       const knowhere::bf16*, const knowhere::bf16*, const size_t, float&, float&,
                                       float&, float&);
+extern void (*bf16_vec_inner_products_batch)(float*, const knowhere::bf16*, const knowhere::bf16*, size_t, size_t,
+                                             size_t);
 // int8
 extern float (*int8_vec_inner_product)(const int8_t*, const int8_t*, size_t);
 extern float (*int8_vec_L2sqr)(const int8_t*, const int8_t*, size_t);
@@ -117,10 +148,27 @@ extern void (*int8_vec_inner_product_batch_4)(const int8_t*, const int8_t*, cons
                                               const size_t, float&, float&, float&, float&);
 extern void (*int8_vec_L2sqr_batch_4)(const int8_t*, const int8_t*, const int8_t*, const int8_t*, const int8_t*,
                                       const size_t, float&, float&, float&, float&);
+extern void (*int8_vec_inner_products_batch)(float*, const int8_t*, const int8_t*, size_t, size_t, size_t);
 
 // rabitq
 extern float (*fvec_masked_sum)(const float*, const uint8_t*, const size_t);
 extern int (*rabitq_dp_popcnt)(const uint8_t*, const uint8_t*, const size_t, const size_t);
+/// the popcount dot products of one code with the bit-planes of nq queries, laid out back to back,
+/// the code is loaded once for the whole group of queries.
+extern void (*rabitq_dp_popcnt_batch)(const uint8_t*, const size_t, const uint8_t*, const size_t, const size_t, int*);
+
+// sparse
+/// inner product of two sparse rows, each one a packed array of
+/// (uint32_t index, float value) pairs sorted by index.
+extern float (*sparse_inner_product)(const char*, size_t, const char*, size_t);
+/// collect the values of the indices that two sparse rows have in common,
+/// returns the number of matches. The outputs need min(nx, ny) elements,
+/// the matches are not ordered.
+extern size_t (*sparse_intersect_values)(const char*, size_t, const char*, size_t, float*, float*);
+/// collect the positions of the ids that two sorted id lists have in common,
+/// returns the number of matches. The outputs need min(nx, ny) elements,
+/// the matches are not ordered.
+extern size_t (*u32_sorted_intersect)(const uint32_t*, size_t, const uint32_t*, size_t, uint32_t*, uint32_t*);
 
 // minhash
 extern int (*u64_binary_search_eq)(const uint64_t*, const size_t, const uint64_t);
@@ -143,6 +191,8 @@ bool
 cpu_support_sse4_2();
 bool
 cpu_support_f16c();
+bool
+cpu_support_amx();
 #endif
 
 #if defined(__aarch64__)
@@ -156,6 +206,9 @@ enable_patch_for_fp32_bf16();
 void
 disable_patch_for_fp32_bf16();
 
+bool
+is_patch_for_fp32_bf16_enabled();
+
 void
 fvec_hook(std::string&);
 
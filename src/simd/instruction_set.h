@@ -41,6 +41,7 @@ class InstructionSet {
           f_1_EDX_{0},
           f_7_EBX_{0},
           f_7_ECX_{0},
+          f_7_EDX_{0},
           f_81_ECX_{0},
           f_81_EDX_{0},
           data_{},
@@ -80,6 +81,7 @@ class InstructionSet {
         if (nIds_ >= 7) {
             f_7_EBX_ = data_[7][1];
             f_7_ECX_ = data_[7][2];
+            f_7_EDX_ = data_[7][3];
         }
 
         // Calling __cpuid with 0x80000000 as the function_id argument
@@ -352,6 +354,19 @@ class InstructionSet {
         return f_7_ECX_[14];
     }
 
+    bool
+    AMX_BF16() {
+        return f_7_EDX_[22];
+    }
+    bool
+    AMX_TILE() {
+        return f_7_EDX_[24];
+    }
+    bool
+    AMX_INT8() {
+        return f_7_EDX_[25];
+    }
+
  private:
     int nIds_;
     int nExIds_;
@@ -363,6 +378,7 @@ class InstructionSet {
     std::bitset<32> f_1_EDX_;
     std::bitset<32> f_7_EBX_;
     std::bitset<32> f_7_ECX_;
+    std::bitset<32> f_7_EDX_;
     std::bitset<32> f_81_ECX_;
     std::bitset<32> f_81_EDX_;
     std::vector<std::array<int, 4>> data_;
@@ -9,6 +9,7 @@
 // is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
 // or implied. See the License for the specific language governing permissions and limitations under the License.
 
+#include <random>
 #include <unordered_set>
 
 #include "catch2/catch_approx.hpp"
@@ -23,11 +24,25 @@
 #include "knowhere/comp/knowhere_config.h"
 #include "knowhere/dataset.h"
 #include "knowhere/log.h"
+#include "simd/hook.h"
 #include "utils.h"
 
 namespace {
 constexpr float kKnnRecallThreshold = 0.8f;
 
+// the assignments are compared exactly, so they are computed by the fp32 kernels instead of the bf16 AMX tiles
+struct ScopedFp32Assignment {
+    ScopedFp32Assignment() : support_amx_(faiss::support_amx) {
+        faiss::support_amx = false;
+    }
+    ~ScopedFp32Assignment() {
+        faiss::support_amx = support_amx_;
+    }
+
+ private:
+    const bool support_amx_;
+};
+
 }  // namespace
 
 // use kNN search to test the correctness of kmeans
@@ -89,3 +104,82 @@ TEST_CASE("Test Kmeans With Float Vector", "[float metrics]") {
         REQUIRE(recall > kKnnRecallThreshold);
     }
 }
+
+#ifndef KNOWHERE_WITH_CARDINAL
+TEST_CASE("Test Kmeans Training Modes", "[float metrics]") {
+    const int64_t nb = 5000, dim = 16;
+    const int64_t num_clusters = 10;
+
+    // well separated blobs, row i belongs to blob i % num_clusters
+    std::mt19937 rng(42);
+    std::normal_distribution<float> distrib(0, 1);
+    std::vector<float> centers(num_clusters * dim);
+    for (auto& c : centers) {
+        c = distrib(rng) * 20;
+    }
+    std::vector<float> xb(nb * dim);
+    for (int64_t i = 0; i < nb; ++i) {
+        for (int64_t j = 0; j < dim; ++j) {
+            xb[i * dim + j] = centers[(i % num_clusters) * dim + j] + distrib(rng);
+        }
+    }
+    auto train_ds = knowhere::GenDataSet(nb, dim, xb.data());
+    ScopedFp32Assignment fp32_assignment;
+
+    auto train = [&](const std::string& mode, bool use_elkan) {
+        auto cluster =
+            knowhere::ClusterFactory::Instance().Create<knowhere::fp32>(knowhere::ClusterEnum::CLUSTER_KMEANS);
+        REQUIRE(cluster.has_value());
+        knowhere::Json json;
+        json[knowhere::indexparam::NUM_CLUSTERS] = num_clusters;
+        json[knowhere::indexparam::KMEANS_MODE] = mode;
+        json[knowhere::indexparam::KMEANS_BATCH_SIZE] = 1024;
+        json[knowhere::indexparam::USE_ELKAN] = use_elkan;
+        auto res = cluster.value().Train(*train_ds, json);
+        REQUIRE(res.has_value());
+        auto assign = reinterpret_cast<const uint32_t*>(res.value()->GetTensor());
+
+        auto centroids = cluster.value().GetCentroids();
+        REQUIRE(centroids.has_value());
+        REQUIRE(centroids.value()->GetRows() == num_clusters);
+        REQUIRE(centroids.value()->GetDim() == dim);
+
+        // assigning the training rows again gives the training assignment
+        auto assign_res = cluster.value().Assign(*train_ds);
+        REQUIRE(assign_res.has_value());
+        auto reassign = reinterpret_cast<const uint32_t*>(assign_res.value()->GetTensor());
+        return std::make_pair(std::vector<uint32_t>(assign, assign + nb),
+                              std::vector<uint32_t>(reassign, reassign + nb));
+    };
+
+    SECTION("Test blobs are recovered") {
+        auto mode = GENERATE(as<std::string>{}, "lloyd", "mini_batch", "streaming");
+        CAPTURE(mode);
+        auto [assign, reassign] = train(mode, true);
+        REQUIRE(assign == reassign);
+        // every blob maps to a single cluster
+        for (int64_t i = num_clusters; i < nb; ++i) {
+            REQUIRE(assign[i] == assign[i % num_clusters]);
+        }
+        std::unordered_set<uint32_t> used(assign.begin(), assign.end());
+        REQUIRE(used.size() == num_clusters);
+    }
+
+    SECTION("Test bounds do not change lloyd") {
+        REQUIRE(train("lloyd", true).first == train("lloyd", false).first);
+    }
+
+    SECTION("Test invalid config") {
+        auto cluster =
+            knowhere::ClusterFactory::Instance().Create<knowhere::fp32>(knowhere::ClusterEnum::CLUSTER_KMEANS);
+        knowhere::Json json;
+        json[knowhere::indexparam::NUM_CLUSTERS] = num_clusters;
+        json[knowhere::indexparam::KMEANS_MODE] = "unknown";
+        REQUIRE(cluster.value().Train(*train_ds, json).error() == knowhere::Status::invalid_args);
+        json[knowhere::indexparam::KMEANS_MODE] = "lloyd";
+        json[knowhere::indexparam::NUM_CLUSTERS] = nb + 1;
+        REQUIRE(cluster.value().Train(*train_ds, json).error() == knowhere::Status::invalid_args);
+        REQUIRE(cluster.value().Assign(*train_ds).error() == knowhere::Status::index_not_trained);
+    }
+}
+#endif
@@ -10,6 +10,7 @@
 // or implied. See the License for the specific language governing permissions and limitations under the License.
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -27,6 +28,10 @@
 #include "catch2/catch_approx.hpp"
 #include "catch2/catch_test_macros.hpp"
 #include "catch2/generators/catch_generators.hpp"
+#include "faiss/IndexHNSW.h"
+#include "index/hnsw/impl/IndexConditionalWrapper.h"
+#include "index/hnsw/impl/IndexHNSWWrapper.h"
+#include "knowhere/bitsetview_idselector.h"
 #include "knowhere/comp/brute_force.h"
 #include "knowhere/comp/index_param.h"
 #include "knowhere/comp/knowhere_config.h"
@@ -394,6 +399,61 @@ test_hnsw_range(const knowhere::DataSetPtr& default_ds_ptr, const knowhere::Data
     return index_file_name;
 }
 
+// the data and the config shared by the tests of the search modes of the faiss HNSW searcher
+struct FaissHnswSearchModeFixture {
+    static constexpr int64_t nb = 10000, nq = 50, dim = 32, k = 10;
+    // the recall every search mode keeps on this data at ef 64
+    static constexpr float kMinRecall = 0.9f;
+
+    const knowhere::DataSetPtr train_ds = GenDataSet(nb, dim, 42);
+    const knowhere::DataSetPtr query_ds = GenDataSet(nq, dim, 43);
+
+    knowhere::Json
+    Conf(const std::string& metric = knowhere::metric::L2) const {
+        knowhere::Json conf;
+        conf[knowhere::meta::DIM] = dim;
+        conf[knowhere::meta::METRIC_TYPE] = metric;
+        conf[knowhere::meta::TOPK] = k;
+        conf[knowhere::indexparam::HNSW_M] = 16;
+        conf[knowhere::indexparam::EFCONSTRUCTION] = 100;
+        conf[knowhere::indexparam::EF] = 64;
+        return conf;
+    }
+
+    knowhere::DataSetPtr
+    GroundTruth(const knowhere::Json& conf, const knowhere::BitsetView& bitset) const {
+        auto gt = knowhere::BruteForce::Search<knowhere::fp32>(train_ds, query_ds, conf, bitset);
+        REQUIRE(gt.has_value());
+        return gt.value();
+    }
+
+    knowhere::Index<knowhere::IndexNode>
+    Build(const std::string& index_type, const knowhere::Json& conf,
+          const int32_t version = knowhere::Version::GetCurrentVersion().VersionNumber()) const {
+        auto idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(index_type, version).value();
+        REQUIRE(idx.Build(train_ds, conf) == knowhere::Status::success);
+        return idx;
+    }
+
+    // a faiss graph over train_ds, searched with the knowhere searcher
+    std::unique_ptr<faiss::IndexHNSWFlat>
+    BuildGraph(const bool dense_level0 = false) const {
+        auto index = std::make_unique<faiss::IndexHNSWFlat>(dim, 16);
+        index->keep_max_size_level0 = dense_level0;
+        index->add(nb, (const float*)train_ds->GetTensor());
+        return index;
+    }
+
+    knowhere::DataSetPtr
+    SearchGraph(faiss::IndexHNSWFlat& index, const knowhere::SearchParametersHNSWWrapper& params) const {
+        auto ids = std::make_unique<faiss::idx_t[]>(nq * k);
+        auto distances = std::make_unique<float[]>(nq * k);
+        knowhere::IndexHNSWWrapper wrapper(&index);
+        wrapper.search(nq, (const float*)query_ds->GetTensor(), k, distances.get(), ids.get(), &params);
+        return knowhere::GenResultDataSet(nq, k, std::move(ids), std::move(distances));
+    }
+};
+
 }  // namespace
 
 TEST_CASE("Search for FAISS HNSW Indices", "Benchmark and validation") {
@@ -2436,3 +2496,593 @@ TEST_CASE("External ID Map for 1-hop Bitset Check", "[external_id_map]") {
         }
     }
 }
+
+TEST_CASE("Merge FAISS HNSW Indices", "[merge]") {
+    const int64_t nb = 4000, nq = 50;
+    const int64_t dim = 32;
+    const int64_t topk = 10;
+    const int64_t nb_a = nb * 3 / 5;
+    auto version = GenTestVersionList();
+
+    const auto train_ds = GenDataSet(nb, dim, 42);
+    const auto query_ds = GenDataSet(nq, dim, 4321);
+    const auto* xb = (const float*)train_ds->GetTensor();
+    const auto ds_a = knowhere::GenDataSet(nb_a, dim, xb);
+    const auto ds_b = knowhere::GenDataSet(nb - nb_a, dim, xb + nb_a * dim);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::TOPK] = topk;
+    json[knowhere::indexparam::HNSW_M] = 16;
+    json[knowhere::indexparam::EFCONSTRUCTION] = 96;
+    json[knowhere::indexparam::EF] = 64;
+
+    auto build = [&](const std::string& index_type, const knowhere::Json& conf, const knowhere::DataSetPtr& ds) {
+        auto idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(index_type, version).value();
+        REQUIRE(idx.Build(ds, conf) == knowhere::Status::success);
+        return idx;
+    };
+
+    SECTION("Test merged search") {
+        auto metric = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::IP, knowhere::metric::COSINE);
+        // copied codes, and codes encoded again from the exact vectors of a refine storage
+        auto [index_type, sq_type, refine] = GENERATE(table<std::string, std::string, bool>({
+            {knowhere::IndexEnum::INDEX_HNSW, "", false},
+            {knowhere::IndexEnum::INDEX_HNSW_SQ, "FP16", false},
+            {knowhere::IndexEnum::INDEX_HNSW_SQ, "SQ8", true},
+        }));
+        CAPTURE(metric, index_type, sq_type, refine);
+
+        knowhere::Json conf = json;
+        conf[knowhere::meta::METRIC_TYPE] = metric;
+        if (!sq_type.empty()) {
+            conf[knowhere::indexparam::SQ_TYPE] = sq_type;
+        }
+        if (refine) {
+            conf["refine"] = true;
+            conf["refine_type"] = "FLAT";
+            conf["refine_k"] = 1.5;
+        }
+
+        auto idx_a = build(index_type, conf, ds_a);
+        auto idx_b = build(index_type, conf, ds_b);
+        REQUIRE(idx_a.Merge(idx_b, conf) == knowhere::Status::success);
+        REQUIRE(idx_a.Count() == nb);
+        // other is left untouched
+        REQUIRE(idx_b.Count() == nb - nb_a);
+
+        auto gt = knowhere::BruteForce::Search<knowhere::fp32>(train_ds, query_ds, conf, nullptr);
+        REQUIRE(gt.has_value());
+        auto results = idx_a.Search(query_ds, conf, nullptr);
+        REQUIRE(results.has_value());
+        // as good as a graph built on all the vectors
+        auto idx_full = build(index_type, conf, train_ds);
+        auto full_results = idx_full.Search(query_ds, conf, nullptr);
+        REQUIRE(full_results.has_value());
+        float recall = GetKNNRecall(*gt.value(), *results.value());
+        float full_recall = GetKNNRecall(*gt.value(), *full_results.value());
+        REQUIRE(recall >= full_recall - 0.05f);
+
+        // both halves are reachable, the vectors of other follow the ones of this index
+        if (metric != knowhere::metric::IP) {
+            for (int64_t id : {int64_t(0), nb - 1}) {
+                auto self_ds = knowhere::GenDataSet(1, dim, xb + id * dim);
+                auto self = idx_a.Search(self_ds, conf, nullptr);
+                REQUIRE(self.has_value());
+                auto self_ids = self.value()->GetIds();
+                REQUIRE(std::find(self_ids, self_ids + topk, id) != self_ids + topk);
+            }
+        }
+
+        if (index_type == knowhere::IndexEnum::INDEX_HNSW) {
+            std::vector<int64_t> ids = {0, nb_a - 1, nb_a, nb - 1};
+            auto vectors = idx_a.GetVectorByIds(GenIdsDataSet(ids.size(), ids));
+            REQUIRE(vectors.has_value());
+            auto data = (const float*)vectors.value()->GetTensor();
+            for (size_t i = 0; i < ids.size(); ++i) {
+                REQUIRE(std::equal(data + i * dim, data + (i + 1) * dim, xb + ids[i] * dim));
+            }
+        }
+
+        knowhere::BinarySet bs;
+        REQUIRE(idx_a.Serialize(bs) == knowhere::Status::success);
+        auto loaded = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(index_type, version).value();
+        REQUIRE(loaded.Deserialize(bs, conf) == knowhere::Status::success);
+        auto loaded_results = loaded.Search(query_ds, conf, nullptr);
+        REQUIRE(loaded_results.has_value());
+        REQUIRE(GetKNNRecall(*results.value(), *loaded_results.value()) == 1.0f);
+
+        // indexes loaded in place are merged too, into memory the merged index owns
+        auto load = [&](const knowhere::Index<knowhere::IndexNode>& idx) {
+            knowhere::BinarySet idx_bs;
+            REQUIRE(idx.Serialize(idx_bs) == knowhere::Status::success);
+            auto idx_loaded = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(index_type, version).value();
+            REQUIRE(idx_loaded.Deserialize(idx_bs, conf) == knowhere::Status::success);
+            return idx_loaded;
+        };
+        auto loaded_a = load(build(index_type, conf, ds_a));
+        auto loaded_b = load(idx_b);
+        REQUIRE(loaded_a.Merge(loaded_b, conf) == knowhere::Status::success);
+        REQUIRE(loaded_a.Count() == nb);
+        auto loaded_merge_results = loaded_a.Search(query_ds, conf, nullptr);
+        REQUIRE(loaded_merge_results.has_value());
+        REQUIRE(GetKNNRecall(*gt.value(), *loaded_merge_results.value()) >= full_recall - 0.05f);
+    }
+
+    SECTION("Test merged quantized codes") {
+        knowhere::Json conf = json;
+        conf[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+        conf[knowhere::indexparam::SQ_TYPE] = "SQ8";
+        auto idx_a = build(knowhere::IndexEnum::INDEX_HNSW_SQ, conf, ds_a);
+
+        // the codes are copied as they are when both quantizers were trained to the same ranges
+        auto idx_same = build(knowhere::IndexEnum::INDEX_HNSW_SQ, conf, ds_a);
+        REQUIRE(idx_a.Merge(idx_same, conf) == knowhere::Status::success);
+        REQUIRE(idx_a.Count() == 2 * nb_a);
+        auto self_ds = knowhere::GenDataSet(1, dim, xb);
+        auto self = idx_a.Search(self_ds, conf, nullptr);
+        REQUIRE(self.has_value());
+        // both copies of the vector have the same code, so the same distance
+        REQUIRE(self.value()->GetDistance()[0] == self.value()->GetDistance()[1]);
+
+        // without the exact vectors, codes trained on other ranges would be quantized twice
+        auto idx_b = build(knowhere::IndexEnum::INDEX_HNSW_SQ, conf, ds_b);
+        REQUIRE(idx_a.Merge(idx_b, conf) == knowhere::Status::invalid_args);
+        REQUIRE(idx_a.Count() == 2 * nb_a);
+    }
+
+    SECTION("Test incompatible merges") {
+        knowhere::Json conf = json;
+        conf[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+        auto idx_a = build(knowhere::IndexEnum::INDEX_HNSW, conf, ds_a);
+
+        knowhere::Json other_m = conf;
+        other_m[knowhere::indexparam::HNSW_M] = 8;
+        auto idx_m = build(knowhere::IndexEnum::INDEX_HNSW, other_m, ds_b);
+        REQUIRE(idx_a.Merge(idx_m, conf) == knowhere::Status::invalid_args);
+
+        knowhere::Json sq_conf = conf;
+        sq_conf[knowhere::indexparam::SQ_TYPE] = "SQ8";
+        auto idx_sq = build(knowhere::IndexEnum::INDEX_HNSW_SQ, sq_conf, ds_b);
+        REQUIRE(idx_a.Merge(idx_sq, conf) == knowhere::Status::invalid_args);
+
+        knowhere::Json pq_conf = conf;
+        pq_conf[knowhere::indexparam::M] = 8;
+        pq_conf[knowhere::indexparam::NBITS] = 8;
+        auto idx_pq = build(knowhere::IndexEnum::INDEX_HNSW_PQ, pq_conf, ds_a);
+        auto idx_pq_b = build(knowhere::IndexEnum::INDEX_HNSW_PQ, pq_conf, ds_b);
+        REQUIRE(idx_pq.Merge(idx_pq_b, pq_conf) == knowhere::Status::not_implemented);
+
+        // a failed merge leaves the index as it was
+        REQUIRE(idx_a.Count() == nb_a);
+        REQUIRE(idx_a.Search(query_ds, conf, nullptr).has_value());
+    }
+}
+
+TEST_CASE("HNSW search cost model", "[cost model]") {
+    const int64_t nb = 20000, dim = 64;
+    auto train_ds = GenDataSet(nb, dim, 42);
+
+    faiss::IndexHNSWFlat index(dim, 16);
+    index.add(nb, (const float*)train_ds->GetTensor());
+
+    const auto model = knowhere::HnswSearchCostModel::Calibrate(&index, false);
+    REQUIRE(model.IsCalibratedFor(&index));
+    REQUIRE(model.ndis_per_candidate >= 1.0f);
+    REQUIRE(model.graph_distance_cost > 1.0f);
+    // the ratio is learned for a few k, a search uses the one of the largest not above its k
+    for (size_t i = 0; i < std::size(model.early_stop_ratios); i++) {
+        REQUIRE(model.early_stop_ratios[i] >= 1.0f);
+        REQUIRE(model.EarlyStopRatio(knowhere::HnswSearchCostModel::kEarlyStopKs[i]) == model.early_stop_ratios[i]);
+    }
+    REQUIRE(model.EarlyStopRatio(1) == model.early_stop_ratios[0]);
+    REQUIRE(model.EarlyStopRatio(16) == model.early_stop_ratios[1]);
+    REQUIRE(model.EarlyStopRatio(1000) == model.early_stop_ratios[3]);
+
+    // the same graph gives the same model, a mapped one only has more expensive random accesses
+    const auto model_again = knowhere::HnswSearchCostModel::Calibrate(&index, false);
+    REQUIRE(model_again.ndis_upper == model.ndis_upper);
+    REQUIRE(model_again.ndis_per_candidate == model.ndis_per_candidate);
+    for (size_t i = 0; i < std::size(model.early_stop_ratios); i++) {
+        REQUIRE(model_again.early_stop_ratios[i] == model.early_stop_ratios[i]);
+    }
+    const auto model_mmapped = knowhere::HnswSearchCostModel::Calibrate(&index, true);
+    REQUIRE(model_mmapped.ndis_per_candidate == model.ndis_per_candidate);
+    REQUIRE(model_mmapped.graph_distance_cost > model.graph_distance_cost);
+
+    // a walk gets more expensive with the filter, but never computes more than nb distances
+    REQUIRE(model.GraphSearchCost(64, 0.5f) > model.GraphSearchCost(64, 0.0f));
+    REQUIRE(model.GraphSearchCost(64, 1.0f) == Catch::Approx(nb * model.graph_distance_cost));
+    // expanding the rejected nodes keeps the distances computed close to an unfiltered walk
+    REQUIRE(model.GraphSearchCost(64, 0.9f, true) < model.GraphSearchCost(64, 0.9f));
+
+    faiss::IndexHNSWFlat empty_index(dim, 16);
+    REQUIRE(!knowhere::HnswSearchCostModel::Calibrate(&empty_index, false).IsCalibratedFor(&empty_index));
+
+    knowhere::FaissHnswConfig cfg;
+    cfg.k = 10;
+    cfg.ef = 64;
+    auto whether_bf_search = [&](const float filter_ratio) {
+        auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, filter_ratio * nb);
+        knowhere::BitsetView bitset(bitset_data.data(), nb);
+        return knowhere::WhetherPerformBruteForceSearch(&index, cfg, bitset, &model).value();
+    };
+    REQUIRE(!knowhere::WhetherPerformBruteForceSearch(&index, cfg, nullptr, &model).value());
+    REQUIRE(!whether_bf_search(0.5f));
+    REQUIRE(whether_bf_search(0.999f));
+
+    // a brute force over a few thousand vectors is cheaper than a walk that would keep most of them
+    cfg.ef = 2000;
+    REQUIRE(whether_bf_search(0.9f));
+
+    // past the fixed thresholds a brute force is used even if the model finds the walk cheaper
+    auto cheap_walk_model = model;
+    cheap_walk_model.graph_distance_cost = 1e-6f;
+    cfg.ef = 64;
+    auto whether_bf = [&](const float filter_ratio, const bool range) {
+        auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, filter_ratio * nb);
+        knowhere::BitsetView bitset(bitset_data.data(), nb);
+        return range ? knowhere::WhetherPerformBruteForceRangeSearch(&index, cfg, bitset, &cheap_walk_model).value()
+                     : knowhere::WhetherPerformBruteForceSearch(&index, cfg, bitset, &cheap_walk_model).value();
+    };
+    REQUIRE(!whether_bf(0.9f, false));
+    REQUIRE(whether_bf(0.95f, false));
+    REQUIRE(!whether_bf(0.95f, true));
+    REQUIRE(whether_bf(0.98f, true));
+}
+
+TEST_CASE("HNSW filtered search recall at high filter ratios", "[cost model]") {
+    const int64_t nb = 20000, nq = 50, dim = 32, k = 10;
+    auto train_ds = GenDataSet(nb, dim, 42);
+    auto query_ds = GenDataSet(nq, dim, 43);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    json[knowhere::meta::TOPK] = k;
+    json[knowhere::indexparam::HNSW_M] = 16;
+    json[knowhere::indexparam::EFCONSTRUCTION] = 100;
+    json[knowhere::indexparam::EF] = 64;
+
+    auto idx = knowhere::IndexFactory::Instance()
+                   .Create<knowhere::fp32>(knowhere::IndexEnum::INDEX_HNSW,
+                                           knowhere::Version::GetCurrentVersion().VersionNumber())
+                   .value();
+    REQUIRE(idx.Build(train_ds, json) == knowhere::Status::success);
+
+    // whichever plan the calibrated model picks, the recall may not fall below the one of the fixed thresholds
+    const float filter_ratio = GENERATE(0.9f, 0.95f, 0.99f);
+    CAPTURE(filter_ratio);
+    auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, filter_ratio * nb);
+    knowhere::BitsetView bitset(bitset_data.data(), nb);
+    auto gt = knowhere::BruteForce::Search<knowhere::fp32>(train_ds, query_ds, json, bitset);
+    REQUIRE(gt.has_value());
+
+    auto results = idx.Search(query_ds, json, bitset);
+    REQUIRE(results.has_value());
+    const float recall = GetKNNRecall(*gt.value(), *results.value());
+    // a brute force is exact past the fixed filter threshold
+    REQUIRE(recall >= (filter_ratio >= knowhere::HnswSearchThresholds::kHnswSearchKnnBFFilterThreshold ? 0.99f : 0.8f));
+}
+
+TEST_CASE_METHOD(FaissHnswSearchModeFixture, "Two-hop filtered search for FAISS HNSW", "[two hop filter]") {
+    const auto json = Conf();
+    const float filter_ratio = GENERATE(0.5f, 0.8f, 0.9f);
+    CAPTURE(filter_ratio);
+    auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, filter_ratio * nb);
+    knowhere::BitsetView bitset(bitset_data.data(), nb);
+    auto gt = GroundTruth(json, bitset);
+
+    SECTION("Test the walk stays on the admitted nodes") {
+        const bool dense_level0 = GENERATE(false, true);
+        CAPTURE(dense_level0);
+        auto index = BuildGraph(dense_level0);
+
+        knowhere::BitsetViewIDSelector bw_idselector(bitset);
+        knowhere::SearchParametersHNSWWrapper params;
+        params.efSearch = 64;
+        params.sel = &bw_idselector;
+        auto kalpha_results = SearchGraph(*index, params);
+        params.two_hop_filter = true;
+        auto results = SearchGraph(*index, params);
+
+        // the results are filled with admitted nodes only
+        auto ids = results->GetIds();
+        for (int64_t i = 0; i < nq * k; i++) {
+            REQUIRE(ids[i] >= 0);
+            REQUIRE(!bitset.test(ids[i]));
+        }
+
+        const float recall = GetKNNRecall(*gt, *results);
+        REQUIRE(recall >= kMinRecall);
+        // past half of the nodes filtered out, staying on the admitted nodes finds at least as much
+        if (filter_ratio >= 0.8f) {
+            REQUIRE(recall >= GetKNNRecall(*gt, *kalpha_results) - 0.01f);
+        }
+    }
+
+    SECTION("Test the config") {
+        knowhere::Json conf = json;
+        conf["dense_level0"] = true;
+        conf["two_hop_filter"] = true;
+        auto idx = Build(knowhere::IndexEnum::INDEX_HNSW, conf);
+
+        auto results = idx.Search(query_ds, conf, bitset);
+        REQUIRE(results.has_value());
+        REQUIRE(GetKNNRecall(*gt, *results.value()) >= kMinRecall);
+    }
+}
+
+TEST_CASE("GetVectorByIds for FAISS HNSW Indices", "[get vector by ids]") {
+    // more rows than a single copy task takes
+    const int64_t nb = 3000;
+    const int64_t dim = 16;
+    const auto train_ds = GenDataSet(nb, dim, 42);
+    const std::string index_file_name = "/tmp/faiss_hnsw_get_vector_by_ids.index";
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    json[knowhere::indexparam::HNSW_M] = 8;
+    json[knowhere::indexparam::EFCONSTRUCTION] = 32;
+
+    // shuffled, with duplicates, and more of them than the rows
+    std::mt19937 rng(123);
+    std::uniform_int_distribution<int64_t> distrib(0, nb - 1);
+    std::vector<int64_t> ids(nb * 3 / 2);
+    for (auto& id : ids) {
+        id = distrib(rng);
+    }
+
+    const bool load_with_mmap = GENERATE(false, true);
+    CAPTURE(load_with_mmap);
+
+    auto check = [&](auto type_tag, const std::string& index_type, const std::string& sq_type,
+                     const std::string& refine_type) {
+        using T = decltype(type_tag);
+        CAPTURE(index_type, sq_type, refine_type);
+
+        knowhere::Json conf = json;
+        if (!sq_type.empty()) {
+            conf[knowhere::indexparam::SQ_TYPE] = sq_type;
+        }
+        if (!refine_type.empty()) {
+            conf["refine"] = true;
+            conf["refine_type"] = refine_type;
+        }
+        auto train_t_ds = knowhere::ConvertToDataTypeIfNeeded<T>(train_ds);
+        auto version = knowhere::Version::GetCurrentVersion().VersionNumber();
+        auto idx = knowhere::IndexFactory::Instance().Create<T>(index_type, version).value();
+        REQUIRE(idx.Build(train_t_ds, conf) == knowhere::Status::success);
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+
+        auto loaded = knowhere::IndexFactory::Instance().Create<T>(index_type, version).value();
+        if (load_with_mmap) {
+            auto binary = bs.GetByName(loaded.Type());
+            std::ofstream out(index_file_name, std::ios::binary);
+            out.write((const char*)binary->data.get(), binary->size);
+            out.close();
+            conf["enable_mmap"] = true;
+            REQUIRE(loaded.DeserializeFromFile(index_file_name, conf) == knowhere::Status::success);
+        } else {
+            REQUIRE(loaded.Deserialize(bs, conf) == knowhere::Status::success);
+        }
+        REQUIRE(loaded.HasRawData(knowhere::metric::L2));
+
+        auto vectors = loaded.GetVectorByIds(GenIdsDataSet(ids.size(), ids));
+        REQUIRE(vectors.has_value());
+        REQUIRE(vectors.value()->GetRows() == (int64_t)ids.size());
+        const auto baseline = (const T*)train_t_ds->GetTensor();
+        const auto candidate = (const T*)vectors.value()->GetTensor();
+        for (size_t i = 0; i < ids.size(); i++) {
+            REQUIRE(std::equal(candidate + i * dim, candidate + (i + 1) * dim, baseline + ids[i] * dim));
+        }
+
+        std::vector<int64_t> out_of_range = {0, nb};
+        REQUIRE(!loaded.GetVectorByIds(GenIdsDataSet(out_of_range.size(), out_of_range)).has_value());
+        std::remove(index_file_name.c_str());
+    };
+
+    SECTION("FLAT") {
+        check(knowhere::fp32{}, knowhere::IndexEnum::INDEX_HNSW, "", "");
+    }
+    SECTION("FP16") {
+        check(knowhere::fp16{}, knowhere::IndexEnum::INDEX_HNSW, "", "");
+    }
+    SECTION("INT8") {
+        check(knowhere::int8{}, knowhere::IndexEnum::INDEX_HNSW, "", "");
+    }
+    SECTION("SQ with a refine storage") {
+        check(knowhere::bf16{}, knowhere::IndexEnum::INDEX_HNSW_SQ, "SQ8", "BF16");
+    }
+}
+
+TEST_CASE_METHOD(FaissHnswSearchModeFixture, "Entry points for FAISS HNSW Indices", "[entry points]") {
+    auto version = GenTestVersionList();
+    auto metric = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::COSINE);
+    auto [index_type, sq_type] = GENERATE(table<std::string, std::string>({
+        {knowhere::IndexEnum::INDEX_HNSW, ""},
+        {knowhere::IndexEnum::INDEX_HNSW_SQ, "SQ8"},
+    }));
+    const float filter_ratio = GENERATE(0.0f, 0.5f);
+    CAPTURE(metric, index_type, filter_ratio);
+
+    knowhere::Json conf = Conf(metric);
+    conf["num_entry_points"] = 16;
+    if (!sq_type.empty()) {
+        conf[knowhere::indexparam::SQ_TYPE] = sq_type;
+    }
+
+    auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, filter_ratio * nb);
+    knowhere::BitsetView bitset(bitset_data.data(), nb);
+    auto gt = GroundTruth(conf, bitset);
+
+    auto idx = Build(index_type, conf, version);
+    auto results = idx.Search(query_ds, conf, bitset);
+    REQUIRE(results.has_value());
+    const float recall = GetKNNRecall(*gt, *results.value());
+    REQUIRE(recall >= kMinRecall);
+
+    // the entry points are stored with the index
+    knowhere::BinarySet bs;
+    REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+    auto loaded = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(index_type, version).value();
+    REQUIRE(loaded.Deserialize(bs, conf) == knowhere::Status::success);
+    auto loaded_results = loaded.Search(query_ds, conf, bitset);
+    REQUIRE(loaded_results.has_value());
+    REQUIRE(GetKNNRecall(*results.value(), *loaded_results.value()) == 1.0f);
+
+    // an index built without them still loads and searches from the upper levels, to about the same recall
+    knowhere::Json no_ep_conf = conf;
+    no_ep_conf["num_entry_points"] = 0;
+    auto no_ep = Build(index_type, no_ep_conf, version);
+    knowhere::BinarySet no_ep_bs;
+    REQUIRE(no_ep.Serialize(no_ep_bs) == knowhere::Status::success);
+    REQUIRE(no_ep_bs.GetByName(no_ep.Type())->size < bs.GetByName(idx.Type())->size);
+    auto no_ep_results = no_ep.Search(query_ds, no_ep_conf, bitset);
+    REQUIRE(no_ep_results.has_value());
+    const float no_ep_recall = GetKNNRecall(*gt, *no_ep_results.value());
+    REQUIRE(no_ep_recall >= kMinRecall);
+    REQUIRE(recall >= no_ep_recall - 0.02f);
+}
+
+TEST_CASE_METHOD(FaissHnswSearchModeFixture, "Early stop for FAISS HNSW", "[early stop]") {
+    const auto json = Conf();
+    auto gt = GroundTruth(json, nullptr);
+
+    SECTION("Test the walk ends before ef") {
+        auto index = BuildGraph();
+
+        auto search = [&](const size_t patience, const float ratio) {
+            faiss::HNSWStats stats;
+            knowhere::SearchParametersHNSWWrapper params;
+            params.efSearch = 256;
+            params.hnsw_stats = &stats;
+            params.early_stop_patience = patience;
+            params.early_stop_ratio = ratio;
+            auto results = SearchGraph(*index, params);
+            return std::make_pair(GetKNNRecall(*gt, *results), stats.ndis);
+        };
+
+        const auto [full_recall, full_ndis] = search(0, 0.0f);
+        REQUIRE(full_recall >= kMinRecall);
+        for (const auto& [patience, ratio] : std::vector<std::pair<size_t, float>>{{32, 0.0f}, {0, 2.0f}}) {
+            CAPTURE(patience, ratio);
+            const auto [recall, ndis] = search(patience, ratio);
+            REQUIRE(ndis < full_ndis);
+            REQUIRE(recall >= full_recall - 0.02f);
+        }
+    }
+
+    SECTION("Test the walk ends once the request is stopped") {
+        auto index = BuildGraph();
+
+        faiss::HNSWStats stats, stopped_stats;
+        knowhere::SearchParametersHNSWWrapper params;
+        params.efSearch = 256;
+        params.hnsw_stats = &stats;
+        SearchGraph(*index, params);
+
+        // the first poll stops the walk, the candidates found until then are kept
+        std::atomic<size_t> n_polls{0};
+        params.hnsw_stats = &stopped_stats;
+        params.should_stop = [&n_polls]() {
+            n_polls++;
+            return true;
+        };
+        auto results = SearchGraph(*index, params);
+        REQUIRE(n_polls > 0);
+        REQUIRE(stopped_stats.ndis < stats.ndis);
+        for (int64_t i = 0; i < nq; i++) {
+            REQUIRE(results->GetIds()[i * k] >= 0);
+        }
+    }
+
+    SECTION("Test the config") {
+        knowhere::Json conf = json;
+        conf[knowhere::indexparam::EF] = 128;
+        auto idx = Build(knowhere::IndexEnum::INDEX_HNSW, conf);
+
+        auto early_stop = GENERATE(as<std::string>{}, "early_stop_patience", "learned_early_stop");
+        CAPTURE(early_stop);
+        if (early_stop == "learned_early_stop") {
+            conf[early_stop] = true;
+        } else {
+            conf[early_stop] = 32;
+        }
+        auto results = idx.Search(query_ds, conf, nullptr);
+        REQUIRE(results.has_value());
+        REQUIRE(GetKNNRecall(*gt, *results.value()) >= kMinRecall);
+    }
+}
+
+TEST_CASE_METHOD(FaissHnswSearchModeFixture, "Lazy refine for FAISS HNSW", "[lazy refine]") {
+    auto version = GenTestVersionList();
+    auto metric = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::IP, knowhere::metric::COSINE);
+    auto index_type =
+        GENERATE(as<std::string>{}, knowhere::IndexEnum::INDEX_HNSW_SQ, knowhere::IndexEnum::INDEX_HNSW_PQ);
+    const float filter_ratio = GENERATE(0.0f, 0.5f);
+    CAPTURE(metric, index_type, filter_ratio);
+
+    knowhere::Json conf = Conf(metric);
+    if (index_type == knowhere::IndexEnum::INDEX_HNSW_SQ) {
+        conf[knowhere::indexparam::SQ_TYPE] = "SQ6";
+    } else {
+        conf[knowhere::indexparam::M] = 8;
+        conf[knowhere::indexparam::NBITS] = 8;
+    }
+    conf["refine"] = true;
+    conf["refine_type"] = "FLAT";
+    conf["refine_k"] = 4;
+
+    auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, filter_ratio * nb);
+    knowhere::BitsetView bitset(bitset_data.data(), nb);
+    auto gt = GroundTruth(conf, bitset);
+
+    auto idx = Build(index_type, conf, version);
+    auto results = idx.Search(query_ds, conf, bitset);
+    REQUIRE(results.has_value());
+
+    knowhere::Json lazy_conf = conf;
+    lazy_conf["lazy_refine"] = true;
+    auto lazy_results = idx.Search(query_ds, lazy_conf, bitset);
+    REQUIRE(lazy_results.has_value());
+
+    // the results are the exact distances in the order of the metric, as good as a full refine
+    const bool is_similarity = metric != knowhere::metric::L2;
+    auto ids = lazy_results.value()->GetIds();
+    auto distances = lazy_results.value()->GetDistance();
+    for (int64_t i = 0; i < nq; i++) {
+        for (int64_t j = 1; j < k; j++) {
+            if (ids[i * k + j] < 0) {
+                continue;
+            }
+            REQUIRE((is_similarity ? distances[i * k + j] <= distances[i * k + j - 1]
+                                   : distances[i * k + j] >= distances[i * k + j - 1]));
+        }
+    }
+    const float recall = GetKNNRecall(*gt, *results.value());
+    if (index_type == knowhere::IndexEnum::INDEX_HNSW_SQ) {
+        REQUIRE(recall >= kMinRecall);
+    }
+    REQUIRE(GetKNNRecall(*gt, *lazy_results.value()) >= recall - 0.02f);
+
+    // with a margin that never ends the rerank early, the k * refine_k candidates of a full refine are reranked
+    knowhere::Json wide_margin_conf = lazy_conf;
+    wide_margin_conf["lazy_refine_margin"] = 1e6f;
+    auto wide_margin_results = idx.Search(query_ds, wide_margin_conf, bitset);
+    REQUIRE(wide_margin_results.has_value());
+    REQUIRE(GetKNNRecall(*results.value(), *wide_margin_results.value()) >= 0.99f);
+
+    // the walk keeps as many candidates as a full refine picks from, even with an ef as small as k
+    knowhere::Json small_ef_conf = conf;
+    small_ef_conf[knowhere::indexparam::EF] = k;
+    auto small_ef_results = idx.Search(query_ds, small_ef_conf, bitset);
+    REQUIRE(small_ef_results.has_value());
+    small_ef_conf["lazy_refine"] = true;
+    auto small_ef_lazy_results = idx.Search(query_ds, small_ef_conf, bitset);
+    REQUIRE(small_ef_lazy_results.has_value());
+    REQUIRE(GetKNNRecall(*gt, *small_ef_lazy_results.value()) >=
+            GetKNNRecall(*gt, *small_ef_results.value()) - 0.02f);
+}
@@ -177,6 +177,12 @@ TEST_CASE("Test Iterator Mem Index With Float Vector", "[float metrics]") {
         return json;
     };
 
+    auto ivf_adaptive_gen = [ivf_base_gen]() {
+        knowhere::Json json = ivf_base_gen();
+        json[knowhere::indexparam::ADAPTIVE_NPROBE] = true;
+        return json;
+    };
+
     auto ivfflatcc_gen = [base_gen]() {
         knowhere::Json json = base_gen();
         json[knowhere::indexparam::NPROBE] = 16;
@@ -230,8 +236,10 @@ TEST_CASE("Test Iterator Mem Index With Float Vector", "[float metrics]") {
         using std::make_tuple;
         auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>(
             {make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivf_base_gen),
+             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivf_adaptive_gen),
              make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT_CC, ivfflatcc_gen),
              make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, ivf_base_gen),
+             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, ivf_adaptive_gen),
              make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ_CC, ivf_sq_cc_gen),
 #ifdef KNOWHERE_WITH_CARDINAL
              make_tuple(knowhere::IndexEnum::INDEX_CARDINAL_TIERED, hnsw_gen),
@@ -9,6 +9,7 @@
 // is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
 // or implied. See the License for the specific language governing permissions and limitations under the License.
 
+#include <atomic>
 #include <filesystem>
 #include <future>
 
@@ -145,6 +146,73 @@ TEST_CASE("Test Build Search Concurrency", "[Concurrency]") {
         }
     }
 
+    SECTION("Test Concurrent Invlists Append & Scan") {
+        // small segments make the writer grow the segment directory many times while the readers scan
+        size_t nlist = 4;
+        size_t code_size = 16;
+        size_t segment_size = 4;
+        size_t rounds = 2000;
+        size_t batch_size = 7;
+        size_t reader_num = 4;
+
+        faiss::ConcurrentArrayInvertedLists invList(nlist, code_size, segment_size, true);
+        std::atomic<bool> done{false};
+        std::atomic<size_t> mismatch{0};
+
+        auto writer = std::async(std::launch::async, [&] {
+            std::vector<faiss::idx_t> ids(batch_size);
+            std::vector<uint8_t> codes(batch_size * code_size);
+            std::vector<float> norms(batch_size);
+            for (size_t r = 0; r < rounds; r++) {
+                for (size_t i = 0; i < nlist; i++) {
+                    size_t offset = invList.list_size(i);
+                    for (size_t j = 0; j < batch_size; j++) {
+                        ids[j] = offset + j;
+                        norms[j] = offset + j;
+                        std::fill_n(codes.data() + j * code_size, code_size, (uint8_t)(offset + j));
+                    }
+                    invList.add_entries(i, batch_size, ids.data(), codes.data(), norms.data());
+                }
+            }
+            done.store(true);
+        });
+
+        std::vector<std::future<void>> readers;
+        for (size_t t = 0; t < reader_num; t++) {
+            readers.push_back(std::async(std::launch::async, [&] {
+                // every entry below the published segment sizes must be fully written
+                while (!done.load()) {
+                    for (size_t i = 0; i < nlist; i++) {
+                        size_t segment_num = invList.get_segment_num(i);
+                        for (size_t s = 0; s < segment_num; s++) {
+                            size_t offset = invList.get_segment_offset(i, s);
+                            size_t size = invList.get_segment_size(i, s);
+                            const faiss::idx_t* ids = invList.get_ids(i, offset);
+                            const uint8_t* codes = invList.get_codes(i, offset);
+                            const float* norms = invList.get_code_norms(i, offset);
+                            for (size_t j = 0; j < size; j++) {
+                                if (ids[j] != (faiss::idx_t)(offset + j) || norms[j] != (float)(offset + j) ||
+                                    codes[j * code_size + code_size - 1] != (uint8_t)(offset + j)) {
+                                    mismatch++;
+                                }
+                            }
+                        }
+                    }
+                }
+            }));
+        }
+
+        writer.get();
+        for (auto& reader : readers) {
+            reader.get();
+        }
+        CHECK(mismatch.load() == 0);
+        for (size_t i = 0; i < nlist; i++) {
+            CHECK(invList.list_size(i) == rounds * batch_size);
+            CHECK(invList.get_segment_num(i) == (rounds * batch_size + segment_size - 1) / segment_size);
+        }
+    }
+
     SECTION("Test Add & Search & RangeSearch Serialized ") {
         using std::make_tuple;
         auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>({
@@ -31,8 +31,13 @@ TEST_CASE("Knowhere global config", "[init]") {
     REQUIRE(knowhere::KnowhereConfig::GetEarlyStopThreshold() == early_stop_threshold);
 
     knowhere::KnowhereConfig::SetClusteringType(knowhere::KnowhereConfig::ClusteringType::K_MEANS_PLUS_PLUS);
+    knowhere::KnowhereConfig::SetClusteringType(knowhere::KnowhereConfig::ClusteringType::K_MEANS_HIERARCHICAL);
     knowhere::KnowhereConfig::SetClusteringType(knowhere::KnowhereConfig::ClusteringType::K_MEANS);
 
+    knowhere::KnowhereConfig::SetClusteringSizeSpread(2.0);
+    REQUIRE(knowhere::KnowhereConfig::GetClusteringSizeSpread() == 2.0);
+    knowhere::KnowhereConfig::SetClusteringSizeSpread(0);
+
     size_t prev_build_thread_num = knowhere::KnowhereConfig::GetBuildThreadPoolSize();
     knowhere::KnowhereConfig::SetBuildThreadPoolSize(8);
     REQUIRE(knowhere::KnowhereConfig::GetBuildThreadPoolSize() == 8);
@@ -12,6 +12,11 @@
 #include "catch2/catch_approx.hpp"
 #include "catch2/catch_test_macros.hpp"
 #include "catch2/generators/catch_generators.hpp"
+#include "faiss/IndexFlat.h"
+#include "faiss/IndexIVF.h"
+#include "faiss/IndexIVFRaBitQ.h"
+#include "faiss/impl/io.h"
+#include "faiss/index_io.h"
 #include "faiss/utils/binary_distances.h"
 #include "hnswlib/hnswalg.h"
 #include "knowhere/bitsetview.h"
@@ -21,6 +26,7 @@
 #include "knowhere/comp/knowhere_config.h"
 #include "knowhere/index/index_factory.h"
 #include "knowhere/log.h"
+#include "knowhere/prometheus_client.h"
 #include "simd/hook.h"
 #include "utils.h"
 
@@ -28,6 +34,31 @@ namespace {
 constexpr float kKnnRecallThreshold = 0.6f;
 constexpr float kBruteForceRecallThreshold = 0.95f;
 constexpr const char* kMmapIndexPath = "/tmp/knowhere_dense_mmap_index_test";
+
+// the faiss index of an IVF index, read back from its index file
+std::unique_ptr<faiss::IndexIVF>
+ReadIvfIndex(const knowhere::Index<knowhere::IndexNode>& idx) {
+    knowhere::BinarySet bs;
+    REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+    auto binary = bs.GetByName(idx.Type());
+    REQUIRE(binary != nullptr);
+    faiss::VectorIOReader reader;
+    reader.data.assign(binary->data.get(), binary->data.get() + binary->size);
+    std::unique_ptr<faiss::Index> index(faiss::read_index(&reader));
+    REQUIRE(dynamic_cast<faiss::IndexIVF*>(index.get()) != nullptr);
+    return std::unique_ptr<faiss::IndexIVF>(static_cast<faiss::IndexIVF*>(index.release()));
+}
+
+// the inverted list sizes of an IVF index
+std::vector<size_t>
+GetIvfListSizes(const knowhere::Index<knowhere::IndexNode>& idx) {
+    auto ivf = ReadIvfIndex(idx);
+    std::vector<size_t> sizes(ivf->nlist);
+    for (size_t i = 0; i < ivf->nlist; i++) {
+        sizes[i] = ivf->invlists->list_size(i);
+    }
+    return sizes;
+}
 }  // namespace
 
 TEST_CASE("Test Mem Index With Float Vector", "[float metrics]") {
@@ -474,6 +505,129 @@ TEST_CASE("Test Mem Index With Float Vector", "[float metrics]") {
         }
     }
 
+    SECTION("Test Multi Search") {
+        using std::make_tuple;
+        // a single probe makes the filtered queries of ensure_topk_full go on past the shared scan
+        auto ivfflatcc_nprobe_1_gen = [ivfflatcc_gen]() {
+            knowhere::Json json = ivfflatcc_gen();
+            json[knowhere::indexparam::NPROBE] = 1;
+            json[knowhere::indexparam::ENSURE_TOPK_FULL] = true;
+            return json;
+        };
+        auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>({
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IDMAP, flat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivfflat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, ivfsq_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFPQ, ivfpq_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT_CC, ivfflatcc_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT_CC, ivfflatcc_nprobe_1_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ_CC, ivfsqcc_code_size_8_gen),
+        }));
+        auto idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+        auto cfg_json = gen().dump();
+        CAPTURE(name, cfg_json);
+        knowhere::Json json = knowhere::Json::parse(cfg_json);
+        REQUIRE(idx.Build(train_ds, json) == knowhere::Status::success);
+
+        // every query gets its own top-k and filter, some of the filters are shared and some are empty
+        auto first_bits = GenerateBitsetWithFirstTbitsSet(nb, 0.4f * nb);
+        auto random_bits = GenerateBitsetWithRandomTbitsSet(nb, 0.8f * nb);
+        std::vector<int64_t> ks(nq);
+        std::vector<knowhere::BitsetView> bitsets(nq);
+        for (int64_t i = 0; i < nq; ++i) {
+            ks[i] = (i % 3 == 0) ? topk : (topk + i) / 2;
+            if (i % 3 == 1) {
+                bitsets[i] = knowhere::BitsetView(first_bits.data(), nb);
+            } else if (i % 3 == 2) {
+                bitsets[i] = knowhere::BitsetView(random_bits.data(), nb);
+            }
+        }
+
+        auto results = idx.MultiSearch(query_ds, json, ks, bitsets);
+        REQUIRE(results.has_value());
+        REQUIRE(results.value().size() == (size_t)nq);
+        auto xq = (const float*)query_ds->GetTensor();
+        for (int64_t i = 0; i < nq; ++i) {
+            auto single_json = json;
+            single_json[knowhere::meta::TOPK] = ks[i];
+            auto single_ds = knowhere::GenDataSet(1, dim, xq + i * dim);
+            auto expected = idx.Search(single_ds, single_json, bitsets[i]);
+            REQUIRE(expected.has_value());
+
+            const auto& res = results.value()[i];
+            REQUIRE(res->GetRows() == 1);
+            REQUIRE(res->GetDim() == ks[i]);
+            for (int64_t j = 0; j < ks[i]; ++j) {
+                auto id = res->GetIds()[j];
+                REQUIRE((id >= 0) == (expected.value()->GetIds()[j] >= 0));
+                if (id >= 0) {
+                    REQUIRE((bitsets[i].empty() || !bitsets[i].test(id)));
+                    REQUIRE(res->GetDistance()[j] == Approx(expected.value()->GetDistance()[j]).epsilon(1e-4));
+                }
+            }
+        }
+
+        // the number of top-k and bitsets must match the number of queries
+        ks.pop_back();
+        REQUIRE(idx.MultiSearch(query_ds, json, ks, bitsets).error() == knowhere::Status::invalid_args);
+    }
+
+    SECTION("Test Search Timeout") {
+        using std::make_tuple;
+        auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>({
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IDMAP, flat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivfflat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_HNSW, hnsw_gen),
+            make_tuple("HNSWLIB_DEPRECATED", hnsw_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFRABITQ, ivfrabitq_refine_flat_gen),
+        }));
+        auto idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+        auto cfg_json = gen().dump();
+        CAPTURE(name, cfg_json);
+        knowhere::Json json = knowhere::Json::parse(cfg_json);
+        REQUIRE(idx.Build(train_ds, json) == knowhere::Status::success);
+        const bool is_graph = name == knowhere::IndexEnum::INDEX_HNSW || name == "HNSWLIB_DEPRECATED";
+        // the queries are searched in groups by the batched RaBitQ scan
+        const bool is_batched = name == knowhere::IndexEnum::INDEX_FAISS_IVFRABITQ;
+
+        // a generous budget does not change the result
+        json[knowhere::meta::SEARCH_TIMEOUT_MS] = 3600 * 1000;
+        auto results = idx.Search(query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        REQUIRE(!results.value()->Get<bool>(knowhere::meta::PARTIAL_RESULT));
+
+        // an expired budget is an error unless partial results are allowed
+        json[knowhere::meta::SEARCH_TIMEOUT_MS] = 0;
+        results = idx.Search(query_ds, json, nullptr);
+        REQUIRE(results.error() == knowhere::Status::timeout);
+
+        json[knowhere::meta::ALLOW_PARTIAL_RESULT] = true;
+        auto aborted = knowhere::knowhere_search_aborted_queries.Value();
+        results = idx.Search(query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        REQUIRE(results.value()->Get<bool>(knowhere::meta::PARTIAL_RESULT));
+        REQUIRE(results.value()->GetRows() == nq);
+        REQUIRE(results.value()->GetDim() == topk);
+        if (is_graph || is_batched) {
+            // every query is either skipped or has its traversal cut short
+            REQUIRE(knowhere::knowhere_search_aborted_queries.Value() == aborted + nq);
+        }
+        if (is_graph) {
+
+            // the iterators of an expired request end right away, they are counted once all of them are released
+            aborted = knowhere::knowhere_search_aborted_queries.Value();
+            {
+                auto its = idx.AnnIterator(query_ds, json, nullptr);
+                REQUIRE(its.has_value());
+                for (auto& it : its.value()) {
+                    REQUIRE(!it->HasNext());
+                }
+                REQUIRE(knowhere::knowhere_search_aborted_queries.Value() == aborted);
+            }
+            REQUIRE(knowhere::knowhere_search_aborted_queries.Value() == aborted + nq);
+        }
+    }
+
     SECTION("Test Serialize/Deserialize") {
         using std::make_tuple;
         auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>(
@@ -513,6 +667,81 @@ TEST_CASE("Test Mem Index With Float Vector", "[float metrics]") {
         REQUIRE(results.has_value());
     }
 
+    SECTION("Test Add after Deserialize") {
+        using std::make_tuple;
+        auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>(
+            {make_tuple(knowhere::IndexEnum::INDEX_FAISS_IDMAP, flat_gen),
+             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivfflat_gen),
+             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT_CC, ivfflatcc_gen),
+             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFSQ8, ivfsq_gen),
+             make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFPQ, ivfpq_gen),
+             make_tuple(knowhere::IndexEnum::INDEX_HNSW, hnsw_gen),
+             make_tuple(knowhere::IndexEnum::INDEX_HNSW_SQ, hnsw_gen)}));
+        auto idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+        auto cfg_json = gen().dump();
+        CAPTURE(name, cfg_json);
+        knowhere::Json json = knowhere::Json::parse(cfg_json);
+        REQUIRE(idx.Build(train_ds, json) == knowhere::Status::success);
+
+        auto idx_ = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+        {
+            knowhere::BinarySet bs;
+            REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+            REQUIRE(idx_.Deserialize(bs) == knowhere::Status::success);
+        }
+        // the index is loaded in place, it keeps the serialized binary alive on its own
+        auto results = idx_.Search(query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        auto ref = idx.Search(query_ds, json, nullptr);
+        REQUIRE(ref.has_value());
+        auto ids = results.value()->GetIds();
+        auto ref_ids = ref.value()->GetIds();
+        REQUIRE(std::equal(ids, ids + nq * topk, ref_ids));
+
+        // the first add copies the storage out of the binary, the loaded index grows like the built one
+        REQUIRE(idx_.Add(train_ds, json) == knowhere::Status::success);
+        REQUIRE(idx.Add(train_ds, json) == knowhere::Status::success);
+        REQUIRE(idx_.Count() == 2 * nb);
+        results = idx_.Search(query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        ref = idx.Search(query_ds, json, nullptr);
+        REQUIRE(ref.has_value());
+        REQUIRE(GetKNNRecall(*ref.value(), *results.value()) >= kKnnRecallThreshold);
+    }
+
+    SECTION("Test SerializeToFile") {
+        using std::make_tuple;
+        auto [name, gen] = GENERATE_REF(table<std::string, std::function<knowhere::Json()>>({
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IDMAP, flat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, ivfflat_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_FAISS_IVFPQ, ivfpq_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_HNSW, hnsw_gen),
+            make_tuple(knowhere::IndexEnum::INDEX_HNSW_SQ, hnsw_gen),
+        }));
+        auto idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+        auto cfg_json = gen().dump();
+        CAPTURE(name, cfg_json);
+        knowhere::Json json = knowhere::Json::parse(cfg_json);
+        REQUIRE(idx.Build(train_ds, json) == knowhere::Status::success);
+
+        // the streamed file holds the same bytes as the binary set
+        knowhere::BinarySet bs;
+        REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+        auto binary = bs.GetByName(idx.Type());
+        std::remove(kMmapIndexPath);
+        REQUIRE(idx.SerializeToFile(kMmapIndexPath) == knowhere::Status::success);
+        std::ifstream in(kMmapIndexPath, std::ios::binary);
+        std::vector<char> file_data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        REQUIRE(file_data.size() == (size_t)binary->size);
+        REQUIRE(std::memcmp(file_data.data(), binary->data.get(), binary->size) == 0);
+
+        auto idx_ = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+        REQUIRE(idx_.DeserializeFromFile(kMmapIndexPath, json) == knowhere::Status::success);
+        auto results = idx_.Search(query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        std::remove(kMmapIndexPath);
+    }
+
     SECTION("Test IVFPQ with invalid params") {
         auto idx = knowhere::IndexFactory::Instance()
                        .Create<knowhere::fp32>(knowhere::IndexEnum::INDEX_FAISS_IVFPQ, version)
@@ -832,3 +1061,484 @@ TEST_CASE("Test Mem Index With Binary Vector", "[bool metrics]") {
     }
 #endif
 }
+
+TEST_CASE("Test IVF With Hierarchical Clustering", "[float metrics]") {
+    const int64_t nlist = 1024;
+    const int64_t nb = nlist * 40, nq = 100;
+    const int64_t dim = 16;
+    const int64_t topk = 10;
+    auto version = GenTestVersionList();
+
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = GenDataSet(nq, dim, 4321);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    json[knowhere::meta::TOPK] = topk;
+    json[knowhere::indexparam::NLIST] = nlist;
+    json[knowhere::indexparam::NPROBE] = 128;
+    auto gt = knowhere::BruteForce::Search<knowhere::fp32>(train_ds, query_ds, json, nullptr);
+
+    auto size_spread = GENERATE(as<double>{}, 0.0, 1.1, 2.0);
+    CAPTURE(size_spread);
+    knowhere::KnowhereConfig::SetClusteringType(knowhere::KnowhereConfig::ClusteringType::K_MEANS_HIERARCHICAL);
+    knowhere::KnowhereConfig::SetClusteringSizeSpread(size_spread);
+
+    auto idx = knowhere::IndexFactory::Instance()
+                   .Create<knowhere::fp32>(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT, version)
+                   .value();
+    auto status = idx.Build(train_ds, json);
+
+    knowhere::KnowhereConfig::SetClusteringType(knowhere::KnowhereConfig::ClusteringType::K_MEANS);
+    knowhere::KnowhereConfig::SetClusteringSizeSpread(0);
+    REQUIRE(status == knowhere::Status::success);
+
+    auto results = idx.Search(query_ds, json, nullptr);
+    REQUIRE(results.has_value());
+    float recall = GetKNNRecall(*gt.value(), *results.value());
+    REQUIRE(recall > kKnnRecallThreshold);
+
+    if (size_spread > 0) {
+        // the cap holds for the lists filled by the add, not just the training assignment
+        const auto cap = static_cast<size_t>(std::ceil(size_spread * nb / nlist));
+        for (auto size : GetIvfListSizes(idx)) {
+            REQUIRE(size <= cap);
+        }
+    }
+
+    // a cap 10% over the average list size moves vectors out of their nearest lists, which voids the list bounds
+    const bool capped = ReadIvfIndex(idx)->lists_capped;
+    if (size_spread == 0.0) {
+        REQUIRE(!capped);
+    } else if (size_spread == 1.1) {
+        REQUIRE(capped);
+    }
+    if (capped) {
+        // adaptive_nprobe is ignored, all the probed lists are scanned
+        json[knowhere::indexparam::ENSURE_TOPK_FULL] = false;
+        results = idx.Search(query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        json[knowhere::indexparam::ADAPTIVE_NPROBE] = true;
+        auto adaptive_results = idx.Search(query_ds, json, nullptr);
+        REQUIRE(adaptive_results.has_value());
+        REQUIRE(GetKNNRecall(*results.value(), *adaptive_results.value()) == 1.0f);
+    }
+}
+
+TEST_CASE("Test IVF With Quantized Coarse Quantizer", "[float metrics]") {
+    const int64_t nlist = 256;
+    const int64_t nb = nlist * 40, nq = 100;
+    const int64_t dim = 32;
+    const int64_t topk = 10;
+    auto version = GenTestVersionList();
+
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = GenDataSet(nq, dim, 4321);
+
+    auto name = GENERATE(as<std::string>{}, knowhere::IndexEnum::INDEX_FAISS_IVFFLAT,
+                         knowhere::IndexEnum::INDEX_FAISS_IVFSQ8);
+    auto metric = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::COSINE);
+    auto coarse_quantizer = GENERATE(as<std::string>{}, "hnsw", "sq8");
+    CAPTURE(name, metric, coarse_quantizer);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = metric;
+    json[knowhere::meta::TOPK] = topk;
+    json[knowhere::indexparam::NLIST] = nlist;
+    json[knowhere::indexparam::NPROBE] = 32;
+
+    // the same centroids are trained with both quantizers, only the picked lists may differ
+    auto flat_idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+    REQUIRE(flat_idx.Build(train_ds, json) == knowhere::Status::success);
+    auto flat_results = flat_idx.Search(query_ds, json, nullptr);
+    REQUIRE(flat_results.has_value());
+
+    json[knowhere::indexparam::COARSE_QUANTIZER] = coarse_quantizer;
+    auto idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+    REQUIRE(idx.Build(train_ds, json) == knowhere::Status::success);
+    // the vectors are added to their exact nearest lists, only the probing is approximate
+    REQUIRE(GetIvfListSizes(idx) == GetIvfListSizes(flat_idx));
+
+    // the coarse quantizer is read back from the index file
+    knowhere::BinarySet bs;
+    REQUIRE(idx.Serialize(bs) == knowhere::Status::success);
+    idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+    REQUIRE(idx.Deserialize(bs, json) == knowhere::Status::success);
+
+    auto meta = idx.GetIndexMeta(json);
+    REQUIRE(meta.has_value());
+    REQUIRE(knowhere::Json::parse(meta.value()->GetJsonInfo())["quantizer_type_"] == coarse_quantizer);
+
+    auto results = idx.Search(query_ds, json, nullptr);
+    REQUIRE(results.has_value());
+    float recall = GetKNNRecall(*flat_results.value(), *results.value());
+    REQUIRE(recall > 0.95f);
+
+    SECTION("Test Invalid Coarse Quantizer") {
+        json[knowhere::indexparam::COARSE_QUANTIZER] = "pq";
+        auto invalid_idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+        REQUIRE(invalid_idx.Build(train_ds, json) == knowhere::Status::invalid_args);
+    }
+}
+
+TEST_CASE("Test IVF Adaptive Nprobe", "[float metrics]") {
+    const int64_t nlist = 256;
+    const int64_t nb = nlist * 40, nq = 100;
+    const int64_t dim = 8;
+    auto version = GenTestVersionList();
+
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = GenDataSet(nq, dim, 4321);
+
+    auto name = GENERATE(as<std::string>{}, knowhere::IndexEnum::INDEX_FAISS_IVFFLAT,
+                         knowhere::IndexEnum::INDEX_FAISS_IVFFLAT_CC);
+    auto topk = GENERATE(as<int64_t>{}, 1, 10, 100);
+    CAPTURE(name, topk);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    json[knowhere::meta::TOPK] = topk;
+    json[knowhere::indexparam::NLIST] = nlist;
+    json[knowhere::indexparam::NPROBE] = 64;
+    json[knowhere::indexparam::ENSURE_TOPK_FULL] = false;
+
+    auto idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+    REQUIRE(idx.Build(train_ds, json) == knowhere::Status::success);
+    auto results = idx.Search(query_ds, json, nullptr);
+    REQUIRE(results.has_value());
+
+    // the skipped lists can not hold a closer vector, so the exact distances give the same top-k
+    json[knowhere::indexparam::ADAPTIVE_NPROBE] = true;
+    auto adaptive_results = idx.Search(query_ds, json, nullptr);
+    REQUIRE(adaptive_results.has_value());
+    float recall = GetKNNRecall(*results.value(), *adaptive_results.value());
+    REQUIRE(recall > 0.99f);
+
+    // the bounds do not hold for IP, the setting is ignored
+    json[knowhere::meta::METRIC_TYPE] = knowhere::metric::IP;
+    auto ip_idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+    REQUIRE(ip_idx.Build(train_ds, json) == knowhere::Status::success);
+    REQUIRE(ip_idx.Search(query_ds, json, nullptr).has_value());
+
+    // nor without the exact centroid distances of a flat quantizer, all the probed lists are scanned
+    json[knowhere::meta::METRIC_TYPE] = knowhere::metric::L2;
+    json[knowhere::indexparam::COARSE_QUANTIZER] = "hnsw";
+    auto hnsw_idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(name, version).value();
+    REQUIRE(hnsw_idx.Build(train_ds, json) == knowhere::Status::success);
+    adaptive_results = hnsw_idx.Search(query_ds, json, nullptr);
+    REQUIRE(adaptive_results.has_value());
+    json[knowhere::indexparam::ADAPTIVE_NPROBE] = false;
+    results = hnsw_idx.Search(query_ds, json, nullptr);
+    REQUIRE(results.has_value());
+    REQUIRE(GetKNNRecall(*results.value(), *adaptive_results.value()) == 1.0f);
+}
+
+TEST_CASE("Test IVF RaBitQ Batched Scan", "[float metrics]") {
+    const int64_t nb = 5000, nq = 40;
+    const int64_t dim = 64;
+    const int64_t topk = 10;
+    auto version = GenTestVersionList();
+
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = GenDataSet(nq, dim, 4321);
+
+    auto metric = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::IP, knowhere::metric::COSINE);
+    auto bits_query = GENERATE(as<int32_t>{}, 0, 4);
+    auto refine = GENERATE(as<bool>{}, false, true);
+    auto filtered = GENERATE(as<bool>{}, false, true);
+    CAPTURE(metric, bits_query, refine, filtered);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = metric;
+    json[knowhere::meta::TOPK] = topk;
+    json[knowhere::indexparam::NLIST] = 32;
+    json[knowhere::indexparam::NPROBE] = 8;
+    json[knowhere::indexparam::RABITQ_QUERY_BITS] = bits_query;
+    if (refine) {
+        json["refine"] = true;
+        json["refine_type"] = "FLAT";
+        json["refine_k"] = 4;
+    }
+
+    auto idx =
+        knowhere::IndexFactory::Instance().Create<knowhere::fp32>(knowhere::IndexEnum::INDEX_FAISS_IVFRABITQ, version);
+    REQUIRE(idx.has_value());
+    REQUIRE(idx.value().Build(train_ds, json) == knowhere::Status::success);
+
+    auto bitset_data = GenerateBitsetWithRandomTbitsSet(nb, nb / 2);
+    knowhere::BitsetView bitset = filtered ? knowhere::BitsetView(bitset_data.data(), nb) : nullptr;
+
+    // a group of queries takes the batched scan, a single one the per-query scan
+    auto results = idx.value().Search(query_ds, json, bitset);
+    REQUIRE(results.has_value());
+    auto xq = (const float*)query_ds->GetTensor();
+    std::vector<std::vector<int64_t>> single_ids(nq);
+    for (int64_t i = 0; i < nq; ++i) {
+        auto single_ds = knowhere::GenDataSet(1, dim, xq + i * dim);
+        auto single = idx.value().Search(single_ds, json, bitset);
+        REQUIRE(single.has_value());
+        single_ids[i].assign(single.value()->GetIds(), single.value()->GetIds() + topk);
+    }
+    for (int64_t i = 0; i < nq * topk; ++i) {
+        auto id = results.value()->GetIds()[i];
+        if (filtered && id >= 0) {
+            REQUIRE(!bitset.test(id));
+        }
+    }
+
+    auto gt = knowhere::BruteForce::Search<knowhere::fp32>(train_ds, query_ds, json, bitset);
+    REQUIRE(gt.has_value());
+    // the same estimates are computed, only the order of the scan is different
+    REQUIRE(GetKNNRecall(*results.value(), single_ids) > 0.99f);
+
+    if (refine && knowhere::IsMetricType(metric, knowhere::metric::L2)) {
+        // the refine stops at the lower bounds on request, which hold with a high probability only
+        json[knowhere::indexparam::RABITQ_REFINE_BY_LOWER_BOUND] = true;
+        auto bounded_results = idx.value().Search(query_ds, json, bitset);
+        REQUIRE(bounded_results.has_value());
+        float recall = GetKNNRecall(*gt.value(), *bounded_results.value());
+        float single_recall = GetKNNRecall(*gt.value(), single_ids);
+        REQUIRE(recall >= single_recall - 0.05f);
+    }
+}
+
+TEST_CASE("Test IVF RaBitQ Batched Scan Stop Check", "[float metrics]") {
+    const int64_t nb = 2000, nq = 16;
+    const int64_t dim = 32;
+    const int64_t nlist = 16, nprobe = 4;
+    const int64_t topk = 10;
+
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = GenDataSet(nq, dim, 4321);
+    auto xb = (const float*)train_ds->GetTensor();
+    auto xq = (const float*)query_ds->GetTensor();
+
+    faiss::IndexFlatL2 quantizer(dim);
+    faiss::IndexIVFRaBitQ index(&quantizer, dim, nlist);
+    index.train(nb, xb);
+    index.add(nb, xb);
+
+    std::vector<faiss::idx_t> assign(nq * nprobe);
+    std::vector<float> coarse_dis(nq * nprobe);
+    quantizer.search(nq, xq, nprobe, coarse_dis.data(), assign.data());
+
+    // polled before every list, the scan keeps what it found before it was stopped
+    auto search = [&](int64_t stop_after) {
+        int64_t polls = 0;
+        faiss::IVFRaBitQSearchParameters params;
+        params.nprobe = nprobe;
+        params.should_stop = [&polls, stop_after]() { return ++polls > stop_after; };
+        std::vector<float> distances(nq * topk);
+        std::vector<faiss::idx_t> ids(nq * topk);
+        index.search_preassigned_batched(nq, xq, topk, assign.data(), distances.data(), ids.data(), &params);
+        auto found = std::count_if(ids.begin(), ids.end(), [](faiss::idx_t id) { return id >= 0; });
+        return std::make_pair(polls, found);
+    };
+
+    auto [all_polls, all_found] = search(std::numeric_limits<int64_t>::max());
+    REQUIRE(all_found == nq * topk);
+
+    auto [no_polls, no_found] = search(0);
+    REQUIRE(no_polls == 1);
+    REQUIRE(no_found == 0);
+
+    auto [one_polls, one_found] = search(1);
+    REQUIRE(one_polls == 2);
+    REQUIRE(one_found > 0);
+    REQUIRE(one_found < all_found);
+}
+
+TEST_CASE("Test IVF Batched Coarse Assignment", "[float metrics]") {
+    const int64_t nb = 10000, nq = 200;
+    const int64_t dim = 64;
+    const int64_t topk = 10;
+    auto version = GenTestVersionList();
+
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = GenDataSet(nq, dim, 4321);
+
+    auto metric = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::IP);
+    auto nprobe = GENERATE(as<int64_t>{}, 1, 8, 32);
+    CAPTURE(metric, nprobe);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = metric;
+    json[knowhere::meta::TOPK] = topk;
+    json[knowhere::indexparam::NLIST] = 256;
+    json[knowhere::indexparam::NPROBE] = nprobe;
+
+    auto idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT,
+                                                                         version);
+    REQUIRE(idx.has_value());
+    REQUIRE(idx.value().Build(train_ds, json) == knowhere::Status::success);
+
+    // without AMX the batched path runs the reference kernel, which still goes through the bf16 bound
+    const bool support_amx = faiss::support_amx;
+    faiss::support_amx = false;
+    auto expected = idx.value().Search(query_ds, json, nullptr);
+    REQUIRE(expected.has_value());
+
+    auto check = [&](const knowhere::Index<knowhere::IndexNode>& index) {
+        faiss::support_amx = true;
+        auto queries = knowhere::knowhere_ivf_batch_assign_queries.Value();
+        auto fallbacks = knowhere::knowhere_ivf_batch_assign_fallbacks.Value();
+        auto results = index.Search(query_ds, json, nullptr);
+        faiss::support_amx = support_amx;
+        REQUIRE(results.has_value());
+        REQUIRE(knowhere::knowhere_ivf_batch_assign_queries.Value() == queries + nq);
+        // the same lists are probed, whether certified by the bound or redone by the quantizer
+        for (int64_t i = 0; i < nq * topk; ++i) {
+            REQUIRE(results.value()->GetIds()[i] == expected.value()->GetIds()[i]);
+        }
+        // the approximate distances are in the same space as the exact ones, the bound rarely fails
+        REQUIRE(knowhere::knowhere_ivf_batch_assign_fallbacks.Value() - fallbacks <= nq / 20);
+    };
+    check(idx.value());
+
+    // the centered centroids are computed again on load
+    knowhere::BinarySet bs;
+    REQUIRE(idx.value().Serialize(bs) == knowhere::Status::success);
+    auto loaded = knowhere::IndexFactory::Instance().Create<knowhere::fp32>(knowhere::IndexEnum::INDEX_FAISS_IVFFLAT,
+                                                                            version);
+    REQUIRE(loaded.has_value());
+    REQUIRE(loaded.value().Deserialize(bs, json) == knowhere::Status::success);
+    check(loaded.value());
+}
+
+TEST_CASE("Test HNSW Delete and Consolidate", "[float metrics]") {
+    const int64_t nb = 2000, nq = 20;
+    const int64_t dim = 32;
+    const int64_t topk = 10;
+    auto version = GenTestVersionList();
+
+    const auto train_ds = GenDataSet(nb, dim);
+    const auto query_ds = GenDataSet(nq, dim, 4321);
+
+    auto metric = GENERATE(as<std::string>{}, knowhere::metric::L2, knowhere::metric::IP);
+    CAPTURE(metric);
+
+    knowhere::Json json;
+    json[knowhere::meta::DIM] = dim;
+    json[knowhere::meta::METRIC_TYPE] = metric;
+    json[knowhere::meta::TOPK] = topk;
+    json[knowhere::indexparam::HNSW_M] = 16;
+    json[knowhere::indexparam::EFCONSTRUCTION] = 120;
+    json[knowhere::indexparam::EF] = 64;
+
+    auto idx = knowhere::IndexFactory::Instance().Create<knowhere::fp32>("HNSWLIB_DEPRECATED", version);
+    REQUIRE(idx.has_value());
+    REQUIRE(idx.value().Build(train_ds, json) == knowhere::Status::success);
+
+    // tombstone a random half of the points
+    auto deleted_data = GenerateBitsetWithRandomTbitsSet(nb, nb / 2);
+    knowhere::BitsetView deleted(deleted_data.data(), nb);
+    std::vector<int64_t> deleted_ids;
+    for (int64_t i = 0; i < nb; ++i) {
+        if (deleted.test(i)) {
+            deleted_ids.push_back(i);
+        }
+    }
+    REQUIRE(idx.value().DeleteByIds(GenIdsDataSet(deleted_ids.size(), deleted_ids)) == knowhere::Status::success);
+    // deleting twice is a no-op
+    REQUIRE(idx.value().DeleteByIds(GenIdsDataSet(deleted_ids.size(), deleted_ids)) == knowhere::Status::success);
+    std::vector<int64_t> bad_ids = {0, nb};
+    REQUIRE(idx.value().DeleteByIds(GenIdsDataSet(bad_ids.size(), bad_ids)) == knowhere::Status::invalid_args);
+
+    auto gt = knowhere::BruteForce::Search<knowhere::fp32>(train_ds, query_ds, json, deleted);
+    REQUIRE(gt.has_value());
+
+    // the user filter is merged with the tombstones
+    auto filter_data = GenerateBitsetWithFirstTbitsSet(nb, nb / 10);
+    knowhere::BitsetView filter(filter_data.data(), nb);
+
+    auto check = [&](knowhere::Index<knowhere::IndexNode>& index) {
+        auto results = index.Search(query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        for (int64_t i = 0; i < nq * topk; ++i) {
+            auto id = results.value()->GetIds()[i];
+            REQUIRE((id < 0 || !deleted.test(id)));
+        }
+        REQUIRE(GetKNNRecall(*gt.value(), *results.value()) >= kKnnRecallThreshold);
+
+        auto filtered = index.Search(query_ds, json, filter);
+        REQUIRE(filtered.has_value());
+        for (int64_t i = 0; i < nq * topk; ++i) {
+            auto id = filtered.value()->GetIds()[i];
+            REQUIRE((id < 0 || (!deleted.test(id) && !filter.test(id))));
+        }
+
+        auto it = index.AnnIterator(query_ds, json, nullptr);
+        REQUIRE(it.has_value());
+        for (auto& iter : it.value()) {
+            for (int64_t j = 0; j < topk && iter->HasNext(); ++j) {
+                REQUIRE(!deleted.test(iter->Next().first));
+            }
+        }
+    };
+
+    check(idx.value());
+    REQUIRE(idx.value().Count() == nb);
+
+    // tombstones survive a round trip before and after the graph is repaired
+    auto round_trip = [&]() {
+        knowhere::BinarySet bs;
+        REQUIRE(idx.value().Serialize(bs) == knowhere::Status::success);
+        auto loaded = knowhere::IndexFactory::Instance().Create<knowhere::fp32>("HNSWLIB_DEPRECATED", version);
+        REQUIRE(loaded.has_value());
+        REQUIRE(loaded.value().Deserialize(bs, json) == knowhere::Status::success);
+        check(loaded.value());
+    };
+    round_trip();
+
+    REQUIRE(idx.value().Consolidate() == knowhere::Status::success);
+    check(idx.value());
+    // nothing left to repair
+    REQUIRE(idx.value().Consolidate() == knowhere::Status::success);
+    round_trip();
+
+    // ids stay stable, so a later delete still lands on the right point
+    std::vector<int64_t> more_ids;
+    for (int64_t i = 0; i < nb && more_ids.size() < 10; ++i) {
+        if (!deleted.test(i)) {
+            more_ids.push_back(i);
+            deleted_data[i >> 3] |= (0x1 << (i & 0x7));
+        }
+    }
+    REQUIRE(idx.value().DeleteByIds(GenIdsDataSet(more_ids.size(), more_ids)) == knowhere::Status::success);
+    REQUIRE(idx.value().Consolidate() == knowhere::Status::success);
+    gt = knowhere::BruteForce::Search<knowhere::fp32>(train_ds, query_ds, json, deleted);
+    REQUIRE(gt.has_value());
+    check(idx.value());
+
+    // deleting every point leaves an empty graph, it is searched and iterated without results
+    std::vector<int64_t> all_ids(nb);
+    for (int64_t i = 0; i < nb; ++i) {
+        all_ids[i] = i;
+    }
+    REQUIRE(idx.value().DeleteByIds(GenIdsDataSet(all_ids.size(), all_ids)) == knowhere::Status::success);
+    REQUIRE(idx.value().Consolidate() == knowhere::Status::success);
+    auto check_empty = [&](knowhere::Index<knowhere::IndexNode>& index) {
+        auto results = index.Search(query_ds, json, nullptr);
+        REQUIRE(results.has_value());
+        for (int64_t i = 0; i < nq * topk; ++i) {
+            REQUIRE(results.value()->GetIds()[i] == -1);
+        }
+        auto it = index.AnnIterator(query_ds, json, nullptr);
+        REQUIRE(it.has_value());
+        for (auto& iter : it.value()) {
+            REQUIRE(!iter->HasNext());
+        }
+    };
+    check_empty(idx.value());
+    knowhere::BinarySet bs;
+    REQUIRE(idx.value().Serialize(bs) == knowhere::Status::success);
+    auto loaded = knowhere::IndexFactory::Instance().Create<knowhere::fp32>("HNSWLIB_DEPRECATED", version);
+    REQUIRE(loaded.has_value());
+    REQUIRE(loaded.value().Deserialize(bs, json) == knowhere::Status::success);
+    check_empty(loaded.value());
+}
@@ -14,6 +14,7 @@
 #include "catch2/generators/catch_generators.hpp"
 #include "catch2/matchers/catch_matchers_floating_point.hpp"
 #include "knowhere/comp/knowhere_config.h"
+#include "knowhere/sparse_utils.h"
 #include "simd/distances_ref.h"
 #include "simd/hook.h"
 #include "utils.h"
@@ -583,3 +584,206 @@ TEST_CASE("Test distance") {
         run_test();
     }
 }
+
+TEST_CASE("Test batched inner products") {
+    auto simd_type = GENERATE(as<knowhere::KnowhereConfig::SimdType>{}, knowhere::KnowhereConfig::SimdType::AVX512,
+                              knowhere::KnowhereConfig::SimdType::AVX2, knowhere::KnowhereConfig::SimdType::GENERIC,
+                              knowhere::KnowhereConfig::SimdType::AUTO);
+    auto dim = GENERATE(as<size_t>{}, 1, 7, 16, 33, 64, 100, 128, 256);
+    // cover both full and partial tile blocks
+    auto nx = GENERATE(as<size_t>{}, 1, 31, 65);
+    const size_t ny = 47;
+
+    LOG_KNOWHERE_INFO_ << "simd type: " << simd_type << ", dim: " << dim << ", nx: " << nx
+                       << ", support amx: " << faiss::support_amx;
+    knowhere::KnowhereConfig::SetSimdType(simd_type);
+
+    // non-positive inputs, so that there is no cancellation in the sums
+    const float bf16_tolerance = 0.03f;
+    const auto x = GenRandomVector<float>(dim, nx, 314, 1);
+    const auto y = GenRandomVector<float>(dim, ny, 271, 1);
+    const auto x_bf16 = ConvertVector<knowhere::bf16>(x.get(), nx, dim);
+    const auto y_bf16 = ConvertVector<knowhere::bf16>(y.get(), ny, dim);
+
+    // int8 products are accumulated in int32, so they are exact
+    const auto x_int8 = GenRandomVector<knowhere::int8>(dim, nx, 314);
+    const auto y_int8 = GenRandomVector<knowhere::int8>(dim, ny, 271);
+
+    std::vector<float> dis(nx * ny);
+
+    faiss::fvec_inner_products_batch_bf16(dis.data(), x.get(), y.get(), dim, nx, ny);
+    for (size_t i = 0; i < nx; i++) {
+        for (size_t j = 0; j < ny; j++) {
+            auto ref = faiss::fvec_inner_product_ref(x.get() + i * dim, y.get() + j * dim, dim);
+            REQUIRE_THAT(dis[i * ny + j], Catch::Matchers::WithinRel(ref, bf16_tolerance));
+        }
+    }
+
+    // under the fp32-as-bf16 patch, only the y side is rounded, as in the per-pair patch kernels
+    knowhere::KnowhereConfig::EnablePatchForComputeFP32AsBF16();
+    faiss::fvec_inner_products_batch(dis.data(), x.get(), y.get(), dim, nx, ny);
+    knowhere::KnowhereConfig::DisablePatchForComputeFP32AsBF16();
+    if (faiss::support_amx) {
+        for (size_t i = 0; i < nx; i++) {
+            for (size_t j = 0; j < ny; j++) {
+                auto ref = faiss::fvec_inner_product_bf16_patch_ref(x.get() + i * dim, y.get() + j * dim, dim);
+                REQUIRE_THAT(dis[i * ny + j], Catch::Matchers::WithinRel(ref, 0.0001f));
+            }
+        }
+    }
+
+    faiss::bf16_vec_inner_products_batch(dis.data(), x_bf16.get(), y_bf16.get(), dim, nx, ny);
+    for (size_t i = 0; i < nx; i++) {
+        for (size_t j = 0; j < ny; j++) {
+            auto ref = faiss::bf16_vec_inner_product_ref(x_bf16.get() + i * dim, y_bf16.get() + j * dim, dim);
+            REQUIRE_THAT(dis[i * ny + j], Catch::Matchers::WithinRel(ref, 0.0001f));
+        }
+    }
+
+    faiss::int8_vec_inner_products_batch(dis.data(), x_int8.get(), y_int8.get(), dim, nx, ny);
+    for (size_t i = 0; i < nx; i++) {
+        for (size_t j = 0; j < ny; j++) {
+            auto ref = faiss::int8_vec_inner_product_ref(x_int8.get() + i * dim, y_int8.get() + j * dim, dim);
+            REQUIRE(dis[i * ny + j] == ref);
+        }
+    }
+}
+
+TEST_CASE("Test ny distance by ids") {
+    auto simd_type = GENERATE(as<knowhere::KnowhereConfig::SimdType>{}, knowhere::KnowhereConfig::SimdType::AVX512,
+                              knowhere::KnowhereConfig::SimdType::AVX2, knowhere::KnowhereConfig::SimdType::GENERIC,
+                              knowhere::KnowhereConfig::SimdType::AUTO);
+    auto dim = GENERATE(as<size_t>{}, 1, 7, 16, 17, 33, 64, 100, 128, 256);
+    // cover the 16, 8, 4-wide blocks and the leftovers
+    auto ny = GENERATE(as<size_t>{}, 0, 1, 5, 8, 15, 16, 31, 47);
+    const size_t nb = 200;
+
+    LOG_KNOWHERE_INFO_ << "simd type: " << simd_type << ", dim: " << dim << ", ny: " << ny;
+    knowhere::KnowhereConfig::SetSimdType(simd_type);
+
+    const float tolerance = 0.00001f;
+    const auto x = GenRandomVector<float>(dim, 1, 314);
+    const auto y = GenRandomVector<float>(dim, nb, 271);
+
+    // scattered ids, with repetitions
+    std::mt19937 rng(42);
+    std::vector<int64_t> ids(ny);
+    for (auto& id : ids) {
+        id = rng() % nb;
+    }
+
+    std::vector<float> dis(ny), ref(ny);
+    auto check = [&](const float tol) {
+        for (size_t j = 0; j < ny; j++) {
+            REQUIRE_THAT(dis[j], Catch::Matchers::WithinRel(ref[j], tol));
+        }
+    };
+
+    faiss::fvec_inner_products_ny_by_ids(dis.data(), x.get(), y.get(), ids.data(), dim, ny);
+    faiss::fvec_inner_products_ny_by_ids_ref(ref.data(), x.get(), y.get(), ids.data(), dim, ny);
+    check(tolerance);
+    faiss::fvec_L2sqr_ny_by_ids(dis.data(), x.get(), y.get(), ids.data(), dim, ny);
+    faiss::fvec_L2sqr_ny_by_ids_ref(ref.data(), x.get(), y.get(), ids.data(), dim, ny);
+    check(tolerance);
+
+    // fp32 computed as bf16
+    knowhere::KnowhereConfig::EnablePatchForComputeFP32AsBF16();
+    faiss::fvec_inner_products_ny_by_ids(dis.data(), x.get(), y.get(), ids.data(), dim, ny);
+    faiss::fvec_inner_products_ny_by_ids_bf16_patch_ref(ref.data(), x.get(), y.get(), ids.data(), dim, ny);
+    check(tolerance);
+    faiss::fvec_L2sqr_ny_by_ids(dis.data(), x.get(), y.get(), ids.data(), dim, ny);
+    faiss::fvec_L2sqr_ny_by_ids_bf16_patch_ref(ref.data(), x.get(), y.get(), ids.data(), dim, ny);
+    check(tolerance);
+    knowhere::KnowhereConfig::DisablePatchForComputeFP32AsBF16();
+}
+
+TEST_CASE("Test RaBitQ batched popcount") {
+    auto simd_type = GENERATE(as<knowhere::KnowhereConfig::SimdType>{}, knowhere::KnowhereConfig::SimdType::AVX512,
+                              knowhere::KnowhereConfig::SimdType::AVX2, knowhere::KnowhereConfig::SimdType::GENERIC,
+                              knowhere::KnowhereConfig::SimdType::AUTO);
+    auto dim = GENERATE(as<size_t>{}, 1, 7, 64, 100, 513);
+    // cover the 4-query blocks and the leftovers
+    auto nq = GENERATE(as<size_t>{}, 1, 4, 7);
+    // more query bits than the specialized kernels take fall back to the reference one
+    auto nb = GENERATE(as<size_t>{}, 1, 4, 8, 9);
+
+    LOG_KNOWHERE_INFO_ << "simd type: " << simd_type << ", dim: " << dim << ", nq: " << nq << ", nb: " << nb;
+    knowhere::KnowhereConfig::SetSimdType(simd_type);
+
+    const size_t code_size = (dim + 7) / 8;
+    std::mt19937 rng(42);
+    std::vector<uint8_t> q(nq * nb * code_size), x(code_size);
+    for (auto& v : q) {
+        v = rng();
+    }
+    for (auto& v : x) {
+        v = rng();
+    }
+
+    std::vector<int> dp(nq);
+    faiss::rabitq_dp_popcnt_batch(q.data(), nq, x.data(), dim, nb, dp.data());
+    for (size_t i = 0; i < nq; i++) {
+        REQUIRE(dp[i] == faiss::rabitq_dp_popcnt_ref(q.data() + i * nb * code_size, x.data(), dim, nb));
+    }
+}
+
+TEST_CASE("Test sparse intersection") {
+    auto simd_type = GENERATE(as<knowhere::KnowhereConfig::SimdType>{}, knowhere::KnowhereConfig::SimdType::AVX512,
+                              knowhere::KnowhereConfig::SimdType::AVX2, knowhere::KnowhereConfig::SimdType::GENERIC,
+                              knowhere::KnowhereConfig::SimdType::AUTO);
+    // cover full and partial blocks on both sides, and very different lengths
+    auto nx = GENERATE(as<size_t>{}, 0, 1, 7, 16, 33, 100);
+    auto ny = GENERATE(as<size_t>{}, 0, 3, 8, 17, 64, 1000);
+    auto max_index = GENERATE(as<uint32_t>{}, 100, 10000, std::numeric_limits<uint32_t>::max());
+    if (nx > max_index || ny > max_index) {
+        return;
+    }
+
+    LOG_KNOWHERE_INFO_ << "simd type: " << simd_type << ", nx: " << nx << ", ny: " << ny;
+    knowhere::KnowhereConfig::SetSimdType(simd_type);
+
+    std::mt19937 rng(42);
+    auto gen_row = [&](size_t n, std::vector<uint32_t>& ids) {
+        std::set<uint32_t> unique_ids;
+        while (unique_ids.size() < n) {
+            unique_ids.insert(rng() % max_index);
+        }
+        ids.assign(unique_ids.begin(), unique_ids.end());
+        std::vector<std::pair<knowhere::sparse::table_t, float>> elems;
+        for (auto id : ids) {
+            elems.emplace_back(id, (float)(rng() % 1000) / 100.0f);
+        }
+        return knowhere::sparse::SparseRow<float>(elems);
+    };
+    std::vector<uint32_t> x_ids, y_ids;
+    const auto x = gen_row(nx, x_ids);
+    const auto y = gen_row(ny, y_ids);
+    const auto x_data = static_cast<const char*>(x.data());
+    const auto y_data = static_cast<const char*>(y.data());
+
+    REQUIRE_THAT(faiss::sparse_inner_product(x_data, nx, y_data, ny),
+                 Catch::Matchers::WithinRel(faiss::sparse_inner_product_ref(x_data, nx, y_data, ny), 0.00001f));
+
+    // the matches may come in any order
+    const size_t max_matches = std::min(nx, ny);
+    std::vector<float> x_vals(max_matches), y_vals(max_matches), x_vals_ref(max_matches), y_vals_ref(max_matches);
+    auto n = faiss::sparse_intersect_values(x_data, nx, y_data, ny, x_vals.data(), y_vals.data());
+    auto n_ref = faiss::sparse_intersect_values_ref(x_data, nx, y_data, ny, x_vals_ref.data(), y_vals_ref.data());
+    REQUIRE(n == n_ref);
+    std::multiset<std::pair<float, float>> vals, vals_ref;
+    for (size_t i = 0; i < n; i++) {
+        vals.emplace(x_vals[i], y_vals[i]);
+        vals_ref.emplace(x_vals_ref[i], y_vals_ref[i]);
+    }
+    REQUIRE(vals == vals_ref);
+
+    std::vector<uint32_t> x_pos(max_matches), y_pos(max_matches);
+    n = faiss::u32_sorted_intersect(x_ids.data(), nx, y_ids.data(), ny, x_pos.data(), y_pos.data());
+    REQUIRE(n == n_ref);
+    std::set<uint32_t> matched;
+    for (size_t i = 0; i < n; i++) {
+        REQUIRE(x_ids[x_pos[i]] == y_ids[y_pos[i]]);
+        matched.insert(x_pos[i]);
+    }
+    REQUIRE(matched.size() == n);
+}
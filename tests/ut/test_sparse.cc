@@ -562,6 +562,36 @@ TEST_CASE("Test Mem Sparse Index CC", "[float metrics]") {
         }
     }
 
+    SECTION("Test GetVectorByIds with concurrent Add") {
+        // the rows of a batch have all their values in [base + 0.1, base + 0.9) and the queries took base 0, so a
+        // fetched row must come from the batch its id belongs to. ids past the rows added so far must be rejected.
+        auto get_task = [&]() {
+            auto start = std::chrono::steady_clock::now();
+            while (std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start).count() <
+                   test_time) {
+                auto count = idx.Count();
+                std::vector<int64_t> ids = {0, count / 2, count - 1};
+                auto results = idx.GetVectorByIds(GenIdsDataSet(ids.size(), ids));
+                REQUIRE(results.has_value());
+                auto res_data = (knowhere::sparse::SparseRow<float>*)results.value()->GetTensor();
+                for (size_t i = 0; i < ids.size(); ++i) {
+                    REQUIRE(res_data[i].size() == (size_t)dim);
+                    REQUIRE((int64_t)res_data[i][0].val == ids[i] / nb + 1);
+                }
+                std::vector<int64_t> out_of_range = {count + nb * 1000};
+                REQUIRE(!idx.GetVectorByIds(GenIdsDataSet(1, out_of_range)).has_value());
+            }
+        };
+        std::vector<std::future<void>> task_list;
+        for (int thread = 0; thread < 4; thread++) {
+            task_list.push_back(std::async(std::launch::async, get_task));
+        }
+        task_list.push_back(std::async(std::launch::async, add_task));
+        for (auto& task : task_list) {
+            task.wait();
+        }
+    }
+
     SECTION("Test GetVectorByIds") {
         std::vector<int64_t> ids = {0, 1, 2};
         REQUIRE(idx.HasRawData(metric) ==
@@ -4,6 +4,7 @@
 #pragma once
 #include <cassert>
 #include <condition_variable>
+#include <functional>
 #include <future>
 #include <mutex>
 #include <optional>
@@ -209,7 +210,8 @@ namespace diskann {
         const bool use_reorder_data = false, QueryStats *stats = nullptr,
         const knowhere::feder::diskann::FederResultUniq &feder = nullptr,
         knowhere::BitsetView                             bitset_view = nullptr,
-        const float                                      filter_ratio = -1.0f);
+        const float                                      filter_ratio = -1.0f,
+        const std::function<bool()>                     &should_stop = nullptr);
 
     void get_vector_by_ids(const int64_t *ids, const int64_t n,
                            T *const output_data);
@@ -1087,7 +1087,8 @@ namespace diskann {
       const T *query1, const _u64 k_search, const _u64 l_search, _s64 *indices,
       float *distances, const _u64 beam_width, const bool use_reorder_data,
       QueryStats *stats, const knowhere::feder::diskann::FederResultUniq &feder,
-      knowhere::BitsetView bitset_view, const float filter_ratio_in) {
+      knowhere::BitsetView bitset_view, const float filter_ratio_in,
+      const std::function<bool()> &should_stop) {
     if (beam_width > defaults::MAX_N_SECTOR_READS)
       throw ANNException("Beamwidth can not be higher than MAX_N_SECTOR_READS",
                          -1, __FUNCSIG__, __FILE__, __LINE__);
@@ -1251,6 +1252,11 @@ namespace diskann {
     };
 
     while (k < cur_list_size) {
+      // a cancelled or timed out request ends the search between beam rounds,
+      // the candidates found so far are still returned
+      if (should_stop && should_stop()) {
+        break;
+      }
       auto nk = cur_list_size;
       // clear iteration state
       frontier.clear();
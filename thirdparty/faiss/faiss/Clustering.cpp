@@ -11,11 +11,13 @@
 #include <faiss/VectorTransform.h>
 #include <faiss/impl/AuxIndexStructures.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cinttypes>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
+#include <numeric>
 
 #include <omp.h>
 
@@ -283,6 +285,142 @@ int split_clusters(
 
 ClusteringType clustering_type = ClusteringType::K_MEANS;
 double early_stop_threshold = 0.0;
+double clustering_size_spread = 0.0;
+
+namespace {
+
+// below this many centroids K_MEANS_HIERARCHICAL runs the regular k-means
+constexpr size_t kHierarchicalMinK = 1024;
+// nearest centroids a point may be moved to when balancing
+constexpr size_t kBalanceCandidates = 8;
+constexpr int kBalanceIterations = 3;
+
+// Splits k centroids among clusters of the given sizes in proportion to the
+// sizes (largest remainder), every non-empty cluster getting at least one and
+// at most as many as it has points. Requires the number of non-empty
+// clusters <= k <= sum(sizes).
+std::vector<size_t> allocate_centroids(
+        const std::vector<size_t>& sizes,
+        size_t k) {
+    const size_t n = std::accumulate(sizes.begin(), sizes.end(), size_t(0));
+    std::vector<size_t> alloc(sizes.size(), 0);
+    std::vector<double> remainder(sizes.size(), 0);
+    size_t total = 0;
+    for (size_t i = 0; i < sizes.size(); i++) {
+        if (sizes[i] == 0) {
+            continue;
+        }
+        const double quota = double(k) * sizes[i] / n;
+        alloc[i] = std::min(sizes[i], std::max(size_t(1), size_t(quota)));
+        remainder[i] = quota - alloc[i];
+        total += alloc[i];
+    }
+    // too many: take back from the clusters that got the most over their quota
+    while (total > k) {
+        size_t best = sizes.size();
+        for (size_t i = 0; i < sizes.size(); i++) {
+            if (alloc[i] > 1 &&
+                (best == sizes.size() || remainder[i] < remainder[best])) {
+                best = i;
+            }
+        }
+        alloc[best]--;
+        remainder[best] += 1;
+        total--;
+    }
+    // too few: give to the clusters that are the most under their quota
+    while (total < k) {
+        size_t best = sizes.size();
+        for (size_t i = 0; i < sizes.size(); i++) {
+            if (alloc[i] < sizes[i] &&
+                (best == sizes.size() || remainder[i] > remainder[best])) {
+                best = i;
+            }
+        }
+        alloc[best]++;
+        remainder[best] -= 1;
+        total++;
+    }
+    return alloc;
+}
+
+// Assigns the points to their nearest centroid unless it already holds cap
+// points, then to the next nearest among kBalanceCandidates, and recomputes
+// the centroids. Points that lose the most by moving pick first.
+void balance_clusters(
+        Clustering& clus,
+        idx_t n,
+        const float* x,
+        const float* weights,
+        size_t cap,
+        int64_t* assign) {
+    const size_t d = clus.d;
+    const size_t k = clus.k;
+    const size_t m = std::min(kBalanceCandidates, k);
+    std::vector<float> dis(n * m);
+    std::vector<idx_t> labels(n * m);
+    std::vector<idx_t> order(n);
+    std::vector<size_t> counts(k);
+    std::vector<float> hassign(k);
+
+    for (int iter = 0; iter < kBalanceIterations; iter++) {
+        knn_L2sqr(
+                x,
+                clus.centroids.data(),
+                d,
+                n,
+                k,
+                m,
+                dis.data(),
+                labels.data());
+
+        std::iota(order.begin(), order.end(), 0);
+        if (m > 1) {
+            std::sort(order.begin(), order.end(), [&](idx_t a, idx_t b) {
+                return dis[a * m + 1] - dis[a * m] >
+                        dis[b * m + 1] - dis[b * m];
+            });
+        }
+        std::fill(counts.begin(), counts.end(), 0);
+        for (const idx_t i : order) {
+            idx_t label = labels[i * m];
+            for (size_t j = 0; j < m; j++) {
+                const idx_t candidate = labels[i * m + j];
+                if (candidate >= 0 && counts[candidate] < cap) {
+                    label = candidate;
+                    break;
+                }
+            }
+            assign[i] = label;
+            counts[label]++;
+        }
+
+        compute_centroids(
+                d,
+                k,
+                n,
+                0,
+                reinterpret_cast<const uint8_t*>(x),
+                nullptr,
+                assign,
+                weights,
+                hassign.data(),
+                clus.centroids.data());
+        split_clusters(d, k, n, 0, hassign.data(), clus.centroids.data());
+        clus.post_process_centroids();
+    }
+}
+
+} // namespace
+
+size_t balanced_cluster_cap(size_t n, size_t k) {
+    if (clustering_type != ClusteringType::K_MEANS_HIERARCHICAL ||
+        clustering_size_spread <= 0 || k < kHierarchicalMinK) {
+        return 0;
+    }
+    const size_t cap = size_t(std::ceil(clustering_size_spread * n / k));
+    return std::max(cap, (n + k - 1) / k);
+}
 
 void Clustering::kmeans_algorithm(
         std::vector<int>& centroids_index,
@@ -485,6 +623,13 @@ void Clustering::train_encoded(
         return;
     }
 
+    if (ClusteringType::K_MEANS_HIERARCHICAL == clustering_type && !codec &&
+        k >= kHierarchicalMinK) {
+        train_hierarchical(
+                nx, reinterpret_cast<const float*>(x), index, weights);
+        return;
+    }
+
     if (verbose) {
         printf("Clustering %" PRId64
                " points in %zdD to %zd clusters, "
@@ -544,7 +689,8 @@ void Clustering::train_encoded(
             int64_t random_seed = actual_seed + 1 + redo * 15486557L;
             std::vector<int> centroids_index(nx);
 
-            if (ClusteringType::K_MEANS == clustering_type) {
+            if (ClusteringType::K_MEANS == clustering_type ||
+                ClusteringType::K_MEANS_HIERARCHICAL == clustering_type) {
                 //Use classic kmeans algorithm
                 kmeans_algorithm(centroids_index, random_seed, n_input_centroids, d, k, nx, x_in);
             } else if (ClusteringType::K_MEANS_PLUS_PLUS == clustering_type) {
@@ -707,6 +853,121 @@ void Clustering::train_encoded(
     }
 }
 
+void Clustering::train_hierarchical(
+        idx_t nx,
+        const float* x,
+        Index& index,
+        const float* weights) {
+    double t0 = getmillisecs();
+
+    // top level, assign all the points to sqrt(k) clusters
+    const size_t k1 =
+            std::max(size_t(2), size_t(std::lround(std::sqrt(double(k)))));
+    std::vector<idx_t> top_assign(nx);
+    {
+        Clustering top(d, k1, *this);
+        IndexFlatL2 top_index(d);
+        top.train(nx, x, top_index, weights);
+        std::vector<float> top_dis(nx);
+        top_index.search(nx, x, 1, top_dis.data(), top_assign.data());
+    }
+
+    std::vector<std::vector<idx_t>> members(k1);
+    for (idx_t i = 0; i < nx; i++) {
+        members[top_assign[i]].push_back(i);
+    }
+    std::vector<size_t> sizes(k1);
+    for (size_t c = 0; c < k1; c++) {
+        sizes[c] = members[c].size();
+    }
+    const std::vector<size_t> sub_k = allocate_centroids(sizes, k);
+
+    if (verbose) {
+        printf("Hierarchical clustering of %" PRId64
+               " points in %zdD to %zd x %zd clusters, top level in %.2f s\n",
+               nx,
+               d,
+               k1,
+               k / k1,
+               (getmillisecs() - t0) / 1000.);
+    }
+
+    // second level, cluster every top-level cluster on its own
+    const size_t cap = balanced_cluster_cap(nx, k);
+    centroids.resize(k * d);
+    std::unique_ptr<int64_t[]> assign(new int64_t[nx]);
+    std::vector<float> xs;
+    std::vector<float> ws;
+    std::vector<int64_t> sub_assign;
+    std::vector<float> sub_dis;
+    size_t offset = 0;
+    for (size_t c = 0; c < k1; c++) {
+        const size_t nc = members[c].size();
+        const size_t kc = sub_k[c];
+        if (kc == 0) {
+            continue;
+        }
+        xs.resize(nc * d);
+        for (size_t i = 0; i < nc; i++) {
+            memcpy(xs.data() + i * d, x + members[c][i] * d, sizeof(float) * d);
+        }
+        if (weights != nullptr) {
+            ws.resize(nc);
+            for (size_t i = 0; i < nc; i++) {
+                ws[i] = weights[members[c][i]];
+            }
+        }
+        const float* wc = (weights != nullptr) ? ws.data() : nullptr;
+
+        Clustering sub(d, kc, *this);
+        // the allocation keeps the points per centroid close to nx / k
+        sub.min_points_per_centroid = 1;
+        IndexFlatL2 sub_index(d);
+        sub.train(nc, xs.data(), sub_index, wc);
+
+        sub_assign.resize(nc);
+        if (cap > 0) {
+            // the cap can only be met if the cluster got enough centroids
+            const size_t sub_cap = std::max(cap, (nc + kc - 1) / kc);
+            balance_clusters(
+                    sub, nc, xs.data(), wc, sub_cap, sub_assign.data());
+        } else {
+            sub_dis.resize(nc);
+            sub_index.search(
+                    nc, xs.data(), 1, sub_dis.data(), sub_assign.data());
+        }
+
+        memcpy(centroids.data() + offset * d,
+               sub.centroids.data(),
+               sizeof(float) * kc * d);
+        for (size_t i = 0; i < nc; i++) {
+            assign[members[c][i]] = offset + sub_assign[i];
+        }
+        offset += kc;
+        InterruptCallback::check();
+    }
+    FAISS_THROW_IF_NOT(offset == k);
+
+    ClusteringIterationStats stats = {
+            0.0,
+            (getmillisecs() - t0) / 1000.0,
+            0.0,
+            imbalance_factor(nx, k, assign.get()),
+            0};
+    iteration_stats.push_back(stats);
+    if (verbose) {
+        printf("  Hierarchical clustering done in %.2f s, imbalance=%.3f\n",
+               stats.time,
+               stats.imbalance_factor);
+    }
+
+    index.reset();
+    if (!index.is_trained) {
+        index.train(k, centroids.data());
+    }
+    index.add(k, centroids.data());
+}
+
 Clustering1D::Clustering1D(int k) : Clustering(1, k) {}
 
 Clustering1D::Clustering1D(int k, const ClusteringParameters& cp)
@@ -23,6 +23,8 @@ enum ClusteringType
     K_MEANS = 0,
     K_MEANS_PLUS_PLUS,
     K_MEANS_TWO,
+    // two-level k-means for large k, see Clustering::train_hierarchical()
+    K_MEANS_HIERARCHICAL,
 };
 
 // The default algorithm use the K_MEANS
@@ -31,6 +33,17 @@ extern ClusteringType clustering_type;
 // K-Means Early Stop Threshold; defaults to 0.0
 extern double early_stop_threshold;
 
+// Maximum cluster size of K_MEANS_HIERARCHICAL, as a multiple of the average
+// cluster size n / k. Clusters are balanced towards it by reassigning points
+// to their next nearest centroids, and IndexIVF::add keeps the inverted lists
+// under it; 0 (default) disables balancing.
+extern double clustering_size_spread;
+
+// Size cap that K_MEANS_HIERARCHICAL balancing puts on each of k clusters of
+// n points in total, never below ceil(n / k). 0 when the clusters of k
+// centroids are not balanced.
+size_t balanced_cluster_cap(size_t n, size_t k);
+
 /** Class for the clustering parameters. Can be passed to the
  * constructor of the Clustering object.
  */
@@ -167,6 +180,23 @@ struct Clustering : ClusteringParameters {
             Index& index,
             const float* weights = nullptr);
 
+    /** two-level k-means, used by train() for K_MEANS_HIERARCHICAL
+     *
+     * sqrt(k) top-level centroids are trained first, then the k centroids
+     * are split among the top-level clusters in proportion to their sizes
+     * and each cluster is clustered on its own. An iteration costs about
+     * n * sqrt(k) * d instead of n * k * d.
+     *
+     * @param x          training vectors, size n * d
+     * @param index      index the centroids are added to
+     * @param weights    weight associated to each vector: NULL or size n
+     */
+    void train_hierarchical(
+            idx_t n,
+            const float* x,
+            Index& index,
+            const float* weights = nullptr);
+
     /// Post-process the centroids after each centroid update.
     /// includes optional L2 normalization and nearest integer rounding
     void post_process_centroids();
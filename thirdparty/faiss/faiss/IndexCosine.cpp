@@ -146,6 +146,16 @@ struct FlatCosineDis : FlatCodesDistanceComputer {
         dis2 = dp2 * inverse_code_norm2 * inverse_query_norm;
         dis3 = dp3 * inverse_code_norm3 * inverse_query_norm;
     }
+
+    void distances_by_ids(const idx_t* ids, size_t n, float* dis)
+            final override {
+        ndis += n;
+        fvec_inner_products_ny_by_ids(
+                dis, q, reinterpret_cast<const float*>(codes), ids, d, n);
+        for (size_t j = 0; j < n; j++) {
+            dis[j] *= inverse_l2_norms[ids[j]] * inverse_query_norm;
+        }
+    }
 };
 
 
@@ -204,6 +214,17 @@ void WithCosineNormDistanceComputer::distances_batch_4(
     dis3 = dis3 * inverse_l2_norms[idx3] * inverse_query_norm;
 }
 
+void WithCosineNormDistanceComputer::distances_by_ids(
+        const idx_t* ids,
+        size_t n,
+        float* dis) {
+    basedis->distances_by_ids(ids, n, dis);
+
+    for (size_t j = 0; j < n; j++) {
+        dis[j] = dis[j] * inverse_l2_norms[ids[j]] * inverse_query_norm;
+    }
+}
+
 /// compute distance between two stored vectors
 float WithCosineNormDistanceComputer::symmetric_dis(idx_t i, idx_t j) {
     prefetch_L2(inverse_l2_norms + i);
@@ -60,6 +60,8 @@ struct WithCosineNormDistanceComputer : DistanceComputer {
             float& dis2,
             float& dis3) override;
 
+    void distances_by_ids(const idx_t* ids, size_t n, float* dis) override;
+
     /// compute distance between two stored vectors
     float symmetric_dis(idx_t i, idx_t j) override;
 };
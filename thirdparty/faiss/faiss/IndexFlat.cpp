@@ -201,6 +201,13 @@ struct FlatL2Dis : FlatCodesDistanceComputer {
         dis2 = dp2;
         dis3 = dp3;
     }
+
+    void distances_by_ids(const idx_t* ids, size_t n, float* dis)
+            final override {
+        ndis += n;
+        fvec_L2sqr_ny_by_ids(
+                dis, q, reinterpret_cast<const float*>(codes), ids, d, n);
+    }
 };
 
 struct FlatIPDis : FlatCodesDistanceComputer {
@@ -265,6 +272,13 @@ struct FlatIPDis : FlatCodesDistanceComputer {
         dis2 = dp2;
         dis3 = dp3;
     }
+
+    void distances_by_ids(const idx_t* ids, size_t n, float* dis)
+            final override {
+        ndis += n;
+        fvec_inner_products_ny_by_ids(
+                dis, q, reinterpret_cast<const float*>(codes), ids, d, n);
+    }
 };
 
 } // namespace
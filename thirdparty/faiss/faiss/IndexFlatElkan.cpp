@@ -11,13 +11,107 @@
 
 #include <faiss/IndexFlatElkan.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <memory>
+#include <vector>
 
+#include <faiss/FaissHook.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/utils/Heap.h>
 #include <faiss/utils/distances.h>
 
 namespace faiss {
 
+namespace {
+
+// centroids kept per vector on the bf16 products, re-checked in fp32
+constexpr size_t kAssignRecheck = 8;
+
+// k == 1 L2 assignment on top of the batched (AMX) inner product kernel.
+// The kAssignRecheck nearest centroids on bf16-rounded inner products are
+// re-checked in fp32. If the bf16 error bound cannot rule out that a centroid
+// left out is nearer than the best re-checked one, the vector is assigned by an
+// exact scan, so the result is always the one knn_L2sqr() would return.
+void assign_L2_batched(
+        const float* x,
+        const float* y,
+        size_t d,
+        size_t nx,
+        size_t ny,
+        idx_t* labels,
+        float* distances) {
+    constexpr size_t bs_x = 256;
+    constexpr size_t bs_y = 1024;
+    const size_t ncand = std::min(kAssignRecheck, ny);
+
+    std::vector<float> y_norms(ny);
+    fvec_norms_L2sqr(y_norms.data(), y, d, ny);
+    const float max_y_norm = std::sqrt(*std::max_element(y_norms.begin(), y_norms.end()));
+
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t i0 = 0; i0 < (int64_t)nx; i0 += bs_x) {
+        const size_t ni = std::min(bs_x, nx - i0);
+        std::vector<float> ip(ni * bs_y);
+        std::vector<float> cand_dis(ni * ncand);
+        std::vector<idx_t> cand_ids(ni * ncand);
+        for (size_t i = 0; i < ni; i++) {
+            maxheap_heapify(ncand, cand_dis.data() + i * ncand, cand_ids.data() + i * ncand);
+        }
+        for (size_t j0 = 0; j0 < ny; j0 += bs_y) {
+            const size_t nj = std::min(bs_y, ny - j0);
+            fvec_inner_products_batch_bf16(ip.data(), x + i0 * d, y + j0 * d, d, ni, nj);
+            for (size_t i = 0; i < ni; i++) {
+                const float* ip_i = ip.data() + i * nj;
+                float* heap_dis = cand_dis.data() + i * ncand;
+                idx_t* heap_ids = cand_ids.data() + i * ncand;
+                for (size_t j = 0; j < nj; j++) {
+                    // ||x||^2 is the same for all the centroids
+                    const float dis = y_norms[j0 + j] - 2 * ip_i[j];
+                    if (dis < heap_dis[0]) {
+                        maxheap_replace_top(ncand, heap_dis, heap_ids, dis, j0 + j);
+                    }
+                }
+            }
+        }
+        for (size_t i = 0; i < ni; i++) {
+            const float* xi = x + (i0 + i) * d;
+            const float* heap_dis = cand_dis.data() + i * ncand;
+            const idx_t* heap_ids = cand_ids.data() + i * ncand;
+            float best_dis = std::numeric_limits<float>::max();
+            idx_t best_id = 0;
+            for (size_t j = 0; j < ncand; j++) {
+                const float dis = fvec_L2sqr(xi, y + heap_ids[j] * d, d);
+                if (dis < best_dis) {
+                    best_dis = dis;
+                    best_id = heap_ids[j];
+                }
+            }
+            // a centroid left out is at least as far as the worst candidate
+            // minus the error bound, up to the ||x||^2 term
+            const float x_norm = fvec_norm_L2sqr(xi, d);
+            const float err =
+                    2 * kBf16InnerProductRelError * std::sqrt(x_norm) * max_y_norm;
+            if (ncand < ny && best_dis - x_norm > heap_dis[0] - err) {
+                for (size_t j = 0; j < ny; j++) {
+                    const float dis = fvec_L2sqr(xi, y + j * d, d);
+                    if (dis < best_dis) {
+                        best_dis = dis;
+                        best_id = j;
+                    }
+                }
+            }
+            labels[i0 + i] = best_id;
+            if (distances != nullptr) {
+                distances[i0 + i] = best_dis;
+            }
+        }
+    }
+}
+
+} // namespace
+
 IndexFlatElkan::IndexFlatElkan(idx_t d, MetricType metric, bool is_cosine, bool use_elkan)
         : IndexFlat(d, metric, is_cosine) {
     this->use_elkan = use_elkan;
@@ -56,7 +150,10 @@ void IndexFlatElkan::search(
         case METRIC_INNER_PRODUCT:
         case METRIC_L2: {
             // ignore the metric_type, both use L2
-            if (use_elkan) {
+            if (support_amx && ntotal > 0) {
+                // the tile engine outruns both elkan and knn_L2sqr
+                assign_L2_batched(x, get_xb(), d, n, ntotal, labels, dis_inner);
+            } else if (use_elkan) {
                 // use elkan
                 elkan_L2_sse(x, get_xb(), d, n, ntotal, labels, dis_inner, tmp_buffer_for_elkan.get(), sym_dim);
             }
@@ -25,7 +25,8 @@ namespace faiss {
 //   support an early stop strategy from Clustering.cpp. Early stop
 //   strategy is a Knowhere-specific feature.
 //
-// This index is intended to be used in Knowhere's ivf.cc file ONLY!!!
+// This index is intended to be used in Knowhere's ivf.cc and the KMEANS
+// cluster (src/cluster/kmeans) ONLY!!!
 //
 // Elkan algo was introduced into Knowhere in #2178, #2180 and #2258. 
 //
@@ -168,6 +168,8 @@ void hnsw_add_vertices(
 
                 std::unique_ptr<DistanceComputer> dis(
                         storage_distance_computer(index_hnsw.storage));
+                // without x, the queries are reconstructed from the storage
+                std::vector<float> query(x == nullptr ? d : 0);
                 int prev_display =
                         verbose && omp_get_thread_num() == 0 ? 0 : -1;
                 size_t counter = 0;
@@ -178,7 +180,12 @@ void hnsw_add_vertices(
 #pragma omp for schedule(static)
                 for (int i = i0; i < i1; i++) {
                     storage_idx_t pt_id = order[i];
-                    dis->set_query(x + (pt_id - n0) * d);
+                    if (x != nullptr) {
+                        dis->set_query(x + (pt_id - n0) * d);
+                    } else {
+                        index_hnsw.storage->reconstruct(pt_id, query.data());
+                        dis->set_query(query.data());
+                    }
 
                     // cannot break
                     if (interrupt) {
@@ -365,6 +372,171 @@ void IndexHNSW::add(idx_t n, const float* x) {
     hnsw_add_vertices(*this, n0, n, x, verbose, hnsw.levels.size() == ntotal);
 }
 
+void IndexHNSW::add_from_storage() {
+    FAISS_THROW_IF_NOT_MSG(
+            storage,
+            "Please use IndexHNSWFlat (or variants) instead of IndexHNSW directly");
+    FAISS_THROW_IF_NOT(is_trained);
+    int n0 = ntotal;
+    idx_t n = storage->ntotal - n0;
+    ntotal = storage->ntotal;
+
+    hnsw_add_vertices(
+            *this, n0, n, nullptr, verbose, hnsw.levels.size() == ntotal);
+}
+
+void IndexHNSW::merge_graph_from(const IndexHNSW& other) {
+    FAISS_THROW_IF_NOT_MSG(
+            storage,
+            "Please use IndexHNSWFlat (or variants) instead of IndexHNSW directly");
+    FAISS_THROW_IF_NOT(other.d == d && other.metric_type == metric_type);
+    idx_t n0 = ntotal;
+    idx_t n1 = other.ntotal;
+    FAISS_THROW_IF_NOT_MSG(
+            storage->ntotal == n0 + n1,
+            "the vectors of the other index must be appended to the storage");
+    if (n1 == 0) {
+        return;
+    }
+
+    storage_idx_t entry_a = hnsw.entry_point;
+    int level_a = hnsw.max_level;
+    storage_idx_t entry_b = other.hnsw.entry_point + n0;
+    int level_b = other.hnsw.max_level;
+
+    hnsw.append_graph(other.hnsw);
+    ntotal = storage->ntotal;
+    if (n0 == 0) {
+        hnsw.entry_point = entry_b;
+        hnsw.max_level = level_b;
+        return;
+    }
+
+    double t0 = getmillisecs();
+    std::vector<storage_idx_t> cross_links(hnsw.neighbors.size(), -1);
+
+    // the cross searches only have to fill a neighbor list, unlike the
+    // insertions, the graph they run on is already complete
+    int ef_construction = hnsw.efConstruction;
+    hnsw.efConstruction = std::min(ef_construction, hnsw.nb_neighbors(0));
+
+    // find the neighbors of every vertex in the other half, the graph is
+    // only read, so the halves stay disconnected during the searches
+#pragma omp parallel
+    {
+        VisitedTable vt(ntotal);
+        std::unique_ptr<DistanceComputer> dis(
+                storage_distance_computer(storage));
+        std::vector<float> query(d);
+
+#pragma omp for schedule(guided)
+        for (idx_t i = 0; i < ntotal; i++) {
+            storage->reconstruct(i, query.data());
+            dis->set_query(query.data());
+            if (i < n0) {
+                hnsw.search_cross_links(
+                        *dis, i, entry_b, level_b, cross_links.data(), vt);
+            } else {
+                hnsw.search_cross_links(
+                        *dis, i, entry_a, level_a, cross_links.data(), vt);
+            }
+        }
+    }
+
+    hnsw.efConstruction = ef_construction;
+
+    // every vertex only rewrites its own lists
+#pragma omp parallel
+    {
+        std::unique_ptr<DistanceComputer> dis(
+                storage_distance_computer(storage));
+
+#pragma omp for schedule(guided)
+        for (idx_t i = 0; i < ntotal; i++) {
+            hnsw.merge_cross_links(
+                    *dis, i, cross_links.data(), keep_max_size_level0);
+        }
+    }
+
+    // gather the vertices that picked each vertex as a cross link on level
+    // 0, so that every list is pruned once for all of them
+    std::vector<size_t> reverse_lims(ntotal + 1, 0);
+    for (idx_t i = 0; i < ntotal; i++) {
+        size_t begin, end;
+        hnsw.neighbor_range(i, 0, &begin, &end);
+        for (size_t j = begin; j < end && cross_links[j] >= 0; j++) {
+            reverse_lims[cross_links[j] + 1]++;
+        }
+    }
+    for (idx_t i = 0; i < ntotal; i++) {
+        reverse_lims[i + 1] += reverse_lims[i];
+    }
+    std::vector<storage_idx_t> reverse(reverse_lims[ntotal]);
+    {
+        std::vector<size_t> fill(reverse_lims.begin(), reverse_lims.end() - 1);
+        for (idx_t i = 0; i < ntotal; i++) {
+            size_t begin, end;
+            hnsw.neighbor_range(i, 0, &begin, &end);
+            for (size_t j = begin; j < end && cross_links[j] >= 0; j++) {
+                reverse[fill[cross_links[j]]++] = i;
+            }
+        }
+    }
+
+#pragma omp parallel
+    {
+        std::unique_ptr<DistanceComputer> dis(
+                storage_distance_computer(storage));
+
+#pragma omp for schedule(guided)
+        for (idx_t i = 0; i < ntotal; i++) {
+            hnsw.merge_reverse_links(
+                    *dis,
+                    i,
+                    0,
+                    reverse.data() + reverse_lims[i],
+                    reverse_lims[i + 1] - reverse_lims[i],
+                    keep_max_size_level0);
+        }
+    }
+
+    // the upper levels hold few vertices, link them one by one
+    std::vector<omp_lock_t> locks(ntotal);
+    for (idx_t i = 0; i < ntotal; i++) {
+        omp_init_lock(&locks[i]);
+    }
+
+#pragma omp parallel
+    {
+        std::unique_ptr<DistanceComputer> dis(
+                storage_distance_computer(storage));
+
+#pragma omp for schedule(guided)
+        for (idx_t i = 0; i < ntotal; i++) {
+            if (hnsw.levels[i] > 1) {
+                hnsw.add_reverse_cross_links(
+                        *dis, i, cross_links.data(), locks.data());
+            }
+        }
+    }
+
+    for (idx_t i = 0; i < ntotal; i++) {
+        omp_destroy_lock(&locks[i]);
+    }
+
+    if (level_b > level_a) {
+        hnsw.entry_point = entry_b;
+        hnsw.max_level = level_b;
+    }
+    if (verbose) {
+        printf("merge_graph_from: merged %" PRId64 " vertices into %" PRId64
+               " in %.3f ms\n",
+               n1,
+               n0,
+               getmillisecs() - t0);
+    }
+}
+
 void IndexHNSW::reset() {
     hnsw.reset();
     storage->reset();
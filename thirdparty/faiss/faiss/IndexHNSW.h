@@ -53,6 +53,22 @@ struct IndexHNSW : Index {
 
     void add(idx_t n, const float* x) override;
 
+    /** Links the vectors that were appended to the storage directly (eg.
+     * as codes) since the last add into the graph. The queries of the
+     * construction are reconstructed from the storage one vector at a
+     * time, so no float copy of the input is needed.
+     */
+    void add_from_storage();
+
+    /** Merges the graph of other, whose vectors must already be appended
+     * to the storage after the ntotal vectors of this index. The links of
+     * both graphs are kept. Every vertex is searched for in the graph of
+     * the other half, and the neighbors found there compete with its own
+     * through the pruning heuristic, which is much cheaper than adding the
+     * vectors of other one by one. other is left untouched.
+     */
+    void merge_graph_from(const IndexHNSW& other);
+
     /// Trains the storage if needed
     void train(idx_t n, const float* x) override;
 
@@ -15,7 +15,9 @@
 
 #include <algorithm>
 #include <cinttypes>
+#include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <vector>
@@ -23,11 +25,15 @@
 #include <faiss/utils/hamming.h>
 #include <faiss/utils/utils.h>
 
+#include <faiss/FaissHook.h>
 #include <faiss/IndexFlat.h>
+#include <faiss/IndexHNSW.h>
+#include <faiss/IndexRefine.h>
 #include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/CodePacker.h>
 #include <faiss/impl/FaissAssert.h>
 #include <faiss/impl/IDSelector.h>
+#include <faiss/utils/distances.h>
 
 #include "knowhere/object.h"
 
@@ -152,6 +158,36 @@ idx_t Level1Quantizer::decode_listno(const uint8_t* code) const {
     return list_no;
 }
 
+/*****************************************
+ * IVFListBound implementation
+ ******************************************/
+
+IVFListBound::IVFListBound(const Index* quantizer, idx_t ref_list, float ref_dis)
+        : quantizer(quantizer),
+          ref_list(ref_list),
+          ref_dis(ref_dis),
+          ref_norm(std::sqrt(std::max(ref_dis, 0.0f))) {}
+
+float IVFListBound::monotone_bound(float dis) const {
+    float r = (std::sqrt(std::max(dis, 0.0f)) - ref_norm) * 0.5f;
+    return r > 0 ? r * r : 0;
+}
+
+float IVFListBound::list_bound(idx_t list_no, float dis) {
+    float num = dis - ref_dis;
+    if (list_no == ref_list || num <= 0) {
+        return 0;
+    }
+    if (ref_centroid.empty()) {
+        ref_centroid.resize(quantizer->d);
+        centroid.resize(quantizer->d);
+        quantizer->reconstruct(ref_list, ref_centroid.data());
+    }
+    quantizer->reconstruct(list_no, centroid.data());
+    float cc = fvec_L2sqr(ref_centroid.data(), centroid.data(), quantizer->d);
+    return cc > 0 ? num * num / (4 * cc) : 0;
+}
+
 /*****************************************
  * IVFIteratorWorkspace implementation
  ******************************************/
@@ -196,10 +232,124 @@ void IndexIVF::add(idx_t n, const float* x) {
 
 void IndexIVF::add_with_ids(idx_t n, const float* x, const idx_t* xids) {
     std::unique_ptr<idx_t[]> coarse_idx(new idx_t[n]);
-    quantizer->assign(n, x, coarse_idx.get());
+    assign_for_add(n, x, coarse_idx.get());
     add_core(n, x, nullptr, xids, coarse_idx.get());
 }
 
+namespace {
+
+// nearest lists a vector may go to before all the lists are ranked
+constexpr idx_t kCappedAssignCandidates = 8;
+
+// distances kept at once while the vectors with full candidates rank all the
+// lists
+constexpr size_t kCappedAssignRankedDistances = size_t(1) << 20;
+
+// The flat index of the centroids behind a graph or compressed quantizer,
+// the quantizer itself if it has none.
+const Index* exact_quantizer(const Index* quantizer) {
+    if (auto hnsw = dynamic_cast<const IndexHNSW*>(quantizer)) {
+        if (dynamic_cast<const IndexFlat*>(hnsw->storage) != nullptr) {
+            return hnsw->storage;
+        }
+    } else if (auto refine = dynamic_cast<const IndexRefine*>(quantizer)) {
+        if (dynamic_cast<const IndexFlat*>(refine->refine_index) != nullptr) {
+            return refine->refine_index;
+        }
+    }
+    return quantizer;
+}
+
+// The list bounds assume that every vector sits in the list of its nearest
+// centroid, which only holds for the L2 metric and uncapped lists, and that
+// the probed lists are the nearest ones by their exact distances, which takes
+// a flat quantizer.
+bool list_bounds_hold(const IndexIVF& ivf) {
+    return ivf.metric_type == METRIC_L2 && !ivf.lists_capped &&
+            dynamic_cast<const IndexFlat*>(ivf.quantizer) != nullptr;
+}
+
+} // namespace
+
+void IndexIVF::assign_for_add(idx_t n, const float* x, idx_t* coarse_idx) {
+    // an approximate quantizer would misplace vectors for good, it is only
+    // worth its speed when probing lists at search time
+    const Index* q = exact_quantizer(quantizer);
+    const size_t cap = balanced_cluster_cap(ntotal + n, nlist);
+    if (cap == 0 || n == 0) {
+        q->assign(n, x, coarse_idx);
+        return;
+    }
+
+    std::vector<size_t> sizes(nlist);
+    for (size_t i = 0; i < nlist; i++) {
+        sizes[i] = invlists->list_size(i);
+    }
+    const idx_t k = std::min(kCappedAssignCandidates, idx_t(nlist));
+    std::vector<float> dis(n * k);
+    std::vector<idx_t> cand(n * k);
+    q->search(n, x, k, dis.data(), cand.data());
+
+    // the vectors are placed in order, each in its nearest list with room.
+    // Those whose k nearest lists are all full wait for one batched search
+    // over all the lists.
+    std::vector<idx_t> pending;
+    for (idx_t i = 0; i < n; i++) {
+        coarse_idx[i] = -1;
+        for (idx_t j = 0; j < k; j++) {
+            const idx_t c = cand[i * k + j];
+            if (c >= 0 && sizes[c] < cap) {
+                coarse_idx[i] = c;
+                break;
+            }
+        }
+        if (coarse_idx[i] < 0) {
+            pending.push_back(i);
+        } else {
+            sizes[coarse_idx[i]]++;
+            lists_capped = lists_capped || coarse_idx[i] != cand[i * k];
+        }
+    }
+    if (pending.empty()) {
+        return;
+    }
+
+    // cap * nlist >= ntotal + n, so there always is a list with room
+    lists_capped = true;
+    const size_t bs = std::max(size_t(1), kCappedAssignRankedDistances / nlist);
+    std::vector<float> xb;
+    std::vector<float> all_dis;
+    std::vector<idx_t> all_cand;
+    for (size_t i0 = 0; i0 < pending.size(); i0 += bs) {
+        const size_t i1 = std::min(pending.size(), i0 + bs);
+        xb.resize((i1 - i0) * d);
+        for (size_t i = i0; i < i1; i++) {
+            memcpy(xb.data() + (i - i0) * d,
+                   x + pending[i] * d,
+                   sizeof(float) * d);
+        }
+        all_dis.resize((i1 - i0) * nlist);
+        all_cand.resize((i1 - i0) * nlist);
+        q->search(i1 - i0, xb.data(), nlist, all_dis.data(), all_cand.data());
+        for (size_t i = i0; i < i1; i++) {
+            const idx_t* ranked = all_cand.data() + (i - i0) * nlist;
+            idx_t list_no = -1;
+            for (size_t j = 0; j < nlist && list_no < 0; j++) {
+                if (ranked[j] >= 0 && sizes[ranked[j]] < cap) {
+                    list_no = ranked[j];
+                }
+            }
+            if (list_no < 0) {
+                // an approximate search may not rank every list
+                list_no = std::min_element(sizes.begin(), sizes.end()) -
+                        sizes.begin();
+            }
+            sizes[list_no]++;
+            coarse_idx[pending[i]] = list_no;
+        }
+    }
+}
+
 void IndexIVF::add_sa_codes(idx_t n, const uint8_t* codes, const idx_t* xids) {
     size_t coarse_size = coarse_code_size();
     DirectMapAdd dm_adder(direct_map, n, xids);
@@ -477,6 +627,9 @@ void IndexIVF::search_preassigned(
         max_codes = unlimited_list_size;
     }
 
+    const bool adaptive_nprobe = params && params->adaptive_nprobe &&
+            list_bounds_hold(*this) && (pmode == 0 || pmode == 3);
+
     bool do_parallel = omp_get_max_threads() >= 2 &&
             (pmode == 0           ? false
                      : pmode == 3 ? n > 1
@@ -630,8 +783,28 @@ void IndexIVF::search_preassigned(
 
                 idx_t nscan = 0;
 
+                std::unique_ptr<IVFListBound> bound;
+                if (adaptive_nprobe && keys[i * nprobe] >= 0) {
+                    bound = std::make_unique<IVFListBound>(
+                            quantizer,
+                            keys[i * nprobe],
+                            coarse_dis[i * nprobe]);
+                }
+
                 // loop over probes
                 for (size_t ik = 0; ik < nprobe; ik++) {
+                    // simi[0] is the k-th distance, +inf until k results
+                    if (bound && ik > 0) {
+                        const float list_dis = coarse_dis[i * nprobe + ik];
+                        if (bound->monotone_bound(list_dis) > simi[0]) {
+                            break;
+                        }
+                        const idx_t key = keys[i * nprobe + ik];
+                        if (key >= 0 &&
+                            bound->list_bound(key, list_dis) > simi[0]) {
+                            continue;
+                        }
+                    }
                     nscan += scan_one_list(
                             keys[i * nprobe + ik],
                             coarse_dis[i * nprobe + ik],
@@ -1163,6 +1336,7 @@ void IndexIVF::reset() {
     direct_map.clear();
     invlists->reset();
     ntotal = 0;
+    lists_capped = false;
 }
 
 size_t IndexIVF::remove_ids(const IDSelector& sel) {
@@ -1287,6 +1461,13 @@ std::unique_ptr<IVFIteratorWorkspace> IndexIVF::getIteratorWorkspace(
                     ? workspace->search_params->quantizer_params
                     : nullptr);
 
+    if (workspace->search_params &&
+        workspace->search_params->adaptive_nprobe &&
+        list_bounds_hold(*this) && coarse_idx[0] >= 0) {
+        workspace->list_bound = std::make_unique<IVFListBound>(
+                quantizer, coarse_idx[0], coarse_dis[0]);
+    }
+
     workspace->coarse_idx = std::move(coarse_idx);
     workspace->coarse_dis = std::move(coarse_dis);
     workspace->coarse_list_sizes = std::move(coarse_list_sizes);
@@ -1301,10 +1482,27 @@ void IndexIVF::getIteratorNextBatch(
         size_t current_backup_count) const {
     workspace->dists.clear();
 
+    // the closest result held by the caller or found by this batch
+    float best_dis = workspace->best_backup_dis;
+    size_t n_seen = 0;
+
     while (current_backup_count + workspace->dists.size() <
                    workspace->backup_count_threshold &&
            workspace->next_visit_coarse_list_idx < nlist) {
         auto next_list_idx = workspace->next_visit_coarse_list_idx;
+        if (workspace->list_bound) {
+            if (!workspace->refine_dists) {
+                for (; n_seen < workspace->dists.size(); n_seen++) {
+                    best_dis =
+                            std::min(best_dis, workspace->dists[n_seen].val);
+                }
+            }
+            // the next result is already final, scan the list when needed
+            if (workspace->list_bound->monotone_bound(
+                        workspace->coarse_dis[next_list_idx]) > best_dis) {
+                break;
+            }
+        }
         workspace->next_visit_coarse_list_idx++;
 
         invlists->prefetch_lists(
@@ -1407,6 +1605,7 @@ void IndexIVF::merge_from(Index& otherIndex, idx_t add_id) {
     check_compatible_for_merge(otherIndex);
     IndexIVF* other = static_cast<IndexIVF*>(&otherIndex);
     invlists->merge_from(other->invlists, add_id);
+    lists_capped = lists_capped || other->lists_capped;
 
     ntotal += other->ntotal;
     other->ntotal = 0;
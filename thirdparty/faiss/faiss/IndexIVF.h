@@ -11,6 +11,7 @@
 #define FAISS_INDEX_IVF_H
 
 #include <stdint.h>
+#include <limits>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -85,6 +86,13 @@ struct SearchParametersIVF : SearchParameters {
     ///< continuous buckets with no valid results, terminate range search
     size_t max_empty_result_buckets = 0;
 
+    /// L2, flat quantizer and uncapped lists only: skip the probed lists whose vectors
+    /// provably can not enter the current top-k, and stop probing once no
+    /// remaining list can. The iterator defers scanning the next list while
+    /// its buffered best result is closer than any vector of that list.
+    /// nprobe becomes an upper bound.
+    bool adaptive_nprobe = false;
+
     SearchParameters* quantizer_params = nullptr;
 
     /// context object to pass to InvertedLists
@@ -96,6 +104,36 @@ struct SearchParametersIVF : SearchParameters {
 // the new convention puts the index type after SearchParameters
 using IVFSearchParameters = SearchParametersIVF;
 struct DistanceComputer;
+
+/** Lower bounds of the squared L2 distance between a query and the vectors
+ * of an inverted list, derived from the query-to-centroid distances.
+ *
+ * A vector x of list j is closer to its centroid c_j than to the reference
+ * centroid c_r (the nearest probed one), so it lies on the far side of their
+ * bisector hyperplane. With D the squared query-to-centroid distances:
+ *
+ *   ||q - x|| >= (D_j - D_r) / (2 ||c_j - c_r||) >= (sqrt(D_j) - sqrt(D_r)) / 2
+ *
+ * The second form does not need c_j and grows with D_j, so once it exceeds
+ * the k-th result, none of the farther lists can improve the top-k.
+ */
+struct IVFListBound {
+    IVFListBound(const Index* quantizer, idx_t ref_list, float ref_dis);
+
+    /// valid for every list whose coarse distance is >= dis
+    float monotone_bound(float dis) const;
+
+    /// tighter bound for the list list_no, reconstructs its centroid
+    float list_bound(idx_t list_no, float dis);
+
+    const Index* quantizer;
+    idx_t ref_list;
+    float ref_dis;
+    float ref_norm;
+    std::vector<float> ref_centroid; // reconstructed on first use
+    std::vector<float> centroid;
+};
+
 struct IVFIteratorWorkspace {
     IVFIteratorWorkspace() = default;
     IVFIteratorWorkspace(
@@ -117,6 +155,13 @@ struct IVFIteratorWorkspace {
     std::unique_ptr<size_t[]> coarse_list_sizes =
             nullptr; // snapshot of the list_size
     std::unique_ptr<DistanceComputer> dis_refine;
+    /// set if search_params->adaptive_nprobe applies
+    std::unique_ptr<IVFListBound> list_bound = nullptr;
+    /// the closest exact result the caller still holds, used with list_bound
+    float best_backup_dis = std::numeric_limits<float>::max();
+    /// set if the caller refines dists, whose estimates then can not stand
+    /// in for the distances list_bound is compared with
+    bool refine_dists = false;
 };
 
 struct InvertedListScanner;
@@ -239,6 +284,10 @@ struct IndexIVF : Index, IndexIVFInterface {
     /// centroids?
     bool by_residual = true;
 
+    /// set once the list size cap put an added vector outside the list of
+    /// its nearest centroid, adaptive_nprobe is ignored from then on
+    bool lists_capped = false;
+
     /** The Inverted file takes a quantizer (an Index) on input,
      * which implements the function mapping a vector to a list
      * identifier.
@@ -275,6 +324,17 @@ struct IndexIVF : Index, IndexIVFInterface {
     /// default implementation that calls encode_vectors
     void add_with_ids(idx_t n, const float* x, const idx_t* xids) override;
 
+    /** Assigns the vectors to add to inverted lists. A graph or compressed
+     * quantizer over flat centroids (IndexHNSWFlat, IndexRefineFlat) is
+     * bypassed for an exact scan of the centroids. When the lists are
+     * balanced (see balanced_cluster_cap), a vector whose nearest list is
+     * full goes to the nearest list that still has room, and lists_capped
+     * is set.
+     *
+     * @param coarse_idx   output list ids (size n)
+     */
+    void assign_for_add(idx_t n, const float* x, idx_t* coarse_idx);
+
     /** Implementation of vector addition where the vector assignments are
      * predefined. The default implementation hands over the code extraction to
      * encode_vectors.
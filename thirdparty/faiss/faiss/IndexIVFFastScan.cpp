@@ -160,7 +160,7 @@ void IndexIVFFastScan::add_with_ids_impl(
 
     direct_map.check_can_add(xids);
     std::unique_ptr<idx_t[]> idx(new idx_t[n]);
-    quantizer->assign(n, x, idx.get());
+    assign_for_add(n, x, idx.get());
 
     AlignedTable<uint8_t> flat_codes(n * code_size);
     encode_vectors(n, x, idx.get(), flat_codes.get());
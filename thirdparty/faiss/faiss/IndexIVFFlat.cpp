@@ -67,11 +67,11 @@ void IndexIVFFlat::add_with_ids(idx_t n, const float* x, const idx_t* xids) {
         std::memcpy(x_normalized.get(), x, n * d * sizeof(float));
         auto norms = knowhere::NormalizeVecs(x_normalized.get(), n, d);
         // use normalized data to calculate coarse id
-        quantizer->assign(n, x_normalized.get(), coarse_idx.get());
+        assign_for_add(n, x_normalized.get(), coarse_idx.get());
         // add raw data with its norms to inverted list
         add_core(n, x, norms.data(), xids, coarse_idx.get());
     } else {
-        quantizer->assign(n, x, coarse_idx.get());
+        assign_for_add(n, x, coarse_idx.get());
         add_core(n, x, nullptr, xids, coarse_idx.get());
     }
 }
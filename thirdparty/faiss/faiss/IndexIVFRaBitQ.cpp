@@ -2,13 +2,18 @@
 
 #include <omp.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 
+#include <faiss/impl/AuxIndexStructures.h>
 #include <faiss/impl/FaissAssert.h>
+#include <faiss/impl/IDSelector.h>
 #include <faiss/impl/RaBitQuantizer.h>
+#include <faiss/utils/Heap.h>
 #include <faiss/utils/distances_if.h>
 
 namespace faiss {
@@ -292,4 +297,187 @@ DistanceComputer* IndexIVFRaBitQ::get_distance_computer() const {
     return dc;
 }
 
+namespace {
+
+// the number of codes that are evaluated against a batch of queries at once
+constexpr size_t kBatchedScanBlockSize = 64;
+
+template <class C>
+void scan_lists_batched(
+        const IndexIVFRaBitQ& index,
+        idx_t n,
+        const float* x,
+        idx_t k,
+        size_t nprobe,
+        const idx_t* assign,
+        float* distances,
+        idx_t* labels,
+        uint8_t qb,
+        const IDSelector* sel,
+        const std::function<bool()>& should_stop,
+        bool lower_bounds) {
+    const size_t d = index.d;
+    const size_t code_size = index.code_size;
+    const InvertedLists* invlists = index.invlists;
+
+    for (idx_t i = 0; i < n; i++) {
+        heap_heapify<C>(k, distances + i * k, labels + i * k);
+    }
+
+    // (list, query) pairs, grouped by the list
+    std::vector<std::pair<idx_t, idx_t>> probes;
+    probes.reserve(n * nprobe);
+    for (idx_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < nprobe; j++) {
+            const idx_t list_no = assign[i * nprobe + j];
+            if (list_no >= 0 && invlists->list_size(list_no) > 0) {
+                probes.emplace_back(list_no, i);
+            }
+        }
+    }
+    std::sort(probes.begin(), probes.end());
+
+    std::vector<float> centroid(d);
+    std::vector<float> xs;
+    std::vector<idx_t> queries;
+    std::vector<float> block_dis;
+    RaBitQueryBatch batch;
+
+    for (size_t p_begin = 0; p_begin < probes.size();) {
+        if (should_stop && should_stop()) {
+            break;
+        }
+        const idx_t list_no = probes[p_begin].first;
+        size_t p_end = p_begin;
+        queries.clear();
+        while (p_end < probes.size() && probes[p_end].first == list_no) {
+            queries.push_back(probes[p_end].second);
+            p_end++;
+        }
+        p_begin = p_end;
+
+        const size_t nq = queries.size();
+        xs.resize(nq * d);
+        for (size_t i = 0; i < nq; i++) {
+            std::copy_n(x + queries[i] * d, d, xs.data() + i * d);
+        }
+        index.quantizer->reconstruct(list_no, centroid.data());
+        index.rabitq.compute_query_batch(
+                batch, nq, xs.data(), qb, centroid.data());
+        block_dis.resize(kBatchedScanBlockSize * nq);
+
+        const size_t segment_num = invlists->get_segment_num(list_no);
+        for (size_t segment_idx = 0; segment_idx < segment_num;
+             segment_idx++) {
+            const size_t segment_size =
+                    invlists->get_segment_size(list_no, segment_idx);
+            const size_t segment_offset =
+                    invlists->get_segment_offset(list_no, segment_idx);
+            InvertedLists::ScopedCodes scodes(
+                    invlists, list_no, segment_offset);
+            InvertedLists::ScopedIds sids(invlists, list_no, segment_offset);
+            const uint8_t* codes = scodes.get();
+            const idx_t* ids = sids.get();
+
+            // evaluates a run of consecutive codes that passed the filter
+            auto flush = [&](const size_t run_begin, const size_t run_end) {
+                if (run_end == run_begin) {
+                    return;
+                }
+                index.rabitq.distances_batch(
+                        batch,
+                        run_end - run_begin,
+                        codes + run_begin * code_size,
+                        block_dis.data(),
+                        lower_bounds);
+                for (size_t j = run_begin; j < run_end; j++) {
+                    const float* dis_j =
+                            block_dis.data() + (j - run_begin) * nq;
+                    for (size_t i = 0; i < nq; i++) {
+                        float* heap_dis = distances + queries[i] * k;
+                        idx_t* heap_ids = labels + queries[i] * k;
+                        if (C::cmp(heap_dis[0], dis_j[i])) {
+                            heap_replace_top<C>(
+                                    k, heap_dis, heap_ids, dis_j[i], ids[j]);
+                        }
+                    }
+                }
+            };
+
+            size_t run_begin = 0;
+            for (size_t j = 0; j < segment_size; j++) {
+                if (sel != nullptr && !sel->is_member(ids[j])) {
+                    flush(run_begin, j);
+                    run_begin = j + 1;
+                } else if (j + 1 - run_begin == kBatchedScanBlockSize) {
+                    flush(run_begin, j + 1);
+                    run_begin = j + 1;
+                }
+            }
+            flush(run_begin, segment_size);
+        }
+    }
+
+    for (idx_t i = 0; i < n; i++) {
+        heap_reorder<C>(k, distances + i * k, labels + i * k);
+    }
+}
+
+} // namespace
+
+void IndexIVFRaBitQ::search_preassigned_batched(
+        idx_t n,
+        const float* x,
+        idx_t k,
+        const idx_t* assign,
+        float* distances,
+        idx_t* labels,
+        const IVFRaBitQSearchParameters* params,
+        bool lower_bounds) const {
+    FAISS_THROW_IF_NOT(k > 0);
+    FAISS_THROW_IF_NOT_MSG(
+            !invlists->use_iterator,
+            "batched scan does not support iterable inverted lists");
+    FAISS_THROW_IF_NOT_MSG(
+            !lower_bounds || metric_type == METRIC_L2,
+            "RaBitQ lower bounds are available for L2 only");
+
+    const size_t used_nprobe = std::min(
+            nlist, (params != nullptr) ? params->nprobe : this->nprobe);
+    const uint8_t used_qb = (params != nullptr) ? params->qb : qb;
+    const IDSelector* sel = (params != nullptr) ? params->sel : nullptr;
+    const std::function<bool()> should_stop =
+            (params != nullptr) ? params->should_stop : nullptr;
+
+    if (is_similarity_metric(metric_type)) {
+        scan_lists_batched<CMin<float, idx_t>>(
+                *this,
+                n,
+                x,
+                k,
+                used_nprobe,
+                assign,
+                distances,
+                labels,
+                used_qb,
+                sel,
+                should_stop,
+                lower_bounds);
+    } else {
+        scan_lists_batched<CMax<float, idx_t>>(
+                *this,
+                n,
+                x,
+                k,
+                used_nprobe,
+                assign,
+                distances,
+                labels,
+                used_qb,
+                sel,
+                should_stop,
+                lower_bounds);
+    }
+}
+
 } // namespace faiss
\ No newline at end of file
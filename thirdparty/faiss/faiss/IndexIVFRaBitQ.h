@@ -2,6 +2,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 
 #include <faiss/Index.h>
 #include <faiss/IndexIVF.h>
@@ -12,6 +13,9 @@ namespace faiss {
 
 struct IVFRaBitQSearchParameters : IVFSearchParameters {
     uint8_t qb = 0;
+    /// polled between the lists of search_preassigned_batched(), the scan
+    /// stops with the results found so far once it returns true
+    std::function<bool()> should_stop;
 };
 
 // * by_residual is true, just by design
@@ -59,6 +63,25 @@ struct IndexIVFRaBitQ : IndexIVF {
 
     // unfortunately
     DistanceComputer* get_distance_computer() const override;
+
+    // list-major search of n queries with precomputed assignments (n x
+    //   nprobe). Every probed list is read once and each of its codes is
+    //   evaluated against all the queries that probe the list, instead of
+    //   one scan per query. x is expected to be rotated already.
+    // If lower_bounds is set, the results are the lower bounds of the
+    //   estimated distances given by the error bound of RaBitQ, which is
+    //   useful to decide what is worth refining. METRIC_L2 only.
+    // params->should_stop is polled before every list.
+    // This call runs in the calling thread.
+    void search_preassigned_batched(
+            idx_t n,
+            const float* x,
+            idx_t k,
+            const idx_t* assign,
+            float* distances,
+            idx_t* labels,
+            const IVFRaBitQSearchParameters* params = nullptr,
+            bool lower_bounds = false) const;
 };
 
 } // namespace faiss
\ No newline at end of file
@@ -111,7 +111,7 @@ void IndexIVFScalarQuantizerCC::add_with_ids(
         std::unique_ptr<idx_t[]> coarse_idx(new idx_t[n]);
         {
             auto x_normalized = knowhere::CopyAndNormalizeVecs(x, n, d);
-            quantizer->assign(n, x_normalized.get(), coarse_idx.get());
+            assign_for_add(n, x_normalized.get(), coarse_idx.get());
         }
         add_core(n, x, nullptr, xids, coarse_idx.get());
     } else {
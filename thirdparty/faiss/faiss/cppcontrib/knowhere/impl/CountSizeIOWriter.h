@@ -25,6 +25,13 @@ struct CountSizeIOWriter : IOWriter {
         total_size += size * nitems;
         return nitems;
     }
+
+    // the same call as knowhere::MemoryIOWriter::write(), so that the writers
+    // taking one can be sized with this one
+    template <typename T>
+    size_t write(T* ptr, size_t size, size_t nitems = 1) {
+        return operator()(ptr, size, nitems);
+    }
 };
 
 }
@@ -19,8 +19,10 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <queue>
+#include <vector>
 
 // Faiss-specific headers
 #include <faiss/Index.h>
@@ -89,6 +91,64 @@ struct v2_hnsw_searcher {
     // the pointer is not owned.
     const faiss::SearchParametersHNSW* params;
 
+    // scratch buffers for the neighbors of a node that are evaluated
+    // together, reused across nodes.
+    std::vector<idx_t> saved_indices;
+    std::vector<int> saved_statuses;
+    std::vector<float> saved_distances;
+
+    // an optional check for a cancelled or timed out request, polled
+    // every kStopCheckInterval expanded nodes. Once it returns true, the
+    // traversal ends and the candidates found so far are kept.
+    std::function<bool()> should_stop;
+    static constexpr size_t kStopCheckInterval = 64;
+
+    // whether the neighbors of a node that the filter rejects are taken
+    // instead of the node itself (two-hop expansion, as in ACORN). The walk
+    // then stays on the subgraph admitted by the filter and kAlpha is unused.
+    bool expand_filtered_out = false;
+
+    // an optional table of entry points into the level 0. When it is set,
+    // the descent of the upper levels from hnsw.entry_point is skipped: all
+    // the entry points are evaluated at once and seed the candidates.
+    // the pointer is not owned.
+    const storage_idx_t* entry_points = nullptr;
+    size_t n_entry_points = 0;
+
+    // adaptive termination of a top-k search, ended earlier than by
+    // efSearch if any of these is set:
+    // * once the top-k has not changed for early_stop_patience expanded
+    //   nodes in a row,
+    // * once the next node to expand is farther from the best candidate
+    //   than early_stop_ratio times the spread of the top-k.
+    size_t early_stop_patience = 0;
+    float early_stop_ratio = 0.0f;
+
+    // if set, receives the largest ratio (as for early_stop_ratio) of a
+    // node whose expansion changed the top-k, to learn early_stop_ratio.
+    // the pointer is not owned.
+    float* max_improving_ratio = nullptr;
+
+    // an optional full precision distance computer for a lazy refine of a
+    // top-k search. When it is set, the walk keeps at least rerank_window
+    // candidates, and the exact distances of at most rerank_window of them
+    // are computed by batches of kRerankBatch in the order of their code
+    // distances. The rerank stops early by a heuristic: once the code
+    // distance of the next candidate, less rerank_error_margin times the
+    // largest excess of a code distance over an exact one seen so far, is
+    // not below the exact k-th distance. The excess is only estimated from
+    // the reranked candidates, so a candidate with a larger quantization
+    // error may still be missed, as a smaller rerank_window would miss it.
+    // the pointer is not owned, it already knows the query vector.
+    DistanceComputerT* refine_dis = nullptr;
+    size_t rerank_window = 0;
+    float rerank_error_margin = 2.0f;
+    static constexpr size_t kRerankBatch = 8;
+
+    // the candidates that have their exact distances, as a max-heap of the
+    // k nearest ones.
+    std::vector<std::pair<float, idx_t>> reranked;
+
     //
     v2_hnsw_searcher(
             const faiss::HNSW& hnsw_,
@@ -104,7 +164,12 @@ struct v2_hnsw_searcher {
               visited_nodes{visited_nodes_},
               filter{filter_},
               kAlpha{kAlpha_},
-              params{params_} {}
+              params{params_} {
+        const size_t max_degree = hnsw.nb_neighbors(0);
+        saved_indices.reserve(max_degree);
+        saved_statuses.reserve(max_degree);
+        saved_distances.reserve(max_degree);
+    }
 
     v2_hnsw_searcher(const v2_hnsw_searcher&) = delete;
     v2_hnsw_searcher(v2_hnsw_searcher&&) = delete;
@@ -185,12 +250,11 @@ struct v2_hnsw_searcher {
         size_t end = 0;
         hnsw.neighbor_range(node_id, level, &begin, &end);
 
-        // todo: add prefetch
-        size_t counter = 0;
-        size_t saved_indices[4];
-        int saved_statuses[4];
+        // gather all eligible neighbors first, so that their distances
+        // are evaluated by a single wide batch
+        saved_indices.clear();
+        saved_statuses.clear();
 
-        size_t ndis = 0;
         for (size_t j = begin; j < end; j++) {
             const storage_idx_t v1 = hnsw.neighbors[j];
 
@@ -212,6 +276,14 @@ struct v2_hnsw_searcher {
             // is the node disabled?
             int status = knowhere::Neighbor::kValid;
             if (!filter.is_member(v1)) {
+                if (expand_filtered_out) {
+                    // take its neighbors instead, with no more nodes to
+                    // evaluate than an unfiltered node has
+                    gather_two_hop_neighbors(
+                            v1, level, (size_t)hnsw.nb_neighbors(level));
+                    continue;
+                }
+
                 // yes, disabled
                 status = knowhere::Neighbor::kInvalid;
 
@@ -224,55 +296,25 @@ struct v2_hnsw_searcher {
                 accumulated_alpha -= 1.0f;
             }
 
-            saved_indices[counter] = v1;
-            saved_statuses[counter] = status;
-            counter += 1;
-
-            ndis += 1;
-
-            if (counter == 4) {
-                // evaluate 4x distances at once
-                float dis[4] = {0, 0, 0, 0};
-                qdis.distances_batch_4(
-                        saved_indices[0],
-                        saved_indices[1],
-                        saved_indices[2],
-                        saved_indices[3],
-                        dis[0],
-                        dis[1],
-                        dis[2],
-                        dis[3]);
-
-                for (size_t id4 = 0; id4 < 4; id4++) {
-                    // record a traversed edge
-                    graph_visitor.visit_edge(
-                            level, node_id, saved_indices[id4], dis[id4]);
-
-                    // add a record of visited nodes
-                    knowhere::Neighbor nn(
-                            saved_indices[id4], dis[id4], saved_statuses[id4]);
-                    if (func_add_candidate(nn)) {
-#if defined(USE_PREFETCH)
-                        // TODO
-                        // _mm_prefetch(get_linklist0(v), _MM_HINT_T0);
-#endif
-                    }
-                }
-
-                counter = 0;
-            }
+            saved_indices.push_back(v1);
+            saved_statuses.push_back(status);
         }
 
-        // process leftovers
-        for (size_t id4 = 0; id4 < counter; id4++) {
-            // evaluate a single distance
-            const float dis = qdis(saved_indices[id4]);
+        const size_t ndis = saved_indices.size();
 
+        // evaluate all the distances at once
+        saved_distances.resize(ndis);
+        qdis.distances_by_ids(
+                saved_indices.data(), ndis, saved_distances.data());
+
+        for (size_t i = 0; i < ndis; i++) {
             // record a traversed edge
-            graph_visitor.visit_edge(level, node_id, saved_indices[id4], dis);
+            graph_visitor.visit_edge(
+                    level, node_id, saved_indices[i], saved_distances[i]);
 
-            // add a record of visited
-            knowhere::Neighbor nn(saved_indices[id4], dis, saved_statuses[id4]);
+            // add a record of visited nodes
+            knowhere::Neighbor nn(
+                    saved_indices[i], saved_distances[i], saved_statuses[i]);
             if (func_add_candidate(nn)) {
 #if defined(USE_PREFETCH)
                 // TODO
@@ -291,13 +333,111 @@ struct v2_hnsw_searcher {
         return stats;
     }
 
+    // add the unvisited neighbors of node_id that pass the filter to the
+    // nodes to evaluate, until max_size nodes are gathered.
+    void gather_two_hop_neighbors(
+            const storage_idx_t node_id,
+            const int level,
+            const size_t max_size) {
+        size_t begin = 0;
+        size_t end = 0;
+        hnsw.neighbor_range(node_id, level, &begin, &end);
+
+        for (size_t j = begin; j < end && saved_indices.size() < max_size;
+             j++) {
+            const storage_idx_t v2 = hnsw.neighbors[j];
+            if (v2 < 0) {
+                break;
+            }
+
+            // a rejected node stays unvisited, it may still be expanded
+            // from another node
+            if (visited_nodes.get(v2) || !filter.is_member(v2)) {
+                continue;
+            }
+
+            visited_nodes.set(v2);
+            saved_indices.push_back(v2);
+            saved_statuses.push_back(knowhere::Neighbor::kValid);
+        }
+    }
+
+    // pick the top-k of retset by the exact distances of refine_dis, see
+    // rerank_window. The results are sorted in reranked.
+    faiss::HNSWStats rerank_top_k(
+            knowhere::NeighborSetDoublePopList& retset,
+            const size_t k) {
+        faiss::HNSWStats stats;
+
+        const size_t n = std::min(retset.size(), std::max(rerank_window, k));
+        reranked.clear();
+        float max_excess = 0.0f;
+        for (size_t i = 0; i < n; i += kRerankBatch) {
+            if (reranked.size() == k &&
+                retset[i].distance - rerank_error_margin * max_excess >=
+                        reranked.front().first) {
+                break;
+            }
+
+            // evaluate a batch at once
+            const size_t n_batch = std::min(kRerankBatch, n - i);
+            saved_indices.resize(n_batch);
+            saved_distances.resize(n_batch);
+            for (size_t j = 0; j < n_batch; j++) {
+                saved_indices[j] = retset[i + j].id;
+            }
+            refine_dis->distances_by_ids(
+                    saved_indices.data(), n_batch, saved_distances.data());
+
+            for (size_t j = 0; j < n_batch; j++) {
+                max_excess = std::max(
+                        max_excess,
+                        retset[i + j].distance - saved_distances[j]);
+
+                reranked.emplace_back(saved_distances[j], saved_indices[j]);
+                std::push_heap(reranked.begin(), reranked.end());
+                if (reranked.size() > k) {
+                    std::pop_heap(reranked.begin(), reranked.end());
+                    reranked.pop_back();
+                }
+            }
+
+            if (track_hnsw_stats) {
+                stats.ndis += n_batch;
+            }
+        }
+
+        std::sort_heap(reranked.begin(), reranked.end());
+        return stats;
+    }
+
+    // the position of node_dis between the best candidate (0) and the k-th
+    // one (1), or 0 if there are less than k candidates.
+    // retset is indexed over the candidates that pass the filter only, so
+    // the filtered out ones that the walk keeps as bridges neither fill nor
+    // narrow the top-k.
+    float top_k_ratio(
+            knowhere::NeighborSetDoublePopList& retset,
+            const size_t k,
+            const float node_dis) {
+        if (retset.size() < k) {
+            return 0.0f;
+        }
+
+        const float d_first = retset[0].distance;
+        const float spread = retset[k - 1].distance - d_first;
+        return (spread > 0) ? (node_dis - d_first) / spread : 0.0f;
+    }
+
     // perform the search on a given level.
     // it is assumed that retset is initialized and contains the initial nodes.
+    // the adaptive termination applies to the top k candidates, if k > 0.
     faiss::HNSWStats search_on_a_level(
             knowhere::NeighborSetDoublePopList& retset,
             const int level,
             knowhere::IteratorMinHeap* const __restrict disqualified = nullptr,
-            const float initial_accumulated_alpha = 1.0f) {
+            const float initial_accumulated_alpha = 1.0f,
+            const size_t k = 0) {
         faiss::HNSWStats stats;
 
         //
@@ -308,11 +448,36 @@ struct v2_hnsw_searcher {
             return retset.insert(n, disqualified);
         };
 
+        // the top-k is tracked by its k-th candidate, which moves whenever
+        // a closer candidate is inserted
+        const bool track_top_k = (k > 0) &&
+                (early_stop_patience > 0 || early_stop_ratio > 0 ||
+                 max_improving_ratio != nullptr);
+        idx_t last_kth_id = -1;
+        size_t n_unchanged = 0;
+
         // iterate while possible
+        size_t n_popped = 0;
         while (retset.has_next()) {
+            if (should_stop && (++n_popped % kStopCheckInterval) == 0 &&
+                should_stop()) {
+                break;
+            }
+
             // get a node to be processed
             const knowhere::Neighbor neighbor = retset.pop();
 
+            // a filtered out node is only a bridge to the nodes behind it,
+            // its own distance does not bound them
+            float ratio = 0.0f;
+            if (track_top_k &&
+                neighbor.status != knowhere::Neighbor::kInvalid) {
+                ratio = top_k_ratio(retset, k, neighbor.distance);
+                if (early_stop_ratio > 0 && ratio > early_stop_ratio) {
+                    break;
+                }
+            }
+
             // analyze its neighbors
             faiss::HNSWStats local_stats = evaluate_single_node(
                     neighbor.id,
@@ -324,6 +489,22 @@ struct v2_hnsw_searcher {
             if (track_hnsw_stats) {
                 stats.combine(local_stats);
             }
+
+            if (track_top_k && retset.size() >= k) {
+                const idx_t kth_id = retset[k - 1].id;
+                if (kth_id != last_kth_id) {
+                    last_kth_id = kth_id;
+                    n_unchanged = 0;
+                    if (max_improving_ratio != nullptr) {
+                        *max_improving_ratio =
+                                std::max(*max_improving_ratio, ratio);
+                    }
+                } else if (
+                        early_stop_patience > 0 &&
+                        ++n_unchanged >= early_stop_patience) {
+                    break;
+                }
+            }
         }
 
         // done
@@ -354,6 +535,65 @@ struct v2_hnsw_searcher {
         return stats;
     }
 
+    // put the starting nodes of the level 0 into retset: either all the
+    // entry points, or the node found by the greedy descent of the upper
+    // levels.
+    faiss::HNSWStats seed_level_0(knowhere::NeighborSetDoublePopList& retset) {
+        faiss::HNSWStats stats;
+
+        auto insert_seed = [&](const storage_idx_t node, const float dis) {
+            if (!filter.is_member(node)) {
+                retset.insert(knowhere::Neighbor(
+                        node, dis, knowhere::Neighbor::kInvalid));
+            } else {
+                retset.insert(knowhere::Neighbor(
+                        node, dis, knowhere::Neighbor::kValid));
+            }
+
+            visited_nodes[node] = true;
+        };
+
+        if (entry_points != nullptr && n_entry_points > 0) {
+            // update the visitor
+            graph_visitor.visit_level(0);
+
+            // evaluate all the entry points at once
+            saved_indices.assign(entry_points, entry_points + n_entry_points);
+            saved_distances.resize(n_entry_points);
+            qdis.distances_by_ids(
+                    saved_indices.data(),
+                    n_entry_points,
+                    saved_distances.data());
+
+            for (size_t i = 0; i < n_entry_points; i++) {
+                if (!visited_nodes[saved_indices[i]]) {
+                    insert_seed(saved_indices[i], saved_distances[i]);
+                }
+            }
+
+            if (track_hnsw_stats) {
+                stats.ndis += n_entry_points;
+            }
+
+            return stats;
+        }
+
+        // initialize the starting point.
+        storage_idx_t nearest = hnsw.entry_point;
+        float d_nearest = qdis(nearest);
+
+        // iterate through upper levels
+        stats = greedy_search_top_levels(nearest, d_nearest);
+
+        // update the visitor
+        graph_visitor.visit_level(0);
+
+        // initialize retset with a single 'nearest' point
+        insert_seed(nearest, d_nearest);
+
+        return stats;
+    }
+
     // perform the search.
     faiss::HNSWStats search(
             const idx_t k,
@@ -375,15 +615,16 @@ struct v2_hnsw_searcher {
             return stats;
         }
 
-        // yes.
-        // greedy search on upper levels.
-
-        // initialize the starting point.
-        storage_idx_t nearest = hnsw.entry_point;
-        float d_nearest = qdis(nearest);
+        // initialize the container for candidates, a lazy refine picks from
+        // as many as a refine of the top rerank_window would
+        idx_t n_candidates = std::max((idx_t)efSearch, k);
+        if (refine_dis != nullptr) {
+            n_candidates = std::max(n_candidates, (idx_t)rerank_window);
+        }
+        knowhere::NeighborSetDoublePopList retset(n_candidates);
 
-        // iterate through upper levels
-        auto bottom_levels_stats = greedy_search_top_levels(nearest, d_nearest);
+        // greedy search on upper levels, or the entry points
+        auto bottom_levels_stats = seed_level_0(retset);
 
         // update stats
         if (track_hnsw_stats) {
@@ -392,36 +633,32 @@ struct v2_hnsw_searcher {
 
         // level 0 search
 
-        // update the visitor
-        graph_visitor.visit_level(0);
-
-        // initialize the container for candidates
-        const idx_t n_candidates = std::max((idx_t)efSearch, k);
-        knowhere::NeighborSetDoublePopList retset(n_candidates);
-
-        // initialize retset with a single 'nearest' point
-        {
-            if (!filter.is_member(nearest)) {
-                retset.insert(knowhere::Neighbor(
-                        nearest, d_nearest, knowhere::Neighbor::kInvalid));
-            } else {
-                retset.insert(knowhere::Neighbor(
-                        nearest, d_nearest, knowhere::Neighbor::kValid));
-            }
-
-            visited_nodes[nearest] = true;
-        }
-
         // perform the search of the level 0.
-        faiss::HNSWStats local_stats = search_on_a_level(retset, 0);
+        faiss::HNSWStats local_stats =
+                search_on_a_level(retset, 0, nullptr, 1.0f, (size_t)k);
 
         // todo: switch to brute-force in case of (retset.size() < k)
 
         // populate the result
-        const idx_t len = std::min((idx_t)retset.size(), k);
-        for (idx_t i = 0; i < len; i++) {
-            distances[i] = retset[i].distance;
-            labels[i] = (idx_t)retset[i].id;
+        idx_t len = 0;
+        if (refine_dis != nullptr) {
+            // pick the top-k by the exact distances
+            faiss::HNSWStats rerank_stats = rerank_top_k(retset, (size_t)k);
+            if (track_hnsw_stats) {
+                local_stats.combine(rerank_stats);
+            }
+
+            len = (idx_t)reranked.size();
+            for (idx_t i = 0; i < len; i++) {
+                distances[i] = reranked[i].first;
+                labels[i] = reranked[i].second;
+            }
+        } else {
+            len = std::min((idx_t)retset.size(), k);
+            for (idx_t i = 0; i < len; i++) {
+                distances[i] = retset[i].distance;
+                labels[i] = (idx_t)retset[i].id;
+            }
         }
         if (len < k) {
             for (idx_t idx = len; idx < k; idx++) {
@@ -459,15 +696,12 @@ struct v2_hnsw_searcher {
             return stats;
         }
 
-        // yes.
-        // greedy search on upper levels.
-
-        // initialize the starting point.
-        storage_idx_t nearest = hnsw.entry_point;
-        float d_nearest = qdis(nearest);
+        // initialize the container for candidates
+        const idx_t n_candidates = efSearch;
+        knowhere::NeighborSetDoublePopList retset(n_candidates);
 
-        // iterate through upper levels
-        auto bottom_levels_stats = greedy_search_top_levels(nearest, d_nearest);
+        // greedy search on upper levels, or the entry points
+        auto bottom_levels_stats = seed_level_0(retset);
 
         // update stats
         if (track_hnsw_stats) {
@@ -476,26 +710,6 @@ struct v2_hnsw_searcher {
 
         // level 0 search
 
-        // update the visitor
-        graph_visitor.visit_level(0);
-
-        // initialize the container for candidates
-        const idx_t n_candidates = efSearch;
-        knowhere::NeighborSetDoublePopList retset(n_candidates);
-
-        // initialize retset with a single 'nearest' point
-        {
-            if (!filter.is_member(nearest)) {
-                retset.insert(knowhere::Neighbor(
-                        nearest, d_nearest, knowhere::Neighbor::kInvalid));
-            } else {
-                retset.insert(knowhere::Neighbor(
-                        nearest, d_nearest, knowhere::Neighbor::kValid));
-            }
-
-            visited_nodes[nearest] = true;
-        }
-
         // perform the search of the level 0.
         faiss::HNSWStats local_stats = search_on_a_level(retset, 0);
 
@@ -520,7 +734,13 @@ struct v2_hnsw_searcher {
             }
         }
 
+        size_t n_popped = 0;
         while (!radius_queue.empty()) {
+            if (should_stop && (++n_popped % kStopCheckInterval) == 0 &&
+                should_stop()) {
+                break;
+            }
+
             auto current = radius_queue.front();
             radius_queue.pop();
 
@@ -550,6 +770,24 @@ struct v2_hnsw_searcher {
                     if (track_hnsw_stats) {
                         pick_stats.ndis += 1;
                     }
+                } else if (expand_filtered_out) {
+                    // reach the nodes behind the rejected one
+                    saved_indices.clear();
+                    saved_statuses.clear();
+                    gather_two_hop_neighbors(
+                            ngb, 0, (size_t)hnsw.nb_neighbors(0));
+
+                    for (const idx_t v2 : saved_indices) {
+                        const float dis = qdis(v2);
+                        if (dis < radius) {
+                            radius_queue.push({dis, v2});
+                            rres->add_result(dis, v2);
+                        }
+                    }
+
+                    if (track_hnsw_stats) {
+                        pick_stats.ndis += saved_indices.size();
+                    }
                 }
             }
         }
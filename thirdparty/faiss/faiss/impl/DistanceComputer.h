@@ -53,6 +53,27 @@ struct DistanceComputer {
         dis3 = d3;
     }
 
+    /// compute distances of current query to n stored vectors,
+    /// dis[j] = dis(ids[j]). Implementations that know their storage
+    /// layout may gather the vectors into wider batches than 4.
+    virtual void distances_by_ids(const idx_t* ids, size_t n, float* dis) {
+        size_t j = 0;
+        for (; j + 4 <= n; j += 4) {
+            this->distances_batch_4(
+                    ids[j],
+                    ids[j + 1],
+                    ids[j + 2],
+                    ids[j + 3],
+                    dis[j],
+                    dis[j + 1],
+                    dis[j + 2],
+                    dis[j + 3]);
+        }
+        for (; j < n; j++) {
+            dis[j] = this->operator()(ids[j]);
+        }
+    }
+
     /// compute distance between two stored vectors
     virtual float symmetric_dis(idx_t i, idx_t j) = 0;
 
@@ -95,6 +116,13 @@ struct NegativeDistanceComputer : DistanceComputer {
         dis3 = -dis3;
     }
 
+    void distances_by_ids(const idx_t* ids, size_t n, float* dis) override {
+        basedis->distances_by_ids(ids, n, dis);
+        for (size_t j = 0; j < n; j++) {
+            dis[j] = -dis[j];
+        }
+    }
+
     /// compute distance between two stored vectors
     float symmetric_dis(idx_t i, idx_t j) override {
         return -basedis->symmetric_dis(i, j);
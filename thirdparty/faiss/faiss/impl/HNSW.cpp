@@ -7,6 +7,7 @@
 
 #include <faiss/impl/HNSW.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <string>
 
@@ -1159,6 +1160,226 @@ void HNSW::permute_entries(const idx_t* map) {
     neighbors = std::move(new_neighbors);
 }
 
+/**************************************************************
+ * Merging
+ **************************************************************/
+
+void HNSW::append_graph(const HNSW& other) {
+    FAISS_THROW_IF_NOT_MSG(
+            cum_nneighbor_per_level == other.cum_nneighbor_per_level,
+            "the graphs to merge must have the same number of links per level");
+    storage_idx_t n0 = levels.size();
+    size_t nb0 = neighbors.size();
+    storage_idx_t n1 = other.levels.size();
+
+    levels.insert(levels.end(), other.levels.begin(), other.levels.end());
+    offsets.reserve(n0 + n1 + 1);
+    for (storage_idx_t i = 1; i <= n1; i++) {
+        offsets.push_back(nb0 + other.offsets[i]);
+    }
+    // the other table may be a view, only use data() and size() on it
+    size_t nb1 = other.neighbors.size();
+    const storage_idx_t* other_neighbors = other.neighbors.data();
+    neighbors.resize(nb0 + nb1);
+    for (size_t j = 0; j < nb1; j++) {
+        storage_idx_t neigh = other_neighbors[j];
+        neighbors[nb0 + j] = neigh >= 0 ? neigh + n0 : -1;
+    }
+}
+
+void HNSW::search_cross_links(
+        DistanceComputer& ptdis,
+        storage_idx_t pt_id,
+        storage_idx_t entry,
+        int entry_level,
+        storage_idx_t* cross_links,
+        VisitedTable& vt) {
+    int pt_level = levels[pt_id] - 1;
+    storage_idx_t nearest = entry;
+    float d_nearest = ptdis(nearest);
+
+    int level = entry_level;
+    for (; level > pt_level; level--) {
+        greedy_update_nearest(*this, ptdis, level, nearest, d_nearest);
+    }
+
+    // before the cross links are merged, the search can not leave the
+    // half of the graph entry belongs to
+    for (; level >= 0; level--) {
+        std::priority_queue<NodeDistCloser> link_targets;
+        search_neighbors_to_add(
+                *this, ptdis, link_targets, nearest, d_nearest, level, vt);
+        ::faiss::shrink_neighbor_list(
+                ptdis, link_targets, nb_neighbors(level));
+
+        size_t begin, end;
+        neighbor_range(pt_id, level, &begin, &end);
+        size_t i = begin;
+        while (!link_targets.empty()) {
+            const NodeDistCloser& target = link_targets.top();
+            // the next level starts from the nearest vertex of this one
+            if (target.d < d_nearest) {
+                nearest = target.id;
+                d_nearest = target.d;
+            }
+            cross_links[i++] = target.id;
+            link_targets.pop();
+        }
+    }
+}
+
+void HNSW::merge_cross_links(
+        DistanceComputer& qdis,
+        storage_idx_t pt_id,
+        storage_idx_t* cross_links,
+        bool keep_max_size_level0) {
+    for (int level = 0; level < levels[pt_id]; level++) {
+        size_t begin, end;
+        neighbor_range(pt_id, level, &begin, &end);
+        if (cross_links[begin] < 0) {
+            // the other graph has no vertex on this level
+            continue;
+        }
+
+        // both lists come from different halves, they have no common id
+        std::priority_queue<NodeDistFarther> candidates;
+        for (size_t i = begin; i < end; i++) {
+            if (neighbors[i] >= 0) {
+                candidates.emplace(
+                        qdis.symmetric_dis(pt_id, neighbors[i]), neighbors[i]);
+            }
+            if (cross_links[i] >= 0) {
+                candidates.emplace(
+                        qdis.symmetric_dis(pt_id, cross_links[i]),
+                        cross_links[i]);
+            }
+        }
+
+        std::vector<NodeDistFarther> kept;
+        shrink_neighbor_list(
+                qdis,
+                candidates,
+                kept,
+                end - begin,
+                keep_max_size_level0 && level == 0);
+
+        size_t i = begin;
+        for (const NodeDistFarther& node : kept) {
+            neighbors[i++] = node.id;
+        }
+        while (i < end) {
+            neighbors[i++] = -1;
+        }
+
+        // keep the cross links that survived the pruning at the front
+        size_t n_cross = begin;
+        for (size_t j = begin; j < end && cross_links[j] >= 0; j++) {
+            for (const NodeDistFarther& node : kept) {
+                if (node.id == cross_links[j]) {
+                    cross_links[n_cross++] = cross_links[j];
+                    break;
+                }
+            }
+        }
+        while (n_cross < end) {
+            cross_links[n_cross++] = -1;
+        }
+    }
+}
+
+void HNSW::merge_reverse_links(
+        DistanceComputer& qdis,
+        storage_idx_t pt_id,
+        int level,
+        const storage_idx_t* reverse,
+        size_t n_reverse,
+        bool keep_max_size_level0) {
+    size_t begin, end;
+    neighbor_range(pt_id, level, &begin, &end);
+
+    std::vector<storage_idx_t> links;
+    links.reserve(end - begin + n_reverse);
+    for (size_t i = begin; i < end; i++) {
+        if (neighbors[i] >= 0) {
+            links.push_back(neighbors[i]);
+        }
+    }
+    size_t n_own = links.size();
+    for (size_t j = 0; j < n_reverse; j++) {
+        // pt_id may have picked the vertex as a cross link itself
+        if (std::find(links.begin(), links.begin() + n_own, reverse[j]) ==
+            links.begin() + n_own) {
+            links.push_back(reverse[j]);
+        }
+    }
+    if (links.size() == n_own) {
+        return;
+    }
+
+    if (links.size() > end - begin) {
+        // let them fight out which to keep, once for all of them
+        std::priority_queue<NodeDistFarther> candidates;
+        for (storage_idx_t v : links) {
+            candidates.emplace(qdis.symmetric_dis(pt_id, v), v);
+        }
+        std::vector<NodeDistFarther> kept;
+        shrink_neighbor_list(
+                qdis,
+                candidates,
+                kept,
+                end - begin,
+                keep_max_size_level0 && level == 0);
+        links.resize(kept.size());
+        for (size_t j = 0; j < kept.size(); j++) {
+            links[j] = kept[j].id;
+        }
+    }
+
+    size_t i = begin;
+    for (storage_idx_t v : links) {
+        neighbors[i++] = v;
+    }
+    while (i < end) {
+        neighbors[i++] = -1;
+    }
+}
+
+void HNSW::add_reverse_cross_links(
+        DistanceComputer& qdis,
+        storage_idx_t pt_id,
+        const storage_idx_t* cross_links,
+        omp_lock_t* locks,
+        bool keep_max_size_level0) {
+    for (int level = 1; level < levels[pt_id]; level++) {
+        size_t begin, end;
+        neighbor_range(pt_id, level, &begin, &end);
+        for (size_t i = begin; i < end && cross_links[i] >= 0; i++) {
+            storage_idx_t other_id = cross_links[i];
+            omp_set_lock(&locks[other_id]);
+            // other_id may have picked pt_id as a cross link itself
+            size_t other_begin, other_end;
+            neighbor_range(other_id, level, &other_begin, &other_end);
+            bool linked = false;
+            for (size_t j = other_begin; j < other_end; j++) {
+                if (neighbors[j] == pt_id) {
+                    linked = true;
+                    break;
+                }
+            }
+            if (!linked) {
+                add_link(
+                        *this,
+                        qdis,
+                        other_id,
+                        pt_id,
+                        level,
+                        keep_max_size_level0);
+            }
+            omp_unset_lock(&locks[other_id]);
+        }
+    }
+}
+
 /**************************************************************
  * MinimaxHeap
  **************************************************************/
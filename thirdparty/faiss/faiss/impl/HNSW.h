@@ -232,6 +232,55 @@ struct HNSW {
             bool keep_max_size_level0 = false);
 
     void permute_entries(const idx_t* map);
+
+    // methods used to merge two graphs, see IndexHNSW::merge_graph_from
+
+    /** append the levels and links of other after the vertices of this
+     * graph, with its ids shifted by the current number of vertices. The
+     * entry point is left unchanged. */
+    void append_graph(const HNSW& other);
+
+    /** search the graph reached from entry, a vertex of the other half of
+     * a merge at level entry_level, for the neighbors of pt_id on all
+     * levels <= min(its level, entry_level). The neighbor lists, pruned
+     * with the heuristic, are stored in cross_links with the layout of the
+     * neighbors table. Only reads the graph. */
+    void search_cross_links(
+            DistanceComputer& ptdis,
+            storage_idx_t pt_id,
+            storage_idx_t entry,
+            int entry_level,
+            storage_idx_t* cross_links,
+            VisitedTable& vt);
+
+    /** prune the union of the neighbors and the cross links of pt_id back
+     * to the neighbor list sizes. Only the cross links that survived stay in
+     * cross_links. Only touches the lists of pt_id. */
+    void merge_cross_links(
+            DistanceComputer& qdis,
+            storage_idx_t pt_id,
+            storage_idx_t* cross_links,
+            bool keep_max_size_level0 = false);
+
+    /** prune the union of the neighbors of pt_id on level and the n_reverse
+     * vertices of reverse back to the list size, in a single pass. Only
+     * touches the list of pt_id. */
+    void merge_reverse_links(
+            DistanceComputer& qdis,
+            storage_idx_t pt_id,
+            int level,
+            const storage_idx_t* reverse,
+            size_t n_reverse,
+            bool keep_max_size_level0 = false);
+
+    /** add pt_id to the neighbor lists of its remaining cross links on the
+     * levels > 0, level 0 is gathered for merge_reverse_links instead */
+    void add_reverse_cross_links(
+            DistanceComputer& qdis,
+            storage_idx_t pt_id,
+            const storage_idx_t* cross_links,
+            omp_lock_t* locks,
+            bool keep_max_size_level0 = false);
 };
 
 struct HNSWStats {
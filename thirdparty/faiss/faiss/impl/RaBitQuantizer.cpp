@@ -23,15 +23,6 @@ struct FactorsData {
     float sum_xb = 0;
 };
 
-struct QueryFactorsData {
-    float c1 = 0;
-    float c2 = 0;
-    float c34 = 0;
-
-    float qr_to_c_L2sqr = 0;
-    float qr_norm_L2sqr = 0;
-};
-
 static size_t get_code_size(const size_t d) {
     return (d + 7) / 8 + sizeof(FactorsData);
 }
@@ -168,6 +159,180 @@ void RaBitQuantizer::decode_core(
     }
 }
 
+namespace {
+
+// P^(-1)(qr - c) and the factors of a query that is not quantized
+void compute_query_factors_notq(
+        const float* x,
+        const float* centroid,
+        const size_t d,
+        const MetricType metric_type,
+        float* rotated_q,
+        QueryFactorsData& query_fac) {
+    // compute the distance from the query to the centroid
+    if (centroid != nullptr) {
+        query_fac.qr_to_c_L2sqr = fvec_L2sqr(x, centroid, d);
+    } else {
+        query_fac.qr_to_c_L2sqr = fvec_norm_L2sqr(x, d);
+    }
+
+    // subtract c, obtain P^(-1)(qr - c)
+    for (size_t i = 0; i < d; i++) {
+        rotated_q[i] = x[i] - ((centroid == nullptr) ? 0 : centroid[i]);
+    }
+
+    // compute some numbers
+    const float inv_d = (d == 0) ? 1.0f : (1.0f / std::sqrt((float)d));
+
+    // do not quantize the query
+    float sum_q = 0;
+    for (size_t i = 0; i < d; i++) {
+        sum_q += rotated_q[i];
+    }
+
+    query_fac.c1 = 2 * inv_d;
+    query_fac.c2 = 0;
+    query_fac.c34 = sum_q * inv_d;
+
+    if (metric_type == MetricType::METRIC_INNER_PRODUCT) {
+        // precompute if needed
+        query_fac.qr_norm_L2sqr = fvec_norm_L2sqr(x, d);
+    }
+}
+
+// SQ qb-bits quantization of P^(-1)(qr - c), rearranged into qb bit-planes
+//   of (d + 7) / 8 bytes each, plus the factors of the query
+void compute_query_factors_q(
+        const float* x,
+        const float* centroid,
+        const size_t d,
+        const MetricType metric_type,
+        const uint8_t qb,
+        uint8_t* rotated_qq,
+        uint8_t* rearranged_rotated_qq,
+        QueryFactorsData& query_fac) {
+    // compute the distance from the query to the centroid
+    if (centroid != nullptr) {
+        query_fac.qr_to_c_L2sqr = fvec_L2sqr(x, centroid, d);
+    } else {
+        query_fac.qr_to_c_L2sqr = fvec_norm_L2sqr(x, d);
+    }
+
+    // rotate the query
+    std::vector<float> rotated_q(d);
+    for (size_t i = 0; i < d; i++) {
+        rotated_q[i] = x[i] - ((centroid == nullptr) ? 0 : centroid[i]);
+    }
+
+    // compute some numbers
+    const float inv_d = (d == 0) ? 1.0f : (1.0f / std::sqrt((float)d));
+
+    // quantize the query. compute min and max
+    float v_min = std::numeric_limits<float>::max();
+    float v_max = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i < d; i++) {
+        const float v_q = rotated_q[i];
+        v_min = std::min(v_min, v_q);
+        v_max = std::max(v_max, v_q);
+    }
+
+    const float pow_2_qb = 1 << qb;
+
+    const float delta = (v_max - v_min) / (pow_2_qb - 1);
+    const float inv_delta = 1.0f / delta;
+
+    size_t sum_qq = 0;
+    for (int32_t i = 0; i < d; i++) {
+        const float v_q = rotated_q[i];
+
+        // a default non-randomized SQ
+        const int v_qq = std::round((v_q - v_min) * inv_delta);
+
+        rotated_qq[i] = std::min(255, std::max(0, v_qq));
+        sum_qq += v_qq;
+    }
+
+    // rearrange the query vector
+    size_t offset = (d + 7) / 8;
+
+    std::fill(rearranged_rotated_qq, rearranged_rotated_qq + offset * qb, 0);
+
+    size_t d8 = (d / 8) * 8;
+    for (size_t iv = 0; iv < qb; iv++) {
+        for (size_t idim = 0; idim < d8; idim += 8) {
+            uint8_t value = 0;
+            for (size_t ldim = 0; ldim < 8; ldim++) {
+                const bool bit = ((rotated_qq[ldim + idim] & (1 << iv)) != 0);
+                value |= bit ? (1 << (ldim % 8)) : 0;
+            }
+
+            rearranged_rotated_qq[iv * offset + idim / 8] = value;
+        }
+
+        for (size_t idim = d8; idim < d; idim++) {
+            const bool bit = ((rotated_qq[idim] & (1 << iv)) != 0);
+            rearranged_rotated_qq[iv * offset + idim / 8] |=
+                    bit ? (1 << (idim % 8)) : 0;
+        }
+    }
+
+    query_fac.c1 = 2 * delta * inv_d;
+    query_fac.c2 = 2 * v_min * inv_d;
+    query_fac.c34 = inv_d * (delta * sum_qq + d * v_min);
+
+    if (metric_type == MetricType::METRIC_INNER_PRODUCT) {
+        // precompute if needed
+        query_fac.qr_norm_L2sqr = fvec_norm_L2sqr(x, d);
+    }
+}
+
+// turns <q,o> (either a popcount-based or a float one) into a distance
+inline float finalize_distance(
+        const FactorsData* fac,
+        const QueryFactorsData& query_fac,
+        const float dot_qo,
+        const MetricType metric_type) {
+    // Baseline FAISS:
+    //
+    // It was a willful decision (after the discussion) to not to pre-cache
+    //   the sum of all bits, just in order to reduce the overhead per vector.
+
+    // This implementation:
+    //
+    // The sum of all bits is cached.
+    float sum_q = fac->sum_xb;
+
+    // dot-product itself
+    float final_dot = query_fac.c1 * dot_qo;
+    // normalizer coefficients
+    final_dot += query_fac.c2 * sum_q;
+    // normalizer coefficients
+    final_dot -= query_fac.c34;
+
+    // this is ||or - c||^2 - (IP ? ||or||^2 : 0)
+    const float or_c_l2sqr = fac->or_minus_c_l2sqr;
+
+    // pre_dist = ||or - c||^2 + ||qr - c||^2 -
+    //     2 * ||or - c|| * ||qr - c|| * <q,o> - (IP ? ||or||^2 : 0)
+    const float pre_dist = or_c_l2sqr + query_fac.qr_to_c_L2sqr -
+            2 * fac->dp_multiplier * final_dot;
+
+    if (metric_type == MetricType::METRIC_L2) {
+        // ||or - q||^ 2
+        return pre_dist;
+    } else {
+        // metric == MetricType::METRIC_INNER_PRODUCT
+
+        // this is ||q||^2
+        const float query_norm_sqr = query_fac.qr_norm_L2sqr;
+
+        // 2 * (or, q) = (||or - q||^2 - ||q||^2 - ||or||^2)
+        return -0.5f * (pre_dist - query_norm_sqr);
+    }
+}
+
+} // namespace
+
 struct RaBitDistanceComputer : FlatCodesDistanceComputer {
     // dimensionality
     size_t d = 0;
@@ -218,46 +383,9 @@ float RaBitDistanceComputerNotQ::distance_to_code(const uint8_t* code) {
     // this is the baseline code
     //
     // compute <q,o> using floats
-    float dot_qo = 0;
-    // Baseline FAISS:
-    //
-    // It was a willful decision (after the discussion) to not to pre-cache
-    //   the sum of all bits, just in order to reduce the overhead per vector.
-
-    // Current implementation:
-    // 
-    // Sum of all bits is cached.
-    dot_qo = fvec_masked_sum(rotated_q.data(), binary_data, d);
+    const float dot_qo = fvec_masked_sum(rotated_q.data(), binary_data, d);
 
-    float sum_q = fac->sum_xb;
-
-    // dot-product itself
-    float final_dot = query_fac.c1 * dot_qo;
-    // normalizer coefficients
-    final_dot += query_fac.c2 * sum_q;
-    // normalizer coefficients
-    final_dot -= query_fac.c34;
-
-    // this is ||or - c||^2 - (IP ? ||or||^2 : 0)
-    const float or_c_l2sqr = fac->or_minus_c_l2sqr;
-
-    // pre_dist = ||or - c||^2 + ||qr - c||^2 -
-    //     2 * ||or - c|| * ||qr - c|| * <q,o> - (IP ? ||or||^2 : 0)
-    const float pre_dist = or_c_l2sqr + query_fac.qr_to_c_L2sqr -
-            2 * fac->dp_multiplier * final_dot;
-
-    if (metric_type == MetricType::METRIC_L2) {
-        // ||or - q||^ 2
-        return pre_dist;
-    } else {
-        // metric == MetricType::METRIC_INNER_PRODUCT
-
-        // this is ||q||^2
-        const float query_norm_sqr = query_fac.qr_norm_L2sqr;
-
-        // 2 * (or, q) = (||or - q||^2 - ||q||^2 - ||or||^2)
-        return -0.5f * (pre_dist - query_norm_sqr);
-    }
+    return finalize_distance(fac, query_fac, dot_qo, metric_type);
 }
 
 void RaBitDistanceComputerNotQ::set_query(const float* x) {
@@ -266,36 +394,9 @@ void RaBitDistanceComputerNotQ::set_query(const float* x) {
             (metric_type == MetricType::METRIC_L2 ||
              metric_type == MetricType::METRIC_INNER_PRODUCT));
 
-    // compute the distance from the query to the centroid
-    if (centroid != nullptr) {
-        query_fac.qr_to_c_L2sqr = fvec_L2sqr(x, centroid, d);
-    } else {
-        query_fac.qr_to_c_L2sqr = fvec_norm_L2sqr(x, d);
-    }
-
-    // subtract c, obtain P^(-1)(qr - c)
     rotated_q.resize(d);
-    for (size_t i = 0; i < d; i++) {
-        rotated_q[i] = x[i] - ((centroid == nullptr) ? 0 : centroid[i]);
-    }
-
-    // compute some numbers
-    const float inv_d = (d == 0) ? 1.0f : (1.0f / std::sqrt((float)d));
-
-    // do not quantize the query
-    float sum_q = 0;
-    for (size_t i = 0; i < d; i++) {
-        sum_q += rotated_q[i];
-    }
-
-    query_fac.c1 = 2 * inv_d;
-    query_fac.c2 = 0;
-    query_fac.c34 = sum_q * inv_d;
-
-    if (metric_type == MetricType::METRIC_INNER_PRODUCT) {
-        // precompute if needed
-        query_fac.qr_norm_L2sqr = fvec_norm_L2sqr(x, d);
-    }
+    compute_query_factors_notq(
+            x, centroid, d, metric_type, rotated_q.data(), query_fac);
 }
 
 //
@@ -348,45 +449,10 @@ float RaBitDistanceComputerQ::distance_to_code(const uint8_t* code) {
     // }
 
     // this is the scheme for popcount
-    float dot_qo = rabitq_dp_popcnt(rearranged_rotated_qq.data(), binary_data, d, qb);
-
-    // Baseline FAISS:
-    //
-    // It was a willful decision (after the discussion) to not to pre-cache
-    //   the sum of all bits, just in order to reduce the overhead per vector.
+    const float dot_qo =
+            rabitq_dp_popcnt(rearranged_rotated_qq.data(), binary_data, d, qb);
 
-    // This implementation:
-    //
-    // The sum of all bits is cached.
-    float sum_q = fac->sum_xb;
-
-    // dot-product itself
-    float final_dot = query_fac.c1 * dot_qo;
-    // normalizer coefficients
-    final_dot += query_fac.c2 * sum_q;
-    // normalizer coefficients
-    final_dot -= query_fac.c34;
-
-    // this is ||or - c||^2 - (IP ? ||or||^2 : 0)
-    const float or_c_l2sqr = fac->or_minus_c_l2sqr;
-
-    // pre_dist = ||or - c||^2 + ||qr - c||^2 -
-    //     2 * ||or - c|| * ||qr - c|| * <q,o> - (IP ? ||or||^2 : 0)
-    const float pre_dist = or_c_l2sqr + query_fac.qr_to_c_L2sqr -
-            2 * fac->dp_multiplier * final_dot;
-
-    if (metric_type == MetricType::METRIC_L2) {
-        // ||or - q||^ 2
-        return pre_dist;
-    } else {
-        // metric == MetricType::METRIC_INNER_PRODUCT
-
-        // this is ||q||^2
-        const float query_norm_sqr = query_fac.qr_norm_L2sqr;
-
-        // 2 * (or, q) = (||or - q||^2 - ||q||^2 - ||or||^2)
-        return -0.5f * (pre_dist - query_norm_sqr);
-    }
+    return finalize_distance(fac, query_fac, dot_qo, metric_type);
 }
 
 void RaBitDistanceComputerQ::set_query(const float* x) {
@@ -395,84 +461,135 @@ void RaBitDistanceComputerQ::set_query(const float* x) {
             (metric_type == MetricType::METRIC_L2 ||
              metric_type == MetricType::METRIC_INNER_PRODUCT));
 
-    // compute the distance from the query to the centroid
-    if (centroid != nullptr) {
-        query_fac.qr_to_c_L2sqr = fvec_L2sqr(x, centroid, d);
-    } else {
-        query_fac.qr_to_c_L2sqr = fvec_norm_L2sqr(x, d);
-    }
-
     // allocate space
     rotated_qq.resize(d);
+    popcount_aligned_dim = ((d + 7) / 8) * 8;
+    rearranged_rotated_qq.resize((d + 7) / 8 * qb);
+
+    compute_query_factors_q(
+            x,
+            centroid,
+            d,
+            metric_type,
+            qb,
+            rotated_qq.data(),
+            rearranged_rotated_qq.data(),
+            query_fac);
+}
 
-    // rotate the query
-    std::vector<float> rotated_q(d);
-    for (size_t i = 0; i < d; i++) {
-        rotated_q[i] = x[i] - ((centroid == nullptr) ? 0 : centroid[i]);
-    }
+void RaBitQuantizer::compute_query_batch(
+        RaBitQueryBatch& batch,
+        size_t nq,
+        const float* x,
+        uint8_t qb,
+        const float* centroid_in) const {
+    FAISS_ASSERT(x != nullptr || nq == 0);
+    FAISS_ASSERT(
+            (metric_type == MetricType::METRIC_L2 ||
+             metric_type == MetricType::METRIC_INNER_PRODUCT));
 
-    // compute some numbers
-    const float inv_d = (d == 0) ? 1.0f : (1.0f / std::sqrt((float)d));
+    batch.nq = nq;
+    batch.qb = qb;
+    batch.query_fac.resize(nq);
 
-    // quantize the query. compute min and max
-    float v_min = std::numeric_limits<float>::max();
-    float v_max = std::numeric_limits<float>::lowest();
-    for (size_t i = 0; i < d; i++) {
-        const float v_q = rotated_q[i];
-        v_min = std::min(v_min, v_q);
-        v_max = std::max(v_max, v_q);
+    if (qb == 0) {
+        batch.rotated_q.resize(nq * d);
+        for (size_t i = 0; i < nq; i++) {
+            compute_query_factors_notq(
+                    x + i * d,
+                    centroid_in,
+                    d,
+                    metric_type,
+                    batch.rotated_q.data() + i * d,
+                    batch.query_fac[i]);
+        }
+    } else {
+        const size_t q_stride = (d + 7) / 8 * qb;
+        std::vector<uint8_t> rotated_qq(d);
+        batch.rearranged_rotated_qq.resize(nq * q_stride);
+        for (size_t i = 0; i < nq; i++) {
+            compute_query_factors_q(
+                    x + i * d,
+                    centroid_in,
+                    d,
+                    metric_type,
+                    qb,
+                    rotated_qq.data(),
+                    batch.rearranged_rotated_qq.data() + i * q_stride,
+                    batch.query_fac[i]);
+        }
     }
+}
 
-    const float pow_2_qb = 1 << qb;
-
-    const float delta = (v_max - v_min) / (pow_2_qb - 1);
-    const float inv_delta = 1.0f / delta;
-
-    size_t sum_qq = 0;
-    for (int32_t i = 0; i < d; i++) {
-        const float v_q = rotated_q[i];
-
-        // a default non-randomized SQ
-        const int v_qq = std::round((v_q - v_min) * inv_delta);
-
-        rotated_qq[i] = std::min(255, std::max(0, v_qq));
-        sum_qq += v_qq;
+void RaBitQuantizer::distances_batch(
+        const RaBitQueryBatch& batch,
+        size_t n,
+        const uint8_t* codes,
+        float* dis,
+        bool lower_bounds) const {
+    FAISS_ASSERT(codes != nullptr || n == 0);
+    FAISS_THROW_IF_NOT_MSG(
+            !lower_bounds || metric_type == MetricType::METRIC_L2,
+            "RaBitQ lower bounds are available for L2 only");
+
+    const size_t nq = batch.nq;
+    // eps0 * 2 / sqrt(d - 1) of the error bound, see compute_codes_core()
+    //   for the factors of a code
+    const float err_multiplier = (d > 1)
+            ? (2 * kErrorBoundEpsilon / std::sqrt((float)(d - 1)))
+            : 0.0f;
+
+    std::vector<float> query_err(lower_bounds ? nq : 0);
+    for (size_t i = 0; i < query_err.size(); i++) {
+        query_err[i] =
+                err_multiplier * std::sqrt(batch.query_fac[i].qr_to_c_L2sqr);
     }
 
-    // rearrange the query vector
-    popcount_aligned_dim = ((d + 7) / 8) * 8;
-    size_t offset = (d + 7) / 8;
-
-    rearranged_rotated_qq.resize(offset * qb);
-    std::fill(rearranged_rotated_qq.begin(), rearranged_rotated_qq.end(), 0);
-
-    size_t d8 = (d / 8) * 8;
-    for (size_t iv = 0; iv < qb; iv++) {
-        for (size_t idim = 0; idim < d8; idim += 8) {
-            uint8_t value = 0;
-            for (size_t ldim = 0; ldim < 8; ldim++) {
-                const bool bit = ((rotated_qq[ldim + idim] & (1 << iv)) != 0);
-                value |= bit ? (1 << (ldim % 8)) : 0;
+    std::vector<int> dp_qo(batch.qb == 0 ? 0 : nq);
+    for (size_t j = 0; j < n; j++) {
+        const uint8_t* binary_data = codes + j * code_size;
+        const FactorsData* fac =
+                reinterpret_cast<const FactorsData*>(binary_data + (d + 7) / 8);
+        float* dis_j = dis + j * nq;
+
+        if (batch.qb == 0) {
+            for (size_t i = 0; i < nq; i++) {
+                const float dot_qo = fvec_masked_sum(
+                        batch.rotated_q.data() + i * d, binary_data, d);
+                dis_j[i] = finalize_distance(
+                        fac, batch.query_fac[i], dot_qo, metric_type);
+            }
+        } else {
+            // the code is loaded once for all the queries
+            rabitq_dp_popcnt_batch(
+                    batch.rearranged_rotated_qq.data(),
+                    nq,
+                    binary_data,
+                    d,
+                    batch.qb,
+                    dp_qo.data());
+            for (size_t i = 0; i < nq; i++) {
+                dis_j[i] = finalize_distance(
+                        fac, batch.query_fac[i], dp_qo[i], metric_type);
             }
-
-            rearranged_rotated_qq[iv * offset + idim / 8] = value;
         }
 
-        for (size_t idim = d8; idim < d; idim++) {
-            const bool bit = ((rotated_qq[idim] & (1 << iv)) != 0);
-            rearranged_rotated_qq[iv * offset + idim / 8] |=
-                    bit ? (1 << (idim % 8)) : 0;
+        if (lower_bounds) {
+            // |<o_bar,q> / <o_bar,o> - <o,q>| <= eps0 *
+            //     sqrt(1 - <o_bar,o>^2) / <o_bar,o> / sqrt(d - 1),
+            //   with <o_bar,o> = ||or - c|| / dp_multiplier, so the error of
+            //   the distance is err_multiplier * ||qr - c|| *
+            //   sqrt(dp_multiplier^2 - ||or - c||^2).
+            //   The error of the query quantization is not accounted for.
+            const float code_err = std::sqrt(std::max(
+                    0.0f,
+                    fac->dp_multiplier * fac->dp_multiplier -
+                            fac->or_minus_c_l2sqr));
+            for (size_t i = 0; i < nq; i++) {
+                dis_j[i] -= query_err[i] * code_err;
+            }
         }
     }
-
-    query_fac.c1 = 2 * delta * inv_d;
-    query_fac.c2 = 2 * v_min * inv_d;
-    query_fac.c34 = inv_d * (delta * sum_qq + d * v_min);
-
-    if (metric_type == MetricType::METRIC_INNER_PRODUCT) {
-        // precompute if needed
-        query_fac.qr_norm_L2sqr = fvec_norm_L2sqr(x, d);
-    }
 }
 
 FlatCodesDistanceComputer* RaBitQuantizer::get_distance_computer(
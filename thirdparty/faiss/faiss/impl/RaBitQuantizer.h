@@ -10,6 +10,31 @@
 
 namespace faiss {
 
+struct QueryFactorsData {
+    float c1 = 0;
+    float c2 = 0;
+    float c34 = 0;
+
+    float qr_to_c_L2sqr = 0;
+    float qr_norm_L2sqr = 0;
+};
+
+// A group of queries, prepared against the same centroid, which are evaluated
+//   together against blocks of codes (see RaBitQuantizer::distances_batch()).
+struct RaBitQueryBatch {
+    size_t nq = 0;
+    // the number of bits for SQ quantization of the queries, 0 means that
+    //   the queries are not quantized
+    uint8_t qb = 0;
+
+    // qb > 0: nq x (qb * (d + 7) / 8) bit-planes of the quantized queries
+    std::vector<uint8_t> rearranged_rotated_qq;
+    // qb == 0: nq x d values of (qr - c)
+    std::vector<float> rotated_q;
+    // some additional numbers for every query
+    std::vector<QueryFactorsData> query_fac;
+};
+
 // the reference implementation of the https://arxiv.org/pdf/2405.12497
 //   Jianyang Gao, Cheng Long, "RaBitQ: Quantizing High-Dimensional Vectors
 //   with a Theoretical Error Bound for Approximate Nearest Neighbor Search".
@@ -67,6 +92,31 @@ struct RaBitQuantizer : Quantizer {
     FlatCodesDistanceComputer* get_distance_computer(
             uint8_t qb,
             const float* centroid_in = nullptr) const;
+
+    // eps0 of the error bound of the estimator, the bound holds with
+    //   a high probability for eps0 = 1.9 (section 3.2.2 of the paper).
+    static constexpr float kErrorBoundEpsilon = 1.9f;
+
+    // prepares nq queries for distances_batch().
+    // specify qb = 0 to keep the queries unquantized, qb > 0 for SQ qb-bits
+    void compute_query_batch(
+            RaBitQueryBatch& batch,
+            size_t nq,
+            const float* x,
+            uint8_t qb,
+            const float* centroid_in = nullptr) const;
+
+    // estimates the distances between n codes and all the queries of a batch,
+    //   dis is n x batch.nq. Every code is loaded once for the whole batch,
+    //   which amortizes the memory traffic of a scan over several queries.
+    // If lower_bounds is set, the output is the estimate minus its error
+    //   bound, which is supported for METRIC_L2 only.
+    void distances_batch(
+            const RaBitQueryBatch& batch,
+            size_t n,
+            const uint8_t* codes,
+            float* dis,
+            bool lower_bounds = false) const;
 };
 
 } // namespace faiss
\ No newline at end of file
@@ -173,7 +173,7 @@ bool read_vector_base(
                     size_t(size),
                     strerror(errno));
 
-            VectorT view = VectorT::create_view(address, nread, nullptr);
+            VectorT view = VectorT::create_view(address, nread, zr->owner);
             target = std::move(view);
 
             return true;
@@ -223,13 +223,19 @@ void read_xb_vector(VectorT& target, IOReader* f) {
  * Read
  **************************************************************/
 
-static void read_index_header(Index* idx, IOReader* f) {
+static void read_index_header(
+        Index* idx,
+        IOReader* f,
+        uint8_t* flags = nullptr) {
     READ1(idx->d);
     READ1(idx->ntotal);
     READ1(idx->is_cosine);
 
     uint8_t dummy8;
     READ1(dummy8);
+    if (flags) {
+        *flags = dummy8;
+    }
     READ1(dummy8);
     READ1(dummy8);
     uint32_t dummy32;
@@ -425,15 +431,21 @@ InvertedLists* read_InvertedLists(IOReader* f, int io_flags) {
         }
         std::vector<size_t> sizes(ails->nlist);
         read_ArrayInvertedLists_sizes(f, sizes);
+        // with a mmap or zero-copy reader, ids and codes become views over
+        // the input, allocating them first would only double the peak memory
+        const bool reads_views = dynamic_cast<MappedFileIOReader*>(f) ||
+                dynamic_cast<ZeroCopyIOReader*>(f);
         for (size_t i = 0; i < ails->nlist; i++) {
-            ails->ids[i].resize(sizes[i]);
-            ails->codes[i].resize(sizes[i] * ails->code_size);
+            if (!reads_views) {
+                ails->ids[i].resize(sizes[i]);
+                ails->codes[i].resize(sizes[i] * ails->code_size);
+            }
             if (ails->with_norm) {
                 ails->code_norms[i].resize(sizes[i]);
             }
         }
         for (size_t i = 0; i < ails->nlist; i++) {
-            size_t n = ails->ids[i].size();
+            size_t n = sizes[i];
             if (n > 0) {
                 read_vector_with_known_size(
                         ails->codes[i], f, n * ails->code_size);
@@ -705,7 +717,9 @@ static void read_ivf_header(
         IndexIVF* ivf,
         IOReader* f,
         std::vector<std::vector<idx_t>>* ids = nullptr) {
-    read_index_header(ivf, f);
+    uint8_t flags = 0;
+    read_index_header(ivf, f, &flags);
+    ivf->lists_capped = flags & 1;
     READ1(ivf->nlist);
     READ1(ivf->nprobe);
     ivf->quantizer = read_index(f);
@@ -85,15 +85,19 @@ namespace faiss {
 /*************************************************************
  * Write
  **************************************************************/
-static void write_index_header(const Index* idx, IOWriter* f) {
+// flags goes in the first reserved byte, files that predate it hold 0 there
+static void write_index_header(
+        const Index* idx,
+        IOWriter* f,
+        uint8_t flags = 0) {
     WRITE1(idx->d);
     WRITE1(idx->ntotal);
     WRITE1(idx->is_cosine);
 
+    WRITE1(flags);
     uint8_t dummy8 = 0;
     WRITE1(dummy8);
     WRITE1(dummy8);
-    WRITE1(dummy8);
     uint32_t dummy32 = 0;
     WRITE1(dummy32);
     idx_t dummy = 0;
@@ -501,7 +505,7 @@ static void write_direct_map(const DirectMap* dm, IOWriter* f) {
 }
 
 static void write_ivf_header(const IndexIVF* ivf, IOWriter* f) {
-    write_index_header(ivf, f);
+    write_index_header(ivf, f, ivf->lists_capped ? 1 : 0);
     WRITE1(ivf->nlist);
     WRITE1(ivf->nprobe);
     // subclasses write by_residual (some of them support only one setting of
@@ -7,12 +7,19 @@
 
 #include <faiss/impl/zerocopy_io.h>
 #include <cstring>
+#include <utility>
 
 namespace faiss {
 
 ZeroCopyIOReader::ZeroCopyIOReader(uint8_t* data, size_t size)
         : data_(data), rp_(0), total_(size) {}
 
+ZeroCopyIOReader::ZeroCopyIOReader(
+        uint8_t* data,
+        size_t size,
+        std::shared_ptr<MaybeOwnedVectorOwner> owner)
+        : data_(data), rp_(0), total_(size), owner(std::move(owner)) {}
+
 ZeroCopyIOReader::~ZeroCopyIOReader() {}
 
 size_t ZeroCopyIOReader::get_data_view(void** ptr, size_t size, size_t nitems) {
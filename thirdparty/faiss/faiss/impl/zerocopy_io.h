@@ -8,8 +8,10 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 
 #include <faiss/impl/io.h>
+#include <faiss/impl/maybe_owned_vector.h>
 
 namespace faiss {
 
@@ -19,7 +21,14 @@ struct ZeroCopyIOReader : public faiss::IOReader {
     size_t rp_ = 0;
     size_t total_ = 0;
 
+    // optional, keeps the buffer alive for the views created over it
+    std::shared_ptr<MaybeOwnedVectorOwner> owner;
+
     ZeroCopyIOReader(uint8_t* data, size_t size);
+    ZeroCopyIOReader(
+            uint8_t* data,
+            size_t size,
+            std::shared_ptr<MaybeOwnedVectorOwner> owner);
     ~ZeroCopyIOReader();
 
     void reset();
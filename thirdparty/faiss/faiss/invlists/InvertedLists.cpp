@@ -469,17 +469,52 @@ void ArrayInvertedLists::permute_invlists(const idx_t* map) {
 
 ArrayInvertedLists::~ArrayInvertedLists() {}
 
+template <typename T>
+void ConcurrentArrayInvertedLists::SegmentTable<T>::emplace_back(
+        size_t segment_size,
+        size_t code_size) {
+    const size_t n = num_segments.load(std::memory_order_relaxed);
+    if (n == capacity) {
+        // publish a grown copy, the readers may still hold the current one
+        const size_t new_capacity = std::max<size_t>(8, capacity * 2);
+        auto grown = std::make_unique<Segment<T>*[]>(new_capacity);
+        if (n > 0) {
+            std::copy_n(
+                    directory.load(std::memory_order_relaxed), n, grown.get());
+        }
+        directory.store(grown.get(), std::memory_order_release);
+        directories.push_back(std::move(grown));
+        capacity = new_capacity;
+    }
+    segments.push_back(std::make_unique<Segment<T>>(segment_size, code_size));
+    directory.load(std::memory_order_relaxed)[n] = segments.back().get();
+    num_segments.store(n + 1, std::memory_order_release);
+}
+
+template <typename T>
+void ConcurrentArrayInvertedLists::SegmentTable<T>::pop_back() {
+    const size_t n = num_segments.load(std::memory_order_relaxed);
+    assert(n > 0);
+    num_segments.store(n - 1, std::memory_order_release);
+    segments.pop_back();
+}
+
+template struct ConcurrentArrayInvertedLists::SegmentTable<uint8_t>;
+template struct ConcurrentArrayInvertedLists::SegmentTable<idx_t>;
+template struct ConcurrentArrayInvertedLists::SegmentTable<float>;
+
 ConcurrentArrayInvertedLists::ConcurrentArrayInvertedLists(
         size_t nlist,
         size_t code_size,
         size_t segment_size,
         bool snorm)
-        : InvertedLists(nlist, code_size), segment_size(segment_size), save_norm(snorm), list_cur(nlist) {
-    ids.resize(nlist);
-    if (save_norm) {
-        code_norms.resize(nlist);
-    }
-    codes.resize(nlist);
+        : InvertedLists(nlist, code_size),
+          segment_size(segment_size),
+          save_norm(snorm),
+          list_cur(nlist),
+          codes(nlist),
+          ids(nlist),
+          code_norms(snorm ? nlist : 0) {
     for (int i = 0; i < nlist; i++) {
         list_cur[i].store(0);
     }
@@ -494,14 +529,11 @@ void ConcurrentArrayInvertedLists::reserve(size_t list_no, size_t capacity) {
     size_t target_segment_no = cal_segment_num(capacity);
 
     for (size_t idx = cur_segment_no; idx < target_segment_no; idx++) {
-        Segment<uint8_t> segment_codes(segment_size, code_size);
-        Segment<idx_t> segment_ids(segment_size, 1);
-        Segment<float> segment_code_norms(segment_size, 1);
-        codes[list_no].emplace_back(std::move(segment_codes));
+        codes[list_no].emplace_back(segment_size, code_size);
         if (save_norm) {
-            code_norms[list_no].emplace_back(std::move(segment_code_norms));
+            code_norms[list_no].emplace_back(segment_size, 1);
         }
-        ids[list_no].emplace_back(std::move(segment_ids));
+        ids[list_no].emplace_back(segment_size, 1);
     }
 }
 
@@ -520,7 +552,7 @@ void ConcurrentArrayInvertedLists::shrink_to_fit(size_t list_no, size_t capacity
 
 size_t ConcurrentArrayInvertedLists::list_size(size_t list_no) const {
     assert(list_no < nlist);
-    return list_cur[list_no].load();
+    return list_cur[list_no].load(std::memory_order_acquire);
 }
 
 const uint8_t* ConcurrentArrayInvertedLists::get_codes(size_t list_no) const {
@@ -540,6 +572,8 @@ size_t ConcurrentArrayInvertedLists::add_entries(
         return 0;
 
     assert(list_no < nlist);
+    // the entries are written first and published by the length of the list,
+    //   in chunks of at most a segment
     size_t o = list_size(list_no);
 
     reserve(list_no, o + n_entry);
@@ -556,7 +590,7 @@ size_t ConcurrentArrayInvertedLists::add_entries(
                     n_entry * sizeof(float));
         }
         std::memcpy(&codes[list_no][first_id][first_cur], codes_in, n_entry * code_size);
-        list_cur[list_no].fetch_add(n_entry);
+        list_cur[list_no].fetch_add(n_entry, std::memory_order_release);
         return o;
     }
 
@@ -573,7 +607,7 @@ size_t ConcurrentArrayInvertedLists::add_entries(
     memcpy(&codes[list_no][first_id][first_cur],
            codes_in,
            first_rest * code_size);
-    list_cur[list_no].fetch_add(first_rest);
+    list_cur[list_no].fetch_add(first_rest, std::memory_order_release);
 
     auto rest_entry = n_entry - first_rest;
     auto entry_cur  = first_rest;
@@ -593,7 +627,8 @@ size_t ConcurrentArrayInvertedLists::add_entries(
             memcpy(&ids[list_no][segment_id][0],
                    ids_in + entry_cur,
                    segment_size * sizeof(ids_in[0]));
-            list_cur[list_no].fetch_add(segment_size);
+            list_cur[list_no].fetch_add(
+                    segment_size, std::memory_order_release);
 
             entry_cur += segment_size;
             rest_entry -= segment_size;
@@ -609,7 +644,7 @@ size_t ConcurrentArrayInvertedLists::add_entries(
             memcpy(&ids[list_no][segment_id][0],
                    ids_in + entry_cur,
                    rest_entry * sizeof(ids_in[0]));
-            list_cur[list_no].fetch_add(rest_entry);
+            list_cur[list_no].fetch_add(rest_entry, std::memory_order_release);
 
             entry_cur += rest_entry;
             rest_entry -= rest_entry;
@@ -703,14 +738,14 @@ void ConcurrentArrayInvertedLists::resize(size_t list_no, size_t new_size) {
 }
 size_t ConcurrentArrayInvertedLists::get_segment_num(size_t list_no) const {
     assert(list_no < nlist);
-    auto o = list_cur[list_no].load();
+    auto o = list_cur[list_no].load(std::memory_order_acquire);
     return (o / segment_size) + (o % segment_size != 0);
 }
 size_t ConcurrentArrayInvertedLists::get_segment_size(
         size_t list_no,
         size_t segment_no) const {
     assert(list_no < nlist);
-    auto o = list_cur[list_no].load();
+    auto o = list_cur[list_no].load(std::memory_order_acquire);
     if (segment_no == 0 && o == 0) {
         return 0;
     }
@@ -727,7 +762,7 @@ size_t ConcurrentArrayInvertedLists::get_segment_offset(
         size_t list_no,
         size_t segment_no) const {
     assert(list_no < nlist);
-    auto o = list_cur[list_no].load();
+    auto o = list_cur[list_no].load(std::memory_order_acquire);
     auto seg_o = cal_segment_num(o);
     assert(segment_no < seg_o);
     return segment_size * segment_no;
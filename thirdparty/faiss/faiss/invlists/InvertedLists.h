@@ -381,7 +381,13 @@ struct ArrayInvertedLists : InvertedLists {
     ~ArrayInvertedLists() override;
 };
 
-// A Concurrent implementation for inverted lists
+// A Concurrent implementation for inverted lists.
+// The lists are append-only: a single writer per list appends entries while
+// searches read the lists without taking any lock. The writer fills the
+// entries first and then publishes the new length of the list with a release
+// store, a reader loads the length with an acquire and never looks past it,
+// so every entry it sees is complete. Shrinking, resizing down and reset need
+// exclusive access.
 struct ConcurrentArrayInvertedLists : InvertedLists {
     template <typename T>
     struct Segment {
@@ -401,6 +407,40 @@ struct ConcurrentArrayInvertedLists : InvertedLists {
         std::vector<T> data_;
     };
 
+    // The segments of a list. Segments never move once allocated, and the
+    // directory of segment pointers is never reallocated in place: when it is
+    // full, a grown copy is published and the previous one is retired, so a
+    // reader can keep indexing whichever directory it has loaded. The retired
+    // directories are freed with the table, they take a pointer per segment.
+    template <typename T>
+    struct SegmentTable {
+        SegmentTable() = default;
+        SegmentTable(const SegmentTable&) = delete;
+        SegmentTable& operator=(const SegmentTable&) = delete;
+
+        size_t size() const {
+            return num_segments.load(std::memory_order_acquire);
+        }
+        Segment<T>& operator[](size_t segment_no) {
+            return *directory.load(std::memory_order_acquire)[segment_no];
+        }
+        const Segment<T>& operator[](size_t segment_no) const {
+            return *directory.load(std::memory_order_acquire)[segment_no];
+        }
+
+        // for the writer of the list only
+        void emplace_back(size_t segment_size, size_t code_size);
+        // needs exclusive access
+        void pop_back();
+
+        std::atomic<Segment<T>**> directory{nullptr};
+        std::atomic<size_t> num_segments{0};
+        // owned by the writer
+        size_t capacity = 0;
+        std::vector<std::unique_ptr<Segment<T>*[]>> directories;
+        std::vector<std::unique_ptr<Segment<T>>> segments;
+    };
+
     ConcurrentArrayInvertedLists(size_t nlist, size_t code_size, size_t segment_size, bool save_normal);
 
     size_t cal_segment_num(size_t capacity) const;
@@ -447,10 +487,11 @@ struct ConcurrentArrayInvertedLists : InvertedLists {
 
     size_t segment_size;
     bool save_norm;
+    // the published length of every list
     std::vector<std::atomic<size_t>> list_cur;
-    std::vector<std::deque<Segment<uint8_t>>> codes;
-    std::vector<std::deque<Segment<idx_t>>> ids;
-    std::vector<std::deque<Segment<float>>> code_norms;
+    std::vector<SegmentTable<uint8_t>> codes;
+    std::vector<SegmentTable<idx_t>> ids;
+    std::vector<SegmentTable<float>> code_norms;
 };
 
 struct ReadOnlyArrayInvertedLists: InvertedLists {
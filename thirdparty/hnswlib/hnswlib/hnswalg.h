@@ -40,6 +40,7 @@
 #endif
 #include "knowhere/utils.h"
 #include "neighbor.h"
+#include "spin_lock.h"
 #include "visited_list_pool.h"
 
 #if defined(__SSE__)
@@ -209,7 +210,11 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     size_t cur_element_count;
     size_t size_data_per_element_;
     size_t size_links_per_element_;
-    size_t num_deleted_;
+    // elements marked deleted, and how many of them have been unlinked from the graph by consolidateDeleted
+    size_t num_deleted_ = 0;
+    size_t num_consolidated_ = 0;
+    // bit i is set if element i is deleted, sized lazily, laid out like knowhere::BitsetView
+    std::vector<uint8_t> deleted_;
 
     size_t M_;
     size_t maxM_;
@@ -222,7 +227,8 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     VisitedListPool* visited_list_pool_;
     std::mutex cur_element_count_guard_;
 
-    std::vector<std::mutex> link_list_locks_;
+    // one byte per element, guards the link lists of all the levels of the element during build
+    std::vector<SpinLock> link_list_locks_;
 
     // Locks to prevent race condition during update/insert of an element at same time.
     // Note: Locks for additions can also be used to prevent this race condition if the querying of KNN is not exposed
@@ -382,7 +388,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
             tableint curNodeNum = curr_el_pair.second;
 
-            std::unique_lock<std::mutex> lock(link_list_locks_[curNodeNum]);
+            std::unique_lock<SpinLock> lock(link_list_locks_[curNodeNum]);
 
             int* data;  // = (int *)(linkList0_ + curNodeNum * size_links_per_element0_);
             if (layer == 0) {
@@ -488,7 +494,8 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     searchBaseLayerST(tableint ep_id, const void* data_point, size_t ef, std::vector<bool>& visited,
                       const knowhere::BitsetView& bitset,
                       const knowhere::feder::hnsw::FederResultUniq& feder_result = nullptr,
-                      IteratorMinHeap* disqualified = nullptr, float accumulative_alpha = 1.0f) const {
+                      IteratorMinHeap* disqualified = nullptr, float accumulative_alpha = 1.0f,
+                      const std::function<bool()>& should_stop = nullptr) const {
         if (feder_result != nullptr) {
             feder_result->visit_info_.AddLevelVisitRecord(0);
         }
@@ -505,6 +512,9 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         auto add_search_candidate = [&](Neighbor n) { return retset.insert(n, disqualified); };
         size_t hops = 0;
         while (retset.has_next()) {
+            if (should_stop && hops > 0 && (hops % kStopCheckInterval) == 0 && should_stop()) {
+                break;
+            }
             searchBaseLayerSTNext<decltype(add_search_candidate), has_deletions, collect_metrics>(
                 data_point, retset.pop(), visited, accumulative_alpha, bitset, add_search_candidate, feder_result);
             hops++;
@@ -658,7 +668,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         }
 
         for (size_t idx = 0; idx < selectedNeighbors.size(); idx++) {
-            std::unique_lock<std::mutex> lock(link_list_locks_[selectedNeighbors[idx]]);
+            std::unique_lock<SpinLock> lock(link_list_locks_[selectedNeighbors[idx]]);
 
             linklistsizeint* ll_other;
             if (level == 0)
@@ -748,7 +758,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
         element_levels_.resize(new_max_elements);
 
-        std::vector<std::mutex>(new_max_elements).swap(link_list_locks_);
+        std::vector<SpinLock>(new_max_elements).swap(link_list_locks_);
 
         // Reallocate base layer
         char* data_level0_memory_new = (char*)realloc(data_level0_memory_, new_max_elements * size_data_per_element_);
@@ -899,10 +909,29 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                 input.read(linkLists_[i], linkListSize);
             }
         }
+
+        if ((size_t)input.offset() < input.size()) {
+            readBinaryPOD(input, num_deleted_);
+            readBinaryPOD(input, num_consolidated_);
+            deleted_.resize(deletedMaskSize());
+            input.read((char*)deleted_.data(), deleted_.size());
+        }
     }
 
     void
     saveIndex(knowhere::MemoryIOWriter& output) {
+        writeIndex(output);
+    }
+
+    // sizes the output of saveIndex() without writing anything
+    void
+    saveIndex(faiss::cppcontrib::knowhere::CountSizeIOWriter& output) {
+        writeIndex(output);
+    }
+
+    template <typename Writer>
+    void
+    writeIndex(Writer& output) {
         using knowhere::writeBinaryPOD;
         // write l2/ip calculator
         writeBinaryPOD(output, metric_type_);
@@ -940,6 +969,13 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                 output.write(linkLists_[i], linkListSize);
         }
 
+        // optional trailer, older readers stop before it and indexes without deletes do not write it
+        if (num_deleted_ > 0) {
+            writeBinaryPOD(output, num_deleted_);
+            writeBinaryPOD(output, num_consolidated_);
+            output.write((char*)deleted_.data(), deleted_.size());
+        }
+
         // output.close();
     }
 
@@ -1044,6 +1080,13 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                 input.read(linkLists_[i], linkListSize);
             }
         }
+
+        if (input.tellg() < input.total_) {
+            readBinaryPOD(input, num_deleted_);
+            readBinaryPOD(input, num_consolidated_);
+            deleted_.resize(deletedMaskSize());
+            input.read((char*)deleted_.data(), deleted_.size());
+        }
     }
 
 #ifdef KNOWHERE_WITH_CUVS
@@ -1250,7 +1293,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                 getNeighborsByHeuristic2(candidates, layer == 0 ? maxM0_ : maxM_);
 
                 {
-                    std::unique_lock<std::mutex> lock(link_list_locks_[neigh]);
+                    std::unique_lock<SpinLock> lock(link_list_locks_[neigh]);
                     linklistsizeint* ll_cur;
                     ll_cur = get_linklist_at_level(neigh, layer);
                     size_t candSize = candidates.size();
@@ -1278,7 +1321,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                 while (changed) {
                     changed = false;
                     unsigned int* data;
-                    std::unique_lock<std::mutex> lock(link_list_locks_[currObj]);
+                    std::unique_lock<SpinLock> lock(link_list_locks_[currObj]);
                     data = get_linklist_at_level(currObj, level);
                     int size = getListCount(data);
                     tableint* datal = (tableint*)(data + 1);
@@ -1325,7 +1368,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
     std::vector<tableint>
     getConnectionsWithLock(tableint internalId, int level) {
-        std::unique_lock<std::mutex> lock(link_list_locks_[internalId]);
+        std::unique_lock<SpinLock> lock(link_list_locks_[internalId]);
         unsigned int* data = get_linklist_at_level(internalId, level);
         int size = getListCount(data);
         std::vector<tableint> result(size);
@@ -1345,7 +1388,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             cur_element_count++;
         }
 
-        std::unique_lock<std::mutex> lock_el(link_list_locks_[cur_c]);
+        std::unique_lock<SpinLock> lock_el(link_list_locks_[cur_c]);
         int curlevel = (level > 0) ? level : getRandomLevel(mult_);
 
         element_levels_[cur_c] = curlevel;
@@ -1383,7 +1426,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
                     while (changed) {
                         changed = false;
                         unsigned int* data;
-                        std::unique_lock<std::mutex> lock(link_list_locks_[currObj]);
+                        std::unique_lock<SpinLock> lock(link_list_locks_[currObj]);
                         data = get_linklist(currObj, level);
                         int size = getListCount(data);
 
@@ -1516,7 +1559,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     std::vector<std::pair<dist_t, labeltype>>
     searchKnn(const void* query_data, size_t k, const knowhere::BitsetView bitset, const SearchParam* param = nullptr,
               const knowhere::feder::hnsw::FederResultUniq& feder_result = nullptr) const {
-        if (cur_element_count == 0 || bitset.count() == cur_element_count)
+        if (elementsInGraph() == 0 || bitset.count() == cur_element_count)
             return {};
 
         // do normalize for COSINE metric type
@@ -1549,7 +1592,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             double ratio = ((double)filtered_out_num) / bitset.size();
             knowhere::knowhere_hnsw_bitset_ratio.Observe(ratio);
 #endif
-            if (filtered_out_num >= (cur_element_count * kHnswSearchKnnBFFilterThreshold) ||
+            if (filteredOutInGraph(filtered_out_num) >= (elementsInGraph() * kHnswSearchKnnBFFilterThreshold) ||
                 k >= (cur_element_count - filtered_out_num) * kHnswSearchBFTopkThreshold) {
                 return searchKnnBF(query_data, k, bitset);
             }
@@ -1558,15 +1601,17 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         auto [currObj, vec_hash] = searchTopLayers(query_data, param, feder_result);
         NeighborSetDoublePopList retset;
         size_t ef = param ? param->ef_ : this->ef_;
+        const std::function<bool()> should_stop = param ? param->should_stop : nullptr;
         auto visited = visited_list_pool_->getFreeVisitedList();
         if (!bitset.empty()) {
-            retset = searchBaseLayerST<true, true>(currObj, query_data, std::max(ef, k), visited, bitset, feder_result);
+            retset = searchBaseLayerST<true, true>(currObj, query_data, std::max(ef, k), visited, bitset, feder_result,
+                                                   nullptr, 1.0f, should_stop);
         } else {
-            retset =
-                searchBaseLayerST<false, true>(currObj, query_data, std::max(ef, k), visited, bitset, feder_result);
+            retset = searchBaseLayerST<false, true>(currObj, query_data, std::max(ef, k), visited, bitset,
+                                                    feder_result, nullptr, 1.0f, should_stop);
         }
-        // switch to brute-force when insufficient k
-        if (retset.size() < k) {
+        // switch to brute-force when insufficient k, unless the request has been stopped
+        if (retset.size() < k && !(should_stop && should_stop())) {
             return searchKnnBF(query_data, k, bitset);
         }
         std::vector<std::pair<dist_t, labeltype>> result;
@@ -1591,9 +1636,10 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
     std::unique_ptr<IteratorWorkspace>
     getIteratorWorkspace(const void* query_data, const size_t ef, const knowhere::BitsetView& bitset) const {
-        auto accumulative_alpha = (bitset.count() >= (cur_element_count * kHnswSearchKnnBFFilterThreshold))
-                                      ? std::numeric_limits<float>::max()
-                                      : 1.0f;
+        auto accumulative_alpha =
+            (filteredOutInGraph(bitset.count()) >= (elementsInGraph() * kHnswSearchKnnBFFilterThreshold))
+                ? std::numeric_limits<float>::max()
+                : 1.0f;
         std::unique_ptr<int8_t[]> query_data_copy = nullptr;
         query_data_copy = std::make_unique<int8_t[]>(data_size_);
         std::memcpy(query_data_copy.get(), query_data, data_size_);
@@ -1617,7 +1663,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     getIteratorNextBatch(IteratorWorkspace* workspace,
                          const knowhere::feder::hnsw::FederResultUniq& feder_result = nullptr) const {
         workspace->dists.clear();
-        if (cur_element_count == 0 || workspace->bitset.count() == cur_element_count) {
+        if (elementsInGraph() == 0 || workspace->bitset.count() == cur_element_count) {
             return;
         }
         // TODO: add bruteforce
@@ -1629,11 +1675,11 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             if (has_deletions) {
                 retset = searchBaseLayerST<true, true>(currObj, query_data, workspace->ef, workspace->visited,
                                                        workspace->bitset, feder_result, &workspace->to_visit,
-                                                       workspace->accumulative_alpha);
+                                                       workspace->accumulative_alpha, workspace->param->should_stop);
             } else {
                 retset = searchBaseLayerST<false, true>(currObj, query_data, workspace->ef, workspace->visited,
                                                         workspace->bitset, feder_result, &workspace->to_visit,
-                                                        workspace->accumulative_alpha);
+                                                        workspace->accumulative_alpha, workspace->param->should_stop);
             }
             workspace->dists.reserve(retset.size());
             for (int i = 0; i < retset.size(); i++) {
@@ -1686,7 +1732,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
     searchRange(const void* query_data, float radius, const knowhere::BitsetView bitset,
                 const SearchParam* param = nullptr,
                 const knowhere::feder::hnsw::FederResultUniq& feder_result = nullptr) const {
-        if (cur_element_count == 0 || bitset.count() == cur_element_count) {
+        if (elementsInGraph() == 0 || bitset.count() == cur_element_count) {
             return {};
         }
 
@@ -1720,7 +1766,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             double ratio = ((double)filtered_out_num) / bitset.size();
             knowhere::knowhere_hnsw_bitset_ratio.Observe(ratio);
 #endif
-            if (filtered_out_num >= (cur_element_count * kHnswSearchRangeBFFilterThreshold) ||
+            if (filteredOutInGraph(filtered_out_num) >= (elementsInGraph() * kHnswSearchRangeBFFilterThreshold) ||
                 ef >= (cur_element_count - filtered_out_num) * kHnswSearchBFTopkThreshold) {
                 return searchRangeBF(query_data, radius, bitset);
             }
@@ -1783,7 +1829,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
             start_points = touched;
 
             for (tableint i = 0; i < cur_element_count; ++i) {
-                if (element_levels_[i] >= level) {
+                if (element_levels_[i] >= level && !isMarkedDeleted(i)) {
                     if (!visited[i]) {
                         if (level > 0) {  // for upper level, directly add edges since nodes num is usually small and
                                           // fast to search its neighbors
@@ -1853,7 +1899,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
 
             // try to connect candidate to the element
             // add an edge if there is space
-            std::unique_lock<std::mutex> lock(link_list_locks_[cand_id]);
+            std::unique_lock<SpinLock> lock(link_list_locks_[cand_id]);
             linklistsizeint* ll_cand = get_linklist_at_level(cand_id, level);
             size_t size = getListCount(ll_cand);
             tableint* data_cand = (tableint*)(ll_cand + 1);
@@ -1869,6 +1915,145 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         }
     }
 
+    size_t
+    deletedMaskSize() const {
+        return (cur_element_count + 7) / 8;
+    }
+
+    bool
+    isMarkedDeleted(tableint id) const {
+        return (id >> 3) < deleted_.size() && (deleted_[id >> 3] & (0x1 << (id & 0x7)));
+    }
+
+    // returns false if id is already deleted. The element keeps its slot and id, searches skip it once the caller
+    // adds getDeletedMask() to the bitset, and it is still used to route the graph search until consolidateDeleted.
+    bool
+    markDeleted(tableint id) {
+        if (id >= cur_element_count) {
+            throw std::runtime_error("id " + std::to_string(id) + " out of range");
+        }
+        if (isMarkedDeleted(id)) {
+            return false;
+        }
+        deleted_.resize(deletedMaskSize());
+        deleted_[id >> 3] |= (0x1 << (id & 0x7));
+        num_deleted_++;
+        return true;
+    }
+
+    // nullptr if nothing was ever deleted, otherwise deletedMaskSize() bytes
+    const uint8_t*
+    getDeletedMask() const {
+        return num_deleted_ > 0 ? deleted_.data() : nullptr;
+    }
+
+    // the searches get a bitset that covers all the deleted elements, the consolidated ones are out of the graph
+    // and should not push the search towards brute force.
+    size_t
+    filteredOutInGraph(size_t filtered_out_num) const {
+        return filtered_out_num - std::min(filtered_out_num, num_consolidated_);
+    }
+
+    size_t
+    elementsInGraph() const {
+        return cur_element_count - num_consolidated_;
+    }
+
+    // Replaces the deleted neighbors of a live element at one level, FreshDiskANN style: the candidates are its
+    // live neighbors and the live neighbors of its deleted neighbors, pruned with the build heuristic. Returns false
+    // if the element had no deleted neighbor at this level. Only the list of cur_c is written, the lists of the
+    // deleted elements are only read, so all the live elements of a level can be repaired concurrently, but not
+    // concurrently with searches.
+    bool
+    repairDeletedNeighbors(tableint cur_c, int level) {
+        if (isMarkedDeleted(cur_c) || level > element_levels_[cur_c]) {
+            return false;
+        }
+        linklistsizeint* ll_cur = get_linklist_at_level(cur_c, level);
+        size_t size = getListCount(ll_cur);
+        tableint* data = (tableint*)(ll_cur + 1);
+        bool has_deleted = false;
+        for (size_t i = 0; i < size && !has_deleted; i++) {
+            has_deleted = isMarkedDeleted(data[i]);
+        }
+        if (!has_deleted) {
+            return false;
+        }
+
+        std::unordered_set<tableint> cand_set;
+        for (size_t i = 0; i < size; i++) {
+            tableint neigh = data[i];
+            if (!isMarkedDeleted(neigh)) {
+                cand_set.insert(neigh);
+                continue;
+            }
+            linklistsizeint* ll_del = get_linklist_at_level(neigh, level);
+            size_t del_size = getListCount(ll_del);
+            tableint* del_data = (tableint*)(ll_del + 1);
+            for (size_t j = 0; j < del_size; j++) {
+                if (del_data[j] != cur_c && !isMarkedDeleted(del_data[j])) {
+                    cand_set.insert(del_data[j]);
+                }
+            }
+        }
+
+        std::priority_queue<std::pair<dist_t, tableint>, std::vector<std::pair<dist_t, tableint>>, CompareByFirst>
+            candidates;
+        for (auto cand : cand_set) {
+            candidates.emplace(calcDistance(cur_c, cand), cand);
+        }
+        std::vector<tableint> selected(getNeighborsByHeuristic2(candidates, level ? maxM_ : maxM0_));
+
+        std::unique_lock<SpinLock> lock(link_list_locks_[cur_c]);
+        setListCount(ll_cur, selected.size());
+        for (size_t i = 0; i < selected.size(); i++) {
+            data[i] = selected[i];
+        }
+        return true;
+    }
+
+    // Called once repairDeletedNeighbors has run on every live element at every level: no live element links to a
+    // deleted one anymore, so the lists of the deleted elements are cleared and their upper level lists freed. The
+    // level 0 slots are kept, the ids of the other elements must not change. Moves the entry point off a deleted
+    // element, to the live element with the highest level. With no live element left, the graph is reset to the
+    // empty one, the searches return nothing and the next addPoint starts a new graph.
+    void
+    finishConsolidation() {
+        if (mmap_enabled_) {
+            throw std::runtime_error("can not consolidate a mmapped index");
+        }
+        for (tableint i = 0; i < cur_element_count; i++) {
+            if (!isMarkedDeleted(i)) {
+                continue;
+            }
+            setListCount(get_linklist0(i), 0);
+            if (element_levels_[i] > 0) {
+                free(linkLists_[i]);
+                linkLists_[i] = nullptr;
+                element_levels_[i] = 0;
+            }
+        }
+        num_consolidated_ = num_deleted_;
+
+        if (isMarkedDeleted(enterpoint_node_)) {
+            int new_max_level = -1;
+            tableint new_entry = enterpoint_node_;
+            for (tableint i = 0; i < cur_element_count; i++) {
+                if (!isMarkedDeleted(i) && element_levels_[i] > new_max_level) {
+                    new_max_level = element_levels_[i];
+                    new_entry = i;
+                }
+            }
+            if (new_max_level >= 0) {
+                enterpoint_node_ = new_entry;
+                maxlevel_ = new_max_level;
+            } else {
+                enterpoint_node_ = -1;
+                maxlevel_ = -1;
+            }
+        }
+    }
+
     void
     checkIntegrity() {
         int connections_checked = 0;
@@ -1909,6 +2094,7 @@ class HierarchicalNSW : public AlgorithmInterface<dist_t> {
         ret += sizeof(*space_);
         ret += visited_list_pool_->size();
         ret += element_levels_.size() * sizeof(int);
+        ret += deleted_.size();
         ret += max_elements_ * size_data_per_element_;
         ret += max_elements_ * sizeof(void*);
         for (auto i = 0; i < max_elements_; ++i) {
@@ -126,6 +126,7 @@ AVX512Capable() {
 #include <string.h>
 
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <optional>
 #include <queue>
@@ -176,8 +177,13 @@ class SpaceInterface {
 
 struct SearchParam {
     size_t ef_;
+    // an optional check for a cancelled or timed out request, polled every kStopCheckInterval hops of the level 0
+    // traversal. Once it returns true, the traversal ends and the candidates found so far are kept.
+    std::function<bool()> should_stop = nullptr;
 };
 
+constexpr size_t kStopCheckInterval = 64;
+
 struct IteratorWorkspace {
     IteratorWorkspace(std::unique_ptr<int8_t[]> query_data_sq, const size_t num_elements, const size_t ef,
                       std::unique_ptr<int8_t[]> raw_query_data, const knowhere::BitsetView& bitset,
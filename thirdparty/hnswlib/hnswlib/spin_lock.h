@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace hnswlib {
+
+// One byte lock for the per element link lists. std::mutex takes 40 bytes, which adds up to a large part of the
+// graph on big builds, and its futex path is slower than spinning for the short critical sections around a link
+// list. Meets the Lockable requirements, so it works with std::unique_lock and std::lock_guard.
+class SpinLock {
+ public:
+    SpinLock() = default;
+    SpinLock(const SpinLock&) = delete;
+    SpinLock&
+    operator=(const SpinLock&) = delete;
+
+    void
+    lock() {
+        while (locked_.exchange(1, std::memory_order_acquire)) {
+            // wait on a plain load so that the cache line stays shared until the holder releases it
+            int spins = 0;
+            while (locked_.load(std::memory_order_relaxed)) {
+                if (++spins < kSpinsBeforeYield) {
+                    pause();
+                } else {
+                    // the holder may be inserting a whole element, give the core away
+                    std::this_thread::yield();
+                    spins = 0;
+                }
+            }
+        }
+    }
+
+    bool
+    try_lock() {
+        return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(1, std::memory_order_acquire);
+    }
+
+    void
+    unlock() {
+        locked_.store(0, std::memory_order_release);
+    }
+
+ private:
+    static constexpr int kSpinsBeforeYield = 64;
+
+    static void
+    pause() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    std::atomic<uint8_t> locked_{0};
+};
+
+static_assert(sizeof(SpinLock) == 1);
+
+}  // namespace hnswlib